@@ -296,6 +296,44 @@ typedef enum
 	MSTP_TCM_ACTIVE
 } MSTP_TCM_STATE;
 
+/*
+ * state machine gates that can be scheduled through the mstp work queue.
+ * the per instance port machines come first, their value is the bit used
+ * in MSTP_COMMON_PORT.schedPending.
+ */
+typedef enum
+{
+	MSTP_SCHED_PIM = 0,
+	MSTP_SCHED_PRT,
+	MSTP_SCHED_PRT2,
+	MSTP_SCHED_PST,
+	MSTP_SCHED_TCM,
+	MSTP_SCHED_PRS,
+	MSTP_SCHED_PTX,
+	MSTP_SCHED_MAX
+} MSTP_SCHED_SM;
+
+typedef struct
+{
+	// number of times the work queue was drained to a fixed point
+	UINT32                  runs;
+
+	// gates executed from the work queue, per state machine
+	UINT32                  executed[MSTP_SCHED_MAX];
+
+	// signals dropped because the gate was already queued
+	UINT32                  deduped;
+
+	// largest number of gates executed by a single run
+	UINT32                  max_run;
+
+	// deepest the queue has been
+	UINT32                  max_depth;
+
+	// runs aborted after MSTP_SCHED_RUN_LIMIT gates
+	UINT32                  overflows;
+} MSTP_SCHED_STATS;
+
 /* Vlan port DBs structure */
 typedef struct
 {
@@ -342,8 +380,11 @@ typedef struct
 	// mstid associated with this bridge - 0 for cist, 1-4094 for msti
 	UINT16                  mstid:12;
 
-	// spare bits
-	UINT16                  spare:2;
+	// port role selection gate is queued in the mstp work queue
+	UINT16                  schedPending:1;
+
+	// roles of the last role selection are valid for incremental selection
+	UINT16                  rolesValid:1;
 
 	// root port for the bridge
 	PORT_ID                 rootPortId;
@@ -351,6 +392,9 @@ typedef struct
 	// vlans that are members of this instance
 	VLAN_MASK               vlanmask;
 
+	// run encoded view of vlanmask, refreshed whenever vlanmask changes
+	VLAN_SET                vlanset;
+
 	// ports that are members of this instance
 	PORT_MASK               *portmask;
 
@@ -359,6 +403,11 @@ typedef struct
 
 	// port role selection state machine state
 	MSTP_PRS_STATE          prsState;
+
+	// ports whose port priority vector changed since the last role
+	// selection, reselectCount > MSTP_RESELECT_PORTS_MAX if too many did
+	UINT8                   reselectCount;
+	PORT_ID                 reselectPorts[MSTP_RESELECT_PORTS_MAX];
     
     PORT_MASK				*untag_mask;
 
@@ -398,7 +447,9 @@ typedef struct
 	UINT32                  tcProp:1;
 	UINT32                  updtInfo:1;
 	UINT32                  disputed:1;
-	UINT32                  spareBits:11;
+	// gates queued in the mstp work queue, one bit per MSTP_SCHED_SM
+	UINT32                  schedPending:5;
+	UINT32                  spareBits:6;
 
 	MSTP_INFOIS             infoIs;
 	MSTP_RCVD_INFO          rcvdInfo;
@@ -647,8 +698,8 @@ typedef struct
 	// mstp configuration identifier
 	MSTP_CONFIG_IDENTIFIER  mstConfigId;
 
-	// to word align
-	UINT8                   pad;
+	// mstid_table changed since config_digest was last computed
+	UINT8                   config_digest_dirty;
 
 	// common spanning tree bridge information
 	MSTP_CIST_BRIDGE         cist;
@@ -680,7 +731,8 @@ typedef struct
 	UINT32                  tcAck:1;
 	UINT32                  restrictedRole:1;
 	UINT32                  bpdu_guard_active:1;
-	UINT32                  unusedBits:15;
+	UINT32                  schedPtx:1;
+	UINT32                  unusedBits:14;
 
 	// number of packets transmitted in the last second
 	UINT16                  txCount;
@@ -712,6 +764,11 @@ typedef struct
 	// bpdu receive and send statistics for the port
 	struct { MSTP_BPDU_STATS rx,tx;} stats;
 
+	// raw copy of the last bpdu fully processed on the port, rxCacheLen is
+	// 0 if there is none
+	UINT8                   *rxCache;
+	UINT16                  rxCacheLen;
+
 	// mask of the set of mstp index that are currently configured (excluding cist)
 	L2_PROTO_INSTANCE_MASK  instance_mask;
 
@@ -744,6 +801,19 @@ typedef struct
 	
 	// to word align.
 	UINT8                   pad;
+
+	// work deferred by an open config transaction
+	UINT8                   txn_restart_pending:1;
+	UINT8                   txn_refresh_all:1;
+	UINT8                   txn_refresh_bpdu:1;
+	UINT8                   txn_spare:5;
+	L2_PROTO_INSTANCE_MASK  txn_refresh_mask;
+
+	// state machine work queue statistics
+	MSTP_SCHED_STATS        sched_stats;
+
+	// bpdus handled by the repeated bpdu fast path
+	UINT32                  rx_repeated;
  } MSTP_GLOBAL;
 
 
@@ -22,6 +22,9 @@
 #define MSTP_MIN_INSTANCES                  1
 #define MSTP_MAX_INSTANCES_PER_REGION		64
 
+// ports tracked per tree for incremental role selection
+#define MSTP_RESELECT_PORTS_MAX             8
+
 #define MSTP_BPDU_BASE_SIZE                 38
 #define MSTP_BPDU_BASE_V3_LENGTH            64
 
@@ -47,6 +50,15 @@ typedef struct
 
 }__attribute__((__packed__)) MSTP_BRIDGE_IDENTIFIER;
 
+/* 64-bit comparison keys (see STP_BRIDGE_KEY). msti bridge ids compare on
+ * the priority only, the system id being the mstid of the instance. */
+#define MSTP_CIST_BRIDGE_KEY(_id_) \
+	STP_BRIDGE_KEY(((_id_)->priority << 12) | (_id_)->system_id, &(_id_)->address)
+#define MSTP_MSTI_BRIDGE_KEY(_id_) \
+	STP_BRIDGE_KEY((_id_)->priority << 12, &(_id_)->address)
+#define MSTP_PORT_KEY(_port_) \
+	((UINT16) (((_port_)->priority << 12) | (_port_)->number))
+
 /*****************************************************************************/
 /* msti configuration message structure                                      */
 /*****************************************************************************/
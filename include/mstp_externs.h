@@ -48,10 +48,12 @@ extern void mstp_prs_gate(MSTP_INDEX mstp_index);
 /* mstp_prt.c */
 extern void mstp_prt_init(MSTP_INDEX mstp_index, PORT_ID port_number);
 extern void mstp_prt_gate(MSTP_INDEX mstp_index, PORT_ID port_number);
+extern void mstp_prt_gate2(MSTP_INDEX mstp_index, PORT_ID port_number);
 
 /* mstp_prx.c */
 extern void mstp_prx_init(PORT_ID port_number);
 extern void mstp_prx_gate(PORT_ID port_number, MSTP_BPDU *bpdu);
+extern bool mstp_prx_repeated(PORT_ID port_number, MSTP_BPDU *bpdu);
 
 /* mstp_pst.c */
 extern void mstp_pst_init(MSTP_INDEX mstp_index, PORT_ID port_number);
@@ -62,6 +64,10 @@ extern void mstp_pst_action(MSTP_INDEX mstp_index, PORT_ID port_number);
 extern void mstp_ptx_init(PORT_ID port_number);
 extern void mstp_ptx_gate(PORT_ID port_number);
 
+/* mstp_sched.c */
+extern void mstp_sched_gate(MSTP_SCHED_SM sm, MSTP_INDEX mstp_index, PORT_ID port_number);
+extern void mstp_sched_run();
+
 /* mstp_tcm.c */
 extern void mstp_tcm_init(MSTP_INDEX mstp_index, PORT_ID port_number);
 extern void mstp_tcm_gate(MSTP_INDEX mstp_index, PORT_ID port_number);
@@ -122,6 +128,7 @@ extern bool mstp_betterorsameInfoCist(MSTP_INDEX mstp_index, PORT_ID port_number
 extern bool mstp_betterorsameInfoMsti(MSTP_INDEX mstp_index, PORT_ID port_number, MSTP_INFOIS newInfoIs);
 extern void mstp_clearAllRcvdMsgs(PORT_ID port_number);
 extern void mstp_setReselectTree(MSTP_INDEX mstp_index);
+extern void mstp_setReselectPort(MSTP_INDEX mstp_index, PORT_ID port_number);
 extern void mstp_clearReselectTree(MSTP_INDEX mstp_index);
 extern void mstp_disableForwarding(MSTP_INDEX mstp_index, PORT_ID port_number);
 extern void mstp_disableLearning(MSTP_INDEX mstp_index, PORT_ID port_number);
@@ -170,6 +177,7 @@ extern void mstputil_get_default_name(UINT8 * name, UINT32 name_length);
 extern UINT8 * mstputil_bridge_to_string(MSTP_BRIDGE_IDENTIFIER * bridge_id, UINT8 * buffer, UINT16 size);
 extern void mstputil_port_to_string(MSTP_PORT_IDENTIFIER *portId, UINT8 *buffer, UINT16 size);
 extern void mstputil_compute_message_digest(bool print);
+extern void mstputil_update_message_digest();
 extern bool mstputil_computeReselect(MSTP_INDEX mstp_index);
 extern bool mstputil_setReselectAll(PORT_ID port_number);
 extern void mstputil_set_changedMaster(MSTP_PORT *mstp_port);
@@ -232,6 +240,8 @@ extern void mstpmgr_clear_statistics_all();
 extern void mstpmgr_clear_port_statistics(PORT_ID port_number);
 extern bool mstpmgr_config_msti_priority(MSTP_MSTID mstid, UINT16 priority);
 extern bool mstpmgr_refresh_all();
+extern void mstpmgr_config_txn_apply();
+extern void mstpmgr_config_txn_refresh();
 extern void mstpmgr_instance_init_port_state_machines(MSTP_INDEX mstp_index, PORT_ID port_number);
 
 #endif //  __MSTP_EXTERNS_H__
\ No newline at end of file
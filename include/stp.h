@@ -29,6 +29,15 @@
 
 #define STP_DFLT_HOLD_TIME 1
 
+/*
+ * stptimer_tick() services the stp classes in STP_TICK_GROUPS groups, one
+ * group per 100 ms tick. hello slots are the class ticks (500 ms) of the
+ * hello interval in which a root bridge class transmits its hellos.
+ */
+#define STP_TICK_GROUPS 5
+#define STP_HELLO_MAX_SLOTS (STP_MAX_HELLO_TIME << 1)
+#define STP_DFLT_HELLO_SLOTS (STP_DFLT_HELLO_TIME << 1)
+
 #define STP_DFLT_ROOT_PROTECT_TIMEOUT 30
 #define STP_MIN_ROOT_PROTECT_TIMEOUT 5
 #define STP_MAX_ROOT_PROTECT_TIMEOUT 600
@@ -82,10 +91,11 @@
 #define g_stp_tick_id stp_global.tick_id
 #define g_stp_bpdu_sync_tick_id stp_global.bpdu_sync_tick_id
 
-#define g_stp_config_bpdu stp_global.config_bpdu
-#define g_stp_tcn_bpdu stp_global.tcn_bpdu
-#define g_stp_pvst_config_bpdu stp_global.pvst_config_bpdu
-#define g_stp_pvst_tcn_bpdu stp_global.pvst_tcn_bpdu
+/* bpdus are encoded in the buffers of the calling thread, see g_stp_bpdu_bufs */
+#define g_stp_config_bpdu g_stp_bpdu_bufs->config_bpdu
+#define g_stp_tcn_bpdu g_stp_bpdu_bufs->tcn_bpdu
+#define g_stp_pvst_config_bpdu g_stp_bpdu_bufs->pvst_config_bpdu
+#define g_stp_pvst_tcn_bpdu g_stp_bpdu_bufs->pvst_tcn_bpdu
 
 #define g_fastspan_mask stp_global.fastspan_mask
 #define g_fastspan_config_mask stp_global.fastspan_admin_mask
@@ -99,6 +109,7 @@
 #define g_stp_enable_config_mask stp_global.enable_admin_mask
 
 #define g_stp_invalid_port_name stp_global.invalid_port_name
+#define g_stp_txn_class_mask stp_global.txn_class_mask
 
 #define STP_GET_MIN_PORT_PATH_COST ((UINT32)(g_stpd_extend_mode ? STP_MIN_PORT_PATH_COST : STP_LEGACY_MIN_PORT_PATH_COST))
 #define STP_GET_MAX_PORT_PATH_COST ((UINT32)(g_stpd_extend_mode ? STP_MAX_PORT_PATH_COST : STP_LEGACY_MAX_PORT_PATH_COST))
@@ -253,11 +264,28 @@ typedef struct
 	UINT32 modified_fields;
 } __attribute__((aligned(4))) BRIDGE_DATA;
 
+/*
+ * tournament tree over the enabled ports of an stp class, used by root
+ * selection. the leaves (node[size + port]) hold the port number if the port
+ * can be the root port and STP_INVALID_PORT otherwise, each internal node
+ * holds the better of its two children, so node[1] is the root port.
+ */
+typedef struct
+{
+	UINT32 size;            // number of leaves, power of 2
+	UINT8 valid : 1;
+	UINT8 spare : 7;
+	UINT8 changed_count;    // ports changed since the last configuration update (saturates at 2)
+	PORT_ID changed_port;
+	UINT16 *node;
+} STP_ROOT_TREE;
+
 typedef struct
 {
 	VLAN_ID vlan_id; // UINT16
 	UINT16 fast_aging : 1;
-	UINT16 spare : 11;
+	UINT16 hello_scheduled : 1;
+	UINT16 spare : 10;
 	UINT16 state : 4; /* encode using enum STP_CLASS_STATE */
 	BRIDGE_DATA bridge_info;
 
@@ -265,9 +293,13 @@ typedef struct
 	PORT_MASK *control_mask;
 	PORT_MASK *untag_mask;
 
+	STP_ROOT_TREE *root_tree;
+
 	TIMER hello_timer;
 	TIMER tcn_timer;
 	TIMER topology_change_timer;
+	UINT8 hello_slot;   /* hello slot of the class while hello_scheduled */
+	UINT16 hello_load;  /* ports accounted to hello_slot */
 	UINT32 last_expiry_time;  /* for RAS to log delay events */
 	UINT32 last_bpdu_rx_time; /* for RAS to log Rx delay events */
 	UINT32 rx_drop_bpdu;
@@ -338,6 +370,14 @@ typedef struct
 	UINT32 modified_fields;
 } __attribute__((aligned(4))) STP_PORT_CLASS;
 
+typedef struct
+{
+	STP_CONFIG_BPDU config_bpdu;
+	STP_TCN_BPDU tcn_bpdu;
+	PVST_CONFIG_BPDU pvst_config_bpdu;
+	PVST_TCN_BPDU pvst_tcn_bpdu;
+} STP_BPDU_BUFS;
+
 typedef struct
 {
 	UINT16 max_instances;
@@ -346,10 +386,8 @@ typedef struct
 	STP_CLASS *class_array;
 	STP_PORT_CLASS *port_array;
 
-	STP_CONFIG_BPDU config_bpdu;
-	STP_TCN_BPDU tcn_bpdu;
-	PVST_CONFIG_BPDU pvst_config_bpdu;
-	PVST_TCN_BPDU pvst_tcn_bpdu;
+	// templates, copied to the buffers of each sharded worker (stp_shard.c)
+	STP_BPDU_BUFS bpdu_bufs;
 
 	UINT8 tick_id;
 	UINT8 bpdu_sync_tick_id;
@@ -374,12 +412,25 @@ typedef struct
 	uint16_t root_protect_timeout;
 	L2_PROTO_MODE proto_mode;
 
+	// hello slots per interval, 0 or 1 sends all hellos of a group together
+	UINT8 hello_slots;
+	// incremented each time all tick groups have been serviced
+	UINT32 hello_round;
+	// ports transmitting hellos in each slot of each tick group
+	UINT32 hello_load[STP_TICK_GROUPS][STP_HELLO_MAX_SLOTS];
+
+	// incremented with STP_DROP_COUNT_INC(), also from sharded workers
 	UINT32 stp_drop_count;
 	UINT32 tcn_drop_count;
 	UINT32 pvst_drop_count;
 	char invalid_port_name[IFNAMSIZ];
+
+	// stp classes to recompute when the open config transaction commits
+	BITMAP_T *txn_class_mask;
 } __attribute__((aligned(4))) STP_GLOBAL;
 
+#define STP_DROP_COUNT_INC(counter) __atomic_add_fetch(&stp_global.counter, 1, __ATOMIC_RELAXED)
+
 #define INVALID_STP_PARAM ((UINT32)0xffffffff)
 
 /*Below ENUM for RAS STP, please update "stp_ras_state_string" structure when you are adding new event here*/
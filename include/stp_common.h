@@ -28,6 +28,16 @@ typedef enum SORT_RETURN
 	GREATER_THAN = 1
 } SORT_RETURN;
 
+/* branch free three way compare of two unsigned values */
+#define STP_SORT(_a_, _b_) ((SORT_RETURN) (((_a_) > (_b_)) - ((_a_) < (_b_))))
+
+/* host order mac address as a 48-bit integer */
+#define STP_MAC_KEY(_mac_) ((((uint64_t) (_mac_)->_ulong) << 16) | (_mac_)->_ushort)
+
+/* bridge identifier as a 64-bit integer, 16-bit priority field above the mac,
+ * so that priority vectors compare with one integer compare per bridge id */
+#define STP_BRIDGE_KEY(_prio_, _mac_) ((((uint64_t) (_prio_)) << 48) | STP_MAC_KEY(_mac_))
+
 #define STP_VERSION_ID      0
 #define RSTP_VERSION_ID     2
 #define MSTP_VERSION_ID     3
@@ -42,6 +52,11 @@ typedef enum SORT_RETURN
 #define IS_STP_MAC(_mac_ptr_) (SAME_MAC_ADDRESS((_mac_ptr_), &bridge_group_address))
 #define IS_PVST_MAC(_mac_ptr_) (SAME_MAC_ADDRESS((_mac_ptr_), &pvst_bridge_group_address))
 
+/* Log-linear usec histogram, see stp_rxlat.c */
+#define STPD_HIST_SUB_BITS      2
+#define STPD_HIST_SUB           (1 << STPD_HIST_SUB_BITS)
+#define STPD_HIST_BUCKETS       (STPD_HIST_SUB + ((32 - STPD_HIST_SUB_BITS) * STPD_HIST_SUB))
+
 /*****************************************************************************/
 /* enum definitions                                                          */
 /*****************************************************************************/
@@ -57,6 +72,33 @@ typedef enum STP_BPDU_TYPE
 /* structure definitions                                                     */
 /*****************************************************************************/
 
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum;
+    uint32_t max;
+    uint32_t bucket[STPD_HIST_BUCKETS];
+}STPD_HIST;
+
+/* Sharded PVST workers, see stp_shard.c */
+#define STPD_SHARD_MAX          8
+
+//runs the part of a sharded phase of worker shard out of shards
+typedef void (STPD_SHARD_FN)(uint32_t shard, uint32_t shards, void *arg);
+
+typedef struct
+{
+    uint32_t workers;
+    uint64_t phases;
+    uint64_t phase_usec;        //fork to join
+    uint64_t crit_usec;         //sum over phases of the busiest worker
+    uint64_t busy_usec[STPD_SHARD_MAX];
+    uint64_t rx_frames[STPD_SHARD_MAX];
+    uint64_t tx_frames[STPD_SHARD_MAX];
+    uint64_t rx_inline;         //processed by the event loop thread
+    uint64_t rx_full;           //phases started by a full rx batch
+}STPD_SHARD_STATS;
+
 typedef struct BRIDGE_BPDU_FLAGS
 {
 #if __BYTE_ORDER == __BIG_ENDIAN
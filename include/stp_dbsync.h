@@ -150,6 +150,8 @@ extern void stpsync_del_mst_port_info(char *if_name, uint16_t mst_id);
 extern void stpsync_update_boundary_port(char *ifName, bool enabled,
         char *proto);
 extern void stpsync_flush_instance_port(char *ifName, uint16_t instance);
+extern void stpsync_set_buffered(bool buffered);
+extern void stpsync_flush(void);
 
 #ifdef __cplusplus
 } /* extern "C" */
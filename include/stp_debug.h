@@ -16,6 +16,7 @@ extern FILE *dbgfp;
 
 extern void stpdbg_dump_nl_db();
 extern void stpdbg_dump_stp_stats();
+extern void stpdbg_dump_mempool_stats();
 extern void stpdbg_dump_nl_db_intf(char *name);
 
 #endif //__STP_DEBUG_H__
@@ -21,6 +21,7 @@
 /* variable declarations */
 extern struct STPD_CONTEXT stpd_context;
 extern STP_GLOBAL stp_global;
+extern __thread STP_BPDU_BUFS *g_stp_bpdu_bufs;
 extern uint32_t g_max_stp_port;
 extern uint16_t g_stp_bmp_po_offset;
 extern MAC_ADDRESS bridge_group_address;
@@ -93,8 +94,10 @@ extern void stpmgr_set_extend_mode(bool enable);
 extern void stpmgr_port_event(PORT_ID port_number, bool up);
 extern void stpmgr_100ms_timer(evutil_socket_t fd, short what, void *arg);
 extern void stpmgr_recv_client_msg(evutil_socket_t fd, short what, void *arg);
+extern void stpmgr_config_txn_commit();
+extern void stpmgr_config_txn_tick();
 extern struct event *stpmgr_libevent_create(struct event_base *base, evutil_socket_t sock, short flags, 
-        void *cb_fn, void *arg, const struct timeval *timeout);
+        void *cb_fn, void *arg, const struct timeval *timeout, const char *name);
 extern void stpmgr_process_rx_bpdu(uint16_t vlan_id, uint32_t port_id, unsigned char *pkt);
 extern void stpmgr_libevent_destroy(struct event *ev);
 extern void stpmgr_clear_statistics(VLAN_ID vlan_id, PORT_ID port_number);
@@ -114,6 +117,13 @@ extern bool stputil_get_index_from_vlan(VLAN_ID vlan_id, STP_INDEX *stp_index);
 extern enum SORT_RETURN stputil_compare_mac(MAC_ADDRESS *mac1, MAC_ADDRESS *mac2);
 extern enum SORT_RETURN stputil_compare_bridge_id(BRIDGE_IDENTIFIER *id1, BRIDGE_IDENTIFIER *id2);
 extern enum SORT_RETURN stputil_compare_port_id(PORT_IDENTIFIER *port_id1,PORT_IDENTIFIER *port_id2);
+extern enum SORT_RETURN stputil_compare_root_candidate(STP_CLASS *stp_class, PORT_ID port1, PORT_ID port2);
+extern void stputil_root_tree_update(STP_CLASS *stp_class, PORT_ID port_number);
+extern void stputil_root_tree_invalidate(STP_CLASS *stp_class);
+extern void stputil_root_tree_free(STP_CLASS *stp_class);
+extern PORT_ID stputil_get_root_port(STP_CLASS *stp_class);
+extern bool stputil_root_tree_incremental(STP_CLASS *stp_class, PORT_ID *port_number);
+extern void stputil_root_tree_clear_changes(STP_CLASS *stp_class);
 extern UINT16 stputil_get_bridge_priority(BRIDGE_IDENTIFIER * id);
 extern void stputil_set_bridge_priority(BRIDGE_IDENTIFIER * id, UINT16 priority, VLAN_ID vlan_id);
 extern bool stputil_is_same_bridge_priority(BRIDGE_IDENTIFIER * id1, UINT16 priority);
@@ -134,10 +144,25 @@ extern void stputil_sync_port_counters(STP_CLASS *stp_class, STP_PORT_CLASS * st
 extern void stptimer_sync_db(STP_CLASS *stp_class);
 extern void stptimer_start(TIMER *sptr_timer, UINT32 start_value_in_seconds);
 extern void stptimer_stop(TIMER *sptr_timer);
+extern void stptimer_start_hello(STP_CLASS *stp_class);
+extern void stptimer_stop_hello(STP_CLASS *stp_class);
+extern void stptimer_hello_port_update(STP_CLASS *stp_class, bool add);
+extern void stptimer_set_hello_slots(UINT8 slots);
 extern bool stptimer_expired(TIMER *timer, UINT32 timer_limit_in_seconds);
 extern bool stptimer_is_active(TIMER * timer);
 extern int mask_to_string(BITMAP_T *bmp, uint8_t *str, uint32_t maxlen);
 extern void stptimer_100ms_tick(evutil_socket_t fd, short what, void *arg);
+extern uint64_t stptimer_prof_usec();
+extern uint64_t stptimer_prof_self_usec();
+extern void stptimer_prof_begin();
+extern void stptimer_prof_end();
+extern void stptimer_prof_add(STPD_TICK_PHASE phase, uint64_t usec);
+extern uint64_t stptimer_prof_start();
+extern void stptimer_prof_stop(STPD_TICK_PHASE phase, uint64_t start_usec);
+extern void stptimer_prof_top(bool is_port, uint16_t id, uint64_t usec);
+extern void stptimer_prof_set_overrun(uint32_t msec);
+extern void stptimer_prof_clear();
+extern void stptimer_prof_dump();
 extern int mask_to_string2(BITMAP_T *bmp, uint8_t *str, uint32_t maxlen);
 extern int vlanmask_to_string(BITMAP_T *mask, uint8_t *str, uint32_t maxlen);
 
@@ -160,6 +185,8 @@ extern void stpdm_port_class(STP_CLASS *stp_class, PORT_ID port_number);
 extern void stpdm_global();
 extern void stpdm_clear();
 extern void stpdbg_dump_stp_stats();
+extern void stpdbg_dump_mempool_stats();
+extern void stpdbg_set_log_module(char *name, int enable);
 
 
 extern void stp_show_debug_log (UINT16 instance_id, UINT16 print_count, UINT8 print_all);
@@ -172,6 +199,8 @@ extern void stp_delete_debug_instance (UINT16 instance_id);
 extern char* l2_port_state_to_string(uint8_t state, uint32_t port);
 
 //stp_intf.h
+extern MEMPOOL g_stpd_intf_node_pool;
+extern MEMPOOL_AVL_ALLOCATOR g_stpd_intf_avl_allocator;
 extern int stp_intf_get_netlink_fd();
 extern char * stp_intf_get_port_name(uint32_t port_id);
 extern bool stp_intf_is_port_up(int port_id);
@@ -186,7 +215,10 @@ extern uint32_t stp_intf_get_port_id_by_name(char *ifname);
 extern INTERFACE_NODE *stp_intf_get_node_by_name(char *ifname);
 extern struct event_base *stp_intf_get_evbase();
 extern int stp_intf_event_mgr_init(void);
+extern int stp_intf_init_port_stats();
+extern int stp_intf_init_po_id_pool();
 extern int stp_intf_avl_compare(const void *user_p, const void *data_p, void *param);
+extern int stp_intf_mst_info_avl_compare(const void *user_p, const void *data_p, void *param);
 extern void stp_intf_netlink_cb(struct netlink_db_s *if_db, uint8_t is_add, bool init_in_prog);
 extern void stp_intf_reset_port_params();
 
@@ -201,6 +233,37 @@ extern void stp_pkt_sock_close(INTERFACE_NODE *intf_node);
 extern int stp_pkt_sock_create(INTERFACE_NODE *intf_node);
 extern void stp_pkt_rx_handler (evutil_socket_t fd, short what, void *arg);
 extern int stp_pkt_tx_handler ( uint32_t kif_index, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged);
+extern void stp_pkt_tx_drain(evutil_socket_t fd, short what, void *arg);
+extern void stp_pkt_tx_set_rate(uint32_t rate, uint32_t burst);
+extern void stp_pkt_rx_process(INTERFACE_NODE *intf_node, uint32_t from_kif, uint16_t vlan_id, uint64_t rx_ns, char *pkt, ssize_t packet_len);
+extern uint64_t stp_pkt_cmsg_ns(struct cmsghdr *cmsg);
+extern int stp_pkt_io_init();
+extern bool stp_pkt_io_enabled();
+extern void stp_pkt_io_add_sock(int sock, uint32_t kif_index);
+extern void stp_pkt_io_del_sock(int sock);
+extern int stp_pkt_io_tx(uint32_t kif_index, char *buffer, uint16_t size);
+extern void stp_pkt_io_dump_stats();
+extern int stp_shard_init(uint32_t workers);
+extern bool stp_shard_enabled();
+extern void stp_shard_run(STPD_SHARD_FN *fn, void *arg);
+extern bool stp_shard_rx(uint32_t port_id, VLAN_ID vlan_id, char *pkt, ssize_t packet_len);
+extern void stp_shard_rx_flush();
+extern int stp_shard_tx(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged);
+extern void stp_shard_sync_lock();
+extern void stp_shard_sync_unlock();
+extern void stp_shard_get_stats(STPD_SHARD_STATS *stats);
+extern void stp_shard_dump_stats();
+extern void stpd_hist_add(STPD_HIST *hist, uint64_t usec);
+extern uint32_t stpd_hist_percentile(STPD_HIST *hist, uint32_t percent);
+extern void stpd_hist_dump_buckets(STPD_HIST *hist);
+extern void stp_rxlat_queued(uint32_t port_id, uint64_t rx_ns);
+extern void stp_rxlat_begin(uint32_t port_id, uint64_t rx_ns);
+extern void stp_rxlat_end(uint32_t port_id);
+extern uint64_t stp_rxlat_program_start();
+extern void stp_rxlat_program_end(uint64_t start_ns);
+extern void stp_rxlat_clear();
+extern void stp_rxlat_dump(char *ifname);
+extern void stp_shm_publish();
 extern void stpdbg_process_ctl_msg(void *msg);
 extern PORT_ID stp_intf_handle_po_preconfig(char * ifname);
 extern bool stputil_set_kernel_bridge_port_state(STP_CLASS * stp_class, STP_PORT_CLASS * stp_port_class);
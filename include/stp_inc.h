@@ -11,6 +11,8 @@
 #include "applog.h"
 #include "avl.h"
 #include "bitmap.h"
+#include "vlan_set.h"
+#include "mempool.h"
 #include "stp_netlink.h"
 
 #include <stdio.h>
@@ -31,6 +33,7 @@
 #include "stp_debug.h"
 #include "l2.h"
 #include "stp_timer.h"
+#include "stp_trace.h"
 #include "stp_intf.h"
 #include "stp_common.h"
 #include "stp_ipc.h"
@@ -79,13 +79,18 @@ typedef uint32_t PORT_ID;
 #define MAX_CONFIG_PORTS 16
 #define MSTP_MAX_INSTANCES 65               //MSTP_MAX_INSTANCES_PER_REGION+1
 
+//Per instance port priority/path cost override.
+//Overrides are rare, so they live in a sparse side table keyed by
+//(port_id, mstp_index) rather than in every INTERFACE_NODE.
 typedef struct
 {
     #define MSTP_PORT_PRI_FLAG          0x0001
     #define MSTP_PORT_PATH_COST_FLAG    0x0002
-    int8_t         flag;
-    uint16_t        priority;
+    uint32_t        port_id;
     uint32_t        path_cost;
+    uint16_t        mstp_index;
+    uint16_t        priority;
+    int8_t          flag;
 }MST_INFO;
 
 typedef struct
@@ -103,7 +108,6 @@ typedef struct
     uint16_t        priority;
     uint32_t        path_cost;
     int             sock;               //socket created for this kif_index
-    MST_INFO        mst_info[MSTP_MAX_INSTANCES];
     struct event *  ev;                 //libevent to handle this sock
 }INTERFACE_NODE;
 
@@ -134,6 +138,7 @@ struct netlink_db_s;
 
 BITMAP_T *static_portmask_init(STATIC_BITMAP_T *bmp);
 int stp_intf_avl_compare(const void *user_p, const void *data_p, void *param);
+int stp_intf_mst_info_avl_compare(const void *user_p, const void *data_p, void *param);
 void stp_intf_netlink_cb(struct netlink_db_s *if_db, uint8_t is_add, bool init_in_prog);
 char * stp_intf_get_port_name(uint32_t port_id);
 uint32_t stp_intf_get_port_id_by_kif_index(uint32_t kif_index);
@@ -37,6 +37,8 @@ typedef enum STP_MSG_TYPE
     STP_MST_INST_CONFIG,
     STP_MST_VLAN_PORT_LIST_CONFIG,
     STP_MST_INST_PORT_CONFIG,
+    STP_CONFIG_TXN_BEGIN,
+    STP_CONFIG_TXN_COMMIT,
     STP_MAX_MSG
 } STP_MSG_TYPE;
 
@@ -59,6 +61,12 @@ typedef enum STP_CTL_TYPE
     STP_CTL_CLEAR_VLAN_INTF,
     STP_CTL_DUMP_MST,
     STP_CTL_DUMP_MST_PORT,
+    STP_CTL_DUMP_MEMPOOL_STATS,
+    STP_CTL_SET_TX_RATE,
+    STP_CTL_DUMP_RX_LATENCY,
+    STP_CTL_SET_TICK_OVERRUN,
+    STP_CTL_SET_LOG_MODULE,
+    STP_CTL_SET_HELLO_SLOTS,
     STP_CTL_MAX
 } STP_CTL_TYPE;
 
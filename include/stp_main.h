@@ -31,11 +31,25 @@
 #define STP_LOG_SET_LEVEL   APP_LOG_SET_LEVEL
 #define STP_LOG_LEVEL_DEBUG APP_LOG_LEVEL_DEBUG
 #define STP_LOG_LEVEL_INFO  APP_LOG_LEVEL_INFO
+#define STP_LOG_IS_ENABLED  APP_LOG_IS_ENABLED
+
+/* log modules, enabled by stpctl logmod */
+typedef enum
+{
+    STP_LOG_MOD_PVST,
+    STP_LOG_MOD_MSTP,
+    STP_LOG_MOD_PKT,
+    STP_LOG_MOD_INTF,
+    STP_LOG_MOD_TIMER,
+    STP_LOG_MOD_MGR,
+    STP_LOG_MOD_LIB,
+    STP_LOG_MOD_MAX
+}STP_LOG_MODULE;
 
 /* Logs directed to /var/log/syslog */
-#define STP_SYSLOG(msg, ...) applog_write(APP_LOG_LEVEL_INFO, "STP_SYSLOG: "msg" ", ##__VA_ARGS__)
+#define STP_SYSLOG(msg, ...) APP_LOG_SITE_WRITE(APP_LOG_LEVEL_INFO, NULL, "STP_SYSLOG: "msg" ", ##__VA_ARGS__)
 
-#define STP_PKTLOG(msg, ...) applog_write(APP_LOG_LEVEL_INFO, "STP_PKT: "msg" ", ##__VA_ARGS__)
+#define STP_PKTLOG(msg, ...) APP_LOG_SITE_WRITE(APP_LOG_LEVEL_INFO, NULL, "STP_PKT: "msg" ", ##__VA_ARGS__)
 
 //forward declaration
 struct netlink_db_s;
@@ -48,6 +62,7 @@ struct netlink_db_s;
 #define g_stpd_netlink_cbuf_sz  stpd_context.netlink_curr_buf_sz
 #define g_stpd_port_init_done   stpd_context.port_init_done
 #define g_stpd_intf_db          stpd_context.intf_avl_tree
+#define g_stpd_mst_info_db      stpd_context.mst_info_avl_tree
 #define g_stpd_po_id_pool       stpd_context.po_id_pool
 #define g_stpd_ioctl_sock       stpd_context.ioctl_sock
 #define g_stpd_sys_max_port     stpd_context.sys_max_port
@@ -55,6 +70,60 @@ struct netlink_db_s;
 
 #define STPD_100MS_TIMEOUT      100000
 
+/* Packet rx/tx is moved to a dedicated thread (stp_pkt_io.c) when this file
+ * exists at startup. */
+#define STPD_PKT_IO_FLAG        "/stpd_pkt_io_thread"
+
+/* Sharded PVST (stp_shard.c): when this file exists at startup and holds a
+ * worker count of 2 to STPD_SHARD_MAX, the timer updates of a tick and the
+ * state machines of received BPDUs are run by that many threads, the event
+ * loop thread being worker 0. Classes of the tick group are split by
+ * STP_INDEX, BPDUs by vlan. Up to STPD_SHARD_RX_BATCH BPDUs per worker are
+ * queued before being processed, at the latest before the next tick or
+ * ipc message. */
+#define STPD_SHARD_FLAG         "/stpd_shard_workers"
+#define STPD_SHARD_RX_BATCH     256
+#define STPD_SHARD_TX_BATCH     256     //initial size, grows
+
+/* IPC receive: datagrams are drained in batches of STPD_IPC_RX_BATCH, up to
+ * STPD_IPC_RX_BUDGET per wakeup so the timer queue is not starved. recvmmsg
+ * cannot size the messages after the first one, so a batch slot holds the
+ * largest datagram a client can send, twice net.core.wmem_max (SO_SNDBUF).
+ * The slots are reserved, not committed, only the pages messages were read
+ * into are resident. Only a client past wmem_max (SO_SNDBUFFORCE) can send
+ * more, such a message is read on its own when at the head of the queue,
+ * dropped otherwise. */
+#define STPD_IPC_RX_BATCH       16
+#define STPD_IPC_RX_SLOT_MIN    16384
+#define STPD_IPC_RX_BUDGET      256
+#define STPD_IPC_WMEM_MAX_FILE  "/proc/sys/net/core/wmem_max"
+
+/* Config transactions: between STP_CONFIG_TXN_BEGIN and STP_CONFIG_TXN_COMMIT
+ * config messages only update data structures, recomputation is done once
+ * on commit. A transaction left open longer than the timeout (in 100ms
+ * ticks) is committed by the timer. */
+#define STPD_CONFIG_TXN_TIMEOUT_TICKS   50
+#define STPD_CONFIG_TXN_ACTIVE()        (stpd_context.config_txn_depth != 0)
+
+/* BPDU tx pacing: frames to a port are sent through a token bucket of
+ * g_stpd_tx_rate frames per second, bursts of up to g_stpd_tx_burst frames.
+ * Frames that find no token are queued per port, TCN and frames carrying
+ * topology change, proposal or agreement flags ahead of periodic ones, and
+ * drained every STPD_TX_DRAIN_USEC. A rate of 0 sends every frame at once.
+ * Frames longer than STPD_TX_FRAME_LEN (MSTP with many MSTIs, one per port
+ * per hello) are never queued. */
+#define g_stpd_tx_rate          stpd_context.tx_pacer.rate
+#define g_stpd_tx_burst         stpd_context.tx_pacer.burst
+#define STPD_TX_DFLT_RATE       4000
+#define STPD_TX_DFLT_BURST      400
+#define STPD_TX_QUEUE_MAX       8192
+#define STPD_TX_FRAME_LEN       128
+#define STPD_TX_DRAIN_USEC      10000
+#define STPD_TX_TOKEN           1000000ULL  //a token is a millionth of a frame
+#define STPD_TX_Q_URGENT        0
+#define STPD_TX_Q_PERIODIC      1
+#define STPD_TX_Q_MAX           2
+
 #define STP_ETH_NAME_PREFIX_LEN 8
 
 /*
@@ -90,10 +159,38 @@ struct netlink_db_s;
 // IPC can be run from multiple terminals, in which case there can be a socket opened for each terminal.
 // Lets restrict our libevent queue to process only 5 sockets at any given instance.
 //
+// "stpctl lstats" shows the callback run times and how often these limits defer events.
+//
 */
 #define STP_LIBEV_PRIO_QUEUES 2
 #define STP_LIBEV_HIGH_PRI_Q 0
 #define STP_LIBEV_LOW_PRI_Q  1
+#define STP_LIBEV_MAX_DISPATCH_MSEC 50
+#define STP_LIBEV_MAX_DISPATCH_CBS  5
+
+/* Event loop profiler: every event created by stpmgr_libevent_create() runs
+ * through stpmgr_libevent_prof_cb(). Callbacks sharing a name share stats. */
+#define STPD_LIBEV_PROF_MAX     8
+
+typedef struct
+{
+    const char *name;
+    uint64_t calls;
+    STPD_HIST run;          //callback run time
+    STPD_HIST wait;         //persistent timer: lateness against its schedule,
+                            //low priority: time since its dispatch run started
+}STPD_LIBEV_PROF;
+
+typedef struct
+{
+    STPD_LIBEV_PROF *prof;
+    void (*cb_fn)(evutil_socket_t, short, void *);
+    void *arg;
+    struct event_base *base;
+    int prio;
+    uint64_t interval_usec;     //persistent timer period, 0 otherwise
+    uint64_t next_usec;         //persistent timer: next scheduled run (monotonic)
+}STPD_LIBEV_PROF_EVENT;
 
 
 typedef struct
@@ -113,6 +210,9 @@ typedef struct
 #define g_stpd_stats_libev_ipc     stpd_context.dbg_stats.libev.ipc
 #define g_stpd_stats_libev_netlink stpd_context.dbg_stats.libev.netlink
 
+#define g_stpd_stats_ipc           stpd_context.dbg_stats.ipc
+#define g_stpd_tick_stats          stpd_context.dbg_stats.tick
+
 #define g_stpd_intf_stats          stpd_context.dbg_stats.intf
 #define STPD_INCR_PKT_COUNT(x, y)   (g_stpd_intf_stats[x]->y)++
 #define STPD_GET_PKT_COUNT(x, y)    (g_stpd_intf_stats[x]->y)
@@ -124,8 +224,60 @@ typedef struct
     uint64_t pkt_rx;
     uint64_t ipc;
     uint64_t netlink;
+
+    STPD_LIBEV_PROF prof[STPD_LIBEV_PROF_MAX];
+    uint8_t  prof_count;
+    uint64_t run_start_usec;        //first low priority callback of the current dispatch run
+    uint32_t run_cbs;               //low priority callbacks in that run, 0 if no run is open
+    uint64_t dispatch_limited;      //iterations cut short by the dispatch limits
+    uint64_t dispatch_deferred;     //events left active when that happened
+    uint32_t dispatch_deferred_max;
 }STPD_LIBEV_STATS;
 
+typedef struct
+{
+    uint64_t rx_msgs;
+    uint64_t rx_batches;    //recvmmsg calls that returned data
+    uint64_t rx_large;      //messages bigger than a batch slot
+    uint64_t rx_trunc;      //messages dropped due to truncation
+    uint64_t rx_err;
+    uint64_t txn_commits;
+    uint64_t txn_timeouts;
+}STPD_IPC_STATS;
+
+/* 100ms tick accounting, see stptimer_prof_begin() */
+#define STPD_TICK_DFLT_OVERRUN_MSEC 50
+#define STPD_TICK_OVERRUN_LOG_SEC   10      //at most one overrun summary per interval
+#define STPD_TICK_TOP_MAX           5
+
+typedef struct
+{
+    uint8_t  is_port;       //id is a port number, else an instance (vlan / mst id)
+    uint16_t id;
+    uint32_t usec;
+}STPD_TICK_TOP;
+
+typedef struct
+{
+    uint32_t overrun_msec;                  //0 disables overrun detection
+    STPD_HIST phase[STPD_TICK_PHASES];
+    uint64_t overruns;
+    uint32_t overruns_unlogged;
+    uint32_t last_log_sec;
+
+    //current tick
+    bool     active;
+    uint64_t start_usec;
+    uint64_t usec[STPD_TICK_PHASES];
+    STPD_TICK_TOP top[STPD_TICK_TOP_MAX];
+    uint8_t  top_count;
+
+    //last tick over the threshold
+    uint64_t last_overrun_usec[STPD_TICK_PHASES];
+    STPD_TICK_TOP last_overrun_top[STPD_TICK_TOP_MAX];
+    uint8_t  last_overrun_top_count;
+}STPD_TICK_STATS;
+
 typedef struct
 {
     uint64_t pkt_rx;
@@ -133,12 +285,60 @@ typedef struct
     uint64_t pkt_rx_err_trunc;
     uint64_t pkt_rx_err;
     uint64_t pkt_tx_err;
+    uint64_t pkt_tx_queued;     //frames held back by tx pacing
+    uint64_t pkt_tx_replaced;   //queued frames replaced by newer ones
+    uint64_t pkt_tx_drop;       //frames dropped by tx pacing
+    uint64_t pkt_tx_delay_sum;  //usec spent queued by frames sent
+    uint32_t pkt_tx_delay_max;  //usec
+    uint32_t pkt_tx_depth_max;
 }STPD_INTF_STATS;
 
+typedef struct STPD_TX_FRAME
+{
+    struct STPD_TX_FRAME *next;
+    struct STPD_TX_FRAME *prev;
+    uint64_t enq_usec;
+    uint16_t vlan_id;
+    uint16_t size;
+    uint8_t  tagged:1;
+    uint8_t  urgent:1;
+    uint8_t  coalesce:1;    //config bpdu, replaced by a newer one of its vlan
+    uint8_t  ieee:1;        //stp sap encapsulation, else pvst snap
+    uint8_t  spare:4;
+    char     buf[STPD_TX_FRAME_LEN];
+}STPD_TX_FRAME;
+
+typedef struct
+{
+    STPD_TX_FRAME *head;
+    STPD_TX_FRAME *tail;
+}STPD_TX_QUEUE;
+
+typedef struct
+{
+    STPD_TX_QUEUE q[STPD_TX_Q_MAX];
+    STPD_TX_FRAME **vlan_frame;     //queued pvst config bpdu of each vlan
+    STPD_TX_FRAME *ieee_frame;      //queued ieee config bpdu of the port
+    uint32_t depth;
+    uint64_t tokens;
+    uint64_t last_usec;
+}STPD_TX_PORT;
+
+typedef struct
+{
+    uint32_t rate;
+    uint32_t burst;
+    struct event *ev;               //drain timer
+    STPD_TX_PORT **port;            //allocated when a port first queues
+    struct BITMAP_S *backlog;       //ports with queued frames
+}STPD_TX_PACER;
+
 typedef struct 
 {
     STPD_INTF_STATS   **intf;
     STPD_LIBEV_STATS libev;
+    STPD_IPC_STATS   ipc;
+    STPD_TICK_STATS  tick;
 }STPD_DEBUG_STATS;
 
 typedef struct STPD_CONTEXT {
@@ -156,6 +356,10 @@ typedef struct STPD_CONTEXT {
     uint32_t            netlink_init_buf_sz; //default netlink rcv buff size fetched on bootup
     uint32_t            netlink_curr_buf_sz; //updated netlink rcv buff size by stp
 
+    /*Config transaction, see STPD_CONFIG_TXN_ACTIVE*/
+    uint16_t            config_txn_depth;
+    uint16_t            config_txn_ticks;
+
     /*INTERFACE Database*/
     //The Interface DB- AVL tree.
     //Key := Interface name
@@ -163,6 +367,10 @@ typedef struct STPD_CONTEXT {
     //PO node will be created only when 1st Member port is added to the system.
     struct avl_table    *intf_avl_tree;
 
+    //Per instance port priority/path cost overrides.
+    //Key := (port_id, mstp_index). Holds a node only for overridden values.
+    struct avl_table    *mst_info_avl_tree;
+
     //array of pointers to nodes in avl tree.
     //for faster access by avoiding parsing avl tree.
     int                 **intf_ptr_to_avl_node;
@@ -172,6 +380,7 @@ typedef struct STPD_CONTEXT {
     uint32_t            ioctl_sock;
     //Max Phy ports in system. calculated using netlink dump
     uint16_t            sys_max_port;
+    STPD_TX_PACER       tx_pacer;
     STPD_DEBUG_STATS    dbg_stats;
 }STPD_CONTEXT;
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#ifndef __STP_SHM_H__
+#define __STP_SHM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Live counters published by stpd in a POSIX shared memory segment
+ * (/dev/shm/stpd_stats), so monitoring reads them without going through the
+ * stpd event loop.
+ *
+ * The segment is a header followed by the port and instance tables, their
+ * offsets and record sizes are in the header. stpd rewrites the whole
+ * segment every STP_SHM_PUBLISH_TICKS under the seq seqlock: seq is odd
+ * while an update is in progress and is bumped again when it is done, a
+ * reader copies the segment and retries if seq was odd or changed meanwhile
+ * (stp_shm_snapshot() in lib/stp_shm_reader.c does it).
+ *
+ * Fields are only ever appended to the records, readers must use the record
+ * sizes of the header. The version changes when existing fields change.
+ */
+
+#define STP_SHM_NAME            "/stpd_stats"
+#define STP_SHM_MAGIC           0x53545053      //"STPS"
+#define STP_SHM_VERSION         1
+#define STP_SHM_PUBLISH_TICKS   5               //100ms ticks between updates
+#define STP_SHM_IFNAME_LEN      16
+#define STP_SHM_READ_RETRIES    100
+
+typedef struct
+{
+    char     ifname[STP_SHM_IFNAME_LEN];        //empty if the port is unused
+    uint64_t pkt_rx;
+    uint64_t pkt_tx;
+    uint64_t pkt_rx_err;
+    uint64_t pkt_rx_err_trunc;
+    uint64_t pkt_tx_err;
+    uint64_t pkt_tx_queued;
+    uint64_t pkt_tx_drop;
+    //mstp bpdu counters, 0 in pvst mode
+    uint32_t mstp_rx[4];                        //mstp, rstp, config, tcn
+    uint32_t mstp_tx[4];
+}STP_SHM_PORT;
+
+typedef struct
+{
+    uint16_t id;                                //vlan for pvst, mst id for mstp
+    uint8_t  active;
+    uint8_t  topology_change;                   //pvst only
+    uint16_t root_port;                         //port id, 0xffff if none
+    uint16_t spare;
+    uint32_t root_path_cost;                    //external cost for the cist
+    uint32_t topology_change_count;             //pvst only
+    uint32_t rx_drop_bpdu;                      //pvst only
+}STP_SHM_INSTANCE;
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_size;
+    uint32_t seq;
+    uint32_t pid;
+    uint32_t size;                              //of the whole segment
+    uint32_t publish_count;
+    uint64_t update_usec;                       //CLOCK_REALTIME of the last update
+
+    uint8_t  proto_mode;                        //enum L2_PROTO_MODE
+    uint8_t  enable;
+    uint16_t active_instances;
+    uint32_t stp_drop_count;
+    uint32_t tcn_drop_count;
+    uint32_t pvst_drop_count;
+
+    uint32_t port_offset;
+    uint16_t port_size;
+    uint16_t port_count;
+    uint32_t inst_offset;
+    uint16_t inst_size;
+    uint16_t inst_count;                        //records in use
+}STP_SHM_HDR;
+
+#define STP_SHM_PORT_REC(_hdr_, _i_) \
+    ((STP_SHM_PORT *)((char *)(_hdr_) + (_hdr_)->port_offset + ((size_t)(_i_) * (_hdr_)->port_size)))
+#define STP_SHM_INST_REC(_hdr_, _i_) \
+    ((STP_SHM_INSTANCE *)((char *)(_hdr_) + (_hdr_)->inst_offset + ((size_t)(_i_) * (_hdr_)->inst_size)))
+
+//reader library (lib/stp_shm_reader.c), the snapshot stays valid until the
+//next snapshot or close
+typedef struct
+{
+    int      fd;
+    void     *map;
+    size_t   map_size;
+    void     *copy;                             //last snapshot
+}STP_SHM_READER;
+
+int stp_shm_open(STP_SHM_READER *reader);
+STP_SHM_HDR *stp_shm_snapshot(STP_SHM_READER *reader);
+void stp_shm_close(STP_SHM_READER *reader);
+
+#endif //__STP_SHM_H__
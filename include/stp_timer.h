@@ -37,6 +37,17 @@ typedef struct TIMER
 	UINT32 value;
 } __attribute__((aligned(4))) TIMER;
 
+/* phases of the stpd 100ms tick, see stptimer_prof_begin() */
+typedef enum
+{
+    STPD_TICK_TIMERS,       //timer updates and the state machine work of expiries
+    STPD_TICK_TX,           //bpdu transmission done by the tick, out of the other phases
+    STPD_TICK_SYNC_DB,
+    STPD_TICK_BPDU_SYNC,
+    STPD_TICK_TOTAL,
+    STPD_TICK_PHASES
+}STPD_TICK_PHASE;
+
 uint32_t sys_get_seconds();
 /*
  * start_timer()
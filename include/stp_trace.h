@@ -0,0 +1,60 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#ifndef __STP_TRACE_H__
+#define __STP_TRACE_H__
+
+/*
+ * Static tracepoints (USDT) of provider "stpd", usable from SystemTap,
+ * perf and bpftrace (see scripts/bpftrace). A probe is a nop instruction
+ * until a tracer attaches to it, arguments are only evaluated then.
+ * Without <sys/sdt.h> at build time the probes compile out.
+ *
+ *   bpdu_rx      (port, vlan, len)
+ *   bpdu_tx      (port, vlan, len)
+ *   port_state   (instance, vlan, port, state)         state : enum L2_PORT_STATE
+ *   timer_expiry (instance, vlan, port, timer)         timer : STP_TRACE_TIMER_xxx
+ *   db_sync      (instance, vlan, port)
+ *
+ * instance is the stp index for PVST and the mst id for MSTP, vlan is 0
+ * for MSTP and port is STP_TRACE_NO_PORT for instance wide events.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define STP_TRACE_BPDU_RX(port, vlan, len)                  DTRACE_PROBE3(stpd, bpdu_rx, port, vlan, len)
+#define STP_TRACE_BPDU_TX(port, vlan, len)                  DTRACE_PROBE3(stpd, bpdu_tx, port, vlan, len)
+#define STP_TRACE_PORT_STATE(inst, vlan, port, state)       DTRACE_PROBE4(stpd, port_state, inst, vlan, port, state)
+#define STP_TRACE_TIMER_EXPIRY(inst, vlan, port, timer)     DTRACE_PROBE4(stpd, timer_expiry, inst, vlan, port, timer)
+#define STP_TRACE_DB_SYNC(inst, vlan, port)                 DTRACE_PROBE3(stpd, db_sync, inst, vlan, port)
+#else
+#define STP_TRACE_BPDU_RX(port, vlan, len)
+#define STP_TRACE_BPDU_TX(port, vlan, len)
+#define STP_TRACE_PORT_STATE(inst, vlan, port, state)
+#define STP_TRACE_TIMER_EXPIRY(inst, vlan, port, timer)
+#define STP_TRACE_DB_SYNC(inst, vlan, port)
+#endif
+
+#define STP_TRACE_NO_PORT   0xffff
+
+typedef enum
+{
+    STP_TRACE_TIMER_HELLO = 1,
+    STP_TRACE_TIMER_MESSAGE_AGE,
+    STP_TRACE_TIMER_FORWARD_DELAY,
+    STP_TRACE_TIMER_TCN,
+    STP_TRACE_TIMER_TOPOLOGY_CHANGE,
+    STP_TRACE_TIMER_HOLD,
+    STP_TRACE_TIMER_ROOT_PROTECT,
+    STP_TRACE_TIMER_FD_WHILE,           //MSTP
+    STP_TRACE_TIMER_RR_WHILE,
+    STP_TRACE_TIMER_RB_WHILE,
+    STP_TRACE_TIMER_TC_WHILE,
+    STP_TRACE_TIMER_RCVD_INFO_WHILE,
+    STP_TRACE_TIMER_HELLO_WHEN,
+    STP_TRACE_TIMER_MDELAY_WHILE,
+}STP_TRACE_TIMER;
+
+#endif //__STP_TRACE_H__
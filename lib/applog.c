@@ -16,10 +16,15 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <syslog.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 #include "applog.h"
 
@@ -27,6 +32,60 @@ int applog_level_map[APP_LOG_LEVEL_MAX + 2];
 int applog_config_level = APP_LOG_LEVEL_DEFAULT;
 int applog_inited = 0;
 
+/* argument classes of a site, from the conversion and length modifier */
+#define APPLOG_ARG_INT      0
+#define APPLOG_ARG_LONG     1
+#define APPLOG_ARG_LLONG    2
+#define APPLOG_ARG_PTR      3
+#define APPLOG_ARG_DOUBLE   4
+#define APPLOG_ARG_STR      5
+
+#define APPLOG_SITE_BUSY    2           /* being parsed by another thread */
+#define APPLOG_STR_NULL     0xffff
+
+#define APPLOG_LINE_MAX     1024
+
+typedef struct
+{
+  uint32_t seq;                         /* ring position the slot is ready for */
+  uint16_t len;
+  uint16_t spare;
+  uint32_t suppressed;                  /* messages of the site dropped before this one */
+  uint32_t pad;
+  APPLOG_SITE *site;
+  uint8_t data[APPLOG_SLOT_SIZE - 24];
+} APPLOG_SLOT;
+
+_Static_assert(APPLOG_MAX_ARGS * sizeof(uint64_t) < sizeof(((APPLOG_SLOT *)0)->data),
+    "applog slot too small for APPLOG_MAX_ARGS");
+
+/*
+ * bounded multi producer ring: a producer claims a position with a cas on
+ * applog_enq_pos and fills the slot, then sets its seq to pos + 1. the drain
+ * thread consumes the slot once seq is pos + 1 and hands it back for the
+ * next lap by setting seq to pos + APPLOG_RING_SLOTS.
+ *
+ * once the ring is empty the drain thread sets applog_drain_idle, checks the
+ * ring again and waits on the futex. a producer that sees the flag after
+ * publishing its slot clears it and wakes the thread. the fences on both
+ * sides make sure either the thread sees the slot or the producer the flag.
+ */
+static APPLOG_SLOT *applog_ring;
+static uint32_t applog_enq_pos;
+static uint32_t applog_deq_pos;
+static int applog_async;
+static int applog_drain_run;
+static int applog_drain_idle;
+static pthread_t applog_drain_tid;
+static APPLOG_SITE *applog_sites;
+static APPLOG_STATS applog_stats;
+
+uint32_t applog_module_disabled;
+static const APPLOG_MODULE *applog_modules;
+static int applog_module_count;
+
+#define APPLOG_STAT_INC(field)  __atomic_fetch_add(&applog_stats.field, 1, __ATOMIC_RELAXED)
+
 int applog_init()
 {
   memset(applog_level_map, 0, sizeof(applog_level_map));
@@ -97,10 +156,634 @@ int applog_write(int level, const char *fmt, ...)
   return APP_LOG_STATUS_OK;
 }
 
+/*
+ * walks the conversion specification after a '%', returns the character
+ * following it and sets *type to the argument class, or returns NULL if the
+ * specification can not be deferred.
+ */
+static const char *applog_parse_spec(const char *p, uint8_t *type)
+{
+  int longs = 0;
+  int other = 0;
+
+  while (*p && strchr("-+ #0'", *p))
+    p++;
+  while (*p >= '0' && *p <= '9')
+    p++;
+  if (*p == '.')
+  {
+    p++;
+    while (*p >= '0' && *p <= '9')
+      p++;
+  }
+
+  for (;; p++)
+  {
+    if (*p == 'l')
+      longs++;
+    else if (*p == 'h')
+      ;
+    else if (*p == 'z' || *p == 't')
+      longs = (longs > 1) ? longs : 1;
+    else if (*p == 'j' || *p == 'q')
+      longs = 2;
+    else if (*p == 'L')
+      other = 1;
+    else
+      break;
+  }
+
+  switch (*p)
+  {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+      if (other)
+        return NULL;
+      *type = (longs == 0) ? APPLOG_ARG_INT : (longs == 1) ? APPLOG_ARG_LONG : APPLOG_ARG_LLONG;
+      break;
+
+    case 's':
+      if (longs || other)
+        return NULL;
+      *type = APPLOG_ARG_STR;
+      break;
+
+    case 'p':
+      *type = APPLOG_ARG_PTR;
+      break;
+
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      if (other)
+        return NULL;
+      *type = APPLOG_ARG_DOUBLE;
+      break;
+
+    default:
+      /* '*', %n, %m (errno of the drain thread) and anything unknown */
+      return NULL;
+  }
+
+  return p + 1;
+}
+
+static int8_t applog_site_parse(APPLOG_SITE *site)
+{
+  const char *p = site->fmt;
+
+  site->argc = 0;
+  while ((p = strchr(p, '%')))
+  {
+    if (p[1] == '%')
+    {
+      p += 2;
+      continue;
+    }
+
+    if (site->argc == APPLOG_MAX_ARGS)
+      return APPLOG_SITE_SYNC;
+
+    p = applog_parse_spec(p + 1, &site->arg_type[site->argc]);
+    if (!p)
+      return APPLOG_SITE_SYNC;
+    site->argc++;
+  }
+
+  return APPLOG_SITE_ASYNC;
+}
+
+static uint32_t applog_site_module_bit(APPLOG_SITE *site)
+{
+  int i;
+
+  for (i = 0; site->file && i < applog_module_count; i++)
+  {
+    if (strstr(site->file, applog_modules[i].path))
+      return 1u << applog_modules[i].id;
+  }
+
+  return 0;
+}
+
+static int8_t applog_site_register(APPLOG_SITE *site)
+{
+  int8_t state = APPLOG_SITE_NEW;
+
+  if (__atomic_compare_exchange_n(&site->state, &state, APPLOG_SITE_BUSY, 0,
+        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+  {
+    state = applog_site_parse(site);
+    site->module_bit = applog_site_module_bit(site);
+
+    site->next = __atomic_load_n(&applog_sites, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&applog_sites, &site->next, site, 1,
+          __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+
+    __atomic_store_n(&site->state, state, __ATOMIC_RELEASE);
+  }
+
+  return state;
+}
+
+static int applog_write_sync(APPLOG_SITE *site, va_list ap)
+{
+  char msg[APPLOG_LINE_MAX];
+
+  if (!site->func)
+  {
+    vsyslog(applog_level_map[site->level], site->fmt, ap);
+  }
+  else
+  {
+    vsnprintf(msg, sizeof(msg), site->fmt, ap);
+    syslog(applog_level_map[site->level], "%s:%u:%s ", site->func, site->line, msg);
+  }
+  APPLOG_STAT_INC(sync_written);
+
+  return APP_LOG_STATUS_OK;
+}
+
+/* per site token bucket of APPLOG_RATE_BURST messages a second */
+static int applog_rate_limited(APPLOG_SITE *site)
+{
+  struct timespec ts;
+  uint32_t sec;
+
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  sec = (uint32_t)ts.tv_sec;
+  if (__atomic_load_n(&site->rate_sec, __ATOMIC_RELAXED) != sec)
+  {
+    __atomic_store_n(&site->rate_sec, sec, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->rate_count, 0, __ATOMIC_RELAXED);
+  }
+
+  return __atomic_add_fetch(&site->rate_count, 1, __ATOMIC_RELAXED) > APPLOG_RATE_BURST;
+}
+
+static void applog_site_drop(APPLOG_SITE *site)
+{
+  __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&site->dropped, 1, __ATOMIC_RELAXED);
+}
+
+static void applog_drain_wake()
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&applog_drain_idle, __ATOMIC_RELAXED)
+      && __atomic_exchange_n(&applog_drain_idle, 0, __ATOMIC_RELAXED))
+    syscall(SYS_futex, &applog_drain_idle, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static APPLOG_SLOT *applog_slot_claim(uint32_t *claimed)
+{
+  APPLOG_SLOT *slot;
+  uint32_t pos, seq;
+
+  pos = __atomic_load_n(&applog_enq_pos, __ATOMIC_RELAXED);
+  for (;;)
+  {
+    slot = &applog_ring[pos & (APPLOG_RING_SLOTS - 1)];
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos)
+    {
+      if (__atomic_compare_exchange_n(&applog_enq_pos, &pos, pos + 1, 1,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      {
+        *claimed = pos;
+        return slot;
+      }
+    }
+    else if ((int32_t)(seq - pos) < 0)
+    {
+      /* slot still holds the record of the previous lap, ring is full */
+      return NULL;
+    }
+    else
+    {
+      pos = __atomic_load_n(&applog_enq_pos, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+static void applog_encode(APPLOG_SITE *site, APPLOG_SLOT *slot, va_list ap)
+{
+  uint8_t *data = slot->data;
+  const char *str;
+  uint64_t val;
+  double dval;
+  uint16_t len;
+  size_t slen, str_room = sizeof(slot->data);
+  int i;
+
+  /*
+   * strings share what the fixed size arguments and the string lengths
+   * leave, at most APPLOG_MAX_ARGS * 8 bytes so there always is some.
+   */
+  for (i = 0; i < site->argc; i++)
+    str_room -= (site->arg_type[i] == APPLOG_ARG_STR) ? sizeof(len) : sizeof(val);
+
+  for (i = 0; i < site->argc; i++)
+  {
+    switch (site->arg_type[i])
+    {
+      case APPLOG_ARG_INT:
+        val = (uint64_t)(int64_t)va_arg(ap, int);
+        break;
+      case APPLOG_ARG_LONG:
+        val = (uint64_t)va_arg(ap, long);
+        break;
+      case APPLOG_ARG_LLONG:
+        val = (uint64_t)va_arg(ap, long long);
+        break;
+      case APPLOG_ARG_PTR:
+        val = (uint64_t)(uintptr_t)va_arg(ap, void *);
+        break;
+      case APPLOG_ARG_DOUBLE:
+        dval = va_arg(ap, double);
+        memcpy(&val, &dval, sizeof(val));
+        break;
+      default:
+        str = va_arg(ap, const char *);
+        slen = str ? strlen(str) : 0;
+        if (slen > str_room)
+        {
+          slen = str_room;
+          APPLOG_STAT_INC(truncated);
+        }
+        str_room -= slen;
+        len = str ? (uint16_t)slen : APPLOG_STR_NULL;
+        memcpy(data, &len, sizeof(len));
+        data += sizeof(len);
+        if (slen)
+          memcpy(data, str, slen);
+        data += slen;
+        continue;
+    }
+    memcpy(data, &val, sizeof(val));
+    data += sizeof(val);
+  }
+
+  slot->len = data - slot->data;
+}
+
+/* FUNCTION
+ *    applog_write_site()
+ *
+ * SYNOPSIS
+ *    logs a message of an APP_LOG_xxx call site, through the ring when
+ *    asynchronous logging is running.
+ */
+int applog_write_site(APPLOG_SITE *site, ...)
+{
+  APPLOG_SLOT *slot;
+  uint32_t pos;
+  int8_t state;
+  va_list ap;
+  int ret;
+
+  if (site->level < APP_LOG_LEVEL_MIN || site->level > APP_LOG_LEVEL_MAX)
+  {
+    return APP_LOG_STATUS_INVALID_LEVEL;
+  }
+
+  if (site->level > applog_config_level)
+  {
+    return APP_LOG_STATUS_LEVEL_DISABLED;
+  }
+
+  state = __atomic_load_n(&site->state, __ATOMIC_ACQUIRE);
+  if (state == APPLOG_SITE_NEW)
+  {
+    state = applog_site_register(site);
+    if (APPLOG_MODULE_GATED(site->level) && (site->module_bit & applog_module_disabled))
+      return APP_LOG_STATUS_LEVEL_DISABLED;
+  }
+
+  if (state != APPLOG_SITE_ASYNC || site->level <= APP_LOG_LEVEL_CRIT
+      || !__atomic_load_n(&applog_async, __ATOMIC_ACQUIRE))
+  {
+    va_start(ap, site);
+    ret = applog_write_sync(site, ap);
+    va_end(ap);
+    return ret;
+  }
+
+  if (applog_rate_limited(site))
+  {
+    applog_site_drop(site);
+    APPLOG_STAT_INC(rate_drops);
+    return APP_LOG_STATUS_FAIL;
+  }
+
+  slot = applog_slot_claim(&pos);
+  if (!slot)
+  {
+    applog_site_drop(site);
+    APPLOG_STAT_INC(ring_drops);
+    return APP_LOG_STATUS_FAIL;
+  }
+
+  slot->site = site;
+  slot->suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+  va_start(ap, site);
+  applog_encode(site, slot, ap);
+  va_end(ap);
+
+  __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+  APPLOG_STAT_INC(queued);
+  applog_drain_wake();
+
+  return APP_LOG_STATUS_OK;
+}
+
+static int applog_format(APPLOG_SLOT *slot, char *out, size_t size)
+{
+  APPLOG_SITE *site = slot->site;
+  const uint8_t *data = slot->data;
+  const char *p = site->fmt, *next;
+  char spec[32], str[APPLOG_SLOT_SIZE];
+  uint64_t val;
+  double dval;
+  uint16_t len;
+  uint8_t type;
+  size_t pos = 0;
+  int i = 0, n;
+
+#define APPLOG_OUT(expr) \
+  do { n = (expr); if (n > 0) pos += n; if (pos >= size) pos = size - 1; } while (0)
+
+  if (site->func)
+    APPLOG_OUT(snprintf(out, size, "%s:%u:", site->func, site->line));
+
+  while (*p && pos < size - 1)
+  {
+    if (*p != '%')
+    {
+      out[pos++] = *p++;
+      continue;
+    }
+
+    if (p[1] == '%')
+    {
+      out[pos++] = '%';
+      p += 2;
+      continue;
+    }
+
+    next = applog_parse_spec(p + 1, &type);
+    if (!next || i >= site->argc || (size_t)(next - p) >= sizeof(spec))
+      break;
+    memcpy(spec, p, next - p);
+    spec[next - p] = '\0';
+    p = next;
+
+    if (site->arg_type[i++] == APPLOG_ARG_STR)
+    {
+      memcpy(&len, data, sizeof(len));
+      data += sizeof(len);
+      if (len == APPLOG_STR_NULL)
+      {
+        APPLOG_OUT(snprintf(out + pos, size - pos, spec, (char *)NULL));
+        continue;
+      }
+      memcpy(str, data, len);
+      str[len] = '\0';
+      data += len;
+      APPLOG_OUT(snprintf(out + pos, size - pos, spec, str));
+      continue;
+    }
+
+    memcpy(&val, data, sizeof(val));
+    data += sizeof(val);
+    switch (type)
+    {
+      case APPLOG_ARG_INT:
+        APPLOG_OUT(snprintf(out + pos, size - pos, spec, (int)val));
+        break;
+      case APPLOG_ARG_LONG:
+        APPLOG_OUT(snprintf(out + pos, size - pos, spec, (long)val));
+        break;
+      case APPLOG_ARG_LLONG:
+        APPLOG_OUT(snprintf(out + pos, size - pos, spec, (long long)val));
+        break;
+      case APPLOG_ARG_PTR:
+        APPLOG_OUT(snprintf(out + pos, size - pos, spec, (void *)(uintptr_t)val));
+        break;
+      default:
+        memcpy(&dval, &val, sizeof(dval));
+        APPLOG_OUT(snprintf(out + pos, size - pos, spec, dval));
+        break;
+    }
+  }
+
+  if (site->func && pos < size - 1)
+    out[pos++] = ' ';
+  out[pos] = '\0';
+
+#undef APPLOG_OUT
+  return (int)pos;
+}
+
+/* formats and sends the records in the ring, returns how many */
+static int applog_drain()
+{
+  char line[APPLOG_LINE_MAX];
+  APPLOG_SLOT *slot;
+  APPLOG_SITE *site;
+  uint32_t suppressed;
+  int count = 0;
+
+  for (;;)
+  {
+    slot = &applog_ring[applog_deq_pos & (APPLOG_RING_SLOTS - 1)];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != applog_deq_pos + 1)
+      break;
+
+    site = slot->site;
+    suppressed = slot->suppressed;
+    applog_format(slot, line, sizeof(line));
+    __atomic_store_n(&slot->seq, applog_deq_pos + APPLOG_RING_SLOTS, __ATOMIC_RELEASE);
+    applog_deq_pos++;
+
+    if (suppressed)
+      syslog(applog_level_map[site->level], "%s:%u: %u messages suppressed",
+          site->func ? site->func : "applog", site->line, suppressed);
+    syslog(applog_level_map[site->level], "%s", line);
+    APPLOG_STAT_INC(written);
+    count++;
+  }
+
+  return count;
+}
+
+static int applog_ring_empty()
+{
+  APPLOG_SLOT *slot = &applog_ring[applog_deq_pos & (APPLOG_RING_SLOTS - 1)];
+
+  return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != applog_deq_pos + 1;
+}
+
+static void *applog_drain_main(void *arg)
+{
+  (void)arg;
+
+  while (__atomic_load_n(&applog_drain_run, __ATOMIC_ACQUIRE))
+  {
+    if (applog_drain())
+      continue;
+
+    __atomic_store_n(&applog_drain_idle, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (applog_ring_empty() && __atomic_load_n(&applog_drain_run, __ATOMIC_RELAXED))
+      syscall(SYS_futex, &applog_drain_idle, FUTEX_WAIT_PRIVATE, 1, NULL, NULL, 0);
+    __atomic_store_n(&applog_drain_idle, 0, __ATOMIC_RELAXED);
+  }
+
+  return NULL;
+}
+
+/* FUNCTION
+ *    applog_async_start()
+ *
+ * SYNOPSIS
+ *    starts the drain thread, APP_LOG_xxx calls are queued from then on.
+ */
+int applog_async_start()
+{
+  uint32_t i;
+
+  if (applog_async)
+    return APP_LOG_STATUS_OK;
+
+  applog_ring = aligned_alloc(64, sizeof(APPLOG_SLOT) * APPLOG_RING_SLOTS);
+  if (!applog_ring)
+    return APP_LOG_STATUS_FAIL;
+
+  for (i = 0; i < APPLOG_RING_SLOTS; i++)
+    applog_ring[i].seq = i;
+  applog_enq_pos = applog_deq_pos = 0;
+
+  applog_drain_run = 1;
+  if (0 != pthread_create(&applog_drain_tid, NULL, applog_drain_main, NULL))
+  {
+    applog_drain_run = 0;
+    free(applog_ring);
+    applog_ring = NULL;
+    return APP_LOG_STATUS_FAIL;
+  }
+  pthread_setname_np(applog_drain_tid, "applog");
+
+  __atomic_store_n(&applog_async, 1, __ATOMIC_RELEASE);
+  return APP_LOG_STATUS_OK;
+}
+
+static void applog_async_stop()
+{
+  if (!applog_async)
+    return;
+
+  __atomic_store_n(&applog_async, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&applog_drain_run, 0, __ATOMIC_RELEASE);
+  applog_drain_wake();
+  pthread_join(applog_drain_tid, NULL);
+  applog_drain();
+
+  free(applog_ring);
+  applog_ring = NULL;
+}
+
+void applog_get_stats(APPLOG_STATS *stats)
+{
+  stats->queued = __atomic_load_n(&applog_stats.queued, __ATOMIC_RELAXED);
+  stats->written = __atomic_load_n(&applog_stats.written, __ATOMIC_RELAXED);
+  stats->sync_written = __atomic_load_n(&applog_stats.sync_written, __ATOMIC_RELAXED);
+  stats->ring_drops = __atomic_load_n(&applog_stats.ring_drops, __ATOMIC_RELAXED);
+  stats->rate_drops = __atomic_load_n(&applog_stats.rate_drops, __ATOMIC_RELAXED);
+  stats->truncated = __atomic_load_n(&applog_stats.truncated, __ATOMIC_RELAXED);
+}
+
+/* iterates over the sites used so far, start with NULL */
+APPLOG_SITE *applog_site_next(APPLOG_SITE *site)
+{
+  return site ? site->next : __atomic_load_n(&applog_sites, __ATOMIC_ACQUIRE);
+}
+
+/* FUNCTION
+ *    applog_set_modules()
+ *
+ * SYNOPSIS
+ *    sets the module table, a site belongs to the first module whose path
+ *    is found in its source file name. the table must stay valid.
+ */
+int applog_set_modules(const APPLOG_MODULE *modules, int count)
+{
+  APPLOG_SITE *site = NULL;
+  int i;
+
+  for (i = 0; i < count; i++)
+  {
+    if (modules[i].id >= APPLOG_MODULE_MAX)
+      return APP_LOG_STATUS_FAIL;
+  }
+
+  applog_modules = modules;
+  applog_module_count = count;
+
+  /* sites used before the table was set */
+  while ((site = applog_site_next(site)))
+    site->module_bit = applog_site_module_bit(site);
+
+  return APP_LOG_STATUS_OK;
+}
+
+int applog_module_id(const char *name)
+{
+  int i;
+
+  for (i = 0; i < applog_module_count; i++)
+  {
+    if (0 == strcmp(applog_modules[i].name, name))
+      return applog_modules[i].id;
+  }
+
+  return APP_LOG_STATUS_FAIL;
+}
+
+const char *applog_module_name(int id)
+{
+  int i;
+
+  for (i = 0; i < applog_module_count; i++)
+  {
+    if (applog_modules[i].id == id)
+      return applog_modules[i].name;
+  }
+
+  return NULL;
+}
+
+int applog_module_enable(int id, int enable)
+{
+  if (id < 0 || id >= APPLOG_MODULE_MAX)
+    return APP_LOG_STATUS_FAIL;
+
+  if (enable)
+    __atomic_and_fetch(&applog_module_disabled, ~(1u << id), __ATOMIC_RELAXED);
+  else
+    __atomic_or_fetch(&applog_module_disabled, 1u << id, __ATOMIC_RELAXED);
+
+  return APP_LOG_STATUS_OK;
+}
+
+int applog_module_is_enabled(int id)
+{
+  return !(applog_module_disabled & (1u << id));
+}
+
 int applog_deinit()
 {
   int status = 0;
 
+  applog_async_stop();
   closelog();
 
   applog_inited = 0;
@@ -21,6 +21,87 @@
 #include <stdio.h>
 #include <syslog.h>
 #include <stdarg.h>
+#include <stdint.h>
+
+/*
+ * Asynchronous logging.
+ *
+ * Every APP_LOG_xxx call site owns a static APPLOG_SITE. Once
+ * applog_async_start() has run, a call copies the site pointer and the raw
+ * arguments (strings by value) into a fixed size slot of a lock-free ring
+ * and returns, a drain thread formats the records and sends them to syslog.
+ * Sites are rate limited to APPLOG_RATE_BURST messages per second, messages
+ * over the limit or finding the ring full are dropped and counted. The drain
+ * thread sleeps on a futex while the ring is empty, the producer that finds
+ * it asleep wakes it.
+ *
+ * Levels up to APP_LOG_LEVEL_CRIT, formats with '*', %n or %m, and records
+ * that do not fit a slot are written synchronously.
+ */
+#define APPLOG_RING_SLOTS           2048        //power of 2
+#define APPLOG_SLOT_SIZE            256
+#define APPLOG_MAX_ARGS             16
+#define APPLOG_RATE_BURST           50          //per site and second
+
+/*
+ * Log site gating.
+ *
+ * The APP_LOG_xxx macros test the level before evaluating their arguments.
+ * Sites above APP_LOG_COMPILE_LEVEL (configure --with-log-level) are not
+ * compiled in at all, and INFO and DEBUG sites of a module disabled at
+ * runtime with applog_module_enable() cost a load and a test. Modules are
+ * assigned to sites from their source file on first use, see
+ * applog_set_modules().
+ */
+#ifndef APP_LOG_COMPILE_LEVEL
+#define APP_LOG_COMPILE_LEVEL       7           //APP_LOG_LEVEL_DEBUG
+#endif
+
+#define APPLOG_MODULE_MAX           32
+#define APPLOG_MODULE_GATED(level)  ((level) >= 6)  //APP_LOG_LEVEL_INFO
+
+typedef struct
+{
+    const char *name;
+    const char *path;                           //matched anywhere in __FILE__, "" matches all
+    uint8_t     id;                             //< APPLOG_MODULE_MAX, shared by entries of a module
+}APPLOG_MODULE;
+
+typedef struct APPLOG_SITE
+{
+    const char *fmt;
+    const char *func;                           //NULL if not prefixed with func:line:
+    uint32_t    line;
+    int         level;
+    const char *file;
+
+    //filled on first use
+    uint32_t    module_bit;                     //0 until the site is first used
+    int8_t      state;                          //APPLOG_SITE_xxx
+    uint8_t     argc;
+    uint8_t     arg_type[APPLOG_MAX_ARGS];
+    struct APPLOG_SITE *next;                   //all sites used so far
+
+    //rate limiting
+    uint32_t    rate_sec;
+    uint32_t    rate_count;
+    uint32_t    suppressed;                     //not yet reported
+    uint64_t    dropped;
+}APPLOG_SITE;
+
+#define APPLOG_SITE_NEW             0
+#define APPLOG_SITE_ASYNC           1
+#define APPLOG_SITE_SYNC            (-1)
+
+typedef struct
+{
+    uint64_t queued;
+    uint64_t written;                           //by the drain thread
+    uint64_t sync_written;
+    uint64_t ring_drops;
+    uint64_t rate_drops;
+    uint64_t truncated;                         //string arguments cut to fit a slot
+}APPLOG_STATS;
 
 int applog_init();
 int applog_deinit();
@@ -28,6 +109,18 @@ int applog_set_config_level(int level);
 int applog_get_config_level();
 int applog_get_init_status();
 int applog_write(int priority, const char *fmt, ...);
+int applog_write_site(APPLOG_SITE *site, ...);
+int applog_async_start();
+void applog_get_stats(APPLOG_STATS *stats);
+APPLOG_SITE *applog_site_next(APPLOG_SITE *site);
+int applog_set_modules(const APPLOG_MODULE *modules, int count);
+int applog_module_id(const char *name);
+const char *applog_module_name(int id);
+int applog_module_enable(int id, int enable);
+int applog_module_is_enabled(int id);
+
+extern int applog_config_level;
+extern uint32_t applog_module_disabled;
 
 
 #define APP_LOG_LEVEL_NONE            (-1)
@@ -53,32 +146,40 @@ int applog_write(int priority, const char *fmt, ...);
 #define APP_LOG_DEINIT                applog_deinit
 #define APP_LOG_SET_LEVEL(level)      applog_set_config_level(level)
 
+/* Use to skip building log-only strings when the level is disabled */
+#define APP_LOG_IS_ENABLED(level)     ((level) <= APP_LOG_COMPILE_LEVEL && (level) <= applog_config_level)
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wvariadic-macros"
 
+#define APP_LOG_SITE_WRITE(LEVEL, FUNC, MSG, ...) \
+    do { \
+        static APPLOG_SITE _applog_site = { MSG, FUNC, __LINE__, LEVEL, __FILE__ }; \
+        if (APP_LOG_IS_ENABLED(LEVEL) \
+                && !(APPLOG_MODULE_GATED(LEVEL) && (_applog_site.module_bit & applog_module_disabled))) \
+            applog_write_site(&_applog_site, ##__VA_ARGS__); \
+    } while (0)
+
 #ifdef APP_LOG_NO_FUNC_LINE 
-#define APP_LOG_DEBUG(...)            applog_write(APP_LOG_LEVEL_DEBUG, __VA_ARGS__)
-#define APP_LOG_INFO(...)             applog_write(APP_LOG_LEVEL_INFO, __VA_ARGS__)
-#define APP_LOG_ERR(...)              applog_write(APP_LOG_LEVEL_ERR, __VA_ARGS__)
-#define APP_LOG_WARNING(...)          applog_write(APP_LOG_LEVEL_WARNING, __VA_ARGS__)
-#define APP_LOG_EMERG(...)            applog_write(APP_LOG_LEVEL_EMERG, __VA_ARGS__)
-#define APP_LOG_CRITICAL(...)         applog_write(APP_LOG_LEVEL_CRIT, __VA_ARGS__)
-#define APP_LOG_NOTICE(...)           applog_write(APP_LOG_LEVEL_NOTICE, __VA_ARGS__)
-#define APP_LOG_ALERT(...)            applog_write(APP_LOG_LEVEL_ALERT, __VA_ARGS__)
+#define APP_LOG_DEBUG(MSG, ...)       APP_LOG_SITE_WRITE(APP_LOG_LEVEL_DEBUG,   NULL, MSG, ##__VA_ARGS__)
+#define APP_LOG_INFO(MSG, ...)        APP_LOG_SITE_WRITE(APP_LOG_LEVEL_INFO,    NULL, MSG, ##__VA_ARGS__)
+#define APP_LOG_ERR(MSG, ...)         APP_LOG_SITE_WRITE(APP_LOG_LEVEL_ERR,     NULL, MSG, ##__VA_ARGS__)
+#define APP_LOG_WARNING(MSG, ...)     APP_LOG_SITE_WRITE(APP_LOG_LEVEL_WARNING, NULL, MSG, ##__VA_ARGS__)
+#define APP_LOG_EMERG(MSG, ...)       APP_LOG_SITE_WRITE(APP_LOG_LEVEL_EMERG,   NULL, MSG, ##__VA_ARGS__)
+#define APP_LOG_CRITICAL(MSG, ...)    APP_LOG_SITE_WRITE(APP_LOG_LEVEL_CRIT,    NULL, MSG, ##__VA_ARGS__)
+#define APP_LOG_NOTICE(MSG, ...)      APP_LOG_SITE_WRITE(APP_LOG_LEVEL_NOTICE,  NULL, MSG, ##__VA_ARGS__)
+#define APP_LOG_ALERT(MSG, ...)       APP_LOG_SITE_WRITE(APP_LOG_LEVEL_ALERT,   NULL, MSG, ##__VA_ARGS__)
 #else
-#define APP_LOG_DEBUG(MSG, ...)       applog_write(APP_LOG_LEVEL_DEBUG,   "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__) 
-#define APP_LOG_INFO(MSG, ...)        applog_write(APP_LOG_LEVEL_INFO,    "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__)
-#define APP_LOG_ERR(MSG, ...)         applog_write(APP_LOG_LEVEL_ERR,     "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__)
-#define APP_LOG_WARNING(MSG, ...)     applog_write(APP_LOG_LEVEL_WARNING, "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__)
-#define APP_LOG_EMERG(MSG, ...)       applog_write(APP_LOG_LEVEL_EMERG,   "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__)
-#define APP_LOG_CRITICAL(MSG, ...)    applog_write(APP_LOG_LEVEL_CRIT,    "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__)
-#define APP_LOG_NOTICE(MSG, ...)      applog_write(APP_LOG_LEVEL_NOTICE,  "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__)
-#define APP_LOG_ALERT(MSG, ...)       applog_write(APP_LOG_LEVEL_ALERT,   "%s:%u:"MSG" ", __func__, __LINE__,  ##__VA_ARGS__)
+#define APP_LOG_DEBUG(MSG, ...)       APP_LOG_SITE_WRITE(APP_LOG_LEVEL_DEBUG,   __func__, MSG, ##__VA_ARGS__)
+#define APP_LOG_INFO(MSG, ...)        APP_LOG_SITE_WRITE(APP_LOG_LEVEL_INFO,    __func__, MSG, ##__VA_ARGS__)
+#define APP_LOG_ERR(MSG, ...)         APP_LOG_SITE_WRITE(APP_LOG_LEVEL_ERR,     __func__, MSG, ##__VA_ARGS__)
+#define APP_LOG_WARNING(MSG, ...)     APP_LOG_SITE_WRITE(APP_LOG_LEVEL_WARNING, __func__, MSG, ##__VA_ARGS__)
+#define APP_LOG_EMERG(MSG, ...)       APP_LOG_SITE_WRITE(APP_LOG_LEVEL_EMERG,   __func__, MSG, ##__VA_ARGS__)
+#define APP_LOG_CRITICAL(MSG, ...)    APP_LOG_SITE_WRITE(APP_LOG_LEVEL_CRIT,    __func__, MSG, ##__VA_ARGS__)
+#define APP_LOG_NOTICE(MSG, ...)      APP_LOG_SITE_WRITE(APP_LOG_LEVEL_NOTICE,  __func__, MSG, ##__VA_ARGS__)
+#define APP_LOG_ALERT(MSG, ...)       APP_LOG_SITE_WRITE(APP_LOG_LEVEL_ALERT,   __func__, MSG, ##__VA_ARGS__)
 #endif
 
-/* Use below one for Syslog */
-#define APP_SYS_LOG_INFO(...)         applog_write(APP_LOG_LEVEL_INFO, __VA_ARGS__)
-
 #pragma GCC diagnostic pop
 
 #endif /*_APPLOG_H_*/
@@ -204,6 +204,52 @@ BMP_ID bmp_set_first_unset_bit(BITMAP_T *bmp)
     return bmp_id;
 }
 
+/*
+ * Finds the next run of consecutive set bits starting at or after "offset".
+ * Whole words are skipped with count-trailing-zeros and the run length is
+ * found with count-trailing-zeros on the inverted word, so sparse and dense
+ * masks are both walked a word at a time instead of a bit at a time.
+ * return :
+ * >=0 first bit of the run, *run_end is set to the last bit of the run
+ * -1  if there are no bits set at or after offset
+ */
+BMP_ID bmp_get_next_set_run(BITMAP_T *bmp, BMP_ID offset, BMP_ID *run_end)
+{
+    uint32_t index;
+    unsigned int word;
+    BMP_ID start;
+
+    if (offset < 0)
+        offset = 0;
+
+    index = (uint32_t)offset >> BMP_MASK_LEN;
+    if (index >= bmp->size)
+        return BMP_INVALID_ID;
+
+    word = bmp->arr[index] & (-1U << (offset & BMP_MASK));
+    while (word == 0)
+    {
+        if (++index >= bmp->size)
+            return BMP_INVALID_ID;
+        word = bmp->arr[index];
+    }
+    start = (index * BMP_MASK_BITS) + __builtin_ctz(word);
+
+    word = ~(bmp->arr[index]) & (-1U << (start & BMP_MASK));
+    while (word == 0)
+    {
+        if (++index >= bmp->size)
+        {
+            *run_end = (bmp->size * BMP_MASK_BITS) - 1;
+            return start;
+        }
+        word = ~(bmp->arr[index]);
+    }
+    *run_end = (index * BMP_MASK_BITS) + __builtin_ctz(word) - 1;
+
+    return start;
+}
+
 BMP_ID bmp_get_next_set_bit(BITMAP_T *bmp, BMP_ID bmp_id)
 {
     return bmp_find_first_set_bit_after_offset(bmp, bmp_id);
@@ -108,6 +108,7 @@ BMP_ID bmp_find_first_unset_bit(BITMAP_T *bmp);
 BMP_ID bmp_set_first_unset_bit(BITMAP_T *bmp);
 BMP_ID bmp_get_next_set_bit(BITMAP_T *bmp, BMP_ID id);
 BMP_ID bmp_get_first_set_bit(BITMAP_T *bmp);
+BMP_ID bmp_get_next_set_run(BITMAP_T *bmp, BMP_ID offset, BMP_ID *run_end);
 unsigned int bmp_count_set_bits(BITMAP_T *bmp);
 BITMAP_T *static_mask_init(STATIC_BITMAP_T *bmp);
 void static_bmp_init(STATIC_BITMAP_T *vbmp);
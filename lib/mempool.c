@@ -0,0 +1,141 @@
+/*
+ * Copyright 2019 Broadcom. The term "Broadcom" refers to Broadcom Inc. and/or
+ * its subsidiaries.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mempool.h"
+
+static MEMPOOL *g_mempool_list;
+
+static bool mempool_grow(MEMPOOL *pool)
+{
+    MEMPOOL_SLAB *slab;
+    uint8_t *obj;
+    uint32_t i;
+
+    slab = malloc(sizeof(MEMPOOL_SLAB) + ((size_t)pool->obj_size * pool->objs_per_slab));
+    if (!slab)
+        return false;
+
+    slab->start = (uint8_t *)(slab + 1);
+    slab->end = slab->start + ((size_t)pool->obj_size * pool->objs_per_slab);
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->slab_count++;
+
+    // thread the new objects on the free list in address order
+    for (i = pool->objs_per_slab; i > 0; i--)
+    {
+        obj = slab->start + ((size_t)(i - 1) * pool->obj_size);
+        *(void **)obj = pool->free_list;
+        pool->free_list = obj;
+    }
+
+    if (!pool->registered)
+    {
+        pool->next = g_mempool_list;
+        g_mempool_list = pool;
+        pool->registered = true;
+    }
+
+    return true;
+}
+
+void *mempool_alloc(MEMPOOL *pool)
+{
+    void *obj;
+
+    if (!pool->free_list && !mempool_grow(pool))
+    {
+        pool->alloc_fail++;
+        return NULL;
+    }
+
+    obj = pool->free_list;
+    pool->free_list = *(void **)obj;
+
+    pool->alloc_count++;
+    if (++pool->in_use > pool->peak)
+        pool->peak = pool->in_use;
+
+    return obj;
+}
+
+void *mempool_zalloc(MEMPOOL *pool)
+{
+    void *obj = mempool_alloc(pool);
+
+    if (obj)
+        memset(obj, 0, pool->obj_size);
+
+    return obj;
+}
+
+void mempool_free(MEMPOOL *pool, void *obj)
+{
+    if (!obj)
+        return;
+
+    *(void **)obj = pool->free_list;
+    pool->free_list = obj;
+
+    pool->free_count++;
+    pool->in_use--;
+}
+
+bool mempool_owns(MEMPOOL *pool, void *obj)
+{
+    MEMPOOL_SLAB *slab;
+
+    for (slab = pool->slabs; slab; slab = slab->next)
+    {
+        if ((uint8_t *)obj >= slab->start && (uint8_t *)obj < slab->end)
+            return true;
+    }
+    return false;
+}
+
+MEMPOOL *mempool_get_first(void)
+{
+    return g_mempool_list;
+}
+
+MEMPOOL *mempool_get_next(MEMPOOL *pool)
+{
+    return pool->next;
+}
+
+void *mempool_avl_malloc(struct libavl_allocator *allocator, size_t size)
+{
+    MEMPOOL *pool = ((MEMPOOL_AVL_ALLOCATOR *)allocator)->pool;
+
+    if (MEMPOOL_OBJ_SIZE(size) != pool->obj_size)
+        return malloc(size);
+
+    return mempool_alloc(pool);
+}
+
+void mempool_avl_free(struct libavl_allocator *allocator, void *block)
+{
+    MEMPOOL *pool = ((MEMPOOL_AVL_ALLOCATOR *)allocator)->pool;
+
+    // the table header is the only non pool block and is freed once
+    if (mempool_owns(pool, block))
+        mempool_free(pool, block);
+    else
+        free(block);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2019 Broadcom. The term "Broadcom" refers to Broadcom Inc. and/or
+ * its subsidiaries.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MEMPOOL_H__
+#define __MEMPOOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "avl.h"
+
+//
+// Fixed size object pool.
+//
+// Objects are carved out of slabs of objs_per_slab entries and recycled
+// through a free list, so add/remove churn of ports and instances does not
+// go back to the heap. Slabs are kept for the life of the process. Pools are
+// declared statically with MEMPOOL_INITIALIZER and register themselves on
+// the global pool list the first time they grow, so there is no init order
+// to worry about.
+//
+typedef struct MEMPOOL_SLAB_S{
+    struct MEMPOOL_SLAB_S *next;
+    uint8_t *start;
+    uint8_t *end;
+}MEMPOOL_SLAB;
+
+typedef struct MEMPOOL_S{
+    const char *name;
+    uint32_t obj_size;
+    uint32_t objs_per_slab;
+    void *free_list;
+    MEMPOOL_SLAB *slabs;
+    struct MEMPOOL_S *next;     //global pool list
+    bool registered;
+
+    //stats
+    uint32_t slab_count;
+    uint32_t in_use;
+    uint32_t peak;
+    uint64_t alloc_count;
+    uint64_t free_count;
+    uint64_t alloc_fail;
+}MEMPOOL;
+
+#define MEMPOOL_OBJ_ALIGN sizeof(void *)
+#define MEMPOOL_OBJ_SIZE(_size) \
+    ((((_size) < sizeof(void *) ? sizeof(void *) : (_size)) + MEMPOOL_OBJ_ALIGN - 1) & ~(MEMPOOL_OBJ_ALIGN - 1))
+
+#define MEMPOOL_INITIALIZER(_name, _size, _per_slab) \
+    { .name = (_name), .obj_size = MEMPOOL_OBJ_SIZE(_size), .objs_per_slab = (_per_slab) }
+
+//
+// libavl allocator backed by a pool sized for struct avl_node. Anything else
+// libavl asks for (the table itself) goes to malloc.
+//
+typedef struct MEMPOOL_AVL_ALLOCATOR_S{
+    struct libavl_allocator avl_alloc;  //must be first
+    MEMPOOL *pool;
+}MEMPOOL_AVL_ALLOCATOR;
+
+#define MEMPOOL_AVL_ALLOCATOR_INITIALIZER(_pool) \
+    { { mempool_avl_malloc, mempool_avl_free }, (_pool) }
+
+void *mempool_alloc(MEMPOOL *pool);
+void *mempool_zalloc(MEMPOOL *pool);
+void mempool_free(MEMPOOL *pool, void *obj);
+bool mempool_owns(MEMPOOL *pool, void *obj);
+MEMPOOL *mempool_get_first(void);
+MEMPOOL *mempool_get_next(MEMPOOL *pool);
+void *mempool_avl_malloc(struct libavl_allocator *allocator, size_t size);
+void mempool_avl_free(struct libavl_allocator *allocator, void *block);
+
+#endif //__MEMPOOL_H__
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stp_shm.h"
+
+int stp_shm_open(STP_SHM_READER *reader)
+{
+    struct stat st;
+    int err;
+
+    memset(reader, 0, sizeof(STP_SHM_READER));
+
+    reader->fd = shm_open(STP_SHM_NAME, O_RDONLY, 0);
+    if (reader->fd < 0)
+        return -1;
+
+    if (fstat(reader->fd, &st) < 0)
+        goto fail;
+
+    if (st.st_size < (off_t)sizeof(STP_SHM_HDR))
+    {
+        errno = EPROTO;
+        goto fail;
+    }
+
+    reader->map_size = st.st_size;
+    reader->map = mmap(NULL, reader->map_size, PROT_READ, MAP_SHARED, reader->fd, 0);
+    if (reader->map == MAP_FAILED)
+        goto fail;
+
+    reader->copy = malloc(reader->map_size);
+    if (!reader->copy)
+        goto fail;
+
+    return 0;
+
+fail:
+    err = errno;
+    if (reader->map && reader->map != MAP_FAILED)
+        munmap(reader->map, reader->map_size);
+    close(reader->fd);
+    memset(reader, 0, sizeof(STP_SHM_READER));
+    reader->fd = -1;
+    errno = err;
+    return -1;
+}
+
+/*
+ * copies the segment into the reader, retrying while stpd is updating it.
+ * returns NULL with errno EAGAIN if no consistent copy could be taken, or
+ * EPROTO if the segment is not one this library understands.
+ */
+STP_SHM_HDR *stp_shm_snapshot(STP_SHM_READER *reader)
+{
+    STP_SHM_HDR *hdr = reader->map;
+    STP_SHM_HDR *copy = reader->copy;
+    uint32_t seq;
+    int i;
+
+    if (hdr->magic != STP_SHM_MAGIC || hdr->version != STP_SHM_VERSION)
+    {
+        errno = EPROTO;
+        return NULL;
+    }
+
+    for (i = 0; i < STP_SHM_READ_RETRIES; i++)
+    {
+        seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+        {
+            sched_yield();
+            continue;
+        }
+
+        memcpy(copy, hdr, reader->map_size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+
+        if (copy->size > reader->map_size
+                || copy->port_offset + ((size_t)copy->port_count * copy->port_size) > copy->size
+                || copy->inst_offset + ((size_t)copy->inst_count * copy->inst_size) > copy->size
+                || copy->port_size < sizeof(STP_SHM_PORT) || copy->inst_size < sizeof(STP_SHM_INSTANCE))
+        {
+            errno = EPROTO;
+            return NULL;
+        }
+        return copy;
+    }
+
+    errno = EAGAIN;
+    return NULL;
+}
+
+void stp_shm_close(STP_SHM_READER *reader)
+{
+    if (reader->map)
+        munmap(reader->map, reader->map_size);
+    if (reader->fd >= 0)
+        close(reader->fd);
+    free(reader->copy);
+    memset(reader, 0, sizeof(STP_SHM_READER));
+    reader->fd = -1;
+}
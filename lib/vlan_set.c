@@ -0,0 +1,345 @@
+/*
+ * Copyright 2019 Broadcom. The term "Broadcom" refers to Broadcom Inc. and/or
+ * its subsidiaries.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vlan_set.h"
+#include "l2.h"
+
+extern int vlanmask_to_string(BITMAP_T *mask, uint8_t *str, uint32_t maxlen);
+
+//
+// returns the first bit set in mask within [lo, hi], scanning a word at a time.
+// -1 if there is none.
+//
+static BMP_ID vlanset_mask_next_in_range(BITMAP_T *mask, uint32_t lo, uint32_t hi)
+{
+    uint32_t index = lo >> BMP_MASK_LEN;
+    uint32_t last = hi >> BMP_MASK_LEN;
+    unsigned int word;
+    BMP_ID bit;
+
+    if (last >= mask->size)
+        last = mask->size - 1;
+
+    if (index > last)
+        return BMP_INVALID_ID;
+
+    word = mask->arr[index] & (-1U << (lo & BMP_MASK));
+    while (word == 0)
+    {
+        if (++index > last)
+            return BMP_INVALID_ID;
+        word = mask->arr[index];
+    }
+
+    bit = (index * BMP_MASK_BITS) + __builtin_ctz(word);
+    if ((uint32_t)bit > hi)
+        return BMP_INVALID_ID;
+
+    return bit;
+}
+
+static void vlanset_add_run(VLAN_SET *set, uint16_t start, uint16_t end)
+{
+    set->runs[set->nruns].start = start;
+    set->runs[set->nruns].end = end;
+    set->nruns++;
+    set->count += (end - start + 1);
+}
+
+void vlanset_init(VLAN_SET *set)
+{
+    set->nruns = 0;
+    set->count = 0;
+    set->dense = false;
+    set->mask = NULL;
+}
+
+//
+// Builds the set from a vlan bitmap. If the bitmap has more than
+// VLAN_SET_MAX_RUNS ranges, the set refers to the bitmap itself.
+//
+void vlanset_from_mask(VLAN_SET *set, BITMAP_T *mask)
+{
+    BMP_ID start, end;
+
+    vlanset_init(set);
+
+    start = bmp_get_next_set_run(mask, MIN_VLAN_ID, &end);
+    while (start != BMP_INVALID_ID && start <= MAX_VLAN_ID)
+    {
+        if (end > MAX_VLAN_ID)
+            end = MAX_VLAN_ID;
+
+        if (set->dense)
+            set->count += (end - start + 1);
+        else if (set->nruns == VLAN_SET_MAX_RUNS)
+        {
+            set->dense = true;
+            set->mask = mask;
+            set->count += (end - start + 1);
+        }
+        else
+            vlanset_add_run(set, start, end);
+
+        start = bmp_get_next_set_run(mask, end + 1, &end);
+    }
+
+    if (set->dense)
+        set->nruns = 0;
+}
+
+bool vlanset_is_empty(VLAN_SET *set)
+{
+    return (set->count == 0);
+}
+
+bool vlanset_is_equal(VLAN_SET *set1, VLAN_SET *set2)
+{
+    if (set1->count != set2->count)
+        return false;
+
+    if (set1->dense || set2->dense)
+    {
+        if (set1->dense && set2->dense)
+            return bmp_is_mask_equal(set1->mask, set2->mask);
+
+        //a dense set can not be expressed in VLAN_SET_MAX_RUNS runs
+        return false;
+    }
+
+    if (set1->nruns != set2->nruns)
+        return false;
+
+    return (memcmp(set1->runs, set2->runs, set1->nruns * sizeof(VLAN_RUN)) == 0);
+}
+
+bool vlanset_isset(VLAN_SET *set, uint16_t vlan)
+{
+    uint16_t lo = 0, hi = set->nruns, mid;
+
+    if (set->dense)
+        return (vlan < set->mask->nbits && BMP_ISSET(set->mask, vlan));
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (vlan < set->runs[mid].start)
+            hi = mid;
+        else if (vlan > set->runs[mid].end)
+            lo = mid + 1;
+        else
+            return true;
+    }
+    return false;
+}
+
+//
+// tgt = set1 & ~set2, computed on the run lists.
+// returns false if either input is dense or the result does not fit in
+// VLAN_SET_MAX_RUNS runs; the caller has to fall back to the bitmaps then.
+//
+bool vlanset_and_not(VLAN_SET *tgt, VLAN_SET *set1, VLAN_SET *set2)
+{
+    uint16_t i, j = 0, k;
+    uint32_t start, end;
+
+    if (set1->dense || set2->dense)
+        return false;
+
+    vlanset_init(tgt);
+
+    for (i = 0; i < set1->nruns; i++)
+    {
+        start = set1->runs[i].start;
+        end = set1->runs[i].end;
+
+        while (j < set2->nruns && set2->runs[j].end < start)
+            j++;
+
+        for (k = j; start <= end; k++)
+        {
+            if (k >= set2->nruns || set2->runs[k].start > end)
+            {
+                if (tgt->nruns == VLAN_SET_MAX_RUNS)
+                    return false;
+                vlanset_add_run(tgt, start, end);
+                break;
+            }
+
+            if (set2->runs[k].start > start)
+            {
+                if (tgt->nruns == VLAN_SET_MAX_RUNS)
+                    return false;
+                vlanset_add_run(tgt, start, set2->runs[k].start - 1);
+            }
+
+            start = set2->runs[k].end + 1;
+        }
+    }
+
+    return true;
+}
+
+static uint16_t vlanset_next_from(VLAN_SET *set, uint32_t from)
+{
+    BMP_ID bit;
+    uint16_t i;
+
+    if (from > MAX_VLAN_ID)
+        return VLAN_ID_INVALID;
+
+    if (set->dense)
+    {
+        bit = vlanset_mask_next_in_range(set->mask, from, MAX_VLAN_ID);
+        return (bit == BMP_INVALID_ID) ? VLAN_ID_INVALID : bit;
+    }
+
+    for (i = 0; i < set->nruns; i++)
+    {
+        if (set->runs[i].end < from)
+            continue;
+        return (set->runs[i].start > from) ? set->runs[i].start : from;
+    }
+    return VLAN_ID_INVALID;
+}
+
+uint16_t vlanset_get_first_vlan(VLAN_SET *set)
+{
+    return vlanset_next_from(set, MIN_VLAN_ID);
+}
+
+uint16_t vlanset_get_next_vlan(VLAN_SET *set, uint16_t vlan)
+{
+    return vlanset_next_from(set, vlan + 1);
+}
+
+//
+// Iterates (set & mask) without building the intersection: pass
+// VLAN_ID_INVALID to get the first vlan. Only the words of mask covered by
+// the runs are looked at.
+//
+uint16_t vlanset_and_mask_get_next_vlan(VLAN_SET *set, BITMAP_T *mask, uint16_t vlan)
+{
+    uint32_t from = (vlan == VLAN_ID_INVALID) ? MIN_VLAN_ID : (vlan + 1);
+    uint32_t index, last;
+    unsigned int word;
+    BMP_ID bit;
+    uint16_t i;
+
+    if (from > MAX_VLAN_ID)
+        return VLAN_ID_INVALID;
+
+    if (set->dense)
+    {
+        index = from >> BMP_MASK_LEN;
+        last = ((set->mask->size < mask->size) ? set->mask->size : mask->size);
+        for (; index < last; index++)
+        {
+            word = set->mask->arr[index] & mask->arr[index];
+            if (index == (from >> BMP_MASK_LEN))
+                word &= (-1U << (from & BMP_MASK));
+            if (word)
+            {
+                bit = (index * BMP_MASK_BITS) + __builtin_ctz(word);
+                return (bit <= MAX_VLAN_ID) ? bit : VLAN_ID_INVALID;
+            }
+        }
+        return VLAN_ID_INVALID;
+    }
+
+    for (i = 0; i < set->nruns; i++)
+    {
+        if (set->runs[i].end < from)
+            continue;
+
+        bit = vlanset_mask_next_in_range(mask,
+                (set->runs[i].start > from) ? set->runs[i].start : from, set->runs[i].end);
+        if (bit != BMP_INVALID_ID)
+            return bit;
+    }
+    return VLAN_ID_INVALID;
+}
+
+bool vlanset_and_mask_is_clear(VLAN_SET *set, BITMAP_T *mask)
+{
+    return (vlanset_and_mask_get_next_vlan(set, mask, VLAN_ID_INVALID) == VLAN_ID_INVALID);
+}
+
+//
+// tgt = set & mask
+//
+void vlanset_and_mask(BITMAP_T *tgt, VLAN_SET *set, BITMAP_T *mask)
+{
+    uint32_t index, last, lo, hi;
+    unsigned int bits;
+    uint16_t i;
+
+    if (set->dense)
+    {
+        bmp_and_masks(tgt, set->mask, mask);
+        return;
+    }
+
+    bmp_reset_all(tgt);
+
+    for (i = 0; i < set->nruns; i++)
+    {
+        lo = set->runs[i].start;
+        hi = set->runs[i].end;
+        last = hi >> BMP_MASK_LEN;
+        for (index = lo >> BMP_MASK_LEN; index <= last; index++)
+        {
+            if (index >= tgt->size || index >= mask->size)
+                return;
+
+            bits = -1U;
+            if (index == (lo >> BMP_MASK_LEN))
+                bits &= (-1U << (lo & BMP_MASK));
+            if (index == last && (hi & BMP_MASK) != BMP_MASK)
+                bits &= ((1U << ((hi & BMP_MASK) + 1)) - 1);
+
+            tgt->arr[index] |= (mask->arr[index] & bits);
+        }
+    }
+}
+
+int vlanset_to_string(VLAN_SET *set, uint8_t *str, uint32_t maxlen)
+{
+    uint32_t len = 0;
+    uint16_t i;
+
+    if (str == NULL)
+        return false;
+
+    if (set->dense)
+        return vlanmask_to_string(set->mask, str, maxlen);
+
+    *str = '\0';
+
+    for (i = 0; i < set->nruns; i++)
+    {
+        if (len >= maxlen)
+            return false;
+
+        if (set->runs[i].start == set->runs[i].end)
+            len += snprintf((char *)str+len, maxlen-len, "%d ", set->runs[i].start);
+        else
+            len += snprintf((char *)str+len, maxlen-len, "%d to %d ", set->runs[i].start, set->runs[i].end);
+    }
+
+    return len;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2019 Broadcom. The term "Broadcom" refers to Broadcom Inc. and/or
+ * its subsidiaries.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __VLAN_SET_H__
+#define __VLAN_SET_H__
+
+#include "bitmap.h"
+
+//
+// Compact VLAN set.
+//
+// Production VLAN sets are usually a handful of contiguous ranges, so the set
+// is kept as a sorted list of [start, end] runs. Sets too fragmented for the
+// run list fall back to a dense bitmap which is borrowed from the owner (the
+// set never copies the 4K bitmap), so the owner must keep it alive for as
+// long as the set is used.
+//
+#define VLAN_SET_MAX_RUNS 32
+
+typedef struct VLAN_RUN_S{
+    uint16_t start;
+    uint16_t end;
+}VLAN_RUN;
+
+typedef struct VLAN_SET_S{
+    uint16_t nruns;
+    uint16_t count;     //number of vlans in the set
+    uint8_t  dense;     //runs[] is not used, vlans are in mask
+    BITMAP_T *mask;
+    VLAN_RUN runs[VLAN_SET_MAX_RUNS];
+}VLAN_SET;
+
+void vlanset_init(VLAN_SET *set);
+void vlanset_from_mask(VLAN_SET *set, BITMAP_T *mask);
+bool vlanset_is_empty(VLAN_SET *set);
+bool vlanset_is_equal(VLAN_SET *set1, VLAN_SET *set2);
+bool vlanset_isset(VLAN_SET *set, uint16_t vlan);
+bool vlanset_and_not(VLAN_SET *tgt, VLAN_SET *set1, VLAN_SET *set2);
+uint16_t vlanset_get_first_vlan(VLAN_SET *set);
+uint16_t vlanset_get_next_vlan(VLAN_SET *set, uint16_t vlan);
+uint16_t vlanset_and_mask_get_next_vlan(VLAN_SET *set, BITMAP_T *mask, uint16_t vlan);
+bool vlanset_and_mask_is_clear(VLAN_SET *set, BITMAP_T *mask);
+void vlanset_and_mask(BITMAP_T *tgt, VLAN_SET *set, BITMAP_T *mask);
+int vlanset_to_string(VLAN_SET *set, uint8_t *str, uint32_t maxlen);
+
+#endif //__VLAN_SET_H__
@@ -38,47 +38,28 @@ VLAN_ID vlanmask_get_next_vlan(void *bmp,VLAN_ID vlan)
     return i;
 }
 
+/*
+ * Encodes the vlan mask as ranges, e.g. "1 10 to 20 100 ".
+ * Runs are located a word at a time (see bmp_get_next_set_run), so the cost
+ * is proportional to the number of ranges rather than to the 4K vlan space.
+ */
 int vlanmask_to_string(BITMAP_T *mask, uint8_t *str, uint32_t maxlen)
 {
-    uint32_t i;
     uint32_t len;
-    VLAN_ID start_vlan, end_vlan;
+    BMP_ID start_vlan, end_vlan;
 
     if (str == NULL)
         return false;
 
     *str = '\0';
     len = 0;
-    start_vlan = end_vlan = VLAN_ID_INVALID;
 
-    for (i = MIN_VLAN_ID; i <= MAX_VLAN_ID; i++)
+    start_vlan = bmp_get_next_set_run(mask, MIN_VLAN_ID, &end_vlan);
+    while (start_vlan != BMP_INVALID_ID && start_vlan <= MAX_VLAN_ID)
     {
-        if (VLANMASK_ISSET(mask, i))
-        {
-            if (start_vlan == VLAN_ID_INVALID)
-            {
-                start_vlan = i;
-            }
-            end_vlan = i;
-            continue;
-        }
-
-        if (start_vlan != VLAN_ID_INVALID)
-        {
-            if (len >= maxlen)
-                return false;
-
-            if (start_vlan == end_vlan)
-                len += snprintf((char *)str+len, maxlen-len, "%d ", start_vlan);
-            else
-                len += snprintf((char *)str+len, maxlen-len, "%d to %d ", start_vlan, end_vlan);
+        if (end_vlan > MAX_VLAN_ID)
+            end_vlan = MAX_VLAN_ID;
 
-            start_vlan = end_vlan = VLAN_ID_INVALID;
-        }
-    }
-
-    if (start_vlan != VLAN_ID_INVALID)
-    {
         if (len >= maxlen)
             return false;
 
@@ -86,6 +67,8 @@ int vlanmask_to_string(BITMAP_T *mask, uint8_t *str, uint32_t maxlen)
             len += snprintf((char *)str+len, maxlen-len, "%d ", start_vlan);
         else
             len += snprintf((char *)str+len, maxlen-len, "%d to %d ", start_vlan, end_vlan);
+
+        start_vlan = bmp_get_next_set_run(mask, end_vlan + 1, &end_vlan);
     }
 
     return len;
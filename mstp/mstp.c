@@ -483,7 +483,8 @@ bool mstp_flush(MSTP_INDEX mstp_index, PORT_ID port_number)
 bool mstp_fromSameRegion(MSTP_PORT *mstp_port, MSTP_BPDU *bpdu)
 {
 	MSTP_BRIDGE *mstp_bridge = mstpdata_get_bridge();
-	
+
+	mstputil_update_message_digest();
 	if (mstp_bridge->forceVersion >= MSTP_VERSION_ID && 
 		mstp_port->rcvdRSTP &&
 		bpdu->protocol_version_id == MSTP_VERSION_ID &&
@@ -1116,9 +1117,37 @@ void mstp_setReselectTree(MSTP_INDEX mstp_index)
 	if (cbridge)
 	{
 		cbridge->reselect = true;
+		cbridge->rolesValid = false;
 	}
 }
 
+// setReselectTree for a change of the port priority vector of a single port,
+// lets role selection recompute only the ports that changed
+void mstp_setReselectPort(MSTP_INDEX mstp_index, PORT_ID port_number)
+{
+	MSTP_COMMON_BRIDGE *cbridge;
+	UINT8 i;
+
+	cbridge = mstputil_get_common_bridge(mstp_index);
+	if (cbridge == NULL)
+		return;
+
+	cbridge->reselect = true;
+	if (!cbridge->rolesValid || cbridge->reselectCount > MSTP_RESELECT_PORTS_MAX)
+		return;
+
+	for (i = 0; i < cbridge->reselectCount; i++)
+	{
+		if (cbridge->reselectPorts[i] == port_number)
+			return;
+	}
+
+	if (cbridge->reselectCount < MSTP_RESELECT_PORTS_MAX)
+		cbridge->reselectPorts[cbridge->reselectCount] = port_number;
+	// one past the end means too many ports changed, do a full selection
+	cbridge->reselectCount++;
+}
+
 // 13.26.21
 void mstp_setSelectedTree(MSTP_INDEX mstp_index)
 {
@@ -1410,6 +1439,7 @@ void mstp_txMstp(PORT_ID port_number)
 	bpdu->protocol_version_id = MSTP_VERSION_ID;
 
 	bpdu->v3_length = MSTP_BPDU_BASE_V3_LENGTH; // will be modified later if needed
+	mstputil_update_message_digest();
 	bpdu->mst_config_id = mstp_bridge->mstConfigId;
 	bpdu->cist_int_path_cost = cist_port->designatedPriority.intPathCost;
 	bpdu->cist_bridge = cist_port->designatedPriority.designatedId;
@@ -1589,6 +1619,178 @@ void mstp_updtRcvdInfoWhileMsti(MSTP_INDEX mstp_index, PORT_ID port_number)
     }
 }
 
+/*
+ * incremental role selection
+ *
+ * the pim records the ports whose port priority vector changed in the tree
+ * (mstp_setReselectPort). when the root port is not one of them and none of
+ * them offers a root path priority vector at least as good as the current
+ * root priority vector, the root priority vector, root port and root times
+ * are unchanged, so only the roles of the changed ports need to be
+ * recomputed. any other reselect (mstp_setReselectTree) or a change of the
+ * root port's own information falls back to a scan of all ports.
+ */
+
+// 13.27.31 - role of a cist port with received information, returns true and
+// the root path priority vector if the port is a root port candidate
+static bool mstp_updtRolesCistReceived(MSTP_CIST_BRIDGE *cist_bridge, MSTP_PORT *mstp_port,
+    PORT_ID port_number, MSTP_CIST_VECTOR *rootPathPriority)
+{
+    MSTP_CIST_PORT *cist_port = MSTP_GET_CIST_PORT(mstp_port);
+
+    cist_port->co.updtInfo = false;
+
+    if (cist_port->co.infoIs != MSTP_INFOIS_RECEIVED)
+        return false;
+
+    if (mstputil_compare_cist_bridge_id(&cist_port->portPriority.designatedId,
+                &cist_bridge->co.bridgeIdentifier) == EQUAL_TO)
+    {
+        cist_port->co.selectedRole = MSTP_ROLE_BACKUP;
+        STP_LOG_INFO("[MST %u] Port %d Role BACKUP", MSTP_MSTID_CIST, port_number);
+        return false;
+    }
+
+    cist_port->co.selectedRole = MSTP_ROLE_ALTERNATE;
+    *rootPathPriority = cist_port->portPriority;
+
+    if (mstp_port->rcvdInternal)
+    {
+        rootPathPriority->intPathCost += cist_port->co.intPortPathCost;
+    }
+    else
+    {
+        rootPathPriority->extPathCost += cist_port->extPortPathCost;
+        rootPathPriority->regionalRoot = cist_bridge->co.bridgeIdentifier;
+    }
+
+    if (mstp_port->restrictedRole)
+    {
+        STP_SYSLOG("MSTP: Root Guard interface %d MST%u inconsistent (Received superior BPDU)",
+                port_number, MSTP_MSTID_CIST);
+        SET_BIT(cist_port->co.modified_fields, MSTP_PORT_MEMBER_PORT_STATE_BIT);
+        return false;
+    }
+
+    return true;
+}
+
+// 13.27.31 - designated priority and role of a cist port once the root port
+// is known, returns false on an invalid infoIs
+static bool mstp_updtRolesCistDesignated(MSTP_CIST_BRIDGE *cist_bridge, MSTP_PORT *mstp_port,
+    PORT_ID port_number, PORT_ID root_port)
+{
+    MSTP_CIST_PORT *cist_port = MSTP_GET_CIST_PORT(mstp_port);
+    MSTP_INDEX mstp_index;
+
+    mstputil_compute_cist_designated_priority(cist_bridge, mstp_port);
+    cist_port->designatedTimes = cist_bridge->rootTimes;
+
+    if (port_number != root_port) // root_port may be MSTP_INVALID_PORT
+    {
+        switch (cist_port->co.infoIs)
+        {
+            case MSTP_INFOIS_DISABLED:
+                cist_port->co.selectedRole = MSTP_ROLE_DISABLED;
+                break;
+
+            case MSTP_INFOIS_AGED:
+                if(cist_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
+                    STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_AGED)", MSTP_MSTID_CIST, port_number);
+                cist_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
+                cist_port->co.updtInfo = true;
+                break;
+
+            case MSTP_INFOIS_MINE:
+                if(cist_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
+                    STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_MINE)", MSTP_MSTID_CIST, port_number);
+                cist_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
+                if ((mstputil_compare_cist_vectors(&cist_port->portPriority,
+                                &cist_port->designatedPriority) != EQUAL_TO) ||
+                        (mstputil_are_cist_times_equal(&cist_port->portTimes,
+                                                       &cist_port->designatedTimes) == false))
+                {
+                    cist_port->co.updtInfo = true;
+                }
+                break;
+
+            case MSTP_INFOIS_RECEIVED:
+                if (mstputil_compare_cist_vectors(&cist_port->designatedPriority,
+                            &cist_port->portPriority) == LESS_THAN)
+                {
+                    if(cist_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
+                        STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_RECEIVED)", MSTP_MSTID_CIST, port_number);
+                    cist_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
+                    cist_port->co.updtInfo = true;
+                }
+                break;
+
+            default:
+                // print error
+                return false;
+        }
+    }
+
+    if(cist_port->co.selectedRole == MSTP_ROLE_ALTERNATE)
+        STP_LOG_INFO("[MST %u] Port %d Role Alternate", MSTP_MSTID_CIST, port_number);
+
+    if (!mstp_port->rcvdInternal && (cist_port->co.selectedRole != cist_port->co.role))
+    {
+        // boundary port - when role changes signal to the mstis as well
+        mstp_index = l2_proto_get_first_instance(&mstp_port->instance_mask);
+        while (mstp_index != L2_PROTO_INDEX_INVALID)
+        {
+            mstp_setReselectTree(mstp_index);
+            mstp_index = l2_proto_get_next_instance(&mstp_port->instance_mask, mstp_index);
+        }
+    }
+
+    return true;
+}
+
+// recomputes the roles of the ports recorded by mstp_setReselectPort only,
+// returns false if a full role selection is required
+static bool mstp_updtRolesCistPorts(MSTP_BRIDGE *mstp_bridge, MSTP_CIST_BRIDGE *cist_bridge)
+{
+    MSTP_COMMON_BRIDGE *cbridge = &cist_bridge->co;
+    MSTP_CIST_VECTOR rootPathPriority;
+    MSTP_PORT *mstp_port;
+    PORT_ID port_number;
+    UINT8 i;
+
+    if (!cbridge->rolesValid || cbridge->reselectCount > MSTP_RESELECT_PORTS_MAX)
+        return false;
+
+    for (i = 0; i < cbridge->reselectCount; i++)
+    {
+        port_number = cbridge->reselectPorts[i];
+        if (port_number == cbridge->rootPortId)
+            return false;
+
+        if (!IS_MEMBER(mstp_bridge->enable_mask, port_number) ||
+                (mstp_port = mstpdata_get_port(port_number)) == NULL)
+            continue;
+
+        if (mstp_updtRolesCistReceived(cist_bridge, mstp_port, port_number, &rootPathPriority) &&
+                mstputil_compare_cist_vectors(&rootPathPriority, &cist_bridge->rootPriority) != GREATER_THAN)
+            return false;
+    }
+
+    for (i = 0; i < cbridge->reselectCount; i++)
+    {
+        port_number = cbridge->reselectPorts[i];
+        if (!IS_MEMBER(mstp_bridge->enable_mask, port_number) ||
+                (mstp_port = mstpdata_get_port(port_number)) == NULL)
+            continue;
+
+        if (!mstp_updtRolesCistDesignated(cist_bridge, mstp_port, port_number, cbridge->rootPortId))
+            break;
+    }
+
+    cbridge->reselectCount = 0;
+    return true;
+}
+
 // 13.27.31
 void mstp_updtRolesCist(MSTP_INDEX mstp_index)
 {
@@ -1596,11 +1798,10 @@ void mstp_updtRolesCist(MSTP_INDEX mstp_index)
     MSTP_BRIDGE *mstp_bridge;
     MSTP_CIST_BRIDGE *cist_bridge;
     MSTP_PORT *mstp_port;
-    MSTP_CIST_PORT *cist_port, *cist_root_port;
+    MSTP_CIST_PORT *cist_root_port;
     MSTP_CIST_VECTOR rootPathPriority, rootPriority, oldRootPriority;
     bool changedMaster;
     UINT8	root_id_string[20];
-    bool flag = true;
     MSTP_COMMON_BRIDGE *cbridge;
     
     if (!MSTP_IS_CIST_INDEX(mstp_index))
@@ -1615,6 +1816,9 @@ void mstp_updtRolesCist(MSTP_INDEX mstp_index)
     cist_bridge = MSTP_GET_CIST_BRIDGE(mstp_bridge);
     cbridge = &cist_bridge->co;
 
+    if (mstp_updtRolesCistPorts(mstp_bridge, cist_bridge))
+        return;
+
     rootPriority = cist_bridge->bridgePriority;
 
     oldRootPriority = cist_bridge->rootPriority;
@@ -1624,48 +1828,13 @@ void mstp_updtRolesCist(MSTP_INDEX mstp_index)
     while (port_number != BAD_PORT_ID)
     {
         mstp_port = mstpdata_get_port(port_number);
-        if (mstp_port)
+        if (mstp_port &&
+                mstp_updtRolesCistReceived(cist_bridge, mstp_port, port_number, &rootPathPriority) &&
+                (mstputil_compare_cist_vectors(&rootPathPriority, &rootPriority) == LESS_THAN))
         {
-            cist_port = MSTP_GET_CIST_PORT(mstp_port);
-            if (cist_port->co.infoIs == MSTP_INFOIS_RECEIVED)
-            {
-                if (mstputil_compare_cist_bridge_id(&cist_port->portPriority.designatedId,
-                            &cist_bridge->co.bridgeIdentifier) == EQUAL_TO)
-                {
-                    cist_port->co.selectedRole = MSTP_ROLE_BACKUP;
-                    STP_LOG_INFO("[MST %u] Port %d Role BACKUP", MSTP_MSTID_CIST, port_number);
-                }
-                else
-                {
-                    cist_port->co.selectedRole = MSTP_ROLE_ALTERNATE;
-                    rootPathPriority = cist_port->portPriority;
-
-                    if (mstp_port->rcvdInternal)
-                    {
-                        rootPathPriority.intPathCost += cist_port->co.intPortPathCost;
-                    }
-                    else
-                    {
-                        rootPathPriority.extPathCost += cist_port->extPortPathCost;
-                        rootPathPriority.regionalRoot = cist_bridge->co.bridgeIdentifier;
-                    }
-
-                    if ((mstputil_compare_cist_vectors(&rootPathPriority, &rootPriority) == LESS_THAN) && 
-                            (!mstp_port->restrictedRole))
-                    {
-                        root_port = port_number;
-                        cist_root_port = cist_port;
-                        rootPriority = rootPathPriority;
-                    }
-                    if(cist_port->co.selectedRole == MSTP_ROLE_ALTERNATE && mstp_port->restrictedRole)
-                    {
-                        STP_SYSLOG("MSTP: Root Guard interface %d MST%u inconsistent (Received superior BPDU)",
-                                port_number, MSTP_MSTID_CIST);
-                        SET_BIT(cist_port->co.modified_fields, MSTP_PORT_MEMBER_PORT_STATE_BIT);
-                    }
-                }
-            }
-            cist_port->co.updtInfo = false;
+            root_port = port_number;
+            cist_root_port = MSTP_GET_CIST_PORT(mstp_port);
+            rootPriority = rootPathPriority;
         }
 
         port_number = port_mask_get_next_port(mstp_bridge->enable_mask, port_number);
@@ -1741,71 +1910,18 @@ void mstp_updtRolesCist(MSTP_INDEX mstp_index)
             if (changedMaster)
                 mstputil_set_changedMaster(mstp_port);
 
-            cist_port = MSTP_GET_CIST_PORT(mstp_port);
-            mstputil_compute_cist_designated_priority(cist_bridge, mstp_port);
-            cist_port->designatedTimes = cist_bridge->rootTimes;
-
-            if (port_number != root_port) // root_port may be MSTP_INVALID_PORT
+            if (!mstp_updtRolesCistDesignated(cist_bridge, mstp_port, port_number, root_port))
             {
-                switch (cist_port->co.infoIs)
-                {
-                    case MSTP_INFOIS_DISABLED:
-                        cist_port->co.selectedRole = MSTP_ROLE_DISABLED;
-                        break;
-
-                    case MSTP_INFOIS_AGED:
-                        if(cist_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
-                            STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_AGED)", MSTP_MSTID_CIST, port_number);
-                        cist_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
-                        cist_port->co.updtInfo = true;
-                        break;
-
-                    case MSTP_INFOIS_MINE:
-                        if(cist_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
-                            STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_MINE)", MSTP_MSTID_CIST, port_number);
-                        cist_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
-                        if ((mstputil_compare_cist_vectors(&cist_port->portPriority,
-                                        &cist_port->designatedPriority) != EQUAL_TO) ||
-                                (mstputil_are_cist_times_equal(&cist_port->portTimes,
-                                                               &cist_port->designatedTimes) == false))
-                        {
-                            cist_port->co.updtInfo = true;
-                        }
-                        break;
-
-                    case MSTP_INFOIS_RECEIVED:
-                        if (mstputil_compare_cist_vectors(&cist_port->designatedPriority,
-                                    &cist_port->portPriority) == LESS_THAN)
-                        {
-                            if(cist_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
-                                STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_RECEIVED)", MSTP_MSTID_CIST, port_number);
-                            cist_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
-                            cist_port->co.updtInfo = true;
-                        }
-                        break;
-
-                    default:
-                        // print error
-                        return;
-                }
-            }
-        }
-        if(cist_port->co.selectedRole == MSTP_ROLE_ALTERNATE)
-            STP_LOG_INFO("[MST %u] Port %d Role Alternate", MSTP_MSTID_CIST, port_number);
-
-        if (mstp_port && !mstp_port->rcvdInternal && (cist_port->co.selectedRole != cist_port->co.role))
-        {
-            // boundary port - when role changes signal to the mstis as well
-            mstp_index = l2_proto_get_first_instance(&mstp_port->instance_mask);
-            while (mstp_index != L2_PROTO_INDEX_INVALID)
-            {
-                mstp_setReselectTree(mstp_index);
-                mstp_index = l2_proto_get_next_instance(&mstp_port->instance_mask, mstp_index);
+                cbridge->rolesValid = false;
+                return;
             }
         }
         port_number = port_mask_get_next_port(mstp_bridge->enable_mask, port_number);
     }
 
+    cbridge->rolesValid = true;
+    cbridge->reselectCount = 0;
+
     mstputil_bridge_to_string(&rootPriority.root, root_id_string, sizeof(root_id_string));
     if (mstputil_compare_cist_bridge_id(&rootPriority.root, &oldRootPriority.root) != EQUAL_TO)
     {
@@ -1832,22 +1948,272 @@ void mstp_updtRolesCist(MSTP_INDEX mstp_index)
         }
 }
 
+// 13.27.31 - role of an msti port with received information, returns true
+// and the root path priority vector if the port is a root port candidate
+static bool mstp_updtRolesMstiReceived(MSTP_MSTI_BRIDGE *msti_bridge, MSTP_PORT *mstp_port,
+    MSTP_MSTI_PORT *msti_port, PORT_ID port_number, MSTP_MSTI_VECTOR *rootPathPriority)
+{
+    MSTP_MSTID mstid = MSTP_GET_MSTID_FROM_MSTI(msti_bridge);
+
+    msti_port->co.updtInfo = false;
+
+    if (msti_port->co.infoIs != MSTP_INFOIS_RECEIVED)
+        return false;
+
+    if (mstputil_compare_bridge_id(&msti_port->portPriority.designatedId,
+                &msti_bridge->co.bridgeIdentifier) == EQUAL_TO)
+    {
+        msti_port->co.selectedRole = MSTP_ROLE_BACKUP;
+        STP_LOG_INFO("[MST %u] Port %d Role BACKUP", mstid, port_number);
+        return false;
+    }
+
+    msti_port->co.selectedRole = MSTP_ROLE_ALTERNATE;
+    *rootPathPriority = msti_port->portPriority;
+
+    if (mstp_port->rcvdInternal)
+    {
+        rootPathPriority->intPathCost += msti_port->co.intPortPathCost;
+    }
+
+    if (mstp_port->restrictedRole)
+    {
+        STP_SYSLOG("MSTP: Root Guard interface %d MST%u inconsistent (Received superior BPDU)",
+                port_number, mstid);
+        SET_BIT(msti_port->co.modified_fields, MSTP_PORT_MEMBER_PORT_STATE_BIT);
+        return false;
+    }
+
+    return true;
+}
+
+// 13.27.31 - designated priority and role of an msti port once the root port
+// is known, returns false on an invalid infoIs
+static bool mstp_updtRolesMstiDesignated(MSTP_MSTI_BRIDGE *msti_bridge, MSTP_PORT *mstp_port,
+    MSTP_MSTI_PORT *msti_port, PORT_ID port_number, PORT_ID root_port)
+{
+    MSTP_MSTID mstid = MSTP_GET_MSTID_FROM_MSTI(msti_bridge);
+    MSTP_CIST_PORT *cist_port;
+    bool flag = true;
+
+    mstputil_compute_msti_designated_priority(msti_bridge, msti_port);
+    msti_port->designatedTimes = msti_bridge->rootTimes;
+    cist_port = MSTP_GET_CIST_PORT(mstp_port);
+
+    if ((cist_port->co.infoIs != MSTP_INFOIS_RECEIVED) ||
+            (mstp_port->rcvdInternal))
+    {
+        // received inside the region - look at msti infoIs
+        switch (msti_port->co.infoIs)
+        {
+            case MSTP_INFOIS_DISABLED:
+                msti_port->co.selectedRole = MSTP_ROLE_DISABLED;
+                break;
+
+            case MSTP_INFOIS_AGED:
+                if(msti_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
+                    STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_AGED)", mstid, port_number);
+                msti_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
+                msti_port->co.updtInfo = true;
+                break;
+
+            case MSTP_INFOIS_MINE:
+                if(msti_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
+                    STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_MINE)", mstid, port_number);
+
+                msti_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
+                if ((mstputil_compare_msti_vectors(&msti_port->portPriority,
+                                &msti_port->designatedPriority) != EQUAL_TO) ||
+                        (msti_port->portTimes.remainingHops !=
+                         msti_port->designatedTimes.remainingHops))
+                {
+                    msti_port->co.updtInfo = true;
+                }
+                break;
+
+            case MSTP_INFOIS_RECEIVED:
+                if (port_number != root_port)
+                {
+                    if (mstputil_compare_msti_vectors(&msti_port->designatedPriority,
+                                &msti_port->portPriority) == LESS_THAN)
+                    {
+                        if(msti_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
+                            STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_RECEIVED)", mstid, port_number);
+                        msti_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
+                        msti_port->co.updtInfo = true;
+                    }
+                }
+                break;
+
+            default:
+                // print error
+                return false;
+        }
+    }
+    else
+    {
+        // received from outside the region - look at cist selected role.
+        switch (cist_port->co.selectedRole)
+        {
+            case MSTP_ROLE_ROOT:
+                if(msti_port->co.selectedRole != MSTP_ROLE_MASTER)
+                    STP_LOG_INFO("[MST %u] Port %d Role Master", mstid, port_number);
+                msti_port->co.selectedRole = MSTP_ROLE_MASTER;
+                if ((mstputil_compare_msti_vectors(&msti_port->portPriority,
+                                &msti_port->designatedPriority) != EQUAL_TO) ||
+                        (msti_port->portTimes.remainingHops !=
+                         msti_port->designatedTimes.remainingHops))
+                {
+                    msti_port->co.updtInfo = true;
+                }
+                break;
+
+            case MSTP_ROLE_ALTERNATE:
+                if(msti_port->co.selectedRole != MSTP_ROLE_ALTERNATE)
+                {
+                    flag = false;
+                    STP_LOG_INFO("[MST %u] Port %d Role Alternate", mstid, port_number);
+                }
+                msti_port->co.selectedRole = MSTP_ROLE_ALTERNATE;
+                if ((mstputil_compare_msti_vectors(&msti_port->portPriority,
+                                &msti_port->designatedPriority) != EQUAL_TO) ||
+                        (msti_port->portTimes.remainingHops !=
+                         msti_port->designatedTimes.remainingHops))
+                {
+                    msti_port->co.updtInfo = true;
+                }
+                break;
+        }
+    }
+
+    if(flag && (msti_port->co.selectedRole == MSTP_ROLE_ALTERNATE))
+        STP_LOG_INFO("[MST %u] Port %d Role Alternate", mstid, port_number);
+
+    return true;
+}
+
+/*
+ * sets the master flag for all ports if mastered is set for any designated
+ * or root port or the bridge has selected one of the ports as the master
+ * port. see section 13.24.13 and 13.24.14 for more information.
+ */
+static void mstp_updtMasterMsti(MSTP_INDEX mstp_index, PORT_MASK *msti_enable_mask)
+{
+    bool masterSelected, masteredSet;
+    PORT_ID port_number;
+    MSTP_MSTI_PORT *msti_port;
+
+    masterSelected = masteredSet = false;
+
+    port_number = port_mask_get_first_port(msti_enable_mask);
+    while (port_number != BAD_PORT_ID)
+    {
+        msti_port = MSTP_GET_MSTI_PORT(mstpdata_get_port(port_number), mstp_index);
+
+        if (msti_port->co.selectedRole == MSTP_ROLE_MASTER)
+            masterSelected = true;
+
+        if ((msti_port->co.selectedRole == MSTP_ROLE_DESIGNATED ||
+                    msti_port->co.selectedRole == MSTP_ROLE_ROOT) &&
+                msti_port->mastered)
+        {
+            masteredSet = true;
+        }
+        msti_port->master = false;
+
+        port_number = port_mask_get_next_port(msti_enable_mask, port_number);
+    }
+
+    if (masteredSet || masterSelected)
+    {
+        port_number = port_mask_get_first_port(msti_enable_mask);
+        while (port_number != BAD_PORT_ID)
+        {
+            msti_port = MSTP_GET_MSTI_PORT(mstpdata_get_port(port_number), mstp_index);
+
+            if (msti_port->co.role == MSTP_ROLE_DESIGNATED ||
+                    msti_port->co.role == MSTP_ROLE_ROOT)
+            {
+                msti_port->master = true;
+            }
+
+            port_number = port_mask_get_next_port(msti_enable_mask, port_number);
+        }
+    }
+}
+
+// recomputes the roles of the ports recorded by mstp_setReselectPort only,
+// returns false if a full role selection is required. msti_enable_mask is
+// reduced to the ports that have an msti port.
+static bool mstp_updtRolesMstiPorts(MSTP_INDEX mstp_index, MSTP_MSTI_BRIDGE *msti_bridge,
+    PORT_MASK *msti_enable_mask)
+{
+    MSTP_COMMON_BRIDGE *cbridge = &msti_bridge->co;
+    MSTP_MSTI_VECTOR rootPathPriority;
+    MSTP_PORT *mstp_port;
+    MSTP_MSTI_PORT *msti_port;
+    PORT_ID port_number;
+    UINT8 i;
+
+    if (!cbridge->rolesValid || cbridge->reselectCount > MSTP_RESELECT_PORTS_MAX)
+        return false;
+
+    for (i = 0; i < cbridge->reselectCount; i++)
+    {
+        port_number = cbridge->reselectPorts[i];
+        if (port_number == cbridge->rootPortId)
+            return false;
+
+        if (!IS_MEMBER(msti_enable_mask, port_number) ||
+                (mstp_port = mstpdata_get_port(port_number)) == NULL ||
+                (msti_port = MSTP_GET_MSTI_PORT(mstp_port, mstp_index)) == NULL)
+            continue;
+
+        if (mstp_updtRolesMstiReceived(msti_bridge, mstp_port, msti_port, port_number, &rootPathPriority) &&
+                mstputil_compare_msti_vectors(&rootPathPriority, &msti_bridge->rootPriority) != GREATER_THAN)
+            return false;
+    }
+
+    for (i = 0; i < cbridge->reselectCount; i++)
+    {
+        port_number = cbridge->reselectPorts[i];
+        if (!IS_MEMBER(msti_enable_mask, port_number) ||
+                (mstp_port = mstpdata_get_port(port_number)) == NULL ||
+                (msti_port = MSTP_GET_MSTI_PORT(mstp_port, mstp_index)) == NULL)
+            continue;
+
+        if (!mstp_updtRolesMstiDesignated(msti_bridge, mstp_port, msti_port, port_number, cbridge->rootPortId))
+            break;
+    }
+    cbridge->reselectCount = 0;
+
+    // master flags depend on all ports of the tree
+    port_number = port_mask_get_first_port(msti_enable_mask);
+    while (port_number != BAD_PORT_ID)
+    {
+        mstp_port = mstpdata_get_port(port_number);
+        if (mstp_port == NULL || MSTP_GET_MSTI_PORT(mstp_port, mstp_index) == NULL)
+            clear_mask_bit(msti_enable_mask, port_number);
+        port_number = port_mask_get_next_port(msti_enable_mask, port_number);
+    }
+    mstp_updtMasterMsti(mstp_index, msti_enable_mask);
+
+    return true;
+}
+
 // 13.27.31
 void mstp_updtRolesMsti(MSTP_INDEX mstp_index)
 {
-    bool masterSelected, masteredSet;
     PORT_ID port_number, root_port, old_root_port;
     MSTP_BRIDGE *mstp_bridge;
     MSTP_MSTI_BRIDGE *msti_bridge;
     MSTP_PORT *mstp_port;
-    MSTP_CIST_PORT *cist_port;
     MSTP_MSTI_PORT *msti_port, *msti_root_port;
     MSTP_MSTI_VECTOR rootPathPriority, rootPriority, oldRootPriority;
     PORT_MASK_LOCAL l_msti_enable_mask;
     PORT_MASK *msti_enable_mask = portmask_local_init(&l_msti_enable_mask);
     MSTP_MSTID mstid;
     UINT8	root_id_string[20];
-    bool flag = true;
     MSTP_COMMON_BRIDGE *cbridge;
 
     mstp_bridge = mstpdata_get_bridge();
@@ -1861,10 +2227,13 @@ void mstp_updtRolesMsti(MSTP_INDEX mstp_index)
 
     root_port = MSTP_INVALID_PORT;
     msti_root_port = NULL;
-    masterSelected = masteredSet = false;
 
     mstid = MSTP_GET_MSTID_FROM_MSTI(msti_bridge);
     and_masks(msti_enable_mask, msti_bridge->co.portmask, mstp_bridge->enable_mask);
+
+    if (mstp_updtRolesMstiPorts(mstp_index, msti_bridge, msti_enable_mask))
+        return;
+
     rootPriority = msti_bridge->bridgePriority;
 
     oldRootPriority = msti_bridge->rootPriority;
@@ -1884,44 +2253,12 @@ void mstp_updtRolesMsti(MSTP_INDEX mstp_index)
             // clear port so that next loop does not need any of these checks.
             clear_mask_bit(msti_enable_mask, port_number);
         }
-        else
+        else if (mstp_updtRolesMstiReceived(msti_bridge, mstp_port, msti_port, port_number, &rootPathPriority) &&
+                (mstputil_compare_msti_vectors(&rootPathPriority, &rootPriority) == LESS_THAN))
         {
-            msti_port->co.updtInfo = false;
-
-            if (msti_port->co.infoIs == MSTP_INFOIS_RECEIVED)
-            {
-                if (mstputil_compare_bridge_id(&msti_port->portPriority.designatedId,
-                            &msti_bridge->co.bridgeIdentifier) == EQUAL_TO)
-                {
-                    msti_port->co.selectedRole = MSTP_ROLE_BACKUP;
-                    STP_LOG_INFO("[MST %u] Port %d Role BACKUP", mstid, port_number);
-                }
-                else
-                {
-                    msti_port->co.selectedRole = MSTP_ROLE_ALTERNATE;
-                    rootPathPriority = msti_port->portPriority;
-
-                    if (mstp_port->rcvdInternal)
-                    {
-                        rootPathPriority.intPathCost += msti_port->co.intPortPathCost;
-                    }
-
-                    if ((mstputil_compare_msti_vectors(&rootPathPriority, &rootPriority) == LESS_THAN) &&
-                            (!mstp_port->restrictedRole))
-                    {
-                        root_port = port_number;
-                        msti_root_port = msti_port;
-                        rootPriority = rootPathPriority;
-                    }
-                    if(msti_port->co.selectedRole == MSTP_ROLE_ALTERNATE && mstp_port->restrictedRole)
-                    {
-                        STP_SYSLOG("MSTP: Root Guard interface %d MST%u inconsistent (Received superior BPDU)",
-                                port_number, mstid);
-                        SET_BIT(msti_port->co.modified_fields, MSTP_PORT_MEMBER_PORT_STATE_BIT);
-                    }
-
-                }
-            }
+            root_port = port_number;
+            msti_root_port = msti_port;
+            rootPriority = rootPathPriority;
         }
 
         port_number = port_mask_get_next_port(msti_enable_mask, port_number);
@@ -1974,133 +2311,20 @@ void mstp_updtRolesMsti(MSTP_INDEX mstp_index)
         mstp_port = mstpdata_get_port(port_number);
         msti_port = MSTP_GET_MSTI_PORT(mstp_port, mstp_index);
 
-        mstputil_compute_msti_designated_priority(msti_bridge, msti_port);
-        msti_port->designatedTimes = msti_bridge->rootTimes;
-        cist_port = MSTP_GET_CIST_PORT(mstp_port);
-
-        if ((cist_port->co.infoIs != MSTP_INFOIS_RECEIVED) ||
-                (mstp_port->rcvdInternal))
-        {
-            // received inside the region - look at msti infoIs
-            switch (msti_port->co.infoIs)
-            {
-                case MSTP_INFOIS_DISABLED:
-                    msti_port->co.selectedRole = MSTP_ROLE_DISABLED;
-                    break;
-
-                case MSTP_INFOIS_AGED:
-                    if(msti_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
-                        STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_AGED)", mstid, port_number);
-                    msti_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
-                    msti_port->co.updtInfo = true;
-                    break;
-
-                case MSTP_INFOIS_MINE:
-                    if(msti_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
-                        STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_MINE)", mstid, port_number);
-
-                    msti_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
-                    if ((mstputil_compare_msti_vectors(&msti_port->portPriority,
-                                    &msti_port->designatedPriority) != EQUAL_TO) ||
-                            (msti_port->portTimes.remainingHops !=
-                             msti_port->designatedTimes.remainingHops))
-                    {
-                        msti_port->co.updtInfo = true;
-                    }
-                    break;
-
-                case MSTP_INFOIS_RECEIVED:
-                    if (port_number != root_port)
-                    {
-                        if (mstputil_compare_msti_vectors(&msti_port->designatedPriority,
-                                    &msti_port->portPriority) == LESS_THAN)
-                        {
-                            if(msti_port->co.selectedRole != MSTP_ROLE_DESIGNATED)
-                                STP_LOG_INFO("[MST %u] Port %d Role DESIGNATED (INFOIS_RECEIVED)", mstid, port_number);
-                            msti_port->co.selectedRole = MSTP_ROLE_DESIGNATED;
-                            msti_port->co.updtInfo = true;
-                        }
-                    }
-                    break;
-
-                default:
-                    // print error
-                    return;
-            }
-        }
-        else
-        {
-            // received from outside the region - look at cist selected role.
-            switch (cist_port->co.selectedRole)
-            {
-                case MSTP_ROLE_ROOT:
-                    if(msti_port->co.selectedRole != MSTP_ROLE_MASTER)
-                        STP_LOG_INFO("[MST %u] Port %d Role Master", mstid, port_number);
-                    msti_port->co.selectedRole = MSTP_ROLE_MASTER;
-                    masterSelected = true;
-                    if ((mstputil_compare_msti_vectors(&msti_port->portPriority,
-                                    &msti_port->designatedPriority) != EQUAL_TO) ||
-                            (msti_port->portTimes.remainingHops !=
-                             msti_port->designatedTimes.remainingHops))
-                    {
-                        msti_port->co.updtInfo = true;
-                    }
-                    break;
-
-                case MSTP_ROLE_ALTERNATE:
-                    if(msti_port->co.selectedRole != MSTP_ROLE_ALTERNATE)
-                    {
-                        flag = false;
-                        STP_LOG_INFO("[MST %u] Port %d Role Alternate", mstid, port_number);
-                    }
-                    msti_port->co.selectedRole = MSTP_ROLE_ALTERNATE;
-                    if ((mstputil_compare_msti_vectors(&msti_port->portPriority,
-                                    &msti_port->designatedPriority) != EQUAL_TO) ||
-                            (msti_port->portTimes.remainingHops !=
-                             msti_port->designatedTimes.remainingHops))
-                    {
-                        msti_port->co.updtInfo = true;
-                    }
-                    break;
-            }
-        }
-
-        if(flag && (msti_port->co.selectedRole == MSTP_ROLE_ALTERNATE))
-            STP_LOG_INFO("[MST %u] Port %d Role Alternate", mstid, port_number);
-
-        if ((msti_port->co.selectedRole == MSTP_ROLE_DESIGNATED ||
-                    msti_port->co.selectedRole == MSTP_ROLE_ROOT) &&
-                msti_port->mastered)
+        if (!mstp_updtRolesMstiDesignated(msti_bridge, mstp_port, msti_port, port_number, root_port))
         {
-            masteredSet = true;
+            cbridge->rolesValid = false;
+            return;
         }
-        msti_port->master = false;
 
         port_number = port_mask_get_next_port(msti_enable_mask, port_number);
     } /* 2 */
 
-    /*
-     * 3 - set the master flag for all ports if mastered is set for any port
-     * or the bridge has selected one of the ports as the master port.
-     * see section 13.24.13 and 13.24.14 for more information.
-     */
-    if (masteredSet || masterSelected)
-    {
-        port_number = port_mask_get_first_port(msti_enable_mask);
-        while (port_number != BAD_PORT_ID)
-        {
-            mstp_port = mstpdata_get_port(port_number);
-            msti_port = MSTP_GET_MSTI_PORT(mstp_port, mstp_index);
-
-            if (msti_port->co.role == MSTP_ROLE_DESIGNATED ||
-                    msti_port->co.role == MSTP_ROLE_ROOT)
-            {
-                msti_port->master = true;
-            }
+    /* 3 */
+    mstp_updtMasterMsti(mstp_index, msti_enable_mask);
 
-            port_number = port_mask_get_next_port(msti_enable_mask, port_number);
-        }
-    } /* 3 */
+    cbridge->rolesValid = true;
+    cbridge->reselectCount = 0;
 
     mstputil_bridge_to_string(&rootPriority.regionalRoot, root_id_string, sizeof(root_id_string));
     // snmp traps and logging
@@ -2135,6 +2359,11 @@ void mstp_updtRolesDisabledTree(MSTP_INDEX mstp_index)
 	PORT_ID port_number;
 	MSTP_BRIDGE *mstp_bridge = mstpdata_get_bridge();
 	MSTP_COMMON_PORT *cport;
+	MSTP_COMMON_BRIDGE *cbridge;
+
+	cbridge = mstputil_get_common_bridge(mstp_index);
+	if (cbridge)
+		cbridge->rolesValid = false;
 
 	port_number = port_mask_get_first_port(mstp_bridge->enable_mask);
 	while (port_number != BAD_PORT_ID)
@@ -12,6 +12,14 @@
 MSTP_GLOBAL         g_mstp_global;
 MSTP_VLAN_PORT_DB   g_mstp_vlan_port_db[MAX_VLAN_ID];
 MSTP_PORT_VLAN_DB  **g_mstp_port_vlan_db;
+
+/*****************************************************************************/
+/* pools for the per instance and per port structures, recycled on instance */
+/* and port add/remove                                                       */
+/*****************************************************************************/
+static MEMPOOL g_mstp_msti_bridge_pool = MEMPOOL_INITIALIZER("msti_bridge", sizeof(MSTP_MSTI_BRIDGE), 8);
+static MEMPOOL g_mstp_msti_port_pool = MEMPOOL_INITIALIZER("msti_port", sizeof(MSTP_MSTI_PORT), 128);
+static MEMPOOL g_mstp_port_pool = MEMPOOL_INITIALIZER("mstp_port", sizeof(MSTP_PORT), 32);
  
 /*****************************************************************************/
 /* mstpdata_get_port: returns the data structure associated with the input   */
@@ -69,7 +77,7 @@ static MSTP_MSTI_BRIDGE * mstpdata_alloc_msti_bridge(MSTP_INDEX mstp_index)
 	if (msti_bridge == NULL)
 	{
         STP_LOG_DEBUG("[MST Index %d] Memory allocated",mstp_index);	
-		msti_bridge = (MSTP_MSTI_BRIDGE *) calloc(1,sizeof(MSTP_MSTI_BRIDGE));
+		msti_bridge = (MSTP_MSTI_BRIDGE *) mempool_zalloc(&g_mstp_msti_bridge_pool);
 		mstp_bridge->msti[mstp_index] = msti_bridge;
 	}
 	else
@@ -111,7 +119,7 @@ static void mstpdata_free_msti_bridge(MSTP_INDEX mstp_index)
 
     STP_LOG_DEBUG("[MST Index %d] Deallocated msti_bridge", mstp_index);	
 
-	free(msti_bridge);
+	mempool_free(&g_mstp_msti_bridge_pool, msti_bridge);
 	mstp_bridge->msti[mstp_index] = NULL;
 }
 
@@ -140,7 +148,7 @@ MSTP_MSTI_PORT * mstpdata_alloc_msti_port(MSTP_INDEX mstp_index, PORT_ID port_nu
     msti_port = mstp_port->msti[mstp_index];
     if (msti_port == NULL)
     {
-        msti_port = (MSTP_MSTI_PORT *) calloc(1,sizeof(MSTP_MSTI_PORT));
+        msti_port = (MSTP_MSTI_PORT *) mempool_zalloc(&g_mstp_msti_port_pool);
         if (msti_port != NULL)
         {
             mstp_port->msti[mstp_index] = msti_port;
@@ -194,7 +202,7 @@ void mstpdata_free_msti_port(MSTP_INDEX mstp_index, PORT_ID port_number)
 
     STP_LOG_DEBUG("[MST Index %d] Port %d msti_port deallocated", mstp_index, port_number);
 
-    free(msti_port);
+    mempool_free(&g_mstp_msti_port_pool, msti_port);
     mstp_port->msti[mstp_index] = NULL;
 }
 
@@ -344,7 +352,7 @@ MSTP_PORT *mstpdata_alloc_mstp_port(PORT_ID port_number)
 
 	if (mstp_global->port_arr[port_number] == NULL)
 	{
-        mstp_global->port_arr[port_number] = (MSTP_PORT *) calloc(1,sizeof(MSTP_PORT));
+        mstp_global->port_arr[port_number] = (MSTP_PORT *) mempool_zalloc(&g_mstp_port_pool);
         STP_LOG_DEBUG("Port %d mstp_port allocated", port_number);
     }
     return mstp_global->port_arr[port_number];
@@ -377,7 +385,8 @@ void mstpdata_free_port(PORT_ID port_number)
 
     STP_LOG_DEBUG("[MST] %d mstp_port deallocated", port_number);
 
-    free(mstp_port);
+    free(mstp_port->rxCache);
+    mempool_free(&g_mstp_port_pool, mstp_port);
     g_mstp_global.port_arr[port_number] = NULL;
 }
 
@@ -602,6 +602,7 @@ void mstpdm_mstp_bridge()
 			mstp_bridge->maxHops,
 			mstp_bridge->txHoldCount);
 
+	mstputil_update_message_digest();
 	STP_DUMP("mstConfigId:\n\tformat_selector %u revision %u name %s\n",
 		mstp_bridge->mstConfigId.format_selector,
 		mstp_bridge->mstConfigId.revision_number,
@@ -609,6 +610,23 @@ void mstpdm_mstp_bridge()
 
     STP_DUMP ("\tconfig_digest ");
     mstpdebug_print_config_digest(mstp_bridge->mstConfigId.config_digest);
+
+	STP_DUMP("\nwork queue runs %u deduped %u max_run %u max_depth %u overflows %u\n"
+			"executed pim %u prt %u prt2 %u pst %u tcm %u prs %u ptx %u\n"
+			"repeated bpdus %u\n",
+			mstp_global->sched_stats.runs,
+			mstp_global->sched_stats.deduped,
+			mstp_global->sched_stats.max_run,
+			mstp_global->sched_stats.max_depth,
+			mstp_global->sched_stats.overflows,
+			mstp_global->sched_stats.executed[MSTP_SCHED_PIM],
+			mstp_global->sched_stats.executed[MSTP_SCHED_PRT],
+			mstp_global->sched_stats.executed[MSTP_SCHED_PRT2],
+			mstp_global->sched_stats.executed[MSTP_SCHED_PST],
+			mstp_global->sched_stats.executed[MSTP_SCHED_TCM],
+			mstp_global->sched_stats.executed[MSTP_SCHED_PRS],
+			mstp_global->sched_stats.executed[MSTP_SCHED_PTX],
+			mstp_global->rx_repeated);
 }
 
 /*****************************************************************************/
@@ -1110,6 +1128,10 @@ void mstpdbg_process_ctl_msg(void *msg)
             /* Dump Lib event stats */
             STP_DUMP("\nLSTATS:\n");
             stpdbg_dump_stp_stats();
+
+            /* Dump memory pool stats */
+            STP_DUMP("\nMEMPOOL:\n");
+            stpdbg_dump_mempool_stats();
             break;
         }
         case STP_CTL_DUMP_MST:
@@ -1239,9 +1261,50 @@ void mstpdbg_process_ctl_msg(void *msg)
             break;
         }
 
+        case STP_CTL_DUMP_MEMPOOL_STATS:
+        {
+            stpdbg_dump_mempool_stats();
+            break;
+        }
+
+        case STP_CTL_SET_TX_RATE:
+        {
+            stp_pkt_tx_set_rate(pmsg->level, pmsg->vlan_id);
+            MSTP_DUMP("bpdu tx rate set to %u burst %u\n", g_stpd_tx_rate, g_stpd_tx_burst);
+            break;
+        }
+
+        case STP_CTL_DUMP_RX_LATENCY:
+        {
+            stp_rxlat_dump(pmsg->intf_name);
+            break;
+        }
+
+        case STP_CTL_SET_TICK_OVERRUN:
+        {
+            stptimer_prof_set_overrun(pmsg->level);
+            MSTP_DUMP("tick overrun threshold set to %d ms\n", pmsg->level);
+            break;
+        }
+
+        case STP_CTL_SET_LOG_MODULE:
+        {
+            stpdbg_set_log_module(pmsg->intf_name, pmsg->level);
+            break;
+        }
+
+        case STP_CTL_SET_HELLO_SLOTS:
+        {
+            stptimer_set_hello_slots(pmsg->level);
+            MSTP_DUMP("hello slots set to %u (used in pvst mode)\n", stp_global.hello_slots);
+            break;
+        }
+
         case STP_CTL_CLEAR_ALL:
         {
             mstpmgr_clear_statistics_all();
+            stp_rxlat_clear();
+            stptimer_prof_clear();
             MSTP_DUMP("All stats cleared\n");
             break;
         }
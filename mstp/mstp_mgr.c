@@ -62,6 +62,7 @@ static bool mstpmgr_init_mstp_bridge(UINT16 max_instances)
 
     cist_bridge->co.rootPortId = MSTP_INVALID_PORT;
     vlan_bmp_init(&cist_bridge->co.vlanmask);
+    vlanset_init(&cist_bridge->co.vlanset);
     bmp_alloc(&cist_bridge->co.portmask, g_max_stp_port);
 
     cist_bridge->bridgePriority.root = cist_bridge->co.bridgeIdentifier;
@@ -348,6 +349,7 @@ static bool mstpmgr_init_msti(MSTP_MSTID mstid)
 
     msti_bridge->co.rootPortId = MSTP_INVALID_PORT;
     vlan_bmp_init(&msti_bridge->co.vlanmask);
+    vlanset_init(&msti_bridge->co.vlanset);
     bmp_alloc(&msti_bridge->co.portmask, g_max_stp_port);
 
     msti_bridge->bridgePriority.designatedId =
@@ -441,6 +443,7 @@ static void mstpmgr_free_msti_port(MSTP_INDEX mstp_index, PORT_ID port_number)
     }
 
     clear_mask_bit(msti_bridge->co.portmask, port_number);
+    msti_bridge->co.rolesValid = false;
     mstpdata_free_msti_port(mstp_index, port_number);
 }
 
@@ -623,6 +626,14 @@ bool mstpmgr_refresh(MSTP_INDEX mstp_index, bool trigger_bpdu)
     if (cbridge == NULL)
         return false;
 
+    if (STPD_CONFIG_TXN_ACTIVE())
+    {
+        L2_PROTO_INSTANCE_MASK_SET(&g_mstp_global.txn_refresh_mask, mstp_index);
+        if (trigger_bpdu)
+            g_mstp_global.txn_refresh_bpdu = true;
+        return true;
+    }
+
     if (cbridge->active)
     {
         mstp_setReselectTree(mstp_index);
@@ -669,6 +680,12 @@ bool mstpmgr_refresh_all()
     MSTP_PORT *mstp_port;
     PORT_ID port_number;
 
+    if (STPD_CONFIG_TXN_ACTIVE())
+    {
+        g_mstp_global.txn_refresh_all = true;
+        return true;
+    }
+
     mstp_setReselectTree(MSTP_INDEX_CIST);
     if (mstplib_get_num_active_instances())
     {
@@ -864,7 +881,7 @@ bool mstpmgr_disable_port(PORT_ID port_number, bool del_flag)
 /* required when the MstConfigId changes (described in section 13.23.1).     */
 /* this happens when name or revision level or vlan to mstid mapping changes */
 /*****************************************************************************/
-static bool mstpmgr_restart()
+static bool mstpmgr_restart_ports()
 {
     PORT_ID port_number;
     MSTP_BRIDGE *mstp_bridge;
@@ -892,6 +909,75 @@ static bool mstpmgr_restart()
 
     return true;
 }
+
+static bool mstpmgr_restart()
+{
+    if (STPD_CONFIG_TXN_ACTIVE())
+    {
+        g_mstp_global.txn_restart_pending = true;
+        return true;
+    }
+
+    return mstpmgr_restart_ports();
+}
+
+/*****************************************************************************/
+/* mstpmgr_config_txn_apply: runs the restart and digest work deferred by    */
+/* the config transaction. Called on commit while the transaction is still  */
+/* open so that the per port refreshes of the restart are coalesced.         */
+/*****************************************************************************/
+void mstpmgr_config_txn_apply()
+{
+    MSTP_GLOBAL *mstp_global = &g_mstp_global;
+
+    if (mstpdata_get_bridge() == NULL)
+        return;
+
+    mstputil_update_message_digest();
+
+    if (mstp_global->txn_restart_pending)
+    {
+        mstp_global->txn_restart_pending = false;
+        mstpmgr_restart_ports();
+    }
+}
+
+/*****************************************************************************/
+/* mstpmgr_config_txn_refresh: runs the role selection and bpdu transmission */
+/* deferred by the config transaction, once per affected instance. Called    */
+/* after the transaction is closed.                                          */
+/*****************************************************************************/
+void mstpmgr_config_txn_refresh()
+{
+    MSTP_GLOBAL *mstp_global = &g_mstp_global;
+    L2_PROTO_INSTANCE_MASK refresh_mask = mstp_global->txn_refresh_mask;
+    bool refresh_all = mstp_global->txn_refresh_all;
+    bool trigger_bpdu = mstp_global->txn_refresh_bpdu;
+    UINT16 mstp_index;
+
+    mstp_global->txn_refresh_all = false;
+    mstp_global->txn_refresh_bpdu = false;
+    L2_PROTO_INSTANCE_MASK_ZERO(&mstp_global->txn_refresh_mask);
+
+    if (mstpdata_get_bridge() == NULL)
+        return;
+
+    if (refresh_all)
+    {
+        mstpmgr_refresh_all();
+        return;
+    }
+
+    if (L2_PROTO_INSTANCE_MASK_ISSET(&refresh_mask, MSTP_INDEX_CIST))
+        mstpmgr_refresh(MSTP_INDEX_CIST, trigger_bpdu);
+
+    for (mstp_index = MSTP_INDEX_MIN; mstp_index <= MSTP_INDEX_MAX; mstp_index++)
+    {
+        if (L2_PROTO_INSTANCE_MASK_ISSET(&refresh_mask, mstp_index))
+            mstpmgr_refresh(mstp_index, trigger_bpdu);
+    }
+}
+
 /*****************************************************************************/
 /* mstpmgr_add_member_port: adds the port to the instance, allocates all     */
 /* necessary structures to accomplish this                                   */
@@ -1093,6 +1179,36 @@ bool mstpmgr_set_control_mask(MSTP_INDEX mstp_index)
     return flag;
 }
 
+/*****************************************************************************/
+/* mstpmgr_rx_cache_lookup: returns true if the received packet is identical */
+/* to the last bpdu processed on the port. otherwise the packet is copied    */
+/* to the port's cache, to be committed once it has been processed.          */
+/*****************************************************************************/
+static bool mstpmgr_rx_cache_lookup(PORT_ID port_number, void *bufptr, UINT32 size)
+{
+    MSTP_PORT *mstp_port = mstpdata_get_port(port_number);
+
+    if (mstp_port == NULL || size > sizeof(MSTP_BPDU))
+        return false;
+
+    if (mstp_port->rxCacheLen == size &&
+        memcmp(mstp_port->rxCache, bufptr, size) == 0)
+    {
+        return true;
+    }
+
+    mstp_port->rxCacheLen = 0;
+    if (mstp_port->rxCache == NULL)
+    {
+        mstp_port->rxCache = (UINT8 *) malloc(sizeof(MSTP_BPDU));
+        if (mstp_port->rxCache == NULL)
+            return false;
+    }
+
+    memcpy(mstp_port->rxCache, bufptr, size);
+    return false;
+}
+
 /*****************************************************************************/
 /* handler. validates bpdu and triggers the    */
 /* appropriate port receive state machine                                    */
@@ -1107,6 +1223,12 @@ bool mstpmgr_rx_bpdu(VLAN_ID vlan_id, PORT_ID port_number, void *bufptr, UINT32
     uint64_t current_time = 0, time_diff;
     MAC_ADDRESS	    address;
     MSTP_COMMON_BRIDGE *cbridge;
+    UINT32 pkt_size = size;
+    bool repeated;
+
+    // compare against the last bpdu processed on the port before the
+    // conversion below modifies the packet
+    repeated = mstpmgr_rx_cache_lookup(port_number, bufptr, size);
 
     // convert the bpdu fields from network to host order
     mstputil_host_order_bpdu(bpdu);
@@ -1121,6 +1243,8 @@ bool mstpmgr_rx_bpdu(VLAN_ID vlan_id, PORT_ID port_number, void *bufptr, UINT32
     }
 
     size = size - sizeof(MAC_HEADER) - sizeof(LLC_HEADER);
+    // always validate, it also downgrades malformed mstp bpdus to rstp which
+    // repeats of them need as much as the first copy
     if (!mstputil_validate_bpdu(bpdu, size))
         return false;
 
@@ -1188,9 +1312,20 @@ bool mstpmgr_rx_bpdu(VLAN_ID vlan_id, PORT_ID port_number, void *bufptr, UINT32
 
     mstputil_update_stats(port_number, bpdu, true);
 
+    // identical to the previous bpdu, skip the state machines if they have
+    // nothing to do apart from refreshing rcvdInfoWhile
+    if (repeated && mstp_prx_repeated(port_number, bpdu))
+    {
+        g_mstp_global.rx_repeated++;
+        return true;
+    }
+
     mstp_port->rcvdBpdu = true;
     mstp_prx_gate(port_number, bpdu);
 
+    if (!repeated && mstp_port->rxCache)
+        mstp_port->rxCacheLen = pkt_size;
+
     return true;
 }
 
@@ -1568,17 +1703,13 @@ bool mstpmgr_config_instance_vlanmask(MSTP_MSTID mstid, VLAN_MASK *vlanmask)
     UINT8 				vlanmask_string[500] = {0,};
     VLAN_ID             vlan_id = VLAN_ID_INVALID;
     VLAN_MASK           del_vlan_mask, add_vlan_mask;
+    VLAN_SET            new_vlanset, add_vlanset, del_vlanset;
     enum L2_PORT_STATE state;
     bool state_flag = false;
 
-    vlan_bmp_init(&add_vlan_mask);
-    vlan_bmp_init(&del_vlan_mask);
-
     if (!mstp_bridge)
         return false;
 
-    vlanmask_to_string((BITMAP_T *)vlanmask, vlanmask_string, sizeof(vlanmask_string));
-
     mstp_index = MSTP_GET_INSTANCE_INDEX(mstp_bridge, mstid);
 
     if (mstp_index == MSTP_INDEX_INVALID) 
@@ -1597,12 +1728,22 @@ bool mstpmgr_config_instance_vlanmask(MSTP_MSTID mstid, VLAN_MASK *vlanmask)
     if (!cbridge)
         return false;
 
-    and_not_masks((BITMAP_T *)&add_vlan_mask, (BITMAP_T *)vlanmask, (BITMAP_T *)&cbridge->vlanmask);
-    and_not_masks((BITMAP_T *)&del_vlan_mask, (BITMAP_T *)&cbridge->vlanmask, (BITMAP_T *)vlanmask);
+    /* Diff the run lists; fall back to the bitmaps only for fragmented sets */
+    vlanset_from_mask(&new_vlanset, (BITMAP_T *)vlanmask);
+    if (!vlanset_and_not(&add_vlanset, &new_vlanset, &cbridge->vlanset) ||
+            !vlanset_and_not(&del_vlanset, &cbridge->vlanset, &new_vlanset))
+    {
+        vlan_bmp_init(&add_vlan_mask);
+        vlan_bmp_init(&del_vlan_mask);
+        and_not_masks((BITMAP_T *)&add_vlan_mask, (BITMAP_T *)vlanmask, (BITMAP_T *)&cbridge->vlanmask);
+        and_not_masks((BITMAP_T *)&del_vlan_mask, (BITMAP_T *)&cbridge->vlanmask, (BITMAP_T *)vlanmask);
+        vlanset_from_mask(&add_vlanset, (BITMAP_T *)&add_vlan_mask);
+        vlanset_from_mask(&del_vlanset, (BITMAP_T *)&del_vlan_mask);
+    }
 
-    for (vlan_id = vlanmask_get_first_vlan(&add_vlan_mask);
+    for (vlan_id = vlanset_get_first_vlan(&add_vlanset);
             vlan_id != VLAN_ID_INVALID;
-            vlan_id = vlanmask_get_next_vlan(&add_vlan_mask, vlan_id)) 
+            vlan_id = vlanset_get_next_vlan(&add_vlanset, vlan_id)) 
     {
         MSTP_CLASS_SET_MSTID(mstp_bridge, vlan_id, mstid);
         vlanmask_set_bit(&cbridge->vlanmask, vlan_id);
@@ -1612,16 +1753,16 @@ bool mstpmgr_config_instance_vlanmask(MSTP_MSTID mstid, VLAN_MASK *vlanmask)
         }
         flag = true;
     }
-    if(!vlanmask_is_clear(&add_vlan_mask)) 
+    if(STP_LOG_IS_ENABLED(STP_LOG_LEVEL_INFO) && !vlanset_is_empty(&add_vlanset)) 
     {
         memset(vlanmask_string, 0 , sizeof(vlanmask_string));
-        vlanmask_to_string((BITMAP_T *)&add_vlan_mask, vlanmask_string, sizeof(vlanmask_string));
+        vlanset_to_string(&add_vlanset, vlanmask_string, sizeof(vlanmask_string));
         STP_LOG_INFO("[MST %d] ATTACH vlan %s",mstid, vlanmask_string);
     }
 
-    for (vlan_id = vlanmask_get_first_vlan(&del_vlan_mask);
+    for (vlan_id = vlanset_get_first_vlan(&del_vlanset);
             vlan_id != VLAN_ID_INVALID;
-            vlan_id = vlanmask_get_next_vlan(&del_vlan_mask, vlan_id)) 
+            vlan_id = vlanset_get_next_vlan(&del_vlanset, vlan_id)) 
     {
         /* If the VLAN is mapped to other MSTIs, then dont set to CIST*/
         if(MSTP_GET_MSTID(mstp_bridge, vlan_id) == mstid)
@@ -1635,16 +1776,21 @@ bool mstpmgr_config_instance_vlanmask(MSTP_MSTID mstid, VLAN_MASK *vlanmask)
         }
         flag = true;
     }
-    if(!vlanmask_is_clear(&del_vlan_mask)) 
+    if(STP_LOG_IS_ENABLED(STP_LOG_LEVEL_INFO) && !vlanset_is_empty(&del_vlanset)) 
     {
         memset(vlanmask_string, 0 , sizeof(vlanmask_string));
-        vlanmask_to_string((BITMAP_T *)&del_vlan_mask, vlanmask_string, sizeof(vlanmask_string));
+        vlanset_to_string(&del_vlanset, vlanmask_string, sizeof(vlanmask_string));
         STP_LOG_INFO("[MST %d] DETTACH vlan %s",mstid, vlanmask_string);
     }
 
+    /* cbridge->vlanmask now matches the requested mask */
+    if (new_vlanset.dense)
+        vlanset_from_mask(&cbridge->vlanset, (BITMAP_T *)&cbridge->vlanmask);
+    else
+        cbridge->vlanset = new_vlanset;
 
     if (!MSTP_IS_CIST_INDEX(mstp_index) &&
-            vlanmask_is_clear(&cbridge->vlanmask)) 
+            vlanset_is_empty(&cbridge->vlanset)) 
     {
         // delete member ports
         port_number = port_mask_get_first_port(cbridge->portmask);
@@ -1655,9 +1801,9 @@ bool mstpmgr_config_instance_vlanmask(MSTP_MSTID mstid, VLAN_MASK *vlanmask)
             state_flag = mstplib_get_port_state(mstp_index, port_number, &state);
             if(!state_flag || state != FORWARDING) 
             {
-                for (vlan_id = vlanmask_get_first_vlan(&del_vlan_mask);
+                for (vlan_id = vlanset_get_first_vlan(&del_vlanset);
                         vlan_id != VLAN_ID_INVALID;
-                        vlan_id = vlanmask_get_next_vlan(&del_vlan_mask, vlan_id)) 
+                        vlan_id = vlanset_get_next_vlan(&del_vlanset, vlan_id)) 
                 {
 
                     mstputil_set_kernel_bridge_port_state_for_single_vlan(vlan_id, port_number, FORWARDING);
@@ -1673,8 +1819,8 @@ bool mstpmgr_config_instance_vlanmask(MSTP_MSTID mstid, VLAN_MASK *vlanmask)
 
     if(flag) 
     {
-        // recompute mstConfigId message digest
-        mstputil_compute_message_digest(false);
+        // mstConfigId message digest is recomputed lazily, once per batch
+        mstp_bridge->config_digest_dirty = true;
         if(MSTP_IS_CIST_INDEX(mstp_index))
             SET_BIT(cist_bridge->modified_fields, MSTP_BRIDGE_DATA_MEMBER_VLAN_MASK_SET);
         else 
@@ -2576,7 +2722,7 @@ void mstpmgr_process_inst_vlan_config_msg(void *msg)
     PORT_MASK *cist_stp_disabled_ports =  portmask_local_init(&l_cist_stp_disabled_ports);
     PORT_MASK *msti_stp_disabled_ports =  portmask_local_init(&l_msti_stp_disabled_ports);
     PORT_ID port_number;
-    bool restart; 
+    bool restart = false;
 	MSTP_CIST_BRIDGE *cist_bridge;
 
     if (!mstp_bridge)
@@ -2641,11 +2787,14 @@ void mstpmgr_process_inst_vlan_config_msg(void *msg)
                 and_not_masks(msti_port_mask, msti_port_mask, msti_stp_disabled_ports);
             }
 
-            memset(vlanmask_string, 0 , sizeof(vlanmask_string));
-            vlanmask_to_string((BITMAP_T *)&vlan_mask, vlanmask_string, sizeof(vlanmask_string));
+            if (STP_LOG_IS_ENABLED(STP_LOG_LEVEL_INFO))
+            {
+                memset(vlanmask_string, 0 , sizeof(vlanmask_string));
+                vlanmask_to_string((BITMAP_T *)&vlan_mask, vlanmask_string, sizeof(vlanmask_string));
 
-            STP_LOG_INFO("[MST %d] SET pri:%d vcount %d Vlan %s",mst_id, mst_list->priority,
-                    mst_list->vlan_count, vlanmask_string);
+                STP_LOG_INFO("[MST %d] SET pri:%d vcount %d Vlan %s",mst_id, mst_list->priority,
+                        mst_list->vlan_count, vlanmask_string);
+            }
 
             cist_vlanmask = mstplib_instance_get_vlanmask(MSTP_INDEX_CIST);
 
@@ -2729,8 +2878,6 @@ void mstpmgr_process_inst_vlan_config_msg(void *msg)
             mstp_index = mstputil_get_index(mst_id);
             if(mstp_index != MSTP_INDEX_INVALID)
             {
-                vlanmask_to_string((BITMAP_T *)&vlan_mask, vlanmask_string, sizeof(vlanmask_string));
-
                 port_number = port_mask_get_first_port(msti_stp_disabled_ports);
                 while (port_number != BAD_PORT_ID)
                 {
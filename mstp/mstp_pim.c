@@ -22,7 +22,7 @@ static void mstp_pim_signal(MSTP_INDEX mstp_index, PORT_ID port_number)
 		mstp_port->rcvdTcn ||
 		cport->rcvdTc)
 	{
-		mstp_tcm_gate(mstp_index, port_number);
+		mstp_sched_gate(MSTP_SCHED_TCM, mstp_index, port_number);
 	}
 
 	/*
@@ -32,7 +32,7 @@ static void mstp_pim_signal(MSTP_INDEX mstp_index, PORT_ID port_number)
 	 */
 	if (mstputil_computeReselect(mstp_index) ||!cport->selected)
 	{
-		mstp_prs_gate(mstp_index);
+		mstp_sched_gate(MSTP_SCHED_PRS, mstp_index, 0);
 	}
 
 	/*
@@ -47,7 +47,7 @@ static void mstp_pim_signal(MSTP_INDEX mstp_index, PORT_ID port_number)
 		cport->disputed ||
 		(cport->agreed && ((cport->selectedRole == MSTP_ROLE_DESIGNATED) || (cport->selectedRole == MSTP_ROLE_ROOT))))
 	{
-		mstp_prt_gate(mstp_index, port_number);
+		mstp_sched_gate(MSTP_SCHED_PRT, mstp_index, port_number);
 	}
 	
 	/*
@@ -61,7 +61,7 @@ static void mstp_pim_signal(MSTP_INDEX mstp_index, PORT_ID port_number)
 	if (mstp_port->newInfoCist ||
 		mstp_port->newInfoMsti)
 	{
-		mstp_ptx_gate(port_number);
+		mstp_sched_gate(MSTP_SCHED_PTX, 0, port_number);
 	}
 }
 
@@ -73,12 +73,12 @@ static void mstp_pim_set_reselect(MSTP_INDEX mstp_index, MSTP_PORT *mstp_port)
 {
 	if (!MSTP_IS_CIST_INDEX(mstp_index))
 	{
-		mstp_setReselectTree(mstp_index);
+		mstp_setReselectPort(mstp_index, mstp_port->port_number);
 		return;
 	}
 
 	// cist
-	mstp_setReselectTree(mstp_index);
+	mstp_setReselectPort(mstp_index, mstp_port->port_number);
 	if (mstp_port->rcvdInternal)
 	{
 		// internal port - nothing to do
@@ -89,7 +89,7 @@ static void mstp_pim_set_reselect(MSTP_INDEX mstp_index, MSTP_PORT *mstp_port)
 	mstp_index = l2_proto_get_first_instance(&mstp_port->instance_mask);
 	while (mstp_index != L2_PROTO_INDEX_INVALID)
 	{
-		mstp_setReselectTree(mstp_index);
+		mstp_setReselectPort(mstp_index, mstp_port->port_number);
 		mstp_index = l2_proto_get_next_instance(&mstp_port->instance_mask, mstp_index);
 	}
 }
@@ -538,5 +538,6 @@ void mstp_pim_gate(MSTP_INDEX mstp_index, PORT_ID port_number, void *bpdu)
 	if (flag)
 	{
 		mstp_pim_signal(mstp_index, port_number);
+		mstp_sched_run();
 	}
 }
\ No newline at end of file
@@ -154,6 +154,7 @@ void mstp_ppm_gate(PORT_ID port_number)
 
 	if (flag)
 	{
-		mstp_ptx_gate(port_number);
+		mstp_sched_gate(MSTP_SCHED_PTX, 0, port_number);
+		mstp_sched_run();
 	}
 }
\ No newline at end of file
@@ -48,7 +48,7 @@ static void mstp_prs_signal(MSTP_INDEX mstp_index)
 				cport->updtInfo ||
 				cport->changedMaster)
 			{
-				mstp_pim_gate(mstp_index, port_number, NULL);
+				mstp_sched_gate(MSTP_SCHED_PIM, mstp_index, port_number);
 			}
 
 			/*
@@ -60,7 +60,7 @@ static void mstp_prs_signal(MSTP_INDEX mstp_index)
 				!cport->updtInfo ||
 				cport->selectedRole != cport->role)
 			{
-				mstp_prt_gate(mstp_index, port_number);
+				mstp_sched_gate(MSTP_SCHED_PRT, mstp_index, port_number);
 			}
 		}
 		port_number = port_mask_get_next_port(mask, port_number);
@@ -156,6 +156,7 @@ void mstp_prs_init(MSTP_INDEX mstp_index)
 
 	/* kick start all other state machines */
 	mstp_prs_signal(mstp_index);
+	mstp_sched_run();
 }
 
 /*****************************************************************************/
@@ -176,6 +177,7 @@ void mstp_prs_gate2(MSTP_INDEX mstp_index)
 	if (flag)
 	{
 		mstp_prs_signal(mstp_index);
+		mstp_sched_run();
 	}
 }
 
@@ -208,8 +210,9 @@ void mstp_prs_gate(MSTP_INDEX mstp_index)
 				msti_bridge = MSTP_GET_MSTI_BRIDGE(mstp_bridge, index);
 				if (msti_bridge == NULL)
 					continue;
-				mstp_prs_gate2(index);
+				mstp_sched_gate(MSTP_SCHED_PRS, index, 0);
 			}
 		}
+		mstp_sched_run();
 	}
 }
\ No newline at end of file
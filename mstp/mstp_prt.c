@@ -457,7 +457,7 @@ static void mstp_prt_signal2(MSTP_INDEX mstp_index, PORT_ID calling_port)
 	}
 	if (cport->proposing || !cport->synced)
 	{
-		mstp_pim_gate(mstp_index, calling_port, NULL);
+		mstp_sched_gate(MSTP_SCHED_PIM, mstp_index, calling_port);
 	}
 
 	/* learn, forward - PST
@@ -466,13 +466,13 @@ static void mstp_prt_signal2(MSTP_INDEX mstp_index, PORT_ID calling_port)
 	if ((cport->learn != cport->learning) ||
 		(cport->forward != cport->forwarding))
 	{
-		mstp_pst_gate(mstp_index, calling_port);
+		mstp_sched_gate(MSTP_SCHED_PST, mstp_index, calling_port);
 	}
 
 	/* role - TCM
 	 * all roles have applicable transitions
 	 */
-	mstp_tcm_gate(mstp_index, calling_port);
+	mstp_sched_gate(MSTP_SCHED_TCM, mstp_index, calling_port);
 
 	/* role, synced, proposing, agree, newInfoXst - PTX
 	 * role, proposing, agree are used to fill the bpdu flags.
@@ -486,7 +486,7 @@ static void mstp_prt_signal2(MSTP_INDEX mstp_index, PORT_ID calling_port)
 	if (mstp_port->newInfoCist ||
 		mstp_port->newInfoMsti)
 	{
-		mstp_ptx_gate(calling_port);
+		mstp_sched_gate(MSTP_SCHED_PTX, 0, calling_port);
 	}
 }
 
@@ -537,6 +537,7 @@ void mstp_prt_gate2(MSTP_INDEX mstp_index, PORT_ID port_number)
 	if (flag)
 	{
 		mstp_prt_signal2(mstp_index, port_number);
+		mstp_sched_run();
 	}
 }
 
@@ -572,7 +573,7 @@ static void mstp_prt_signal(MSTP_INDEX mstp_index, PORT_ID calling_port)
 				((!cport->reRoot && !cport->sync) && 
 				(cport->role == MSTP_ROLE_ROOT || cport->role == MSTP_ROLE_DESIGNATED))))
 			{
-				mstp_prt_gate2(mstp_index, port_number);
+				mstp_sched_gate(MSTP_SCHED_PRT2, mstp_index, port_number);
 			}
 		}
 mstp_prt_signal_next_port:
@@ -585,7 +586,7 @@ mstp_prt_signal_next_port:
 
 	if (cport->proposing ||	!cport->synced)
 	{
-		mstp_pim_gate(mstp_index, calling_port, NULL);
+		mstp_sched_gate(MSTP_SCHED_PIM, mstp_index, calling_port);
 	}
 
 	/* learn, forward - PST
@@ -594,13 +595,13 @@ mstp_prt_signal_next_port:
 	if ((cport->learn != cport->learning) ||
 		(cport->forward != cport->forwarding))
 	{
-		mstp_pst_gate(mstp_index, calling_port);
+		mstp_sched_gate(MSTP_SCHED_PST, mstp_index, calling_port);
 	}
 
 	/* role - TCM
 	 * all roles have applicable transitions
 	 */
-	mstp_tcm_gate(mstp_index, calling_port);
+	mstp_sched_gate(MSTP_SCHED_TCM, mstp_index, calling_port);
 
 	/* role, synced, proposing, agree, newInfoXst - PTX
 	 * role, proposing, agree are used to fill the bpdu flags.
@@ -615,7 +616,7 @@ mstp_prt_signal_next_port:
 	if (mstp_port->newInfoCist ||
 		mstp_port->newInfoMsti)
 	{
-		mstp_ptx_gate(calling_port);
+		mstp_sched_gate(MSTP_SCHED_PTX, 0, calling_port);
 	}
 }
 
@@ -672,5 +673,6 @@ void mstp_prt_gate(MSTP_INDEX mstp_index, PORT_ID port_number)
 	if (flag)
 	{
 		mstp_prt_signal(mstp_index, port_number);
+		mstp_sched_run();
 	}
 }
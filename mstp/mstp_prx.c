@@ -59,8 +59,8 @@ static void mstp_prx_signal(PORT_ID port_number, MSTP_BPDU *bpdu)
 		{
 			for (mstp_index = MSTP_INDEX_MIN; mstp_index <= MSTP_INDEX_MAX; mstp_index++)
 			{
-				mstp_pim_gate(mstp_index, port_number, NULL);
-				mstp_prt_gate(mstp_index, port_number);
+				mstp_sched_gate(MSTP_SCHED_PIM, mstp_index, port_number);
+				mstp_sched_gate(MSTP_SCHED_PRT, mstp_index, port_number);
 			}
 		}
 	}
@@ -186,9 +186,170 @@ void mstp_prx_init(PORT_ID port_number)
 		return;
 	}
 	mstp_port->prxState = MSTP_PRX_DISCARD;
+	mstp_port->rxCacheLen = 0;
 	mstp_prx_action(port_number, NULL);
 }
 
+/*****************************************************************************/
+/* mstp_prx_repeated_info: checks that processing the received message for  */
+/* the instance would only restart rcvdInfoWhile, i.e. pim is current on     */
+/* received info, the message repeats it (or is a root/alternate reply) and  */
+/* carries no proposal or tc, and recordAgreement/recordMastered would not   */
+/* change any flag. returns the rcvdInfo of the message or MSTP_OTHER_INFO.  */
+/*****************************************************************************/
+static MSTP_RCVD_INFO mstp_prx_repeated_info(MSTP_INDEX mstp_index, MSTP_PORT *mstp_port, MSTP_BPDU *bpdu,
+	MSTI_CONFIG_MESSAGE *msg)
+{
+	MSTP_BRIDGE *mstp_bridge = mstpdata_get_bridge();
+	MSTP_COMMON_PORT *cport;
+	MSTP_CIST_PORT *cist_port;
+	MSTP_MSTI_PORT *msti_port;
+	MSTP_RCVD_INFO info;
+	bool agreed;
+
+	cport = mstputil_get_common_port(mstp_index, mstp_port);
+	if (cport == NULL)
+		return MSTP_OTHER_INFO;
+
+	if (cport->pimState != MSTP_PIM_CURRENT ||
+		cport->infoIs != MSTP_INFOIS_RECEIVED ||
+		cport->updtInfo ||
+		cport->rcvdMsg)
+	{
+		return MSTP_OTHER_INFO;
+	}
+
+	if (msg == NULL)
+	{
+		if (bpdu->cist_flags.topology_change ||
+			bpdu->cist_flags.topology_change_acknowledgement ||
+			bpdu->cist_flags.proposal)
+		{
+			return MSTP_OTHER_INFO;
+		}
+
+		info = mstp_rcvInfoCist(mstp_index, mstp_port->port_number, bpdu);
+		agreed = (mstp_bridge->forceVersion >= RSTP_VERSION_ID &&
+			bpdu->cist_flags.agreement && mstp_port->operPt2PtMac);
+	}
+	else
+	{
+		if (msg->msti_flags.topology_change || msg->msti_flags.proposal)
+			return MSTP_OTHER_INFO;
+
+		msti_port = MSTP_GET_MSTI_PORT(mstp_port, mstp_index);
+		if (msti_port->mastered != (mstp_port->operPt2PtMac && msg->msti_flags.master))
+			return MSTP_OTHER_INFO;
+
+		info = mstp_rcvInfoMsti(mstp_index, mstp_port->port_number, msg);
+
+		cist_port = MSTP_GET_CIST_PORT(mstp_port);
+		agreed = (msg->msti_flags.agreement && mstp_port->operPt2PtMac &&
+			(mstputil_compare_cist_bridge_id(&cist_port->msgPriority.root, &cist_port->portPriority.root) == EQUAL_TO) &&
+			(cist_port->msgPriority.extPathCost == cist_port->portPriority.extPathCost) &&
+			(mstputil_compare_cist_bridge_id(&cist_port->msgPriority.regionalRoot, &cist_port->portPriority.regionalRoot) == EQUAL_TO));
+	}
+
+	if (info != MSTP_REPEATED_DESIGNATED_INFO && info != MSTP_ROOT_INFO)
+		return MSTP_OTHER_INFO;
+
+	if (cport->agreed != agreed || (agreed && cport->proposing))
+		return MSTP_OTHER_INFO;
+
+	return info;
+}
+
+/*****************************************************************************/
+/* mstp_prx_repeated: fast path for a bpdu that is identical to the last one */
+/* processed on the port. if receiving it through prx and pim would leave    */
+/* every state machine variable unchanged apart from rcvdInfoWhile, only     */
+/* that timer is restarted and true is returned. otherwise returns false     */
+/* without side effects and the bpdu has to go through mstp_prx_gate().      */
+/*****************************************************************************/
+bool mstp_prx_repeated(PORT_ID port_number, MSTP_BPDU *bpdu)
+{
+	MSTP_BRIDGE *mstp_bridge = mstpdata_get_bridge();
+	MSTP_PORT *mstp_port = mstpdata_get_port(port_number);
+	MSTP_RCVD_INFO cist_info, info[MSTP_MAX_INSTANCES_PER_REGION];
+	MSTP_INDEX index[MSTP_MAX_INSTANCES_PER_REGION];
+	MSTI_CONFIG_MESSAGE *msg;
+	bool rcvdRSTP, rcvdSTP;
+	UINT16 i, count = 0;
+
+	if (mstp_port == NULL || mstp_bridge == NULL || bpdu->type == TCN_BPDU_TYPE)
+		return false;
+
+	// prx
+	if (mstp_port->prxState != MSTP_PRX_RECEIVE ||
+		!mstp_port->portEnabled ||
+		mstp_port->rcvdBpdu ||
+		mstp_rcvdAnyMsg(port_number) ||
+		mstp_port->rcvdInternal != mstp_fromSameRegion(mstp_port, bpdu))
+	{
+		return false;
+	}
+
+	// boundary ports propagate cist info to all mstis
+	if (!mstp_port->rcvdInternal && !l2_proto_mask_is_clear(&mstp_port->instance_mask))
+		return false;
+
+	// ppm must stay in sensing with the version flags of this bpdu
+	rcvdSTP = mstp_port->rcvdSTP || (bpdu->type == CONFIG_BPDU_TYPE);
+	rcvdRSTP = mstp_port->rcvdRSTP ||
+		(bpdu->type == RSTP_BPDU_TYPE && mstp_bridge->forceVersion >= MSTP_RSTP_COMPATIBILITY_MODE);
+	if (mstp_port->ppmState != MSTP_PPM_SENSING ||
+		mstp_port->mcheck ||
+		(mstp_bridge->forceVersion >= RSTP_VERSION_ID && !mstp_port->sendRSTP && rcvdRSTP) ||
+		(mstp_port->sendRSTP && rcvdSTP))
+	{
+		return false;
+	}
+
+	// pim
+	if (mstp_port->infoInternal != mstp_port->rcvdInternal)
+		return false;
+
+	cist_info = mstp_prx_repeated_info(MSTP_INDEX_CIST, mstp_port, bpdu, NULL);
+	if (cist_info == MSTP_OTHER_INFO)
+		return false;
+
+	if (mstp_port->rcvdInternal && !l2_proto_mask_is_clear(&mstp_port->instance_mask))
+	{
+		for (i = 0; i < MSTP_GET_NUM_MSTI_CONFIG_MESSAGES(bpdu->v3_length) &&
+			i < MSTP_MAX_INSTANCES_PER_REGION; i++)
+		{
+			msg = &bpdu->msti_msgs[i];
+			index[count] = mstputil_get_index(msg->msti_regional_root.system_id);
+			if (index[count] == MSTP_INDEX_INVALID ||
+				mstputil_get_common_port(index[count], mstp_port) == NULL)
+			{
+				continue;
+			}
+
+			info[count] = mstp_prx_repeated_info(index[count], mstp_port, bpdu, msg);
+			if (info[count] == MSTP_OTHER_INFO)
+				return false;
+			count++;
+		}
+	}
+
+	// apply
+	mstp_updtBpduVersion(mstp_port, bpdu);
+
+	mstp_port->cist.co.rcvdInfo = cist_info;
+	if (cist_info == MSTP_REPEATED_DESIGNATED_INFO)
+		mstp_updtRcvdInfoWhileCist(MSTP_INDEX_CIST, port_number);
+
+	for (i = 0; i < count; i++)
+	{
+		mstputil_get_common_port(index[i], mstp_port)->rcvdInfo = info[i];
+		if (info[i] == MSTP_REPEATED_DESIGNATED_INFO)
+			mstp_updtRcvdInfoWhileMsti(index[i], port_number);
+	}
+
+	return true;
+}
+
 /*****************************************************************************/
 /* mstp_prx_gate: invokes the port receive state machine                     */
 /*****************************************************************************/
@@ -208,5 +369,6 @@ void mstp_prx_gate(PORT_ID port_number, MSTP_BPDU *bpdu)
 	if (flag)
 	{
 		mstp_prx_signal(port_number, bpdu);
+		mstp_sched_run();
 	}
 }
\ No newline at end of file
@@ -22,13 +22,13 @@ static void mstp_pst_signal(MSTP_INDEX mstp_index, PORT_ID port_number)
 	if (!cport->learning &&
 		!cport->forwarding)
 	{
-		mstp_prt_gate(mstp_index, port_number);
+		mstp_sched_gate(MSTP_SCHED_PRT, mstp_index, port_number);
 	}
 
 	if (!(cport->learn || cport->learning) ||
 		(cport->learn || cport->forward))
 	{
-		mstp_tcm_gate(mstp_index, port_number);
+		mstp_sched_gate(MSTP_SCHED_TCM, mstp_index, port_number);
 	}
 }
 
@@ -181,5 +181,6 @@ void mstp_pst_gate(MSTP_INDEX mstp_index, PORT_ID port_number)
  	if (flag)
 	{
         mstp_pst_signal(mstp_index, port_number);
+        mstp_sched_run();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include "stp_inc.h"
+
+/*
+ * mstp state machine work queue.
+ *
+ * the signal functions of the state machines queue the gates they want to
+ * run instead of calling them recursively. a gate that is already queued is
+ * not queued again, it will see the latest state when it runs. the queue is
+ * drained to a fixed point by the outermost gate, so a single event (bpdu,
+ * timer, config) runs each affected machine once per change instead of once
+ * per path that reaches it.
+ */
+
+#define MSTP_SCHED_INIT_SIZE    256
+
+/*
+ * upper bound on the gates executed by a single run. converged machines do
+ * not signal, so hitting this means the machines are oscillating.
+ */
+#define MSTP_SCHED_RUN_LIMIT    (1 << 20)
+
+typedef struct
+{
+	UINT8                   sm;
+	MSTP_INDEX              mstp_index;
+	PORT_ID                 port_number;
+} MSTP_SCHED_ITEM;
+
+typedef struct
+{
+	MSTP_SCHED_ITEM         *ring;
+	UINT32                  size;
+	UINT32                  head;
+	UINT32                  count;
+	bool                    running;
+} MSTP_SCHED_QUEUE;
+
+static MSTP_SCHED_QUEUE g_mstp_sched;
+
+/*****************************************************************************/
+/* mstp_sched_set_pending: sets the queued flag of a gate to the input value */
+/* and returns the previous value (0 or 1), or -1 if the port or instance of */
+/* the gate does not exist.                                                  */
+/*****************************************************************************/
+static int mstp_sched_set_pending(MSTP_SCHED_SM sm, MSTP_INDEX mstp_index,
+	PORT_ID port_number, bool pending)
+{
+	MSTP_PORT *mstp_port;
+	MSTP_COMMON_PORT *cport;
+	MSTP_COMMON_BRIDGE *cbridge;
+	int old;
+
+	if (sm == MSTP_SCHED_PRS)
+	{
+		cbridge = mstputil_get_common_bridge(mstp_index);
+		if (cbridge == NULL)
+			return -1;
+		old = cbridge->schedPending;
+		cbridge->schedPending = pending;
+		return old;
+	}
+
+	mstp_port = mstpdata_get_port(port_number);
+	if (mstp_port == NULL)
+		return -1;
+
+	if (sm == MSTP_SCHED_PTX)
+	{
+		old = mstp_port->schedPtx;
+		mstp_port->schedPtx = pending;
+		return old;
+	}
+
+	cport = mstputil_get_common_port(mstp_index, mstp_port);
+	if (cport == NULL)
+		return -1;
+
+	old = (cport->schedPending & (1 << sm)) != 0;
+	if (pending)
+		cport->schedPending |= (1 << sm);
+	else
+		cport->schedPending &= ~(1 << sm);
+	return old;
+}
+
+/*****************************************************************************/
+/* mstp_sched_dispatch: invokes the gate of the state machine                */
+/*****************************************************************************/
+static void mstp_sched_dispatch(MSTP_SCHED_SM sm, MSTP_INDEX mstp_index, PORT_ID port_number)
+{
+	switch (sm)
+	{
+		case MSTP_SCHED_PIM:
+			mstp_pim_gate(mstp_index, port_number, NULL);
+			break;
+		case MSTP_SCHED_PRT:
+			mstp_prt_gate(mstp_index, port_number);
+			break;
+		case MSTP_SCHED_PRT2:
+			mstp_prt_gate2(mstp_index, port_number);
+			break;
+		case MSTP_SCHED_PST:
+			mstp_pst_gate(mstp_index, port_number);
+			break;
+		case MSTP_SCHED_TCM:
+			mstp_tcm_gate(mstp_index, port_number);
+			break;
+		case MSTP_SCHED_PRS:
+			mstp_prs_gate(mstp_index);
+			break;
+		case MSTP_SCHED_PTX:
+			mstp_ptx_gate(port_number);
+			break;
+		default:
+			break;
+	}
+}
+
+/*****************************************************************************/
+/* mstp_sched_grow: doubles the size of the work queue                       */
+/*****************************************************************************/
+static bool mstp_sched_grow()
+{
+	MSTP_SCHED_QUEUE *q = &g_mstp_sched;
+	MSTP_SCHED_ITEM *ring;
+	UINT32 size, i;
+
+	size = q->size ? (q->size * 2) : MSTP_SCHED_INIT_SIZE;
+	ring = (MSTP_SCHED_ITEM *) malloc(size * sizeof(MSTP_SCHED_ITEM));
+	if (ring == NULL)
+	{
+		STP_LOG_ERR("mstp work queue alloc failed size %u", size);
+		return false;
+	}
+
+	for (i = 0; i < q->count; i++)
+		ring[i] = q->ring[(q->head + i) % q->size];
+
+	free(q->ring);
+	q->ring = ring;
+	q->size = size;
+	q->head = 0;
+	return true;
+}
+
+/*****************************************************************************/
+/* mstp_sched_gate: queues the gate of the state machine for the instance    */
+/* and port, unless it is already queued. the per port machine (ptx) ignores */
+/* mstp_index and prs ignores port_number.                                   */
+/*****************************************************************************/
+void mstp_sched_gate(MSTP_SCHED_SM sm, MSTP_INDEX mstp_index, PORT_ID port_number)
+{
+	MSTP_SCHED_QUEUE *q = &g_mstp_sched;
+	MSTP_SCHED_STATS *stats = &g_mstp_global.sched_stats;
+	MSTP_SCHED_ITEM *item;
+
+	switch (mstp_sched_set_pending(sm, mstp_index, port_number, true))
+	{
+		case -1:
+			// nothing to run the gate on
+			return;
+		case 1:
+			stats->deduped++;
+			return;
+		default:
+			break;
+	}
+
+	if (q->count == q->size && !mstp_sched_grow())
+	{
+		// no room, fall back to running the gate inline
+		mstp_sched_set_pending(sm, mstp_index, port_number, false);
+		mstp_sched_dispatch(sm, mstp_index, port_number);
+		return;
+	}
+
+	item = &q->ring[(q->head + q->count) % q->size];
+	item->sm = sm;
+	item->mstp_index = mstp_index;
+	item->port_number = port_number;
+	q->count++;
+
+	if (q->count > stats->max_depth)
+		stats->max_depth = q->count;
+}
+
+/*****************************************************************************/
+/* mstp_sched_run: drains the work queue until no state machine has pending  */
+/* work. gates run from the queue only queue further work, so nested calls   */
+/* return immediately and the outermost caller does the draining.            */
+/*****************************************************************************/
+void mstp_sched_run()
+{
+	MSTP_SCHED_QUEUE *q = &g_mstp_sched;
+	MSTP_SCHED_STATS *stats = &g_mstp_global.sched_stats;
+	MSTP_SCHED_ITEM item;
+	UINT32 executed = 0;
+
+	if (q->running || q->count == 0)
+		return;
+
+	q->running = true;
+	while (q->count)
+	{
+		item = q->ring[q->head];
+		q->head = (q->head + 1) % q->size;
+		q->count--;
+
+		mstp_sched_set_pending(item.sm, item.mstp_index, item.port_number, false);
+
+		if (executed >= MSTP_SCHED_RUN_LIMIT)
+		{
+			stats->overflows++;
+			STP_LOG_ERR("mstp work queue run limit reached, dropping %u gates", q->count + 1);
+			while (q->count)
+			{
+				item = q->ring[q->head];
+				q->head = (q->head + 1) % q->size;
+				q->count--;
+				mstp_sched_set_pending(item.sm, item.mstp_index, item.port_number, false);
+			}
+			break;
+		}
+
+		executed++;
+		stats->executed[item.sm]++;
+		mstp_sched_dispatch(item.sm, item.mstp_index, item.port_number);
+	}
+	q->running = false;
+
+	stats->runs++;
+	if (executed > stats->max_run)
+		stats->max_run = executed;
+}
@@ -282,7 +282,7 @@ void mstp_tcm_signal(MSTP_INDEX mstp_index, PORT_ID calling_port)
 		mstp_port->newInfoMsti ||
 		mstp_port->tcAck)
 	{
-		mstp_ptx_gate(calling_port);
+		mstp_sched_gate(MSTP_SCHED_PTX, 0, calling_port);
 	}
 }
 
@@ -314,5 +314,6 @@ void mstp_tcm_gate(MSTP_INDEX mstp_index, PORT_ID port_number)
 			return;
 		
 		mstp_tcm_signal(mstp_index, port_number);
+		mstp_sched_run();
 	}
 }
@@ -4,6 +4,9 @@
  */
 
 #include "stp_inc.h"
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
 
 extern UINT8 g_stp_base_mac[L2_ETH_ADD_LEN];
 
@@ -250,6 +253,61 @@ void mstputil_port_to_string(MSTP_PORT_IDENTIFIER *portId, UINT8 *buffer, UINT16
 			portId->number);
 }
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static EVP_MAC_CTX *g_mstp_digest_ctx = NULL;
+#else
+static HMAC_CTX *g_mstp_digest_ctx = NULL;
+#endif
+
+/*****************************************************************************/
+/* mstputil_get_digest_ctx: returns the hmac-md5 context keyed with the      */
+/* fixed configuration digest signature key. the key schedule is set up once */
+/* and each digest computation only reinitializes the context.               */
+/*****************************************************************************/
+static bool mstputil_get_digest_ctx()
+{
+	UINT8 key[16] = MSTP_CONFIG_DIGEST_SIGNATURE_KEY;
+
+	if (g_mstp_digest_ctx)
+		return true;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	EVP_MAC *mac;
+	OSSL_PARAM params[2];
+
+	mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+	if (mac == NULL)
+		return false;
+
+	g_mstp_digest_ctx = EVP_MAC_CTX_new(mac);
+	EVP_MAC_free(mac);
+	if (g_mstp_digest_ctx == NULL)
+		return false;
+
+	params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "MD5", 0);
+	params[1] = OSSL_PARAM_construct_end();
+	if (!EVP_MAC_init(g_mstp_digest_ctx, key, sizeof(key), params))
+	{
+		EVP_MAC_CTX_free(g_mstp_digest_ctx);
+		g_mstp_digest_ctx = NULL;
+		return false;
+	}
+#else
+	g_mstp_digest_ctx = HMAC_CTX_new();
+	if (g_mstp_digest_ctx == NULL)
+		return false;
+
+	if (!HMAC_Init_ex(g_mstp_digest_ctx, key, sizeof(key), EVP_md5(), NULL))
+	{
+		HMAC_CTX_free(g_mstp_digest_ctx);
+		g_mstp_digest_ctx = NULL;
+		return false;
+	}
+#endif
+
+	return true;
+}
+
 /*****************************************************************************/
 /* mstputil_compute_message_digest: computes the message digest using md5    */
 /* of the vlan to mstid mapping table                                        */
@@ -257,33 +315,61 @@ void mstputil_port_to_string(MSTP_PORT_IDENTIFIER *portId, UINT8 *buffer, UINT16
 void mstputil_compute_message_digest(bool print)
 {
 	MSTP_BRIDGE *mstp_bridge = mstpdata_get_bridge();
-	UINT8 key[16] = MSTP_CONFIG_DIGEST_SIGNATURE_KEY;
-	int md_len = 0; 
-	unsigned char *md5_ptr = NULL; 
+	UINT8 *digest = mstp_bridge->mstConfigId.config_digest;
+	bool ok = false;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	size_t md_len = 0;
+#else
+	unsigned int md_len = 0;
+#endif
 
-	memset(mstp_bridge->mstConfigId.config_digest,
-		0, sizeof(mstp_bridge->mstConfigId.config_digest));
+	memset(digest, 0, sizeof(mstp_bridge->mstConfigId.config_digest));
 
-	/* PKCS11 HMAC_CALC function */
-	md5_ptr = HMAC(EVP_md5(), key, sizeof(key),
-			(unsigned char *) &mstp_bridge->mstid_table, sizeof(mstp_bridge->mstid_table),
-			mstp_bridge->mstConfigId.config_digest, &md_len);
-	if (md5_ptr == NULL) 
+	if (mstputil_get_digest_ctx())
+	{
+		/* reuse the keyed context, only the message changes */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+		ok = EVP_MAC_init(g_mstp_digest_ctx, NULL, 0, NULL) &&
+			EVP_MAC_update(g_mstp_digest_ctx,
+				(unsigned char *) &mstp_bridge->mstid_table, sizeof(mstp_bridge->mstid_table)) &&
+			EVP_MAC_final(g_mstp_digest_ctx, digest, &md_len,
+				sizeof(mstp_bridge->mstConfigId.config_digest));
+#else
+		ok = HMAC_Init_ex(g_mstp_digest_ctx, NULL, 0, NULL, NULL) &&
+			HMAC_Update(g_mstp_digest_ctx,
+				(unsigned char *) &mstp_bridge->mstid_table, sizeof(mstp_bridge->mstid_table)) &&
+			HMAC_Final(g_mstp_digest_ctx, digest, &md_len);
+#endif
+	}
+	if (!ok) 
 	{ 
 		STP_LOG_ERR("MD5 calculation Error in HMAC"); 
 		return;   
 	} 
+	mstp_bridge->config_digest_dirty = false;
+
 	if (md_len != MD5_DIGEST_LENGTH) 
-		STP_LOG_ERR("MD5 digest len : %d != 16",md_len); 
-	else 
-		STP_LOG_DEBUG("MD5 : 0x%s", md5_ptr); 
+		STP_LOG_ERR("MD5 digest len : %d != 16", (int) md_len); 
 	
     if (print)
 	{
-		mstpdebug_print_config_digest(mstp_bridge->mstConfigId.config_digest);
+		mstpdebug_print_config_digest(digest);
 	}
 }
 
+/*****************************************************************************/
+/* mstputil_update_message_digest: recomputes the message digest if the      */
+/* vlan to mstid mapping changed since it was last computed. config changes  */
+/* only mark the digest dirty, so a batch of vlan mappings costs one hmac.   */
+/*****************************************************************************/
+void mstputil_update_message_digest()
+{
+	MSTP_BRIDGE *mstp_bridge = mstpdata_get_bridge();
+
+	if (mstp_bridge && mstp_bridge->config_digest_dirty)
+		mstputil_compute_message_digest(false);
+}
+
 /*****************************************************************************/
 /* mstputil_computeReselect: computes if port role selection is required     */
 /*****************************************************************************/
@@ -368,13 +454,7 @@ void mstputil_set_changedMaster(MSTP_PORT *mstp_port)
 /*****************************************************************************/
 SORT_RETURN mstputil_compare_bridge_id(MSTP_BRIDGE_IDENTIFIER *id1, MSTP_BRIDGE_IDENTIFIER *id2)
 {
-	if (id1->priority > id2->priority)
-		return GREATER_THAN;
-
-	if (id1->priority < id2->priority)
-		return LESS_THAN;
-
-	return stputil_compare_mac(&id1->address, &id2->address);
+	return STP_SORT(MSTP_MSTI_BRIDGE_KEY(id1), MSTP_MSTI_BRIDGE_KEY(id2));
 }
 
 /*****************************************************************************/
@@ -382,19 +462,7 @@ SORT_RETURN mstputil_compare_bridge_id(MSTP_BRIDGE_IDENTIFIER *id1, MSTP_BRIDGE_
 /*****************************************************************************/
 SORT_RETURN mstputil_compare_cist_bridge_id(MSTP_BRIDGE_IDENTIFIER *id1, MSTP_BRIDGE_IDENTIFIER *id2)
 {
-	if (id1->priority > id2->priority)
-		return GREATER_THAN;
-
-	if (id1->priority < id2->priority)
-		return LESS_THAN;
-
-	if (id1->system_id > id2->system_id)
-		return GREATER_THAN;
-
-	if (id1->system_id < id2->system_id)
-		return LESS_THAN;
-
-	return stputil_compare_mac(&id1->address, &id2->address);
+	return STP_SORT(MSTP_CIST_BRIDGE_KEY(id1), MSTP_CIST_BRIDGE_KEY(id2));
 }
 
 /*****************************************************************************/
@@ -402,19 +470,7 @@ SORT_RETURN mstputil_compare_cist_bridge_id(MSTP_BRIDGE_IDENTIFIER *id1, MSTP_BR
 /*****************************************************************************/
 SORT_RETURN mstputil_compare_port_id(MSTP_PORT_IDENTIFIER *p1, MSTP_PORT_IDENTIFIER *p2)
 {
-	if (p1->priority > p2->priority)
-		return GREATER_THAN;
-	else
-	if (p1->priority < p2->priority)
-		return LESS_THAN;
-
-	if (p1->number > p2->number)
-		return GREATER_THAN;
-	else
-	if (p1->number < p2->number)
-		return LESS_THAN;
-
-	return EQUAL_TO;
+	return STP_SORT(MSTP_PORT_KEY(p1), MSTP_PORT_KEY(p2));
 }
 
 /*****************************************************************************/
@@ -422,34 +478,33 @@ SORT_RETURN mstputil_compare_port_id(MSTP_PORT_IDENTIFIER *p1, MSTP_PORT_IDENTIF
 /*****************************************************************************/
 SORT_RETURN mstputil_compare_cist_vectors(MSTP_CIST_VECTOR *vec1, MSTP_CIST_VECTOR *vec2)
 {
-	SORT_RETURN val;
+	uint64_t key1, key2;
 
-	// compare vectors
-	val = mstputil_compare_cist_bridge_id(&(vec1->root), &(vec2->root));
-	if (val != EQUAL_TO)
-		return val;
+	// each step compares a bridge id and the 32-bit cost or 16-bit port id
+	// that follows it. the costs are compared separately since they do not
+	// fit next to a 64-bit bridge key.
+	key1 = MSTP_CIST_BRIDGE_KEY(&vec1->root);
+	key2 = MSTP_CIST_BRIDGE_KEY(&vec2->root);
+	if (key1 != key2)
+		return STP_SORT(key1, key2);
 
-	if (vec1->extPathCost > vec2->extPathCost)
-		return GREATER_THAN;
-	else
-	if (vec1->extPathCost < vec2->extPathCost)
-		return LESS_THAN;
+	if (vec1->extPathCost != vec2->extPathCost)
+		return STP_SORT(vec1->extPathCost, vec2->extPathCost);
 
-	val = mstputil_compare_cist_bridge_id(&(vec1->regionalRoot), &(vec2->regionalRoot));
-	if (val != EQUAL_TO)
-		return val;
+	key1 = MSTP_CIST_BRIDGE_KEY(&vec1->regionalRoot);
+	key2 = MSTP_CIST_BRIDGE_KEY(&vec2->regionalRoot);
+	if (key1 != key2)
+		return STP_SORT(key1, key2);
 
-	if (vec1->intPathCost > vec2->intPathCost)
-		return GREATER_THAN;
-	else
-	if (vec1->intPathCost < vec2->intPathCost)
-		return LESS_THAN;
+	if (vec1->intPathCost != vec2->intPathCost)
+		return STP_SORT(vec1->intPathCost, vec2->intPathCost);
 
-	val = mstputil_compare_cist_bridge_id(&(vec1->designatedId), &(vec2->designatedId));
-	if (val != EQUAL_TO)
-		return val;
+	key1 = MSTP_CIST_BRIDGE_KEY(&vec1->designatedId);
+	key2 = MSTP_CIST_BRIDGE_KEY(&vec2->designatedId);
+	if (key1 != key2)
+		return STP_SORT(key1, key2);
 
-	return mstputil_compare_port_id(&(vec1->designatedPort), &(vec2->designatedPort));
+	return STP_SORT(MSTP_PORT_KEY(&vec1->designatedPort), MSTP_PORT_KEY(&vec2->designatedPort));
 }
 
 /*****************************************************************************/
@@ -457,23 +512,22 @@ SORT_RETURN mstputil_compare_cist_vectors(MSTP_CIST_VECTOR *vec1, MSTP_CIST_VECT
 /*****************************************************************************/
 SORT_RETURN mstputil_compare_msti_vectors(MSTP_MSTI_VECTOR *vec1, MSTP_MSTI_VECTOR *vec2)
 {
-	SORT_RETURN val;
+	uint64_t key1, key2;
 
-	val = mstputil_compare_bridge_id(&(vec1->regionalRoot), &(vec2->regionalRoot));
-	if (val != EQUAL_TO)
-		return val;
+	key1 = MSTP_MSTI_BRIDGE_KEY(&vec1->regionalRoot);
+	key2 = MSTP_MSTI_BRIDGE_KEY(&vec2->regionalRoot);
+	if (key1 != key2)
+		return STP_SORT(key1, key2);
 
-	if (vec1->intPathCost > vec2->intPathCost)
-		return GREATER_THAN;
-	else
-	if (vec1->intPathCost < vec2->intPathCost)
-		return LESS_THAN;
+	if (vec1->intPathCost != vec2->intPathCost)
+		return STP_SORT(vec1->intPathCost, vec2->intPathCost);
 
-	val = mstputil_compare_bridge_id(&(vec1->designatedId), &(vec2->designatedId));
-	if (val != EQUAL_TO)
-		return val;
+	key1 = MSTP_MSTI_BRIDGE_KEY(&vec1->designatedId);
+	key2 = MSTP_MSTI_BRIDGE_KEY(&vec2->designatedId);
+	if (key1 != key2)
+		return STP_SORT(key1, key2);
 
-	return mstputil_compare_port_id(&(vec1->designatedPort), &(vec2->designatedPort));
+	return STP_SORT(MSTP_PORT_KEY(&vec1->designatedPort), MSTP_PORT_KEY(&vec2->designatedPort));
 }
 
 /*****************************************************************************/
@@ -956,6 +1010,7 @@ bool mstputil_set_kernel_bridge_port_state(MSTP_INDEX mstp_index, PORT_ID port_n
     BITMAP_T    *mstp_vlanmask;
     VLAN_ID     vlan_id = VLAN_ID_INVALID, untag_vlan;
     VLAN_MASK   vlanmask;
+    VLAN_SET    port_vlanset, *vlanset;
     UINT8       vlanmask_string[500] = {0,};
     char        cmd_buff[100];
 
@@ -968,25 +1023,31 @@ bool mstputil_set_kernel_bridge_port_state(MSTP_INDEX mstp_index, PORT_ID port_n
     if(!mstp_vlanmask)
         return false;
 
-    vlan_bmp_init(&vlanmask);
-
-    /* vlanmask has all vlans binded to the port. 
-     * We need to find out those vlans which is mapped to the given mstp index*/
-    and_masks((BITMAP_T *)&vlanmask , mstp_vlanmask, (BITMAP_T *)&cbridge->vlanmask);
+    /* mstp_vlanmask has all vlans binded to the port. 
+     * We need to find out those vlans which is mapped to the given mstp index,
+     * walking only the instance vlan ranges instead of building the AND mask */
+    vlanset = &cbridge->vlanset;
 
-    if (is_mask_clear((BITMAP_T *)&vlanmask))
+    if (vlanset_and_mask_is_clear(vlanset, mstp_vlanmask))
         return false;
 
     untag_vlan = mstpdata_get_untag_vlan_for_port(port_number);
 
     if (IS_MEMBER(mstp_bridge->admin_disable_mask, port_number))
     {
-        copy_mask((BITMAP_T *)&vlanmask, mstp_vlanmask);
+        vlanset_from_mask(&port_vlanset, mstp_vlanmask);
+        vlanset = &port_vlanset;
+    }
+
+    if (STP_LOG_IS_ENABLED(STP_LOG_LEVEL_INFO))
+    {
+        vlan_bmp_init(&vlanmask);
+        vlanset_and_mask((BITMAP_T *)&vlanmask, vlanset, mstp_vlanmask);
     }
 
     if(state == FORWARDING)  
     {
-        vlan_id = vlanmask_get_first_vlan(&vlanmask);
+        vlan_id = vlanset_and_mask_get_next_vlan(vlanset, mstp_vlanmask, VLAN_ID_INVALID);
         while (vlan_id != VLAN_ID_INVALID)
         {
             snprintf(cmd_buff, 100, "/sbin/bridge vlan add vid %u dev %s %s", vlan_id, 
@@ -997,14 +1058,17 @@ bool mstputil_set_kernel_bridge_port_state(MSTP_INDEX mstp_index, PORT_ID port_n
                 STP_LOG_ERR("[Vlan %u] Port %d Error: strerr - %s", vlan_id, port_number, strerror(errno));
                 return false;
             }
-            vlan_id = vlanmask_get_next_vlan(&vlanmask, vlan_id);
+            vlan_id = vlanset_and_mask_get_next_vlan(vlanset, mstp_vlanmask, vlan_id);
+        }
+        if (STP_LOG_IS_ENABLED(STP_LOG_LEVEL_INFO))
+        {
+            vlanmask_to_string((BITMAP_T *)&vlanmask, vlanmask_string, sizeof(vlanmask_string));
+            STP_LOG_INFO("[Port %d] Vlan %s Added", port_number, vlanmask_string);
         }
-        vlanmask_to_string((BITMAP_T *)&vlanmask, vlanmask_string, sizeof(vlanmask_string));
-        STP_LOG_INFO("[Port %d] Vlan %s Added", port_number, vlanmask_string);
     }
     else if(state != FORWARDING)
     {
-        vlan_id = vlanmask_get_first_vlan(&vlanmask);
+        vlan_id = vlanset_and_mask_get_next_vlan(vlanset, mstp_vlanmask, VLAN_ID_INVALID);
         while (vlan_id != VLAN_ID_INVALID)
         {
             snprintf(cmd_buff, 100, "/sbin/bridge vlan del vid %u dev %s %s", vlan_id, 
@@ -1015,10 +1079,13 @@ bool mstputil_set_kernel_bridge_port_state(MSTP_INDEX mstp_index, PORT_ID port_n
                 STP_LOG_ERR("[Vlan %u] Port %d Error: strerr - %s", vlan_id, port_number, strerror(errno));
                 return false;
             }
-            vlan_id = vlanmask_get_next_vlan(&vlanmask, vlan_id);
+            vlan_id = vlanset_and_mask_get_next_vlan(vlanset, mstp_vlanmask, vlan_id);
+        }
+        if (STP_LOG_IS_ENABLED(STP_LOG_LEVEL_INFO))
+        {
+            vlanmask_to_string((BITMAP_T *)&vlanmask, vlanmask_string, sizeof(vlanmask_string));
+            STP_LOG_INFO("[Port %d] Vlan %s Removed", port_number, vlanmask_string);
         }
-        vlanmask_to_string((BITMAP_T *)&vlanmask, vlanmask_string, sizeof(vlanmask_string));
-        STP_LOG_INFO("[Port %d] Vlan %s Removed", port_number, vlanmask_string);
     }
     else
     {
@@ -1043,6 +1110,7 @@ bool mstputil_set_port_state(MSTP_INDEX mstp_index, PORT_ID port_number, enum L2
     MSTP_CIST_PORT *cist_port;
     PORT_MASK *portmask;
     MSTP_COMMON_BRIDGE *cbridge;
+    uint64_t start_ns;
 
 	ifname = stp_intf_get_port_name(port_number);
 
@@ -1062,6 +1130,7 @@ bool mstputil_set_port_state(MSTP_INDEX mstp_index, PORT_ID port_number, enum L2
         return false;
     }
     cport->state = state;
+    STP_TRACE_PORT_STATE(mst_id, 0, port_number, state);
 
     STP_LOG_INFO("[MST %d] %s %s", mst_id, ifname, MSTP_STATE_STRING(state, port_number));
 
@@ -1086,12 +1155,14 @@ bool mstputil_set_port_state(MSTP_INDEX mstp_index, PORT_ID port_number, enum L2
             SET_BIT(msti_port->co.modified_fields, MSTP_PORT_MEMBER_PORT_STATE_BIT);
     }
     
+    start_ns = stp_rxlat_program_start();
     mstputil_set_kernel_bridge_port_state(mstp_index, port_number, state);
 
 	if(ifname)
 	{
         stpsync_update_port_state(ifname, mstp_index, state);
     }		
+    stp_rxlat_program_end(start_ns);
 	return true;
 }
 
@@ -1157,6 +1228,7 @@ static void mstptimer_update(MSTP_INDEX mstp_index, PORT_ID port_number)
         cport->role == MSTP_ROLE_MASTER) &&
         (mstptimer_decrement(&cport->fdWhile)))
     {
+        STP_TRACE_TIMER_EXPIRY(mstp_id, 0, port_number, STP_TRACE_TIMER_FD_WHILE);
         mstp_prt_gate(mstp_index, port_number);
     }
 
@@ -1164,6 +1236,7 @@ static void mstptimer_update(MSTP_INDEX mstp_index, PORT_ID port_number)
         mstptimer_decrement(&cport->rrWhile))
     {
         STP_LOG_INFO("[MST %u] Port %d rrWhile expired",  mstp_id, port_number);
+        STP_TRACE_TIMER_EXPIRY(mstp_id, 0, port_number, STP_TRACE_TIMER_RR_WHILE);
         mstp_prt_gate(mstp_index, port_number);
     }
 
@@ -1171,12 +1244,14 @@ static void mstptimer_update(MSTP_INDEX mstp_index, PORT_ID port_number)
         mstptimer_decrement(&cport->rbWhile))
     {
         STP_LOG_INFO("[MST %u] Port %d rbWhile expired",  mstp_id, port_number);
+        STP_TRACE_TIMER_EXPIRY(mstp_id, 0, port_number, STP_TRACE_TIMER_RB_WHILE);
         mstp_prt_gate(mstp_index, port_number);		
     }
 
     if (mstptimer_decrement(&cport->tcWhile))
     {
         STP_LOG_INFO("[MST %u] Port %d tcWhile expired",  mstp_id, port_number);
+        STP_TRACE_TIMER_EXPIRY(mstp_id, 0, port_number, STP_TRACE_TIMER_TC_WHILE);
         mstp_tcm_gate(mstp_index, port_number);
     }
 
@@ -1184,6 +1259,7 @@ static void mstptimer_update(MSTP_INDEX mstp_index, PORT_ID port_number)
     {
         SET_BIT(cport->modified_fields, MSTP_PORT_MEMBER_REM_TIME_BIT);
         STP_LOG_INFO("[MST %u Port %d rcvdInfoWhile expired",  mstp_id, port_number);
+        STP_TRACE_TIMER_EXPIRY(mstp_id, 0, port_number, STP_TRACE_TIMER_RCVD_INFO_WHILE);
         mstp_pim_gate(mstp_index, port_number, NULL);
     }
     else
@@ -1210,6 +1286,7 @@ void mstputil_timer_tick()
 	MSTP_PORT *mstp_port;
 	static UINT8 mstp_tick = 0;
     MSTP_MSTID mstp_id;
+    uint64_t start, done;
 
     mstp_bridge = mstpdata_get_bridge();
     if (mstp_bridge == NULL || !mstp_bridge->active)
@@ -1228,6 +1305,8 @@ void mstputil_timer_tick()
             mstp_port = mstpdata_get_port(port_number);
             if (mstp_port)
             {
+                start = stptimer_prof_self_usec();
+
                 // cist
                 cport = mstputil_get_common_port(MSTP_INDEX_CIST, mstp_port);
                 if (cport != NULL)
@@ -1254,6 +1333,7 @@ void mstputil_timer_tick()
 
                 if (mstptimer_decrement(&mstp_port->helloWhen))
                 {
+                    STP_TRACE_TIMER_EXPIRY(0, 0, port_number, STP_TRACE_TIMER_HELLO_WHEN);
                     if (!mstp_bridge->disable_auto_edge_port &&
                             !mstp_port->operEdge &&
                             !mstp_port->stats.rx.config_bpdu &&
@@ -1288,30 +1368,36 @@ void mstputil_timer_tick()
 
                 if (mstptimer_decrement(&mstp_port->mdelayWhile))
                 {
+                    STP_TRACE_TIMER_EXPIRY(0, 0, port_number, STP_TRACE_TIMER_MDELAY_WHILE);
                     mstp_ppm_gate(port_number);
                 }
+
+                done = stptimer_prof_self_usec();
+                stptimer_prof_add(STPD_TICK_TIMERS, done - start);
+                stptimer_prof_top(true, port_number, done - start);
             } 
             port_number = port_mask_get_next_port(mstp_bridge->enable_mask, port_number);
         }
 
         for (mstp_index = MSTP_INDEX_MIN; mstp_index <= MSTP_INDEX_CIST; mstp_index++)
         {
-            if (mstp_index == MSTP_INDEX_CIST)
-            {
-                mstputil_timer_sync_db(mstp_index);
-            }
-            else
-            {
-                if (mstp_bridge->msti[mstp_index] == NULL)
-                    continue;
-                mstputil_timer_sync_db(mstp_index);
-            }
+            if (mstp_index != MSTP_INDEX_CIST && mstp_bridge->msti[mstp_index] == NULL)
+                continue;
+
+            start = stptimer_prof_self_usec();
+            mstputil_timer_sync_db(mstp_index);
+            done = stptimer_prof_self_usec();
+
+            stptimer_prof_add(STPD_TICK_SYNC_DB, done - start);
+            stptimer_prof_top(false, mstputil_get_mstid(mstp_index), done - start);
         }
 
         g_stp_bpdu_sync_tick_id++;
         if(g_stp_bpdu_sync_tick_id >= 10)
         {
+            start = stptimer_prof_self_usec();
             mstputil_timer_sync_bpdu_counters();
+            stptimer_prof_add(STPD_TICK_BPDU_SYNC, stptimer_prof_self_usec() - start);
             g_stp_bpdu_sync_tick_id = 0;
         }
     }
@@ -1786,6 +1872,7 @@ void mstputil_sync_cist_port(PORT_ID port_number)
     cist_port->co.modified_fields = 0;
     cist_port->modified_fields = 0;
 
+    STP_TRACE_DB_SYNC(mstputil_get_mstid(MSTP_INDEX_CIST), 0, port_number);
     stpsync_update_mst_port_info(&mstp_intf);
 }
 /*****************************************************************************/
@@ -1926,6 +2013,7 @@ void mstputil_sync_msti_port(MSTP_INDEX mstp_index, PORT_ID port_number)
     msti_port->modified_fields = 0;
     msti_port->co.modified_fields = 0;
 
+    STP_TRACE_DB_SYNC(mstputil_get_mstid(mstp_index), 0, port_number);
     stpsync_update_mst_port_info(&mstp_intf);
 }
 
@@ -2052,6 +2140,7 @@ void mstputil_sync_mst_instance(MSTP_INDEX mstp_index)
 
             cist_bridge->modified_fields = 0;
 
+            STP_TRACE_DB_SYNC(stp_mst_table.mst_id, 0, STP_TRACE_NO_PORT);
             stpsync_update_mst_info(&stp_mst_table);
         }
     }
@@ -2119,6 +2208,7 @@ void mstputil_sync_mst_instance(MSTP_INDEX mstp_index)
             }
 
             msti_bridge->modified_fields = 0;
+            STP_TRACE_DB_SYNC(stp_mst_table.mst_id, 0, STP_TRACE_NO_PORT);
             stpsync_update_mst_info(&stp_mst_table);
         }
 
@@ -152,6 +152,8 @@ void record_config_information(STP_CLASS *stp_class, PORT_ID port_number, STP_CO
     }
 
 	stptimer_start(&stp_port_class->message_age_timer, bpdu->message_age);
+
+	stputil_root_tree_update(stp_class, port_number);
 }
 
 /* 8.6.3 */
@@ -211,98 +213,49 @@ void transmit_tcn(STP_CLASS *stp_class)
 	}
 }
 
+static void designated_port_check(STP_CLASS *stp_class, PORT_ID port_number);
+
 /* 8.6.7 */
 void configuration_update(STP_CLASS *stp_class)
 {
+	BRIDGE_DATA *bridge_info = &stp_class->bridge_info;
+	BRIDGE_IDENTIFIER root_id = bridge_info->root_id;
+	UINT32 root_path_cost = bridge_info->root_path_cost;
+	PORT_ID root_port = bridge_info->root_port;
+	PORT_ID port_number;
+	bool incremental;
+
+	incremental = stputil_root_tree_incremental(stp_class, &port_number);
+
 	root_selection(stp_class);
-	designated_port_selection(stp_class);
+
+	/* designated port selection only depends on the root information and on
+	 * the port itself. if the root did not move, the result only changes for
+	 * the port that changed since the last update.
+	 */
+	if (incremental &&
+		root_port == bridge_info->root_port &&
+		root_path_cost == bridge_info->root_path_cost &&
+		stputil_compare_bridge_id(&root_id, &bridge_info->root_id) == EQUAL_TO)
+	{
+		if (port_number != STP_INVALID_PORT && is_member(stp_class->enable_mask, port_number))
+			designated_port_check(stp_class, port_number);
+	}
+	else
+	{
+		designated_port_selection(stp_class);
+	}
+
+	stputil_root_tree_clear_changes(stp_class);
 }
 
 /* 8.6.8 */
 void root_selection(STP_CLASS *stp_class)
 {
-	enum SORT_RETURN result;
-	PORT_ID port_number, root_port;
-	STP_PORT_CLASS *stp_port_class, *root_port_class;
-	
-	root_port = STP_INVALID_PORT;
-
-	for (
-		port_number = port_mask_get_first_port(stp_class->enable_mask);
-		port_number != BAD_PORT_ID; 
-		port_number = port_mask_get_next_port(stp_class->enable_mask, port_number)
-		)
-	{
-        if (STP_DEBUG_EVENT(stp_class->vlan_id, port_number))
-            STP_LOG_DEBUG("vlan %d port %d", stp_class->vlan_id, port_number);
-
-		stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
-
-		// do not service ports that are on token-ring cabling or backup ports
-		if (stp_port_class->self_loop) 
-			continue;
-		
-
-		if ((!designated_port(stp_class, port_number)) && 
-			(stputil_compare_bridge_id(&stp_port_class->designated_root,
-						&stp_class->bridge_info.bridge_id) == LESS_THAN)) 
-		{
-			if (root_port == STP_INVALID_PORT)
-			{
-				root_port = port_number;
-				continue;
-			}
-
-			root_port_class = GET_STP_PORT_CLASS(stp_class, root_port);
-
-			result = stputil_compare_bridge_id(&stp_port_class->designated_root,
-							&root_port_class->designated_root);
-			if (result == LESS_THAN)
-			{
-				root_port = port_number;
-				continue;
-			}
-			if (result == GREATER_THAN)
-				continue;
+	PORT_ID root_port;
+	STP_PORT_CLASS *root_port_class;
 
-            if (stp_port_class->path_cost + stp_port_class->designated_cost <
-                root_port_class->path_cost + root_port_class->designated_cost)
-            {
-                root_port = port_number;
-                continue;
-            }
-
-            if (stp_port_class->path_cost + stp_port_class->designated_cost >
-                root_port_class->path_cost + root_port_class->designated_cost)
-                continue;
-
-			result = stputil_compare_bridge_id (&stp_port_class->designated_bridge,
-						&root_port_class->designated_bridge);
-			if (result == LESS_THAN)
-			{
-				root_port = port_number;
-				continue;
-			}
-			if (result == GREATER_THAN)
-				continue;
-
-			result = stputil_compare_port_id (&stp_port_class->designated_port,
-							&root_port_class->designated_port);
-			if (result == LESS_THAN)
-			{
-				root_port = port_number;
-				continue;
-			}
-			if (result == GREATER_THAN)
-				continue;
-
-			if (stputil_compare_port_id(&stp_port_class->port_id,
-				&root_port_class->port_id) == LESS_THAN)
-			{
-				root_port = port_number;
-			}
-		}
-	} // for
+	root_port = stputil_get_root_port(stp_class);
 
 	if (root_port == STP_INVALID_PORT)
 	{
@@ -341,68 +294,74 @@ void root_selection(STP_CLASS *stp_class)
 }
 
 /* 8.6.9 */
-void designated_port_selection(STP_CLASS *stp_class)
+static void designated_port_check(STP_CLASS *stp_class, PORT_ID port_number)
 {
-	PORT_ID port_number;
 	STP_PORT_CLASS *stp_port_class;
 	enum SORT_RETURN result;
 
-	for (
-		port_number = port_mask_get_first_port(stp_class->enable_mask);
-		port_number != BAD_PORT_ID; 
-		port_number = port_mask_get_next_port(stp_class->enable_mask, port_number)
-		)
+	if (STP_DEBUG_EVENT(stp_class->vlan_id, port_number))
+		STP_LOG_DEBUG("vlan %d port %d", stp_class->vlan_id, port_number);
+
+	stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
+
+	// case 1
+	if (designated_port(stp_class, port_number))
 	{
-        if (STP_DEBUG_EVENT(stp_class->vlan_id, port_number))
-            STP_LOG_DEBUG("vlan %d port %d", stp_class->vlan_id, port_number);
+		become_designated_port(stp_class, port_number);
+		return;
+	}
 
-		stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
+	// case 2
+	if (stputil_compare_bridge_id(&stp_port_class->designated_root,
+			&stp_class->bridge_info.root_id) != EQUAL_TO) 
+	{
+		become_designated_port(stp_class, port_number);
+		return;
+	}
 
-		// case 1
-		if (designated_port(stp_class, port_number))
-		{
-			become_designated_port(stp_class, port_number);
-			continue;
-		}
+	// case 3
+	if (stp_class->bridge_info.root_path_cost < stp_port_class->designated_cost)
+	{
+		become_designated_port(stp_class, port_number);
+		return;
+	}
 
-		// case 2
-		if (stputil_compare_bridge_id(&stp_port_class->designated_root,
-				&stp_class->bridge_info.root_id) != EQUAL_TO) 
-		{
-			become_designated_port(stp_class, port_number);
-			continue;
-		}
+	if (stp_class->bridge_info.root_path_cost > stp_port_class->designated_cost) 
+		return;
 
-		// case 3
-		if (stp_class->bridge_info.root_path_cost < stp_port_class->designated_cost)
-		{
-			become_designated_port(stp_class, port_number);
-			continue;
-		}
+	result = stputil_compare_bridge_id(&stp_class->bridge_info.bridge_id,
+		 &stp_port_class->designated_bridge);
 
-		if (stp_class->bridge_info.root_path_cost > stp_port_class->designated_cost) 
-			continue;
+	// case 4
+	if (result == LESS_THAN)
+	{
+		become_designated_port(stp_class, port_number);
+		return;
+	}
 
-		result = stputil_compare_bridge_id(&stp_class->bridge_info.bridge_id,
-			 &stp_port_class->designated_bridge);
+	if (result == GREATER_THAN)
+		return;
 
-		// case 4
-		if (result == LESS_THAN)
-		{
-			become_designated_port(stp_class, port_number);
-			continue;
-		}
+	// case 5
+	if ((stputil_compare_port_id(&stp_port_class->port_id,
+		 &stp_port_class->designated_port) != GREATER_THAN))
+	{
+		become_designated_port(stp_class, port_number);
+		STP_LOG_INFO("STP_RAS_DESIGNATED_ROLE I:%lu P:%lu V:%lu",GET_STP_INDEX(stp_class),port_number, stp_class->vlan_id);
+	}
+}
 
-		if (result == GREATER_THAN)
-			continue;
+void designated_port_selection(STP_CLASS *stp_class)
+{
+	PORT_ID port_number;
 
-		// case 5
-		if ((stputil_compare_port_id(&stp_port_class->port_id,
-			 &stp_port_class->designated_port) != GREATER_THAN))
-		{
-			become_designated_port(stp_class, port_number);
-            STP_LOG_INFO("STP_RAS_DESIGNATED_ROLE I:%lu P:%lu V:%lu",GET_STP_INDEX(stp_class),port_number, stp_class->vlan_id);
-		}
+	for (
+		port_number = port_mask_get_first_port(stp_class->enable_mask);
+		port_number != BAD_PORT_ID; 
+		port_number = port_mask_get_next_port(stp_class->enable_mask, port_number)
+		)
+	{
+		designated_port_check(stp_class, port_number);
 	}
 }
 
@@ -437,6 +396,8 @@ void become_designated_port(STP_CLASS *stp_class, PORT_ID port_number)
 	    stp_port_class->designated_port = stp_port_class->port_id;
         SET_BIT(stp_port_class->modified_fields, STP_PORT_CLASS_MEMBER_DESIGN_PORT_BIT);
     }
+
+	stputil_root_tree_update(stp_class, port_number);
 }
 
 /* 8.6.11 */
@@ -589,6 +550,45 @@ void acknowledge_topology_change(STP_CLASS *stp_class, PORT_ID port_number)
 	transmit_config(stp_class, port_number);
 }
 
+/* FUNCTION
+ *		repeated_config_bpdu()
+ *
+ * SYNOPSIS
+ *		returns true if the bpdu repeats the information already recorded
+ *		for the port by a different bridge. supercedes_port_info() holds for
+ *		such a bpdu but recording it changes nothing, so root, designated
+ *		port and port state selection would give the same result.
+ */
+static bool repeated_config_bpdu(STP_CLASS *stp_class, PORT_ID port_number, STP_CONFIG_BPDU *bpdu)
+{
+	STP_PORT_CLASS *stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
+
+	if (stp_port_class->self_loop || designated_port(stp_class, port_number))
+		return false;
+
+	return (bpdu->root_path_cost == stp_port_class->designated_cost &&
+		stputil_compare_port_id(&bpdu->port_id, &stp_port_class->designated_port) == EQUAL_TO &&
+		stputil_compare_bridge_id(&bpdu->root_id, &stp_port_class->designated_root) == EQUAL_TO &&
+		stputil_compare_bridge_id(&bpdu->bridge_id, &stp_port_class->designated_bridge) == EQUAL_TO &&
+		stputil_compare_bridge_id(&bpdu->bridge_id, &stp_class->bridge_info.bridge_id) != EQUAL_TO);
+}
+
+/* relays the root information received on the root port */
+static void received_root_port_bpdu(STP_CLASS *stp_class, PORT_ID port_number, STP_CONFIG_BPDU *bpdu)
+{
+	record_config_timeout_values(stp_class, bpdu);
+	config_bpdu_generation(stp_class);
+
+	if (bpdu->flags.topology_change_acknowledgement)
+	{
+		if (STP_DEBUG_BPDU_RX(stp_class->vlan_id, port_number))
+		{
+			STP_PKTLOG("TCN ACK Received Vlan:%d Port:%d", stp_class->vlan_id, port_number);
+		}
+		topology_change_acknowledged(stp_class);
+	}
+}
+
 /* 8.7.1 */
 void received_config_bpdu(STP_CLASS *stp_class, PORT_ID port_number, STP_CONFIG_BPDU *bpdu)
 {
@@ -601,6 +601,17 @@ void received_config_bpdu(STP_CLASS *stp_class, PORT_ID port_number, STP_CONFIG_
 	if (stp_port_class->state == DISABLED)
 		return;
 
+	// steady state: the designated bridge repeats its information, only
+	// the message age timer needs restarting.
+	if (repeated_config_bpdu(stp_class, port_number, bpdu))
+	{
+		stptimer_start(&stp_port_class->message_age_timer, bpdu->message_age);
+
+		if (port_number == stp_class->bridge_info.root_port)
+			received_root_port_bpdu(stp_class, port_number, bpdu);
+		return;
+	}
+
 	root = root_bridge(stp_class);
 	result = supercedes_port_info(stp_class, port_number, bpdu);
 
@@ -614,7 +625,7 @@ void received_config_bpdu(STP_CLASS *stp_class, PORT_ID port_number, STP_CONFIG_
 
 		if (!root_bridge(stp_class) && root)
 		{
-			stptimer_stop(&stp_class->hello_timer);
+			stptimer_stop_hello(stp_class);
 
 			if (stp_class->bridge_info.topology_change_detected)
 			{
@@ -626,22 +637,14 @@ void received_config_bpdu(STP_CLASS *stp_class, PORT_ID port_number, STP_CONFIG_
 
 		if (port_number == stp_class->bridge_info.root_port)
 		{
-			record_config_timeout_values(stp_class, bpdu);
-			config_bpdu_generation(stp_class);
-
-			if (bpdu->flags.topology_change_acknowledgement)
-			{
-				if (STP_DEBUG_BPDU_RX(stp_class->vlan_id, port_number))
-				{
-					STP_PKTLOG("TCN ACK Received Vlan:%d Port:%d", stp_class->vlan_id, port_number);
-				}
-				topology_change_acknowledged(stp_class);
-
-			}
+			received_root_port_bpdu(stp_class, port_number, bpdu);
 		}
 	}
 	else 
 	{
+		// supercedes_port_info() may have cleared self_loop
+		stputil_root_tree_update(stp_class, port_number);
+
 		if (designated_port(stp_class, port_number))
 		{
 			if (STP_DEBUG_BPDU_RX(stp_class->vlan_id, port_number))
@@ -683,6 +686,8 @@ void hello_timer_expiry(STP_CLASS *stp_class)
 	UINT32 last_expiry_time = 0;
 	UINT32 current_time = 0;
 
+	STP_TRACE_TIMER_EXPIRY(GET_STP_INDEX(stp_class), stp_class->vlan_id, STP_TRACE_NO_PORT, STP_TRACE_TIMER_HELLO);
+
 	last_expiry_time = stp_class->last_expiry_time;
 	current_time = sys_get_seconds();
 	stp_class->last_expiry_time = current_time;
@@ -723,6 +728,8 @@ void message_age_timer_expiry(STP_CLASS *stp_class, PORT_ID port_number)
 	STP_PORT_CLASS *stp_port_class, *stp_ccep_port_class;
 	PORT_ID ccep_port_id;
 
+	STP_TRACE_TIMER_EXPIRY(GET_STP_INDEX(stp_class), stp_class->vlan_id, port_number, STP_TRACE_TIMER_MESSAGE_AGE);
+
 	stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
 	stp_port_class->self_loop = false;
 
@@ -740,7 +747,7 @@ void message_age_timer_expiry(STP_CLASS *stp_class, PORT_ID port_number)
 		topology_change_detection(stp_class);
 		stptimer_stop(&stp_class->tcn_timer);
 		config_bpdu_generation(stp_class);
-		stptimer_start(&stp_class->hello_timer, 0);
+		stptimer_start_hello(stp_class);
 	}
 }
 
@@ -749,6 +756,8 @@ void forwarding_delay_timer_expiry(STP_CLASS *stp_class, PORT_ID port_number)
 {
 	STP_PORT_CLASS *stp_port_class;
 
+	STP_TRACE_TIMER_EXPIRY(GET_STP_INDEX(stp_class), stp_class->vlan_id, port_number, STP_TRACE_TIMER_FORWARD_DELAY);
+
 	stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
 
 	switch (stp_port_class->state)
@@ -791,6 +800,7 @@ void forwarding_delay_timer_expiry(STP_CLASS *stp_class, PORT_ID port_number)
 /* 8.7.6 */
 void tcn_timer_expiry(STP_CLASS *stp_class)
 {
+	STP_TRACE_TIMER_EXPIRY(GET_STP_INDEX(stp_class), stp_class->vlan_id, STP_TRACE_NO_PORT, STP_TRACE_TIMER_TCN);
 	transmit_tcn(stp_class);
 	stptimer_start(&stp_class->tcn_timer, 0);
 }
@@ -798,6 +808,7 @@ void tcn_timer_expiry(STP_CLASS *stp_class)
 /* 8.7.7 */
 void topology_change_timer_expiry(STP_CLASS * stp_class)
 {
+	STP_TRACE_TIMER_EXPIRY(GET_STP_INDEX(stp_class), stp_class->vlan_id, STP_TRACE_NO_PORT, STP_TRACE_TIMER_TOPOLOGY_CHANGE);
 	stp_class->bridge_info.topology_change_detected = false;
 	stp_class->bridge_info.topology_change = false;
 }
@@ -806,6 +817,8 @@ void topology_change_timer_expiry(STP_CLASS * stp_class)
 void hold_timer_expiry(STP_CLASS *stp_class, PORT_ID port_number)
 {
 	STP_PORT_CLASS *stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
+
+	STP_TRACE_TIMER_EXPIRY(GET_STP_INDEX(stp_class), stp_class->vlan_id, port_number, STP_TRACE_TIMER_HOLD);
 	if (stp_port_class->config_pending)
 	{
 		transmit_config(stp_class, port_number);
@@ -21,6 +21,8 @@
 
 uint8_t g_dbg_lvl;
 STP_GLOBAL			stp_global;
+// bpdu encode buffers of the thread, sharded workers point it to their own
+__thread STP_BPDU_BUFS *g_stp_bpdu_bufs = &stp_global.bpdu_bufs;
 uint32_t g_max_stp_port;
 uint16_t g_stp_bmp_po_offset;
 
@@ -88,6 +90,13 @@ bool stpdata_init_global_structures(UINT16 max_instances)
 
 	memset(g_stp_class_array, 0, mem_size);
 
+    if (bmp_alloc(&g_stp_txn_class_mask, g_stp_instances) == -1)
+    {
+        STP_LOG_ERR("txn class mask alloc Failed");
+        free(g_stp_class_array);
+        return false;
+    }
+
     if (stpdata_malloc_port_structures() == false)
     {
         free(g_stp_class_array);
@@ -119,6 +128,9 @@ bool stpdata_init_global_structures(UINT16 max_instances)
 	/* set root-protect timeout to its default value */
 	stp_global.root_protect_timeout = STP_DFLT_ROOT_PROTECT_TIMEOUT;
 
+	/* spread root bridge hellos over the default hello interval */
+	stp_global.hello_slots = STP_DFLT_HELLO_SLOTS;
+
 	/*
 	 * fast span is enabled by default
 	 */
@@ -211,12 +223,13 @@ void stpdata_class_free(STP_INDEX stp_index)
     stp_class->fast_aging = 0;
 	stp_class->state = STP_CLASS_FREE;
     memset(&stp_class->bridge_info, 0, sizeof(BRIDGE_DATA));
-    stop_timer(&stp_class->hello_timer);
+    stptimer_stop_hello(stp_class);
     stop_timer(&stp_class->tcn_timer);
     stop_timer(&stp_class->topology_change_timer);
     stp_class->last_expiry_time = 0;
     stp_class->last_bpdu_rx_time = 0;
     stp_class->modified_fields = 0;
+    stputil_root_tree_free(stp_class);
 
 	g_stp_active_instances--;
 }
@@ -77,9 +77,61 @@ void stpdbg_dump_nl_db()
         stpdbg_dump_nl_db_node(node);
 }
 
+static void stpdbg_dump_libev_hist(STPD_HIST *hist)
+{
+    if (!hist->count)
+    {
+        STP_DUMP(" %8s %8s %8s %8s", "-", "-", "-", "-");
+        return;
+    }
+
+    STP_DUMP(" %8" PRIu64 " %8u %8u %8u", hist->sum / hist->count,
+            stpd_hist_percentile(hist, 50), stpd_hist_percentile(hist, 99), hist->max);
+}
+
+static void stpdbg_dump_libev_prof()
+{
+    STPD_LIBEV_STATS *libev = &stpd_context.dbg_stats.libev;
+    uint8_t i;
+
+    STP_DUMP("\nDispatch limit : %u ms / %u callbacks, limited %" PRIu64 " deferred %" PRIu64 " (max %u)\n",
+            STP_LIBEV_MAX_DISPATCH_MSEC, STP_LIBEV_MAX_DISPATCH_CBS, libev->dispatch_limited,
+            libev->dispatch_deferred, libev->dispatch_deferred_max);
+    STP_DUMP("%-12s %10s |%8s %8s %8s %8s |%8s %8s %8s %8s\n", "Callback(us)", "Calls",
+            "RunAvg", "P50", "P99", "Max", "WaitAvg", "P50", "P99", "Max");
+    for (i = 0; i < libev->prof_count; i++)
+    {
+        STP_DUMP("%-12s %10" PRIu64 " |", libev->prof[i].name, libev->prof[i].calls);
+        stpdbg_dump_libev_hist(&libev->prof[i].run);
+        STP_DUMP(" |");
+        stpdbg_dump_libev_hist(&libev->prof[i].wait);
+        STP_DUMP("\n");
+    }
+}
+
+static void stpdbg_dump_applog_stats()
+{
+    APPLOG_STATS stats;
+    APPLOG_SITE *site = NULL;
+
+    applog_get_stats(&stats);
+    STP_DUMP("\nLog     : queued %" PRIu64 " written %" PRIu64 " sync %" PRIu64 " ring-drop %" PRIu64
+            " rate-drop %" PRIu64 " truncated %" PRIu64 "\n", stats.queued, stats.written,
+            stats.sync_written, stats.ring_drops, stats.rate_drops, stats.truncated);
+
+    while ((site = applog_site_next(site)))
+    {
+        if (site->dropped)
+            STP_DUMP("  %s:%u dropped %" PRIu64 "\n", site->func ? site->func : site->fmt,
+                    site->line, site->dropped);
+    }
+}
+
 void stpdbg_dump_stp_stats()
 {
     uint16_t i = 0;
+    STPD_TX_PORT *tx;
+    uint64_t sent;
     STP_DUMP("STP max port  : %u\n", g_max_stp_port);
     STP_DUMP("Total Sockets : %u\n", g_stpd_stats_libev_no_of_sockets);
     STP_DUMP("No of Active Q's in Libev : %d\n",event_base_get_npriorities(stp_intf_get_evbase()));
@@ -91,6 +143,17 @@ void stpdbg_dump_stp_stats()
     STP_DUMP("Pkt-rx  : %" PRIu64 "\n", g_stpd_stats_libev_pktrx);
     STP_DUMP("IPC     : %" PRIu64 "\n", g_stpd_stats_libev_ipc);
     STP_DUMP("Netlink : %" PRIu64 "\n", g_stpd_stats_libev_netlink);
+    STP_DUMP("IPC-Msgs: %" PRIu64 " (batches %" PRIu64 " large %" PRIu64 " trunc %" PRIu64 " err %" PRIu64 ")\n",
+            g_stpd_stats_ipc.rx_msgs, g_stpd_stats_ipc.rx_batches, g_stpd_stats_ipc.rx_large,
+            g_stpd_stats_ipc.rx_trunc, g_stpd_stats_ipc.rx_err);
+    STP_DUMP("Txn     : commits %" PRIu64 " timeouts %" PRIu64 "%s\n",
+            g_stpd_stats_ipc.txn_commits, g_stpd_stats_ipc.txn_timeouts,
+            STPD_CONFIG_TXN_ACTIVE() ? " (open)" : "");
+    stp_pkt_io_dump_stats();
+    stp_shard_dump_stats();
+    stpdbg_dump_libev_prof();
+    stptimer_prof_dump();
+    stpdbg_dump_applog_stats();
 
     STP_DUMP("\n");
     STP_DUMP("-----------------------------------------\n");
@@ -110,6 +173,73 @@ void stpdbg_dump_stp_stats()
                     , STPD_GET_PKT_COUNT(i, pkt_tx_err));
         }
     }
+
+    STP_DUMP("\n");
+    STP_DUMP("Tx pacing: rate %u burst %u\n", g_stpd_tx_rate, g_stpd_tx_burst);
+    STP_DUMP("------------------------------------------------------------------------\n");
+    STP_DUMP(" Port | Depth | Max-Depth | Queued | Replaced | Drop | Avg-Delay | Max-Delay \n");
+    STP_DUMP("------------------------------------------------------------------------\n");
+    for(i = 0; i<g_max_stp_port; i++)
+    {
+        tx = stpd_context.tx_pacer.port ? stpd_context.tx_pacer.port[i] : NULL;
+        if (STPD_GET_PKT_COUNT(i, pkt_tx_queued) || STPD_GET_PKT_COUNT(i, pkt_tx_drop))
+        {
+            sent = STPD_GET_PKT_COUNT(i, pkt_tx_queued) - (tx ? tx->depth : 0);
+            STP_DUMP("%4u  | %5u | %9u | %6" PRIu64 " | %8" PRIu64 " | %4" PRIu64 " | %7" PRIu64 "us | %7uus \n", i
+                    , tx ? tx->depth : 0
+                    , STPD_GET_PKT_COUNT(i, pkt_tx_depth_max)
+                    , STPD_GET_PKT_COUNT(i, pkt_tx_queued)
+                    , STPD_GET_PKT_COUNT(i, pkt_tx_replaced)
+                    , STPD_GET_PKT_COUNT(i, pkt_tx_drop)
+                    , sent ? (STPD_GET_PKT_COUNT(i, pkt_tx_delay_sum) / sent) : 0
+                    , STPD_GET_PKT_COUNT(i, pkt_tx_delay_max));
+        }
+    }
+}
+
+void stpdbg_dump_mempool_stats()
+{
+    MEMPOOL *pool;
+
+    STP_DUMP("-----------------------------------------------------------------------------------\n");
+    STP_DUMP(" Pool           | ObjSz | Slabs | InUse |  Peak |    Allocs |     Frees | Fail \n");
+    STP_DUMP("-----------------------------------------------------------------------------------\n");
+    for (pool = mempool_get_first(); pool; pool = mempool_get_next(pool))
+    {
+        STP_DUMP(" %-14s | %5u | %5u | %5u | %5u | %9" PRIu64 " | %9" PRIu64 " | %4" PRIu64 "\n",
+                pool->name, pool->obj_size, pool->slab_count, pool->in_use, pool->peak,
+                pool->alloc_count, pool->free_count, pool->alloc_fail);
+    }
+}
+
+/* FUNCTION
+ *		stpdbg_set_log_module()
+ *
+ * SYNOPSIS
+ *		enables (1) or disables (0) the info and debug logs of a module or
+ *		of "all", then shows the module states. enable -1 only shows them.
+ */
+void stpdbg_set_log_module(char *name, int enable)
+{
+    int id;
+
+    if (enable >= 0)
+    {
+        if (0 == strcmp(name, "all"))
+        {
+            for (id = 0; id < STP_LOG_MOD_MAX; id++)
+                applog_module_enable(id, enable);
+        }
+        else if ((id = applog_module_id(name)) >= 0)
+            applog_module_enable(id, enable);
+        else
+            STP_DUMP("unknown log module %s\n", name);
+    }
+
+    STP_DUMP("Compiled log level : %d\n", APP_LOG_COMPILE_LEVEL);
+    STP_DUMP("Log level          : %d\n", applog_get_config_level());
+    for (id = 0; id < STP_LOG_MOD_MAX; id++)
+        STP_DUMP("  %-8s %s\n", applog_module_name(id), applog_module_is_enabled(id) ? "on" : "off");
 }
 
 /* DM */
@@ -152,6 +282,8 @@ void stpdm_global()
             "protect_disabled_mask  = %s\n\t"
             "root_protect_mask      = %s\n\t"
             "root_protect_timeout   = %u\n\t"
+            "hello_slots            = %u\n\t"
+            "hello_round            = %u\n\t"
             "fastspan_mask          = %s\n\t"
             "fastspan_admin_mask    = %s\n\t"
             "fastuplink_admin_mask  = %s\n\t"
@@ -166,10 +298,10 @@ void stpdm_global()
             stp_global.tick_id,
             stp_global.fast_span,
             stp_global.class_array,
-            &stp_global.config_bpdu,
-            &stp_global.tcn_bpdu,
-            &stp_global.pvst_config_bpdu,
-            &stp_global.pvst_tcn_bpdu,
+            &stp_global.bpdu_bufs.config_bpdu,
+            &stp_global.bpdu_bufs.tcn_bpdu,
+            &stp_global.bpdu_bufs.pvst_config_bpdu,
+            &stp_global.bpdu_bufs.pvst_tcn_bpdu,
             enable_string,
             enable_admin_string,
             protect_string,
@@ -177,6 +309,8 @@ void stpdm_global()
             protect_disabled_string,
             root_protect_string,
             stp_global.root_protect_timeout,
+            stp_global.hello_slots,
+            stp_global.hello_round,
             fastspan_string,
             fastspan_admin_string,
             fastuplink_admin_string,
@@ -207,6 +341,7 @@ void stpdm_class(STP_CLASS *stp_class)
             "control_mask          = %s\n\t"
             "untag_mask            = %s\n\t"
             "hello_timer           = %s %d\n\t"
+            "hello_slot            = %d (%s, %u ports)\n\t"
             "tcn_timer             = %s %d\n\t"
             "topology_change_timer = %s %d\n\t",
             stp_class->vlan_id,
@@ -216,6 +351,9 @@ void stpdm_class(STP_CLASS *stp_class)
             s3,
             STP_TIMER_STRING(&stp_class->hello_timer),
             stp_class->hello_timer.value,
+            stp_class->hello_slot,
+            stp_class->hello_scheduled ? "scheduled" : "none",
+            stp_class->hello_load,
             STP_TIMER_STRING(&stp_class->tcn_timer),
             stp_class->tcn_timer.value,
             STP_TIMER_STRING(&stp_class->topology_change_timer),
@@ -473,6 +611,10 @@ void stpdbg_process_ctl_msg(void *msg)
             /* Dump Lib event stats */
             STP_DUMP("\nLSTATS:\n");
             stpdbg_dump_stp_stats();
+
+            /* Dump memory pool stats */
+            STP_DUMP("\nMEMPOOL:\n");
+            stpdbg_dump_mempool_stats();
             break;
         }
         case STP_CTL_DUMP_GLOBAL:
@@ -588,9 +730,44 @@ void stpdbg_process_ctl_msg(void *msg)
             stpdbg_dump_stp_stats();
             break;
         }
+        case STP_CTL_DUMP_MEMPOOL_STATS:
+        {
+            stpdbg_dump_mempool_stats();
+            break;
+        }
+        case STP_CTL_SET_TX_RATE:
+        {
+            stp_pkt_tx_set_rate(pmsg->level, pmsg->vlan_id);
+            STP_DUMP("bpdu tx rate set to %u burst %u\n", g_stpd_tx_rate, g_stpd_tx_burst);
+            break;
+        }
+        case STP_CTL_DUMP_RX_LATENCY:
+        {
+            stp_rxlat_dump(pmsg->intf_name);
+            break;
+        }
+        case STP_CTL_SET_TICK_OVERRUN:
+        {
+            stptimer_prof_set_overrun(pmsg->level);
+            STP_DUMP("tick overrun threshold set to %d ms\n", pmsg->level);
+            break;
+        }
+        case STP_CTL_SET_LOG_MODULE:
+        {
+            stpdbg_set_log_module(pmsg->intf_name, pmsg->level);
+            break;
+        }
+        case STP_CTL_SET_HELLO_SLOTS:
+        {
+            stptimer_set_hello_slots(pmsg->level);
+            STP_DUMP("hello slots set to %u\n", stp_global.hello_slots);
+            break;
+        }
         case STP_CTL_CLEAR_ALL:
         {
             stpmgr_clear_statistics(VLAN_ID_INVALID, BAD_PORT_ID);
+            stp_rxlat_clear();
+            stptimer_prof_clear();
             STP_DUMP("All stats cleared\n");
             break;
         }
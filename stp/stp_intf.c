@@ -17,6 +17,13 @@
 
  #include "stp_inc.h"
 
+/* Interface nodes and their AVL nodes come from fixed size pools so that
+ * mass port add/remove recycles memory instead of fragmenting the heap. */
+MEMPOOL g_stpd_intf_node_pool = MEMPOOL_INITIALIZER("intf_node", sizeof(INTERFACE_NODE), 64);
+static MEMPOOL g_stpd_intf_avl_pool = MEMPOOL_INITIALIZER("intf_avl_node", sizeof(struct avl_node), 256);
+MEMPOOL_AVL_ALLOCATOR g_stpd_intf_avl_allocator = MEMPOOL_AVL_ALLOCATOR_INITIALIZER(&g_stpd_intf_avl_pool);
+static MEMPOOL g_stpd_mst_info_pool = MEMPOOL_INITIALIZER("mst_info", sizeof(MST_INFO), 64);
+
 /*
  * Input:
  *   pointer to STATIC_BITMAP_T
@@ -182,6 +189,83 @@ int stp_intf_avl_compare(const void *user_p, const void *data_p, void *param)
     return (strncasecmp(pa->ifname, pb->ifname, IFNAMSIZ));
 }
 
+int stp_intf_mst_info_avl_compare(const void *user_p, const void *data_p, void *param)
+{
+    MST_INFO *pa = (MST_INFO *)user_p;
+    MST_INFO *pb = (MST_INFO *)data_p;
+
+    if (pa->port_id != pb->port_id)
+        return ((pa->port_id < pb->port_id) ? -1 : 1);
+
+    return ((int)pa->mstp_index - (int)pb->mstp_index);
+}
+
+static MST_INFO *stp_intf_get_mst_info(PORT_ID port_id, UINT16 mstp_index)
+{
+    MST_INFO key;
+
+    key.port_id = port_id;
+    key.mstp_index = mstp_index;
+    return (MST_INFO *)avl_find(g_stpd_mst_info_db, &key);
+}
+
+static MST_INFO *stp_intf_add_mst_info(PORT_ID port_id, UINT16 mstp_index)
+{
+    MST_INFO *info;
+
+    info = stp_intf_get_mst_info(port_id, mstp_index);
+    if (info)
+        return info;
+
+    info = mempool_zalloc(&g_stpd_mst_info_pool);
+    if (!info)
+    {
+        STP_LOG_CRITICAL("mst info alloc Failed, port %u mst index %u", port_id, mstp_index);
+        return NULL;
+    }
+
+    info->port_id = port_id;
+    info->mstp_index = mstp_index;
+    info->priority = STP_DFLT_PORT_PRIORITY >> 4;
+
+    if (avl_insert(g_stpd_mst_info_db, info) != NULL)
+    {
+        STP_LOG_CRITICAL("mst info AVL insert Failed, port %u mst index %u", port_id, mstp_index);
+        mempool_free(&g_stpd_mst_info_pool, info);
+        return NULL;
+    }
+    return info;
+}
+
+/* Drop the entry once nothing is overridden any more */
+static void stp_intf_release_mst_info(MST_INFO *info)
+{
+    if (info->flag)
+        return;
+
+    avl_delete(g_stpd_mst_info_db, info);
+    mempool_free(&g_stpd_mst_info_pool, info);
+}
+
+static void stp_intf_del_mst_info_port(PORT_ID port_id)
+{
+    MST_INFO *info;
+    UINT16 mstp_index;
+
+    if (port_id == BAD_PORT_ID || avl_count(g_stpd_mst_info_db) == 0)
+        return;
+
+    for (mstp_index = 0; mstp_index < MSTP_MAX_INSTANCES; mstp_index++)
+    {
+        info = stp_intf_get_mst_info(port_id, mstp_index);
+        if (info)
+        {
+            avl_delete(g_stpd_mst_info_db, info);
+            mempool_free(&g_stpd_mst_info_pool, info);
+        }
+    }
+}
+
 void stp_intf_del_from_intf_db(INTERFACE_NODE *node)
 {
     STP_LOG_INFO("AVL Delete :  %s  kif : %d  port_id : %u", node->ifname, node->kif_index, node->port_id);
@@ -189,8 +273,10 @@ void stp_intf_del_from_intf_db(INTERFACE_NODE *node)
     if (STP_IS_ETH_PORT(node->ifname))
         stp_pkt_sock_close(node);
 
+    stp_intf_del_mst_info_port(node->port_id);
+
     avl_delete(g_stpd_intf_db, node);
-    free(node);
+    mempool_free(&g_stpd_intf_node_pool, node);
 
     return;
 }
@@ -254,10 +340,10 @@ INTERFACE_NODE * stp_intf_create_intf_node(char * ifname, uint32_t kif_index)
 {
     INTERFACE_NODE *node = NULL;
 
-    node = calloc(1, sizeof(INTERFACE_NODE));
+    node = mempool_zalloc(&g_stpd_intf_node_pool);
     if(!node)
     {
-        STP_LOG_CRITICAL("Calloc Failed");
+        STP_LOG_CRITICAL("Intf node alloc Failed");
         return NULL;
     }
 
@@ -632,7 +718,7 @@ int stp_intf_event_mgr_init(void)
             ( stp_intf_get_evbase()
             , stp_intf_get_netlink_fd()
             , EV_READ|EV_PERSIST
-            , stp_netlink_events_cb, (char *)"NETLINK", NULL);
+            , stp_netlink_events_cb, (char *)"NETLINK", NULL, "NETLINK");
     if (!nl_event)
     {
         STP_LOG_ERR("Netlink Event create Failed");
@@ -697,6 +783,7 @@ void stp_intf_reset_port_params()
 {
     struct avl_traverser trav;
     INTERFACE_NODE *node = 0;
+    MST_INFO *info = NULL;
     avl_t_init(&trav, g_stpd_intf_db);
 
     while(NULL != (node = avl_t_next(&trav)))
@@ -706,9 +793,15 @@ void stp_intf_reset_port_params()
             node->priority = STP_DFLT_PORT_PRIORITY >> 4;
             node->path_cost = stputil_get_path_cost(node->speed, g_stpd_extend_mode);
             node->def_path_cost = true;
-            memset((char *)node->mst_info, 0, (sizeof(MST_INFO) * MSTP_MAX_INSTANCES));
         }
     }
+
+    /* Per instance overrides exist only for valid port ids, drop them all */
+    while(NULL != (info = avl_t_first(&trav, g_stpd_mst_info_db)))
+    {
+        avl_delete(g_stpd_mst_info_db, info);
+        mempool_free(&g_stpd_mst_info_pool, info);
+    }
 }
 
 BITMAP_T *static_mask_init(STATIC_BITMAP_T *bmp)
@@ -719,20 +812,28 @@ BITMAP_T *static_mask_init(STATIC_BITMAP_T *bmp)
 
 void stp_intf_set_inst_port_priority(PORT_ID port_id, UINT16 mstp_index, uint16_t priority, UINT8 add)
 {
-    INTERFACE_NODE *node = NULL;
+    MST_INFO *info = NULL;
 
-    node = stp_intf_get_node(port_id);
-    if (node)
+    if (!stp_intf_get_node(port_id))
+        return;
+
+    if(add)
     {
-        if(add)
+        info = stp_intf_add_mst_info(port_id, mstp_index);
+        if (info)
         {
-            node->mst_info[mstp_index].flag |= MSTP_PORT_PRI_FLAG;
-            node->mst_info[mstp_index].priority = priority >> 4;
+            info->flag |= MSTP_PORT_PRI_FLAG;
+            info->priority = priority >> 4;
         }
-        else
+    }
+    else
+    {
+        info = stp_intf_get_mst_info(port_id, mstp_index);
+        if (info)
         {
-            node->mst_info[mstp_index].flag &= ~MSTP_PORT_PRI_FLAG;
-            node->mst_info[mstp_index].priority = STP_DFLT_PORT_PRIORITY >> 4;
+            info->flag &= ~MSTP_PORT_PRI_FLAG;
+            info->priority = STP_DFLT_PORT_PRIORITY >> 4;
+            stp_intf_release_mst_info(info);
         }
     }
 }
@@ -740,53 +841,57 @@ void stp_intf_set_inst_port_priority(PORT_ID port_id, UINT16 mstp_index, uint16_
 uint16_t stp_intf_get_inst_port_priority(PORT_ID port_id, UINT16 mstp_index)
 {
     INTERFACE_NODE *node = NULL;
+    MST_INFO *info = NULL;
 
-    node = stp_intf_get_node(port_id);
-    if (node)
+    if (mstp_index != MSTP_INDEX_INVALID)
     {
-        if((mstp_index != MSTP_INDEX_INVALID) && (node->mst_info[mstp_index].flag & MSTP_PORT_PRI_FLAG))
-        {
-            return (node->mst_info[mstp_index].priority);
-        }
-        else
-        {
-            return(node->priority);
-        }
+        info = stp_intf_get_mst_info(port_id, mstp_index);
+        if (info && (info->flag & MSTP_PORT_PRI_FLAG))
+            return (info->priority);
     }
+
+    node = stp_intf_get_node(port_id);
+    if (node)
+        return(node->priority);
+
     return (STP_DFLT_PORT_PRIORITY >> 4);
 }
 
 bool stp_intf_is_inst_port_priority_set(PORT_ID port_id, UINT16 mstp_index)
 {
-    INTERFACE_NODE *node = NULL;
+    MST_INFO *info = NULL;
+
+    info = stp_intf_get_mst_info(port_id, mstp_index);
+    if (info && (info->flag & MSTP_PORT_PRI_FLAG))
+        return true;
 
-    node = stp_intf_get_node(port_id);
-    if (node)
-    {
-        if(node->mst_info[mstp_index].flag & MSTP_PORT_PRI_FLAG)
-            return true;
-        else
-            return false;
-    }
     return false;
 }
 
 void stp_intf_set_inst_port_pathcost(PORT_ID port_id, UINT16 mstp_index, UINT32 cost, UINT8 add)
 {
-    INTERFACE_NODE *node = NULL;
+    MST_INFO *info = NULL;
 
-    node = stp_intf_get_node(port_id);
-    if (node)
+    if (!stp_intf_get_node(port_id))
+        return;
+
+    if(add)
     {
-        if(add)
+        info = stp_intf_add_mst_info(port_id, mstp_index);
+        if (info)
         {
-            node->mst_info[mstp_index].flag |= MSTP_PORT_PATH_COST_FLAG;
-            node->mst_info[mstp_index].path_cost = cost;
+            info->flag |= MSTP_PORT_PATH_COST_FLAG;
+            info->path_cost = cost;
         }
-        else
+    }
+    else
+    {
+        info = stp_intf_get_mst_info(port_id, mstp_index);
+        if (info)
         {
-            node->mst_info[mstp_index].flag &= ~MSTP_PORT_PATH_COST_FLAG;
-            node->mst_info[mstp_index].path_cost = cost;
+            info->flag &= ~MSTP_PORT_PATH_COST_FLAG;
+            info->path_cost = cost;
+            stp_intf_release_mst_info(info);
         }
     }
 }
@@ -794,35 +899,32 @@ void stp_intf_set_inst_port_pathcost(PORT_ID port_id, UINT16 mstp_index, UINT32
 UINT32 stp_intf_get_inst_port_pathcost(PORT_ID port_id, UINT16 mstp_index)
 {
     INTERFACE_NODE *node = NULL;
+    MST_INFO *info = NULL;
+
+    if (mstp_index != MSTP_INDEX_INVALID)
+    {
+        info = stp_intf_get_mst_info(port_id, mstp_index);
+        if (info && (info->flag & MSTP_PORT_PATH_COST_FLAG))
+            return (info->path_cost);
+    }
 
     node = stp_intf_get_node(port_id);
     if (node)
     {
-        if((mstp_index != MSTP_INDEX_INVALID) &&(node->mst_info[mstp_index].flag & MSTP_PORT_PATH_COST_FLAG))
-        {
-            return (node->mst_info[mstp_index].path_cost);
-        }
-        else
-        {
-            /* Node path cost will be port level cost */
-            return(node->path_cost);
-        }
+        /* Node path cost will be port level cost */
+        return(node->path_cost);
     }
     return false;
 }
 
 bool stp_intf_is_inst_port_pathcost_set(PORT_ID port_id, UINT16 mstp_index)
 {
-    INTERFACE_NODE *node = NULL;
+    MST_INFO *info = NULL;
+
+    info = stp_intf_get_mst_info(port_id, mstp_index);
+    if (info && (info->flag & MSTP_PORT_PATH_COST_FLAG))
+        return true;
 
-    node = stp_intf_get_node(port_id);
-    if (node)
-    {
-        if(node->mst_info[mstp_index].flag & MSTP_PORT_PATH_COST_FLAG)
-            return true;
-        else
-            return false;
-    }
     return false;
 }
 
@@ -830,14 +932,12 @@ bool stp_intf_is_default_port_pathcost(PORT_ID port_id, UINT16 mstp_index)
 {
     INTERFACE_NODE *node = NULL;
 
+    if (stp_intf_is_inst_port_pathcost_set(port_id, mstp_index))
+        return false;
+
     node = stp_intf_get_node(port_id);
-    if (node)
-    {
-        if((node->mst_info[mstp_index].flag & MSTP_PORT_PATH_COST_FLAG) ||
-                !node->def_path_cost)
-            return false;
-        else
-            return true;
-    }
+    if (node && !node->def_path_cost)
+        return false;
+
     return true;
 }
@@ -47,7 +47,7 @@ int stpd_ipc_init()
     }
 
     ipc_event = stpmgr_libevent_create(g_stpd_evbase, g_stpd_ipc_handle,
-            EV_READ|EV_PERSIST, stpmgr_recv_client_msg, (char *)"IPC", NULL);
+            EV_READ|EV_PERSIST, stpmgr_recv_client_msg, (char *)"IPC", NULL, "IPC");
     if (!ipc_event)
     {
         STP_LOG_ERR("ipc_event Create failed");
@@ -59,9 +59,26 @@ int stpd_ipc_init()
     return 0;
 }
 
+/* first match wins, mstp/ must come before stp/ */
+static const APPLOG_MODULE g_stpd_log_modules[] = {
+    { "pkt",    "stp/stp_pkt",      STP_LOG_MOD_PKT },
+    { "intf",   "stp/stp_intf",     STP_LOG_MOD_INTF },
+    { "intf",   "stp/stp_netlink",  STP_LOG_MOD_INTF },
+    { "timer",  "stp/stp_timer",    STP_LOG_MOD_TIMER },
+    { "mgr",    "stp/stp_mgr",      STP_LOG_MOD_MGR },
+    { "mgr",    "stp/stp_main",     STP_LOG_MOD_MGR },
+    { "mgr",    "stp/stp_debug",    STP_LOG_MOD_MGR },
+    { "mstp",   "mstp/",            STP_LOG_MOD_MSTP },
+    { "pvst",   "stp/",             STP_LOG_MOD_PVST },
+    { "lib",    "",                 STP_LOG_MOD_LIB },
+};
+
 void stpd_log_init()
 {
     STP_LOG_INIT();
+    applog_set_modules(g_stpd_log_modules, sizeof(g_stpd_log_modules) / sizeof(g_stpd_log_modules[0]));
+    if (APP_LOG_STATUS_OK != applog_async_start())
+        STP_LOG_ERR("async logging not started, logging synchronously");
     if (fopen("/stpd_dbg_reload", "r"))
     {
         STP_LOG_SET_LEVEL(STP_LOG_LEVEL_DEBUG);
@@ -70,11 +87,28 @@ void stpd_log_init()
         STP_LOG_SET_LEVEL(STP_LOG_LEVEL_INFO);
 }
 
+/* the flag file holds the number of sharded pvst workers */
+static void stpd_shard_init()
+{
+    FILE *fp;
+    unsigned int workers = 0;
+
+    if (!(fp = fopen(STPD_SHARD_FLAG, "r")))
+        return;
+
+    if (1 != fscanf(fp, "%u", &workers))
+        workers = 0;
+    fclose(fp);
+
+    if (-1 == stp_shard_init(workers))
+        STP_LOG_ERR("sharded pvst init failed, running single threaded");
+}
+
 int stpd_main()
 {
     int rc = 0;
     struct timeval stp_100ms_tv = {0, STPD_100MS_TIMEOUT};
-    struct timeval msec_50 = { 0, 50*1000 };
+    struct timeval msec_50 = { 0, STP_LIBEV_MAX_DISPATCH_MSEC*1000 };
     struct event   *evtimer_100ms = 0;
     struct event   *evpkt = 0;
     struct event_config *cfg = 0;
@@ -86,6 +120,9 @@ int stpd_main()
     stpsync_clear_appdb_stp_tables();
 
     memset(&stpd_context, 0, sizeof(STPD_CONTEXT));
+    g_stpd_tx_rate = STPD_TX_DFLT_RATE;
+    g_stpd_tx_burst = STPD_TX_DFLT_BURST;
+    g_stpd_tick_stats.overrun_msec = STPD_TICK_DFLT_OVERRUN_MSEC;
 
     stpmgr_set_extend_mode(true);
 
@@ -97,7 +134,7 @@ int stpd_main()
     }
 
     STP_LOG_INFO("LIBEVENT VER : 0x%x", event_get_version_number());
-    event_config_set_max_dispatch_interval(cfg, &msec_50/*max_interval*/, 5/*max_callbacks*/, 1/*min-prio*/);
+    event_config_set_max_dispatch_interval(cfg, &msec_50/*max_interval*/, STP_LIBEV_MAX_DISPATCH_CBS/*max_callbacks*/, STP_LIBEV_LOW_PRI_Q/*min-prio*/);
     g_stpd_evbase = event_base_new_with_config(cfg);
     if (g_stpd_evbase == NULL)
     {
@@ -107,9 +144,15 @@ int stpd_main()
 
     event_base_priority_init(g_stpd_evbase, STP_LIBEV_PRIO_QUEUES);
 
+    //Before netlink init, which creates the packet sockets
+    if (0 == access(STPD_PKT_IO_FLAG, F_OK) && -1 == stp_pkt_io_init())
+        STP_LOG_ERR("packet i/o thread init failed, packets are handled inline");
+
+    stpd_shard_init();
+
     //Create the high priority Timer libevent
     evtimer_100ms = stpmgr_libevent_create(g_stpd_evbase, -1, EV_PERSIST, 
-            stptimer_100ms_tick, (char *)"100MS_TIMER", &stp_100ms_tv);
+            stptimer_100ms_tick, (char *)"100MS_TIMER", &stp_100ms_tv, "100MS_TIMER");
     if (!evtimer_100ms)
     {
         STP_LOG_ERR("evtimer_100ms Create failed");
@@ -125,13 +168,23 @@ int stpd_main()
     }
 
     /* Create STP interface DB */
-    g_stpd_intf_db = avl_create(&stp_intf_avl_compare, NULL, NULL);
+    g_stpd_intf_db = avl_create(&stp_intf_avl_compare, NULL,
+            &g_stpd_intf_avl_allocator.avl_alloc);
     if(!g_stpd_intf_db)
     {
         STP_LOG_ERR("intf db create failed");
         return -1;
     }
 
+    /* Create per instance port override DB */
+    g_stpd_mst_info_db = avl_create(&stp_intf_mst_info_avl_compare, NULL,
+            &g_stpd_intf_avl_allocator.avl_alloc);
+    if(!g_stpd_mst_info_db)
+    {
+        STP_LOG_ERR("mst info db create failed");
+        return -1;
+    }
+
     /* Open Netlink comminucation to populate Interface DB */
     g_stpd_netlink_handle = stp_netlink_init(&stp_intf_netlink_cb);
     if(-1 == g_stpd_netlink_handle)
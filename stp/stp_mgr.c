@@ -15,6 +15,7 @@
  * limitations under the License.
  */
 
+#include <sys/mman.h>
 #include "stp_inc.h"
 #include "stp_main.h"
 
@@ -33,23 +34,137 @@ char msgtype_str[][64] = {
     "STP_MST_INST_CONFIG",
     "STP_MST_VLAN_PORT_LIST_CONFIG",
     "STP_MST_INST_PORT_CONFIG",
+    "STP_CONFIG_TXN_BEGIN",
+    "STP_CONFIG_TXN_COMMIT",
     "STP_MAX_MSG"
 };
 
+static uint64_t stpmgr_libevent_usec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static STPD_LIBEV_PROF *stpmgr_libevent_prof_get(const char *name)
+{
+    STPD_LIBEV_STATS *libev = &stpd_context.dbg_stats.libev;
+    uint8_t i;
+
+    for (i = 0; i < libev->prof_count; i++)
+    {
+        if (0 == strcmp(libev->prof[i].name, name))
+            return &libev->prof[i];
+    }
+
+    if (libev->prof_count == STPD_LIBEV_PROF_MAX)
+        return NULL;
+
+    libev->prof[libev->prof_count].name = name;
+    return &libev->prof[libev->prof_count++];
+}
+
+/* Low priority callbacks run in batches, libevent ends a batch after
+ * STP_LIBEV_MAX_DISPATCH_CBS callbacks or STP_LIBEV_MAX_DISPATCH_MSEC and
+ * polls again before running the events still active. The same rule is
+ * applied here to count the events deferred that way. */
+static void stpmgr_libevent_prof_dispatch(struct event_base *base, uint64_t end_usec)
+{
+    STPD_LIBEV_STATS *libev = &stpd_context.dbg_stats.libev;
+    int active;
+
+    libev->run_cbs++;
+
+    active = event_base_get_num_events(base, EVENT_BASE_COUNT_ACTIVE);
+    if (active <= 0)
+    {
+        libev->run_cbs = 0;
+        return;
+    }
+
+    if (libev->run_cbs >= STP_LIBEV_MAX_DISPATCH_CBS ||
+            (end_usec - libev->run_start_usec) >= (STP_LIBEV_MAX_DISPATCH_MSEC * 1000))
+    {
+        libev->dispatch_limited++;
+        libev->dispatch_deferred += active;
+        if ((uint32_t)active > libev->dispatch_deferred_max)
+            libev->dispatch_deferred_max = active;
+        libev->run_cbs = 0;
+    }
+}
+
+static void stpmgr_libevent_prof_cb(evutil_socket_t fd, short what, void *arg)
+{
+    STPD_LIBEV_STATS *libev = &stpd_context.dbg_stats.libev;
+    STPD_LIBEV_PROF_EVENT *pev = (STPD_LIBEV_PROF_EVENT *)arg;
+    //the callback may destroy its own event, pev is not used after it
+    STPD_LIBEV_PROF *prof = pev->prof;
+    struct event_base *base = pev->base;
+    int prio = pev->prio;
+    uint64_t start, end;
+    bool wait_valid = false;
+    uint64_t wait = 0;
+
+    start = stpmgr_libevent_usec();
+
+    if (prio >= STP_LIBEV_LOW_PRI_Q)
+    {
+        if (!libev->run_cbs)
+            libev->run_start_usec = start;
+        wait = start - libev->run_start_usec;
+        wait_valid = true;
+    }
+    else
+    {
+        //low priority events are not run in a loop iteration that ran high priority ones
+        libev->run_cbs = 0;
+    }
+
+    if (pev->interval_usec && (what & EV_TIMEOUT))
+    {
+        //libevent reschedules persistent timers from the scheduled time, or from now once behind
+        wait = (start > pev->next_usec) ? (start - pev->next_usec) : 0;
+        wait_valid = true;
+        pev->next_usec += pev->interval_usec;
+        if (pev->next_usec < start)
+            pev->next_usec = start + pev->interval_usec;
+    }
+
+    pev->cb_fn(fd, what, pev->arg);
+
+    end = stpmgr_libevent_usec();
+
+    prof->calls++;
+    stpd_hist_add(&prof->run, end - start);
+    if (wait_valid)
+        stpd_hist_add(&prof->wait, wait);
+
+    if (prio >= STP_LIBEV_LOW_PRI_Q)
+        stpmgr_libevent_prof_dispatch(base, end);
+}
+
 void stpmgr_libevent_destroy(struct event *ev)
 {
     g_stpd_stats_libev_no_of_sockets--;
     event_del(ev);
+
+    if (event_get_callback(ev) == stpmgr_libevent_prof_cb)
+        free(event_get_callback_arg(ev));
 }
 
+/* name : callbacks registered with the same name share profiling stats */
 struct event *stpmgr_libevent_create(struct event_base *base, 
         evutil_socket_t sock,
         short flags,
         void *cb_fn,
         void *arg, 
-        const struct timeval *tv)
+        const struct timeval *tv,
+        const char *name)
 {
     struct event *ev = 0;
+    STPD_LIBEV_PROF_EVENT *pev = 0;
+    STPD_LIBEV_PROF *prof;
     int prio;
 
     g_stpd_stats_libev_no_of_sockets++;
@@ -62,7 +177,27 @@ struct event *stpmgr_libevent_create(struct event_base *base,
         evutil_make_socket_nonblocking(sock);
     }
 
-    ev = event_new(base, sock, flags, cb_fn, arg);
+    prof = stpmgr_libevent_prof_get(name);
+    if (prof)
+        pev = (STPD_LIBEV_PROF_EVENT *)calloc(1, sizeof(STPD_LIBEV_PROF_EVENT));
+
+    if (pev)
+    {
+        pev->prof = prof;
+        pev->cb_fn = cb_fn;
+        pev->arg = arg;
+        pev->base = base;
+        pev->prio = prio;
+        if (tv && (flags & EV_PERSIST))
+        {
+            pev->interval_usec = ((uint64_t)tv->tv_sec * 1000000) + tv->tv_usec;
+            pev->next_usec = stpmgr_libevent_usec() + pev->interval_usec;
+        }
+        ev = event_new(base, sock, flags, stpmgr_libevent_prof_cb, pev);
+    }
+    else
+        ev = event_new(base, sock, flags, cb_fn, arg);
+
     if (ev)
     {
         if(-1 == event_priority_set(ev, prio))
@@ -73,7 +208,7 @@ struct event *stpmgr_libevent_create(struct event_base *base,
 
         if (-1 != event_add(ev, tv))
         {
-            STP_LOG_DEBUG("Event Added : ev-%p, arg : %s", ev, (char *)arg);
+            STP_LOG_DEBUG("Event Added : ev-%p, name : %s", ev, name);
             STP_LOG_DEBUG("base : %p, sock : %d, flags : %x, cb_fn : %p", base, sock, flags, cb_fn);
             if (tv)
                 STP_LOG_DEBUG("tv.sec : %u, tv.usec : %u", tv->tv_sec, tv->tv_usec);
@@ -81,6 +216,7 @@ struct event *stpmgr_libevent_create(struct event_base *base,
             return ev;
         }
     }
+    free(pev);
     return NULL;
 }
 
@@ -122,6 +258,7 @@ void stpmgr_initialize_stp_class(STP_CLASS *stp_class, VLAN_ID vlan_id)
 	
 	stputil_set_bridge_priority(&stp_class->bridge_info.bridge_id, STP_DFLT_PRIORITY, vlan_id);
 	NET_TO_HOST_MAC(&stp_class->bridge_info.bridge_id.address, &g_stp_base_mac_addr);
+	stputil_root_tree_invalidate(stp_class);
 
 	stp_class->bridge_info.bridge_max_age = STP_DFLT_MAX_AGE;
 	stp_class->bridge_info.bridge_hello_time = STP_DFLT_HELLO_TIME;
@@ -159,6 +296,8 @@ void stpmgr_initialize_control_port(STP_CLASS *stp_class, PORT_ID port_number)
 	stp_port_class->path_cost = stp_intf_get_path_cost(port_number);
 	stp_port_class->change_detection_enabled = true;
 	stp_port_class->auto_config = true;
+
+	stputil_root_tree_update(stp_class, port_number);
 }
 
 /* FUNCTION
@@ -180,7 +319,7 @@ void stpmgr_activate_stp_class(STP_CLASS *stp_class)
 
 	port_state_selection(stp_class);
 	config_bpdu_generation(stp_class);
-	stptimer_start(&stp_class->hello_timer, 0);
+	stptimer_start_hello(stp_class);
 }
 
 /* FUNCTION
@@ -198,7 +337,7 @@ void stpmgr_deactivate_stp_class(STP_CLASS *stp_class)
 
 	stptimer_stop(&stp_class->tcn_timer);
 	stptimer_stop(&stp_class->topology_change_timer);
-	stptimer_stop(&stp_class->hello_timer);
+	stptimer_stop_hello(stp_class);
 
 	if (stp_class->bridge_info.topology_change)
 	{
@@ -231,6 +370,7 @@ void stpmgr_initialize_port(STP_CLASS *stp_class, PORT_ID port_number)
 	stp_port_class->config_pending = false;
 	stp_port_class->change_detection_enabled = true;
 	stp_port_class->self_loop = false;
+	stputil_root_tree_update(stp_class, port_number);
 
 	stptimer_stop(&stp_port_class->message_age_timer);
 	stptimer_stop(&stp_port_class->forward_delay_timer);
@@ -247,9 +387,16 @@ void stpmgr_enable_port(STP_CLASS *stp_class, PORT_ID port_number)
 		return;
 
 	set_mask_bit(stp_class->enable_mask, port_number);
+	stptimer_hello_port_update(stp_class, true);
 
 	stpmgr_initialize_port(stp_class, port_number);
 
+	if (STPD_CONFIG_TXN_ACTIVE())
+	{
+		bmp_set(g_stp_txn_class_mask, GET_STP_INDEX(stp_class));
+		return;
+	}
+
 	port_state_selection(stp_class);
 }
 
@@ -296,6 +443,8 @@ void stpmgr_disable_port(STP_CLASS *stp_class, PORT_ID port_number)
 	}
 
 	clear_mask_bit(stp_class->enable_mask, port_number);
+	stptimer_hello_port_update(stp_class, false);
+	stputil_root_tree_update(stp_class, port_number);
 	configuration_update(stp_class);
 	port_state_selection(stp_class);
 
@@ -308,7 +457,7 @@ void stpmgr_disable_port(STP_CLASS *stp_class, PORT_ID port_number)
 		topology_change_detection(stp_class);
 		stptimer_stop(&stp_class->tcn_timer);
 		config_bpdu_generation(stp_class);
-		stptimer_start(&stp_class->hello_timer, 0);
+		stptimer_start_hello(stp_class);
 	}
 }
 
@@ -335,6 +484,7 @@ void stpmgr_set_bridge_priority(STP_CLASS *stp_class, BRIDGE_IDENTIFIER *bridge_
 	}
 
 	stp_class->bridge_info.bridge_id = *bridge_id;
+	stputil_root_tree_invalidate(stp_class);
 	
 	configuration_update(stp_class);	
 	port_state_selection(stp_class);
@@ -350,7 +500,7 @@ void stpmgr_set_bridge_priority(STP_CLASS *stp_class, BRIDGE_IDENTIFIER *bridge_
 			topology_change_detection(stp_class);
 			stptimer_stop(&stp_class->tcn_timer);
 			config_bpdu_generation(stp_class);
-			stptimer_start(&stp_class->hello_timer, 0);
+			stptimer_start_hello(stp_class);
 		}
 	}
 }
@@ -367,6 +517,7 @@ void stpmgr_set_port_priority(STP_CLASS *stp_class, PORT_ID port_number, UINT16
 
 	stp_port_class->port_id.priority = priority >> 4;
     SET_BIT(stp_port_class->modified_fields, STP_PORT_CLASS_MEMBER_PORT_PRIORITY_BIT);
+	stputil_root_tree_update(stp_class, port_number);
 
 	if (stputil_compare_bridge_id(&stp_class->bridge_info.bridge_id, &stp_port_class->designated_bridge) == EQUAL_TO &&
 		stputil_compare_port_id(&stp_port_class->port_id, &stp_port_class->designated_port) == LESS_THAN)
@@ -385,6 +536,13 @@ void stpmgr_set_path_cost(STP_CLASS *stp_class, PORT_ID port_number, bool auto_c
 
 	stp_port_class->path_cost = path_cost;
 	stp_port_class->auto_config = auto_config;
+	stputil_root_tree_update(stp_class, port_number);
+
+	if (STPD_CONFIG_TXN_ACTIVE())
+	{
+		bmp_set(g_stp_txn_class_mask, GET_STP_INDEX(stp_class));
+		return;
+	}
 
 	configuration_update(stp_class);
 	port_state_selection(stp_class);
@@ -460,6 +618,7 @@ bool stpmgr_config_bridge_priority(STP_INDEX stp_index, UINT16 priority)
 	    {
 		    stp_class->bridge_info.bridge_id = bridge_id;
 		    stp_class->bridge_info.root_id = bridge_id;
+		    stputil_root_tree_invalidate(stp_class);
             SET_BIT(stp_class->bridge_info.modified_fields, STP_BRIDGE_DATA_MEMBER_BRIDGE_ID_BIT);
             SET_BIT(stp_class->bridge_info.modified_fields, STP_BRIDGE_DATA_MEMBER_ROOT_ID_BIT);
 	    }
@@ -593,6 +752,7 @@ bool stpmgr_config_port_priority(STP_INDEX stp_index, PORT_ID port_number, UINT1
 	else
 	{
 		stp_port->port_id.priority = priority >> 4;
+		stputil_root_tree_update(stp_class, port_number);
 	}
     SET_BIT(stp_port->modified_fields, STP_PORT_CLASS_MEMBER_PORT_PRIORITY_BIT);
 	return true;
@@ -651,6 +811,7 @@ bool stpmgr_config_port_path_cost(STP_INDEX stp_index, PORT_ID port_number, bool
 	{
 		stp_port->path_cost = path_cost;
 		stp_port->auto_config = auto_config;
+		stputil_root_tree_update(stp_class, port_number);
 	}
     SET_BIT(stp_port->modified_fields, STP_PORT_CLASS_MEMBER_PATH_COST_BIT);
 
@@ -748,6 +909,7 @@ bool stpmgr_release_index(STP_INDEX stp_index)
 		return true; // already released
 
 	clear_mask(stp_class->enable_mask);
+	stputil_root_tree_invalidate(stp_class);
 	stpmgr_deactivate_stp_class(stp_class);
 
 	port_number = port_mask_get_first_port(stp_class->control_mask);
@@ -1339,6 +1501,7 @@ void stpmgr_port_event(PORT_ID port_number, bool up)
 		if (stp_port->auto_config)
 		{
 			stp_port->path_cost = path_cost;
+			stputil_root_tree_update(stp_class, port_number);
 		}
 		(*func) (index, port_number);
         SET_ALL_BITS(stp_port->modified_fields);
@@ -1368,7 +1531,7 @@ void stpmgr_rx_stp_bpdu(uint16_t vlan_id, uint32_t port_id, char *pkt)
             STP_PKTLOG("Invalid STP BPDU received on Vlan:%d Port:%d - dropping",
                     vlan_id, port_id);
         }
-        stp_global.stp_drop_count++;
+        STP_DROP_COUNT_INC(stp_drop_count);
         return;
     }
 
@@ -1396,9 +1559,9 @@ void stpmgr_rx_stp_bpdu(uint16_t vlan_id, uint32_t port_id, char *pkt)
         if (bpdu->protocol_version_id == STP_VERSION_ID) 
         {
             if (bpdu->type == TCN_BPDU_TYPE)
-                stp_global.tcn_drop_count++;
+                STP_DROP_COUNT_INC(tcn_drop_count);
             else if (bpdu->type == CONFIG_BPDU_TYPE)
-                stp_global.stp_drop_count++;
+                STP_DROP_COUNT_INC(stp_drop_count);
         }
 
         if (STP_DEBUG_BPDU_RX(vlan_id, port_id))
@@ -1426,9 +1589,9 @@ void stpmgr_rx_stp_bpdu(uint16_t vlan_id, uint32_t port_id, char *pkt)
         if (bpdu->protocol_version_id == STP_VERSION_ID) 
         {
             if (bpdu->type == TCN_BPDU_TYPE)
-                stp_global.tcn_drop_count++;
+                STP_DROP_COUNT_INC(tcn_drop_count);
             else if (bpdu->type == CONFIG_BPDU_TYPE)
-                stp_global.stp_drop_count++;
+                STP_DROP_COUNT_INC(stp_drop_count);
         }
 
         if (STP_DEBUG_BPDU_RX(vlan_id, port_id))
@@ -1450,7 +1613,7 @@ void stpmgr_rx_pvst_bpdu(uint16_t vlan_id, uint32_t port_id, void *pkt)
             STP_PKTLOG("Dropping pvst bpdu on port:%d with stp protect enabled for Vlan:%d",
                     port_id, vlan_id);
         }
-        stp_global.pvst_drop_count++;
+        STP_DROP_COUNT_INC(pvst_drop_count);
         return;
     }
 
@@ -1463,7 +1626,7 @@ void stpmgr_rx_pvst_bpdu(uint16_t vlan_id, uint32_t port_id, void *pkt)
             STP_PKTLOG("Invalid PVST BPDU received Vlan:%d Port:%d - dropping",
                     vlan_id, port_id);
         }
-        stp_global.pvst_drop_count++;
+        STP_DROP_COUNT_INC(pvst_drop_count);
         return;
     }
 
@@ -1474,7 +1637,7 @@ void stpmgr_rx_pvst_bpdu(uint16_t vlan_id, uint32_t port_id, void *pkt)
         {
             STP_PKTLOG("Dropping PVST BPDU for VLAN:%d Port:%d",vlan_id, port_id);
         }
-        stp_global.pvst_drop_count++;
+        STP_DROP_COUNT_INC(pvst_drop_count);
         return;
     }
 
@@ -1488,7 +1651,7 @@ void stpmgr_rx_pvst_bpdu(uint16_t vlan_id, uint32_t port_id, void *pkt)
         {
             STP_LOG_INFO("Invalid BPDU (message age %u exceeds max age %u) vlan %u port %u",
                     ntohs(bpdu->message_age), ntohs(bpdu->max_age), vlan_id, port_id);
-            stp_global.pvst_drop_count++;
+            STP_DROP_COUNT_INC(pvst_drop_count);
         }
         else
         {
@@ -1497,7 +1660,7 @@ void stpmgr_rx_pvst_bpdu(uint16_t vlan_id, uint32_t port_id, void *pkt)
     }
     else
     {
-        stp_global.pvst_drop_count++;
+        STP_DROP_COUNT_INC(pvst_drop_count);
         if (STP_DEBUG_BPDU_RX(vlan_id, port_id))
             STP_PKTLOG("dropping bpdu - stp/rstp not configured vlan %u port %u", vlan_id, port_id);
     }
@@ -1863,11 +2026,105 @@ static void stpmgr_process_vlan_mem_config_msg(void *msg)
     }
 }
 
+/* FUNCTION
+ *		stpmgr_config_txn_begin()
+ *
+ * SYNOPSIS
+ *		opens a config transaction. Until it is committed, config messages
+ *		only update data structures and db sync writes are buffered.
+ */
+static void stpmgr_config_txn_begin()
+{
+    if (stpd_context.config_txn_depth == 0)
+    {
+        stpd_context.config_txn_ticks = 0;
+        stpsync_set_buffered(true);
+    }
+    stpd_context.config_txn_depth++;
+    STP_LOG_DEBUG("config txn begin, depth %u", stpd_context.config_txn_depth);
+}
+
+/* FUNCTION
+ *		stpmgr_config_txn_commit()
+ *
+ * SYNOPSIS
+ *		closes the config transaction and recomputes every instance touched
+ *		while it was open, once.
+ */
+void stpmgr_config_txn_commit()
+{
+    BMP_ID stp_index;
+    STP_CLASS *stp_class;
+
+    if (stpd_context.config_txn_depth == 0)
+    {
+        STP_LOG_ERR("config txn commit without begin");
+        return;
+    }
+
+    if (--stpd_context.config_txn_depth != 0)
+        return;
+
+    /* restart while still deferring, so its per port refreshes coalesce */
+    stpd_context.config_txn_depth = 1;
+    if (STP_IS_PROTOCOL_ENABLED(L2_MSTP))
+        mstpmgr_config_txn_apply();
+    stpd_context.config_txn_depth = 0;
+
+    if (g_stp_txn_class_mask)
+    {
+        for (stp_index = bmp_get_first_set_bit(g_stp_txn_class_mask);
+                stp_index != BMP_INVALID_ID && stp_index < g_stp_instances;
+                stp_index = bmp_get_next_set_bit(g_stp_txn_class_mask, stp_index))
+        {
+            stp_class = GET_STP_CLASS(stp_index);
+            if (stp_class->state != STP_CLASS_FREE)
+            {
+                configuration_update(stp_class);
+                port_state_selection(stp_class);
+            }
+        }
+        bmp_reset_all(g_stp_txn_class_mask);
+    }
+
+    if (STP_IS_PROTOCOL_ENABLED(L2_MSTP))
+        mstpmgr_config_txn_refresh();
+
+    stpsync_flush();
+    stpsync_set_buffered(false);
+
+    g_stpd_stats_ipc.txn_commits++;
+    STP_LOG_DEBUG("config txn commit");
+}
+
+/* FUNCTION
+ *		stpmgr_config_txn_tick()
+ *
+ * SYNOPSIS
+ *		called every 100ms, commits a transaction that stpmgrd never closed.
+ */
+void stpmgr_config_txn_tick()
+{
+    if (!STPD_CONFIG_TXN_ACTIVE())
+        return;
+
+    if (++stpd_context.config_txn_ticks < STPD_CONFIG_TXN_TIMEOUT_TICKS)
+        return;
+
+    STP_LOG_ERR("config txn open for %u ticks, committing", stpd_context.config_txn_ticks);
+    g_stpd_stats_ipc.txn_timeouts++;
+    stpd_context.config_txn_depth = 1;
+    stpmgr_config_txn_commit();
+}
+
 static void stpmgr_process_ipc_msg(STP_IPC_MSG *msg, int len, struct sockaddr_un client_addr)
 {
     int ret;
     STP_LOG_INFO("rcvd %s msg type", msgtype_str[msg->msg_type]);
 
+    //bpdus queued to sharded workers were received before this message
+    stp_shard_rx_flush();
+
     /* Temp code until warm boot is handled */
     if(msg->msg_type != STP_INIT_READY && msg->msg_type != STP_STPCTL_MSG)
     {
@@ -1980,29 +2237,206 @@ static void stpmgr_process_ipc_msg(STP_IPC_MSG *msg, int len, struct sockaddr_un
             mstpmgr_process_inst_port_config_msg(msg->data);
             break;
         }
+        case STP_CONFIG_TXN_BEGIN:
+        {
+            stpmgr_config_txn_begin();
+            break;
+        }
+        case STP_CONFIG_TXN_COMMIT:
+        {
+            stpmgr_config_txn_commit();
+            break;
+        }
 
         default:
             break;
     }
 }
 
+static bool stpmgr_ipc_msg_valid(STP_IPC_MSG *msg, int len)
+{
+    if (len < (int)offsetof(STP_IPC_MSG, data) ||
+            msg->msg_type <= STP_INVALID_MSG || msg->msg_type >= STP_MAX_MSG)
+    {
+        g_stpd_stats_ipc.rx_err++;
+        STP_LOG_ERR("invalid ipc msg len %d type %d", len, (len >= (int)sizeof(int)) ? msg->msg_type : -1);
+        return false;
+    }
+    return true;
+}
+
+/* Receive a single message that does not fit a batch slot */
+static bool stpmgr_recv_large_client_msg(evutil_socket_t fd, int size)
+{
+    static char *large_buf = NULL;
+    static int large_buf_sz = 0;
+    struct sockaddr_un client_sock;
+    socklen_t addr_len = sizeof(struct sockaddr_un);
+    char *buf;
+    int len;
+
+    if (size > large_buf_sz)
+    {
+        buf = realloc(large_buf, size);
+        if (!buf)
+        {
+            STP_LOG_ERR("ipc large buffer alloc failed, size %d", size);
+            /* consume the message so the queue does not stall */
+            recv(fd, NULL, 0, MSG_DONTWAIT);
+            g_stpd_stats_ipc.rx_trunc++;
+            return false;
+        }
+        large_buf = buf;
+        large_buf_sz = size;
+    }
+
+    len = recvfrom(fd, large_buf, large_buf_sz, MSG_DONTWAIT, (struct sockaddr *) &client_sock, &addr_len);
+    if (len == -1)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            g_stpd_stats_ipc.rx_err++;
+            STP_LOG_ERR("recv  message error %s", strerror(errno));
+        }
+        return false;
+    }
+
+    g_stpd_stats_ipc.rx_large++;
+    g_stpd_stats_ipc.rx_msgs++;
+    if (stpmgr_ipc_msg_valid((STP_IPC_MSG *)large_buf, len))
+        stpmgr_process_ipc_msg((STP_IPC_MSG *)large_buf, len, client_sock);
+    return true;
+}
+
+/* Size of a batch slot: the largest datagram a client can send */
+static int stpmgr_ipc_rx_slot_size()
+{
+    FILE *fp;
+    int wmem_max = 0;
+    int size;
+
+    fp = fopen(STPD_IPC_WMEM_MAX_FILE, "r");
+    if (fp)
+    {
+        if (fscanf(fp, "%d", &wmem_max) != 1)
+            wmem_max = 0;
+        fclose(fp);
+    }
+
+    /* SO_SNDBUF doubles the value it is given, up to wmem_max */
+    if (wmem_max <= 0 || wmem_max > (INT_MAX / 2))
+        return STPD_IPC_RX_SLOT_MIN;
+
+    size = (2 * wmem_max + 4095) & ~4095;
+    return (size > STPD_IPC_RX_SLOT_MIN) ? size : STPD_IPC_RX_SLOT_MIN;
+}
+
 /* Process all messages from clients (STPMGRd) */
 void stpmgr_recv_client_msg(evutil_socket_t fd, short what, void *arg)
 {
-    char buffer[4096];
-    int len;
-    struct sockaddr_un client_sock;
+    static char *buffer = NULL;
+    static int slot_size = 0;
+    static struct sockaddr_un client_sock[STPD_IPC_RX_BATCH];
+    struct mmsghdr hdrs[STPD_IPC_RX_BATCH];
+    struct iovec iov[STPD_IPC_RX_BATCH];
+    int total = 0;
+    int size;
+    int n, i;
 
     g_stpd_stats_libev_ipc++;
 
-    len = sizeof(struct sockaddr_un);
-    len = recvfrom(fd, buffer, 4096, 0, (struct sockaddr *) &client_sock, &len);
-    if (len == -1)
+    if (!buffer)
     {
-        STP_LOG_ERR("recv  message error %s", strerror(errno));
+        /* reserved only, pages are committed as messages are read into them */
+        slot_size = stpmgr_ipc_rx_slot_size();
+        buffer = mmap(NULL, (size_t)slot_size * STPD_IPC_RX_BATCH, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (buffer == MAP_FAILED)
+        {
+            STP_LOG_ERR("ipc rx buffer map failed: %s", strerror(errno));
+            slot_size = STPD_IPC_RX_SLOT_MIN;
+            buffer = calloc(STPD_IPC_RX_BATCH, slot_size);
+            if (!buffer)
+            {
+                /* read one message at a time through the large message path */
+                slot_size = 0;
+            }
+        }
+        STP_LOG_INFO("ipc rx batch slot size %d", slot_size);
     }
-    else
+
+    for (i = 0; i < STPD_IPC_RX_BATCH; i++)
     {
-        stpmgr_process_ipc_msg((STP_IPC_MSG *)buffer, len, client_sock);
+        iov[i].iov_base = buffer ? (buffer + ((size_t)i * slot_size)) : NULL;
+        iov[i].iov_len = slot_size;
     }
+
+    while (total < STPD_IPC_RX_BUDGET)
+    {
+        /* Size of the message at the head of the queue, without consuming it */
+        size = recv(fd, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+        if (size == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                g_stpd_stats_ipc.rx_err++;
+                STP_LOG_ERR("recv  message error %s", strerror(errno));
+            }
+            break;
+        }
+
+        if (size > slot_size)
+        {
+            if (!stpmgr_recv_large_client_msg(fd, size))
+                break;
+            total++;
+            continue;
+        }
+
+        for (i = 0; i < STPD_IPC_RX_BATCH; i++)
+        {
+            memset(&hdrs[i], 0, sizeof(hdrs[i]));
+            hdrs[i].msg_hdr.msg_name = &client_sock[i];
+            hdrs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_un);
+            hdrs[i].msg_hdr.msg_iov = &iov[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        n = recvmmsg(fd, hdrs, STPD_IPC_RX_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0)
+        {
+            if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                g_stpd_stats_ipc.rx_err++;
+                STP_LOG_ERR("recv  message error %s", strerror(errno));
+            }
+            break;
+        }
+
+        g_stpd_stats_ipc.rx_batches++;
+        for (i = 0; i < n; i++)
+        {
+            g_stpd_stats_ipc.rx_msgs++;
+
+            /* Only a client past wmem_max sends more than a slot, and only
+             * the head of the batch is sized */
+            if (hdrs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                g_stpd_stats_ipc.rx_trunc++;
+                STP_LOG_ERR("ipc msg truncated to %u bytes, dropped", hdrs[i].msg_len);
+                continue;
+            }
+
+            if (stpmgr_ipc_msg_valid((STP_IPC_MSG *)iov[i].iov_base, hdrs[i].msg_len))
+                stpmgr_process_ipc_msg((STP_IPC_MSG *)iov[i].iov_base, hdrs[i].msg_len, client_sock[i]);
+        }
+
+        total += n;
+        if (n < STPD_IPC_RX_BATCH)
+            break;
+    }
+
+    /* config digest is computed once per wakeup; an open txn defers to commit */
+    if (STP_IS_PROTOCOL_ENABLED(L2_MSTP) && !STPD_CONFIG_TXN_ACTIVE())
+        mstputil_update_message_digest();
 }
@@ -84,8 +84,13 @@ struct sock_filter g_stp_filter[] = {
     
 void stp_pkt_sock_close(INTERFACE_NODE *intf_node)
 {
-    stpmgr_libevent_destroy(intf_node->ev);
-    close(intf_node->sock);
+    if (stp_pkt_io_enabled())
+        stp_pkt_io_del_sock(intf_node->sock);
+    else
+    {
+        stpmgr_libevent_destroy(intf_node->ev);
+        close(intf_node->sock);
+    }
     intf_node->sock = 0;
     STP_LOG_INFO("SOCKET closed for port : %u kif : %u", intf_node->port_id, intf_node->kif_index);
 }
@@ -113,6 +118,14 @@ int stp_pkt_sock_create(INTERFACE_NODE *intf_node)
         sys_assert(0);
     }
 
+    //kernel arrival time for the rx latency stats
+    val = 1;
+    if (-1 == setsockopt(intf_node->sock, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(val)))
+    {
+        STP_LOG_ERR("setsock SO_TIMESTAMPNS for (%u) Failed, errno : %s"
+                , intf_node->kif_index, strerror(errno));
+    }
+
     //filter STP/PVST packets only
     prog.filter = g_stp_filter;
     prog.len = (sizeof(g_stp_filter) / sizeof(struct sock_filter));
@@ -140,9 +153,18 @@ int stp_pkt_sock_create(INTERFACE_NODE *intf_node)
         sys_assert(0);
     }
 
+    /*Read by the packet i/o thread when it runs*/
+    if (stp_pkt_io_enabled())
+    {
+        intf_node->ev = NULL;
+        stp_pkt_io_add_sock(intf_node->sock, intf_node->kif_index);
+        STP_LOG_INFO("port-%u, kif-%u, sock-%d, pkt-io", intf_node->port_id, intf_node->kif_index, intf_node->sock);
+        return intf_node->sock;
+    }
+
     /*Add to libevent list */
     intf_node->ev = stpmgr_libevent_create(g_stpd_evbase, intf_node->sock, EV_PERSIST|EV_READ, 
-            stp_pkt_rx_handler, intf_node, NULL);
+            stp_pkt_rx_handler, intf_node, NULL, "PKT_RX");
 
     if (!intf_node->ev)
     {
@@ -207,7 +229,7 @@ static void stp_pkt_fill_tx_buf(uint16_t size, VLAN_ID vlan_id, char *buffer, ch
 }
 
 /* buffer : contains the entire packet including mac */
-int stp_pkt_tx_handler(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
+static int stp_pkt_tx_send(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
 {
     int                     i = 0;
     int                   ret = 0;
@@ -232,6 +254,16 @@ int stp_pkt_tx_handler(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t
     if (STP_DEBUG_BPDU_TX(vlan_id, intf_node->port_id))
         stp_pkt_dump(intf_node, vlan_id, send_buf, size, false);
 
+    if (stp_pkt_io_enabled())
+    {
+        ret = stp_pkt_io_tx(intf_node->kif_index, send_buf, size);
+        if (-1 == ret)
+            STPD_INCR_PKT_COUNT(port_id, pkt_tx_err);
+        else
+            STPD_INCR_PKT_COUNT(port_id, pkt_tx);
+        return ret;
+    }
+
     memset(&sa, 0, sizeof(struct sockaddr_ll));
     sa.sll_family = AF_PACKET;
     sa.sll_ifindex = intf_node->kif_index;
@@ -249,16 +281,359 @@ int stp_pkt_tx_handler(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t
     return ret;
 }
 
+static MEMPOOL g_stpd_tx_frame_pool = MEMPOOL_INITIALIZER("tx_frame", sizeof(STPD_TX_FRAME), 256);
+
+static uint64_t stp_pkt_tx_usec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+// tc and tc-ack flags of a config bpdu, tc-ack is only sent once
+#define STPD_TX_ONE_SHOT_FLAGS  0x81
+
+// pvst bpdus are snap encapsulated, ieee ones use the stp sap
+static bool stp_pkt_tx_is_ieee(char *buffer)
+{
+    return (uint8_t)buffer[sizeof(MAC_HEADER)] != LSAP_SNAP_LLC;
+}
+
+static uint8_t *stp_pkt_tx_bpdu(char *buffer)
+{
+    return (uint8_t *)buffer + (stp_pkt_tx_is_ieee(buffer) ? STP_BPDU_OFFSET : PVST_BPDU_OFFSET);
+}
+
+/*
+ * TCN and config bpdus carrying TC, TC-ack, proposal or agreement flags
+ * drive convergence and go ahead of periodic hellos. Config bpdus are
+ * coalesced per vlan and encapsulation, a newer one carries the information
+ * of the one it replaces except for the tc and tc-ack flags, which are
+ * carried over. The ieee bpdu pvst sends on the untagged vlan next to the
+ * snap one of that vlan is a frame of its own.
+ */
+static bool stp_pkt_tx_is_urgent(char *buffer, uint16_t size, bool *coalesce)
+{
+    uint8_t *bpdu;
+
+    *coalesce = false;
+    if (size < PVST_BPDU_OFFSET + 5)
+        return true;
+
+    bpdu = stp_pkt_tx_bpdu(buffer);
+    if (bpdu[3] == TCN_BPDU_TYPE)
+        return true;
+
+    *coalesce = true;
+    // tc (0x01), proposal (0x02), agreement (0x40), tc-ack (0x80)
+    return (bpdu[4] & 0xc3) != 0;
+}
+
+static void stp_pkt_tx_refill(STPD_TX_PORT *tx, uint64_t now)
+{
+    uint64_t max = (uint64_t)g_stpd_tx_burst * STPD_TX_TOKEN;
+
+    if (now > tx->last_usec)
+    {
+        tx->tokens += (now - tx->last_usec) * g_stpd_tx_rate;
+        if (tx->tokens > max)
+            tx->tokens = max;
+    }
+    tx->last_usec = now;
+}
+
+static STPD_TX_PORT *stp_pkt_tx_get_port(uint32_t port_id, uint64_t now)
+{
+    STPD_TX_PORT *tx;
+
+    if (!stpd_context.tx_pacer.port)
+    {
+        stpd_context.tx_pacer.port = calloc(g_max_stp_port, sizeof(STPD_TX_PORT *));
+        if (!stpd_context.tx_pacer.port)
+            return NULL;
+
+        if (-1 == bmp_alloc(&stpd_context.tx_pacer.backlog, g_max_stp_port))
+        {
+            free(stpd_context.tx_pacer.port);
+            stpd_context.tx_pacer.port = NULL;
+            return NULL;
+        }
+    }
+
+    tx = stpd_context.tx_pacer.port[port_id];
+    if (!tx)
+    {
+        tx = calloc(1, sizeof(STPD_TX_PORT));
+        if (!tx)
+            return NULL;
+
+        tx->tokens = (uint64_t)g_stpd_tx_burst * STPD_TX_TOKEN;
+        tx->last_usec = now;
+        stpd_context.tx_pacer.port[port_id] = tx;
+    }
+
+    return tx;
+}
+
+static void stp_pkt_tx_unlink(STPD_TX_PORT *tx, STPD_TX_FRAME *frame)
+{
+    STPD_TX_QUEUE *q = &tx->q[frame->urgent ? STPD_TX_Q_URGENT : STPD_TX_Q_PERIODIC];
+
+    if (frame->prev)
+        frame->prev->next = frame->next;
+    else
+        q->head = frame->next;
+
+    if (frame->next)
+        frame->next->prev = frame->prev;
+    else
+        q->tail = frame->prev;
+
+    frame->next = frame->prev = NULL;
+}
+
+static void stp_pkt_tx_append(STPD_TX_PORT *tx, STPD_TX_FRAME *frame)
+{
+    STPD_TX_QUEUE *q = &tx->q[frame->urgent ? STPD_TX_Q_URGENT : STPD_TX_Q_PERIODIC];
+
+    frame->next = NULL;
+    frame->prev = q->tail;
+    if (q->tail)
+        q->tail->next = frame;
+    else
+        q->head = frame;
+    q->tail = frame;
+}
+
+// queued config bpdu a newer one of the vlan and encapsulation replaces
+static STPD_TX_FRAME **stp_pkt_tx_slot(STPD_TX_PORT *tx, bool ieee, VLAN_ID vlan_id)
+{
+    if (ieee)
+        return &tx->ieee_frame;
+
+    return tx->vlan_frame ? &tx->vlan_frame[vlan_id] : NULL;
+}
+
+static void stp_pkt_tx_schedule()
+{
+    struct timeval tv = {0, STPD_TX_DRAIN_USEC};
+
+    if (!stpd_context.tx_pacer.ev)
+    {
+        stpd_context.tx_pacer.ev = stpmgr_libevent_create(g_stpd_evbase, -1, 0,
+                stp_pkt_tx_drain, NULL, &tv, "TX_DRAIN");
+        if (!stpd_context.tx_pacer.ev)
+            STP_LOG_ERR("tx drain event create failed");
+        return;
+    }
+
+    if (!evtimer_pending(stpd_context.tx_pacer.ev, NULL))
+        event_add(stpd_context.tx_pacer.ev, &tv);
+}
+
+static int stp_pkt_tx_enqueue(STPD_TX_PORT *tx, uint32_t port_id, VLAN_ID vlan_id,
+        char *buffer, uint16_t size, bool tagged, uint64_t now)
+{
+    STPD_TX_FRAME *frame = NULL, **slot = NULL;
+    bool urgent, coalesce, ieee;
+    uint8_t flags;
+
+    urgent = stp_pkt_tx_is_urgent(buffer, size, &coalesce);
+    ieee = stp_pkt_tx_is_ieee(buffer);
+    if (coalesce && !ieee && vlan_id > MAX_VLAN_ID)
+        coalesce = false;
+
+    if (coalesce && (slot = stp_pkt_tx_slot(tx, ieee, vlan_id)))
+        frame = *slot;
+
+    // the untagged vlan of the port changed, the queued ieee bpdu still goes
+    if (frame && frame->vlan_id != vlan_id)
+    {
+        frame->coalesce = 0;
+        *slot = NULL;
+        frame = NULL;
+    }
+
+    if (frame)
+    {
+        // newer information for the vlan, send it in place of the queued
+        // frame without losing a tc-ack the bridge will not send again
+        flags = stp_pkt_tx_bpdu(frame->buf)[4] & STPD_TX_ONE_SHOT_FLAGS;
+        memcpy(frame->buf, buffer, size);
+        stp_pkt_tx_bpdu(frame->buf)[4] |= flags;
+        if (flags)
+            urgent = true;
+        frame->size = size;
+        frame->tagged = tagged;
+        if (urgent && !frame->urgent)
+        {
+            stp_pkt_tx_unlink(tx, frame);
+            frame->urgent = 1;
+            stp_pkt_tx_append(tx, frame);
+        }
+        STPD_INCR_PKT_COUNT(port_id, pkt_tx_replaced);
+        return size;
+    }
+
+    if (coalesce && !ieee && !tx->vlan_frame)
+    {
+        tx->vlan_frame = calloc(MAX_VLAN_ID + 1, sizeof(STPD_TX_FRAME *));
+        if (!tx->vlan_frame)
+            coalesce = false;
+    }
+
+    if (tx->depth >= STPD_TX_QUEUE_MAX
+            || !(frame = (STPD_TX_FRAME *)mempool_alloc(&g_stpd_tx_frame_pool)))
+    {
+        STPD_INCR_PKT_COUNT(port_id, pkt_tx_drop);
+        return -1;
+    }
+
+    memcpy(frame->buf, buffer, size);
+    frame->enq_usec = now;
+    frame->vlan_id = vlan_id;
+    frame->size = size;
+    frame->tagged = tagged;
+    frame->urgent = urgent;
+    frame->coalesce = coalesce;
+    frame->ieee = ieee;
+    stp_pkt_tx_append(tx, frame);
+    if (coalesce)
+        *stp_pkt_tx_slot(tx, ieee, vlan_id) = frame;
+
+    tx->depth++;
+    if (tx->depth > STPD_GET_PKT_COUNT(port_id, pkt_tx_depth_max))
+        STPD_GET_PKT_COUNT(port_id, pkt_tx_depth_max) = tx->depth;
+    STPD_INCR_PKT_COUNT(port_id, pkt_tx_queued);
+
+    bmp_set(stpd_context.tx_pacer.backlog, port_id);
+    stp_pkt_tx_schedule();
+    return size;
+}
+
+/* sends queued frames of the port while it has tokens, or all of them */
+static void stp_pkt_tx_drain_port(uint32_t port_id, STPD_TX_PORT *tx, uint64_t now, bool flush)
+{
+    STPD_TX_FRAME *frame;
+    uint64_t delay;
+
+    if (!flush)
+        stp_pkt_tx_refill(tx, now);
+
+    while (tx->depth && (flush || tx->tokens >= STPD_TX_TOKEN))
+    {
+        frame = tx->q[STPD_TX_Q_URGENT].head;
+        if (!frame)
+            frame = tx->q[STPD_TX_Q_PERIODIC].head;
+
+        stp_pkt_tx_unlink(tx, frame);
+        if (frame->coalesce)
+            *stp_pkt_tx_slot(tx, frame->ieee, frame->vlan_id) = NULL;
+        tx->depth--;
+        if (!flush)
+            tx->tokens -= STPD_TX_TOKEN;
+
+        delay = (now > frame->enq_usec) ? (now - frame->enq_usec) : 0;
+        STPD_GET_PKT_COUNT(port_id, pkt_tx_delay_sum) += delay;
+        if (delay > STPD_GET_PKT_COUNT(port_id, pkt_tx_delay_max))
+            STPD_GET_PKT_COUNT(port_id, pkt_tx_delay_max) = delay;
+
+        stp_pkt_tx_send(port_id, frame->vlan_id, frame->buf, frame->size, frame->tagged);
+        mempool_free(&g_stpd_tx_frame_pool, frame);
+    }
+
+    if (!tx->depth)
+        bmp_reset(stpd_context.tx_pacer.backlog, port_id);
+}
+
+static void stp_pkt_tx_drain_all(bool flush)
+{
+    uint64_t now;
+    PORT_ID port_id;
+
+    if (!stpd_context.tx_pacer.backlog)
+        return;
+
+    now = stp_pkt_tx_usec();
+    for (port_id = bmp_get_first_set_bit(stpd_context.tx_pacer.backlog);
+            port_id != BAD_PORT_ID;
+            port_id = bmp_get_next_set_bit(stpd_context.tx_pacer.backlog, port_id))
+    {
+        stp_pkt_tx_drain_port(port_id, stpd_context.tx_pacer.port[port_id], now, flush);
+    }
+
+    if (!flush && bmp_isset_any(stpd_context.tx_pacer.backlog))
+        stp_pkt_tx_schedule();
+}
+
+void stp_pkt_tx_drain(evutil_socket_t fd, short what, void *arg)
+{
+    stp_pkt_tx_drain_all(false);
+}
+
+/* rate 0 disables pacing and sends what is queued, burst 0 allows 100ms of rate */
+void stp_pkt_tx_set_rate(uint32_t rate, uint32_t burst)
+{
+    if (rate && !burst)
+        burst = (rate / 10) ? (rate / 10) : 1;
+
+    // settle the buckets at the old rate before switching
+    stp_pkt_tx_drain_all(rate == 0);
+
+    g_stpd_tx_rate = rate;
+    g_stpd_tx_burst = burst;
+}
+
+/*
+ * BPDU tx entry point, paces the frames of each port (see g_stpd_tx_rate).
+ * A frame goes out at once while the port has tokens and nothing queued,
+ * otherwise it is copied to the port's queue and sent by the drain timer.
+ */
+static int stp_pkt_tx_pace(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
+{
+    STPD_TX_PORT *tx;
+    uint64_t now;
+
+    if (!g_stpd_tx_rate || size > STPD_TX_FRAME_LEN || port_id >= g_max_stp_port)
+        return stp_pkt_tx_send(port_id, vlan_id, buffer, size, tagged);
+
+    now = stp_pkt_tx_usec();
+    tx = stp_pkt_tx_get_port(port_id, now);
+    if (!tx)
+        return stp_pkt_tx_send(port_id, vlan_id, buffer, size, tagged);
+
+    stp_pkt_tx_refill(tx, now);
+    if (!tx->depth && tx->tokens >= STPD_TX_TOKEN)
+    {
+        tx->tokens -= STPD_TX_TOKEN;
+        return stp_pkt_tx_send(port_id, vlan_id, buffer, size, tagged);
+    }
+
+    return stp_pkt_tx_enqueue(tx, port_id, vlan_id, buffer, size, tagged, now);
+}
+
+int stp_pkt_tx_handler(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
+{
+    uint64_t start = stptimer_prof_start();
+    int ret;
+
+    STP_TRACE_BPDU_TX(port_id, vlan_id, size);
+    ret = stp_pkt_tx_pace(port_id, vlan_id, buffer, size, tagged);
+    stptimer_prof_stop(STPD_TICK_TX, start);
+    return ret;
+}
+
 
 void stp_pkt_rx_handler (evutil_socket_t fd, short what, void *arg)
 {
     g_stpd_stats_libev_pktrx++;
 
     INTERFACE_NODE *intf_node = (INTERFACE_NODE *)arg;
-    INTERFACE_NODE *intf_node_member = 0;
     int                     i = 0;
     uint16_t          vlan_id = 0;
     ssize_t        packet_len = 0;
+    uint64_t            rx_ns = 0;
     static char pkt[STP_MAX_PKT_LEN];
 
 	struct tpacket_auxdata *aux;
@@ -272,7 +647,6 @@ void stp_pkt_rx_handler (evutil_socket_t fd, short what, void *arg)
         struct cmsghdr align;
     } cmsg_buf;
     int new_buf_size = 0;
-    char ifname[IF_NAMESIZE] = {0};
 
     if (!intf_node)
     {
@@ -317,24 +691,15 @@ void stp_pkt_rx_handler (evutil_socket_t fd, short what, void *arg)
         return;
     }
 
-    if (from.sll_ifindex != intf_node->kif_index)
-    {
-        if_indextoname(from.sll_ifindex, ifname);
-        if ((strncmp("lo",ifname,2) == 0) || (strncmp("eth",ifname,3) == 0))
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) 
+	{
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS &&
+                cmsg->cmsg_len >= CMSG_LEN(sizeof(struct timespec)))
         {
-            /*
-             * STP never expects any packet from "lo" or "eth0/eth1/eth2 etc"
-             */
-            STP_LOG_DEBUG("Drop pkts recvd on %s pkt-kif:%u my-kif-%u my-port:%u",ifname,from.sll_ifindex, intf_node->kif_index,intf_node->port_id);
-            return;
+            rx_ns = stp_pkt_cmsg_ns(cmsg);
+            continue;
         }
-        STP_LOG_ERR("INVALID src_port : pkt-kif:%u my-kif-%u my-port:%u",from.sll_ifindex, intf_node->kif_index, intf_node->port_id);
-        STPD_INCR_PKT_COUNT(intf_node->port_id, pkt_rx_err);
-        return;
-    }
 
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) 
-	{
 		if (cmsg->cmsg_len < CMSG_LEN(sizeof(struct tpacket_auxdata)) ||
 				cmsg->cmsg_level != SOL_PACKET ||
 				    cmsg->cmsg_type != PACKET_AUXDATA) 
@@ -347,10 +712,44 @@ void stp_pkt_rx_handler (evutil_socket_t fd, short what, void *arg)
         if (aux->tp_status & TP_STATUS_VLAN_VALID)
         {
             vlan_id = (aux->tp_vlan_tci & 0x0fff);
-            break;
         }
 	}
 
+    stp_pkt_rx_process(intf_node, from.sll_ifindex, vlan_id, rx_ns, pkt, packet_len);
+}
+
+/* SCM_TIMESTAMPNS control message to nsec since the epoch */
+uint64_t stp_pkt_cmsg_ns(struct cmsghdr *cmsg)
+{
+    struct timespec ts;
+
+    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* intf_node : socket the frame was read from, rx_ns : kernel arrival time (0 if unknown),
+ * pkt : the entire frame */
+void stp_pkt_rx_process(INTERFACE_NODE *intf_node, uint32_t from_kif, uint16_t vlan_id, uint64_t rx_ns, char *pkt, ssize_t packet_len)
+{
+    INTERFACE_NODE *intf_node_member = 0;
+    char ifname[IF_NAMESIZE] = {0};
+
+    if (from_kif != intf_node->kif_index)
+    {
+        if_indextoname(from_kif, ifname);
+        if ((strncmp("lo",ifname,2) == 0) || (strncmp("eth",ifname,3) == 0))
+        {
+            /*
+             * STP never expects any packet from "lo" or "eth0/eth1/eth2 etc"
+             */
+            STP_LOG_DEBUG("Drop pkts recvd on %s pkt-kif:%u my-kif-%u my-port:%u",ifname,from_kif, intf_node->kif_index,intf_node->port_id);
+            return;
+        }
+        STP_LOG_ERR("INVALID src_port : pkt-kif:%u my-kif-%u my-port:%u",from_kif, intf_node->kif_index, intf_node->port_id);
+        STPD_INCR_PKT_COUNT(intf_node->port_id, pkt_rx_err);
+        return;
+    }
+
     //if PO-member port, assign intf_node to PO node.
     if (intf_node->master_ifindex)
     {
@@ -365,13 +764,22 @@ void stp_pkt_rx_handler (evutil_socket_t fd, short what, void *arg)
     }
 
     STPD_INCR_PKT_COUNT(intf_node->port_id, pkt_rx);
+    STP_TRACE_BPDU_RX(intf_node->port_id, vlan_id, packet_len);
 
     if (STP_DEBUG_BPDU_RX(vlan_id, intf_node->port_id))
         stp_pkt_dump(intf_node, vlan_id, pkt, packet_len, true);
 
     if (STP_IS_PROTOCOL_ENABLED(L2_PVSTP))
     { 
+        if (stp_shard_rx(intf_node->port_id, vlan_id, pkt, packet_len))
+        {
+            stp_rxlat_queued(intf_node->port_id, rx_ns);
+            return;
+        }
+
+        stp_rxlat_begin(intf_node->port_id, rx_ns);
         stpmgr_process_rx_bpdu(vlan_id, intf_node->port_id, &pkt[0]);
+        stp_rxlat_end(intf_node->port_id);
     }
     else if (STP_IS_PROTOCOL_ENABLED(L2_MSTP))
     {
@@ -379,7 +787,9 @@ void stp_pkt_rx_handler (evutil_socket_t fd, short what, void *arg)
             return;
         if ((unsigned char)pkt[1] == 128)
         {
-             mstpmgr_rx_bpdu(vlan_id, intf_node->port_id, &pkt[0], packet_len);
+            stp_rxlat_begin(intf_node->port_id, rx_ns);
+            mstpmgr_rx_bpdu(vlan_id, intf_node->port_id, &pkt[0], packet_len);
+            stp_rxlat_end(intf_node->port_id);
         }
     }
 
@@ -0,0 +1,521 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "stp_inc.h"
+
+/*
+ * Packet I/O thread.
+ *
+ * Optional (see STPD_PKT_IO_FLAG). When running, the thread owns the per
+ * port PF_PACKET sockets and a socket of its own for tx. Received frames
+ * are copied with their vlan and arrival time into descriptors on the rx
+ * ring, which the protocol thread drains from its event loop. Frames to
+ * send take the tx ring the other way. Socket add/delete go through the
+ * command ring so a socket is only closed by the thread reading it.
+ *
+ * All rings are single producer single consumer. The producer wakes the
+ * consumer through an eventfd only when the consumer may have seen the
+ * ring empty, so a busy ring costs no syscalls.
+ */
+
+#define STPD_PKT_IO_RX_RING     2048    //power of 2
+#define STPD_PKT_IO_TX_RING     2048    //power of 2
+#define STPD_PKT_IO_CMD_RING    256     //power of 2
+#define STPD_PKT_IO_RX_BURST    32      //frames read per socket wakeup
+#define STPD_PKT_IO_RX_BUDGET   256     //frames processed per protocol wakeup
+#define STPD_PKT_IO_EPOLL_MAX   64
+#define STPD_PKT_IO_WAKE_KEY    ((uint64_t)-1)
+
+typedef struct
+{
+    uint32_t kif_index;     //rx: socket the frame was read from, tx: egress
+    uint32_t from_kif;      //rx: sll_ifindex of the frame
+    uint64_t rx_usec;       //rx: monotonic arrival time
+    uint64_t rx_ns;         //rx: kernel arrival time, 0 if unknown
+    int32_t  err;           //rx: errno of a failed read
+    uint16_t vlan_id;
+    uint16_t len;
+    uint8_t  trunc;
+    char     bytes[STP_MAX_PKT_LEN];
+}STPD_PKT_DESC;
+
+typedef enum
+{
+    STPD_PKT_IO_SOCK_ADD,
+    STPD_PKT_IO_SOCK_DEL,
+}STPD_PKT_IO_OP;
+
+typedef struct
+{
+    STPD_PKT_IO_OP op;
+    int sock;
+    uint32_t kif_index;
+}STPD_PKT_IO_CMD;
+
+typedef struct
+{
+    uint32_t head __attribute__((aligned(64)));    //next slot to consume
+    uint32_t tail __attribute__((aligned(64)));    //next slot to produce
+    uint32_t size __attribute__((aligned(64)));
+    uint32_t elem_size;
+    uint8_t  *slots;
+    int      wake_fd;                               //eventfd of the consumer
+}STPD_PKT_RING;
+
+typedef struct
+{
+    bool            active;
+    pthread_t       thread;
+    int             epoll_fd;
+    int             io_wake_fd;     //wakes the i/o thread (tx, cmd rings)
+    int             rx_wake_fd;     //wakes the protocol thread (rx ring)
+    int             tx_sock;
+    struct event    *rx_ev;
+    STPD_PKT_RING   rx;
+    STPD_PKT_RING   tx;
+    STPD_PKT_RING   cmd;
+
+    //written by the i/o thread only
+    uint64_t        rx_frames;
+    uint64_t        rx_ring_full;
+    uint64_t        tx_frames;
+    uint64_t        tx_err;
+
+    //written by the protocol thread only
+    uint64_t        rx_wakeups;
+    uint64_t        tx_ring_full;
+}STPD_PKT_IO;
+
+static STPD_PKT_IO g_stpd_pkt_io;
+
+static int stp_pkt_ring_init(STPD_PKT_RING *ring, uint32_t size, uint32_t elem_size, int wake_fd)
+{
+    ring->slots = calloc(size, elem_size);
+    if (!ring->slots)
+        return -1;
+
+    ring->head = ring->tail = 0;
+    ring->size = size;
+    ring->elem_size = elem_size;
+    ring->wake_fd = wake_fd;
+    return 0;
+}
+
+//returns the next free slot, NULL if the ring is full
+static void *stp_pkt_ring_reserve(STPD_PKT_RING *ring)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (ring->tail - head == ring->size)
+        return NULL;
+
+    return ring->slots + (size_t)(ring->tail & (ring->size - 1)) * ring->elem_size;
+}
+
+//publishes the reserved slot
+static void stp_pkt_ring_commit(STPD_PKT_RING *ring)
+{
+    uint32_t tail = ring->tail;
+    uint64_t one = 1;
+
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_SEQ_CST);
+
+    //the consumer may have found the ring empty and gone to sleep
+    if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail)
+    {
+        if (write(ring->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+            STP_LOG_ERR("pkt io wake failed : %s", strerror(errno));
+    }
+}
+
+//returns the oldest slot, NULL if the ring is empty
+static void *stp_pkt_ring_peek(STPD_PKT_RING *ring)
+{
+    if (ring->head == __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST))
+        return NULL;
+
+    return ring->slots + (size_t)(ring->head & (ring->size - 1)) * ring->elem_size;
+}
+
+//releases the slot returned by peek
+static void stp_pkt_ring_release(STPD_PKT_RING *ring)
+{
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_SEQ_CST);
+}
+
+static void stp_pkt_io_clear_wake(int fd)
+{
+    uint64_t val;
+
+    if (read(fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+        STP_LOG_ERR("pkt io wake read failed : %s", strerror(errno));
+}
+
+static uint64_t stp_pkt_io_usec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/* I/O THREAD --------------------------------------------------------------- */
+
+static void stp_pkt_io_read_sock(int sock, uint32_t kif_index)
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    STPD_PKT_DESC *desc;
+    static char drop_buf[STP_MAX_PKT_LEN];
+    struct tpacket_auxdata *aux;
+    struct sockaddr_ll from;
+    struct iovec iov;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    union {
+        char buf[CMSG_SPACE(sizeof(struct tpacket_auxdata)) + CMSG_SPACE(sizeof(struct timespec))];
+        struct cmsghdr align;
+    } cmsg_buf;
+    ssize_t len;
+    int i;
+
+    for (i = 0; i < STPD_PKT_IO_RX_BURST; i++)
+    {
+        desc = (STPD_PKT_DESC *)stp_pkt_ring_reserve(&io->rx);
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name        = &from;
+        msg.msg_namelen     = sizeof(from);
+        msg.msg_iov         = &iov;
+        msg.msg_iovlen      = 1;
+        msg.msg_control     = &cmsg_buf;
+        msg.msg_controllen  = sizeof(cmsg_buf);
+        iov.iov_base        = desc ? desc->bytes : drop_buf;
+        iov.iov_len         = STP_MAX_PKT_LEN;
+
+        len = recvmsg(sock, &msg, MSG_TRUNC);
+        if (-1 == len && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return;
+
+        if (!desc)
+        {
+            //protocol thread is behind, leave room for what it has
+            io->rx_ring_full++;
+            if (-1 == len)
+                return;
+            continue;
+        }
+
+        desc->kif_index = kif_index;
+        desc->from_kif  = from.sll_ifindex;
+        desc->rx_usec   = stp_pkt_io_usec();
+        desc->err       = (-1 == len) ? errno : 0;
+        desc->trunc     = (len != -1 && (msg.msg_flags & MSG_TRUNC)) ? 1 : 0;
+        desc->len       = (len > 0 && !desc->trunc) ? (uint16_t)len : 0;
+        desc->vlan_id   = 0;
+        desc->rx_ns     = 0;
+        //the protocol code expects a zero filled frame buffer, as on the direct path
+        memset(desc->bytes + desc->len, 0, STP_MAX_PKT_LEN - desc->len);
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); len != -1 && cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS &&
+                    cmsg->cmsg_len >= CMSG_LEN(sizeof(struct timespec)))
+            {
+                desc->rx_ns = stp_pkt_cmsg_ns(cmsg);
+                continue;
+            }
+
+            if (cmsg->cmsg_len < CMSG_LEN(sizeof(struct tpacket_auxdata)) ||
+                    cmsg->cmsg_level != SOL_PACKET ||
+                    cmsg->cmsg_type != PACKET_AUXDATA)
+                continue;
+
+            aux = (struct tpacket_auxdata *)CMSG_DATA(cmsg);
+            if (aux->tp_status & TP_STATUS_VLAN_VALID)
+                desc->vlan_id = (aux->tp_vlan_tci & 0x0fff);
+        }
+
+        io->rx_frames++;
+        stp_pkt_ring_commit(&io->rx);
+
+        if (-1 == len)
+            return;
+    }
+}
+
+static void stp_pkt_io_run_cmds()
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    STPD_PKT_IO_CMD *cmd;
+    struct epoll_event ev;
+
+    while ((cmd = (STPD_PKT_IO_CMD *)stp_pkt_ring_peek(&io->cmd)))
+    {
+        if (cmd->op == STPD_PKT_IO_SOCK_ADD)
+        {
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.u64 = ((uint64_t)cmd->kif_index << 32) | (uint32_t)cmd->sock;
+            if (-1 == epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, cmd->sock, &ev))
+                STP_LOG_ERR("pkt io add sock %d kif %u failed : %s", cmd->sock, cmd->kif_index, strerror(errno));
+        }
+        else
+        {
+            epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, cmd->sock, NULL);
+            close(cmd->sock);
+        }
+        stp_pkt_ring_release(&io->cmd);
+    }
+}
+
+static void stp_pkt_io_run_tx()
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    STPD_PKT_DESC *desc;
+    struct sockaddr_ll sa;
+
+    while ((desc = (STPD_PKT_DESC *)stp_pkt_ring_peek(&io->tx)))
+    {
+        memset(&sa, 0, sizeof(sa));
+        sa.sll_family = AF_PACKET;
+        sa.sll_ifindex = desc->kif_index;
+
+        if (-1 == sendto(io->tx_sock, desc->bytes, desc->len, 0,
+                    (const struct sockaddr *)&sa, sizeof(sa)))
+            io->tx_err++;
+        else
+            io->tx_frames++;
+
+        stp_pkt_ring_release(&io->tx);
+    }
+}
+
+static void *stp_pkt_io_main(void *arg)
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    struct epoll_event events[STPD_PKT_IO_EPOLL_MAX];
+    int i, n;
+
+    for (;;)
+    {
+        n = epoll_wait(io->epoll_fd, events, STPD_PKT_IO_EPOLL_MAX, -1);
+        if (-1 == n)
+        {
+            if (errno != EINTR)
+                STP_LOG_ERR("pkt io epoll_wait failed : %s", strerror(errno));
+            continue;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            if (events[i].data.u64 == STPD_PKT_IO_WAKE_KEY)
+                stp_pkt_io_clear_wake(io->io_wake_fd);
+            else
+                stp_pkt_io_read_sock((int)(uint32_t)events[i].data.u64,
+                        (uint32_t)(events[i].data.u64 >> 32));
+        }
+
+        //sockets are closed here, after the events read above
+        stp_pkt_io_run_cmds();
+        stp_pkt_io_run_tx();
+    }
+
+    return NULL;
+}
+
+/* PROTOCOL THREAD ---------------------------------------------------------- */
+
+static void stp_pkt_io_rx_handler(evutil_socket_t fd, short what, void *arg)
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    STPD_PKT_DESC *desc;
+    INTERFACE_NODE *intf_node;
+    uint64_t one = 1;
+    int count = 0;
+
+    g_stpd_stats_libev_pktrx++;
+    io->rx_wakeups++;
+    stp_pkt_io_clear_wake(io->rx_wake_fd);
+
+    while (count < STPD_PKT_IO_RX_BUDGET && (desc = (STPD_PKT_DESC *)stp_pkt_ring_peek(&io->rx)))
+    {
+        count++;
+
+        //the interface may have been deleted since the frame was read
+        intf_node = stp_intf_get_node_by_kif_index(desc->kif_index);
+        if (intf_node)
+        {
+            if (desc->err)
+            {
+                if (desc->err == ENETDOWN)
+                    STP_LOG_INFO("%s : errno : Network is down", intf_node->ifname);
+                else
+                    STP_LOG_ERR("%s : errno : %s", intf_node->ifname, strerror(desc->err));
+                STPD_INCR_PKT_COUNT(intf_node->port_id, pkt_rx_err);
+            }
+            else if (desc->trunc)
+                STPD_INCR_PKT_COUNT(intf_node->port_id, pkt_rx_err_trunc);
+            else
+                stp_pkt_rx_process(intf_node, desc->from_kif, desc->vlan_id, desc->rx_ns, desc->bytes, desc->len);
+        }
+
+        stp_pkt_ring_release(&io->rx);
+    }
+
+    //more left, come back after the other events had their turn
+    if (stp_pkt_ring_peek(&io->rx))
+    {
+        if (write(io->rx_wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+            STP_LOG_ERR("pkt io rx rearm failed : %s", strerror(errno));
+    }
+}
+
+bool stp_pkt_io_enabled()
+{
+    return g_stpd_pkt_io.active;
+}
+
+static void stp_pkt_io_send_cmd(STPD_PKT_IO_OP op, int sock, uint32_t kif_index)
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    STPD_PKT_IO_CMD *cmd;
+
+    //commands are rare and the i/o thread drains them at once
+    while (!(cmd = (STPD_PKT_IO_CMD *)stp_pkt_ring_reserve(&io->cmd)))
+        sched_yield();
+
+    cmd->op = op;
+    cmd->sock = sock;
+    cmd->kif_index = kif_index;
+    stp_pkt_ring_commit(&io->cmd);
+}
+
+/* hands a configured rx socket over to the i/o thread */
+void stp_pkt_io_add_sock(int sock, uint32_t kif_index)
+{
+    int flags = fcntl(sock, F_GETFL, 0);
+
+    if (-1 == flags || -1 == fcntl(sock, F_SETFL, flags | O_NONBLOCK))
+        STP_LOG_ERR("pkt io sock %d nonblock failed : %s", sock, strerror(errno));
+
+    stp_pkt_io_send_cmd(STPD_PKT_IO_SOCK_ADD, sock, kif_index);
+}
+
+/* the i/o thread stops reading the socket and closes it */
+void stp_pkt_io_del_sock(int sock)
+{
+    stp_pkt_io_send_cmd(STPD_PKT_IO_SOCK_DEL, sock, 0);
+}
+
+/* queues a complete frame for the i/o thread to send */
+int stp_pkt_io_tx(uint32_t kif_index, char *buffer, uint16_t size)
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    STPD_PKT_DESC *desc;
+
+    desc = (STPD_PKT_DESC *)stp_pkt_ring_reserve(&io->tx);
+    if (!desc)
+    {
+        io->tx_ring_full++;
+        return -1;
+    }
+
+    desc->kif_index = kif_index;
+    desc->len = size;
+    memcpy(desc->bytes, buffer, size);
+    stp_pkt_ring_commit(&io->tx);
+    return size;
+}
+
+int stp_pkt_io_init()
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+    struct epoll_event ev;
+
+    memset(io, 0, sizeof(STPD_PKT_IO));
+    io->epoll_fd = io->io_wake_fd = io->rx_wake_fd = io->tx_sock = -1;
+
+    io->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    io->io_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    io->rx_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    io->tx_sock = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (-1 == io->epoll_fd || -1 == io->io_wake_fd || -1 == io->rx_wake_fd || -1 == io->tx_sock)
+    {
+        STP_LOG_ERR("pkt io fd create failed : %s", strerror(errno));
+        goto fail;
+    }
+
+    if (-1 == stp_pkt_ring_init(&io->rx, STPD_PKT_IO_RX_RING, sizeof(STPD_PKT_DESC), io->rx_wake_fd)
+            || -1 == stp_pkt_ring_init(&io->tx, STPD_PKT_IO_TX_RING, sizeof(STPD_PKT_DESC), io->io_wake_fd)
+            || -1 == stp_pkt_ring_init(&io->cmd, STPD_PKT_IO_CMD_RING, sizeof(STPD_PKT_IO_CMD), io->io_wake_fd))
+    {
+        STP_LOG_ERR("pkt io ring alloc failed");
+        goto fail;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = STPD_PKT_IO_WAKE_KEY;
+    if (-1 == epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->io_wake_fd, &ev))
+    {
+        STP_LOG_ERR("pkt io epoll add failed : %s", strerror(errno));
+        goto fail;
+    }
+
+    io->rx_ev = stpmgr_libevent_create(g_stpd_evbase, io->rx_wake_fd, EV_READ|EV_PERSIST,
+            stp_pkt_io_rx_handler, NULL, NULL, "PKT_IO_RX");
+    if (!io->rx_ev)
+    {
+        STP_LOG_ERR("pkt io rx event create failed");
+        goto fail;
+    }
+
+    if (0 != pthread_create(&io->thread, NULL, stp_pkt_io_main, NULL))
+    {
+        STP_LOG_ERR("pkt io thread create failed");
+        stpmgr_libevent_destroy(io->rx_ev);
+        goto fail;
+    }
+
+    io->active = true;
+    STP_LOG_INFO("packet i/o thread running");
+    return 0;
+
+fail:
+    free(io->rx.slots);
+    free(io->tx.slots);
+    free(io->cmd.slots);
+    if (io->epoll_fd != -1)
+        close(io->epoll_fd);
+    if (io->io_wake_fd != -1)
+        close(io->io_wake_fd);
+    if (io->rx_wake_fd != -1)
+        close(io->rx_wake_fd);
+    if (io->tx_sock != -1)
+        close(io->tx_sock);
+    memset(io, 0, sizeof(STPD_PKT_IO));
+    return -1;
+}
+
+void stp_pkt_io_dump_stats()
+{
+    STPD_PKT_IO *io = &g_stpd_pkt_io;
+
+    if (!io->active)
+        return;
+
+    STP_DUMP("Pkt-IO  : rx %" PRIu64 " rx-ring-full %" PRIu64 " wakeups %" PRIu64
+            " tx %" PRIu64 " tx-err %" PRIu64 " tx-ring-full %" PRIu64 "\n",
+            __atomic_load_n(&io->rx_frames, __ATOMIC_RELAXED),
+            __atomic_load_n(&io->rx_ring_full, __ATOMIC_RELAXED),
+            io->rx_wakeups,
+            __atomic_load_n(&io->tx_frames, __ATOMIC_RELAXED),
+            __atomic_load_n(&io->tx_err, __ATOMIC_RELAXED),
+            io->tx_ring_full);
+}
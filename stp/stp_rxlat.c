@@ -0,0 +1,309 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include "stp_inc.h"
+
+/*
+ * BPDU rx latency.
+ *
+ * Every received BPDU is timed through three stages, globally and per port:
+ *   queue   : kernel arrival (SO_TIMESTAMPNS) until stpd starts processing
+ *   process : protocol processing, excluding port state programming
+ *   program : port state programming (kernel bridge and APP DB) done while
+ *             processing the BPDU, recorded only for BPDUs that changed state
+ *
+ * The histograms (STPD_HIST) are log-linear in usec: values below 4 have a
+ * bucket each, every power of two above is split into 4 linear buckets, so
+ * the relative bucket width stays below 25% up to the 71 minute maximum.
+ * They are also used by the event loop profiler (stp_mgr.c).
+ */
+
+typedef enum
+{
+    STPD_LAT_QUEUE,
+    STPD_LAT_PROCESS,
+    STPD_LAT_PROGRAM,
+    STPD_LAT_STAGES
+}STPD_LAT_STAGE;
+
+static const char *g_stpd_lat_stage_name[STPD_LAT_STAGES] = { "queue", "process", "program" };
+
+typedef struct
+{
+    STPD_HIST stage[STPD_LAT_STAGES];
+}STPD_LAT_STATS;
+
+static STPD_LAT_STATS g_stpd_lat;
+static STPD_LAT_STATS **g_stpd_port_lat;   //allocated when a port first receives
+
+//bpdu being processed
+static bool g_stpd_lat_active;
+static uint64_t g_stpd_lat_start_ns;
+static uint64_t g_stpd_lat_program_ns;
+
+static uint64_t stp_rxlat_clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static uint32_t stp_rxlat_bucket(uint32_t usec)
+{
+    uint32_t exp;
+
+    if (usec < STPD_HIST_SUB)
+        return usec;
+
+    exp = 31 - __builtin_clz(usec);
+    return STPD_HIST_SUB + ((exp - STPD_HIST_SUB_BITS) * STPD_HIST_SUB)
+        + ((usec >> (exp - STPD_HIST_SUB_BITS)) & (STPD_HIST_SUB - 1));
+}
+
+//smallest value of the bucket
+static uint32_t stp_rxlat_bucket_low(uint32_t index)
+{
+    uint32_t exp;
+
+    if (index < STPD_HIST_SUB)
+        return index;
+
+    exp = ((index - STPD_HIST_SUB) / STPD_HIST_SUB) + STPD_HIST_SUB_BITS;
+    return (STPD_HIST_SUB + ((index - STPD_HIST_SUB) % STPD_HIST_SUB)) << (exp - STPD_HIST_SUB_BITS);
+}
+
+//largest value of the bucket
+static uint32_t stp_rxlat_bucket_high(uint32_t index)
+{
+    if (index < STPD_HIST_SUB)
+        return index;
+
+    if (index == STPD_HIST_BUCKETS - 1)
+        return UINT32_MAX;
+
+    return stp_rxlat_bucket_low(index + 1) - 1;
+}
+
+void stpd_hist_add(STPD_HIST *hist, uint64_t usec)
+{
+    uint32_t val = (usec > UINT32_MAX) ? UINT32_MAX : (uint32_t)usec;
+
+    hist->count++;
+    hist->sum += val;
+    if (val > hist->max)
+        hist->max = val;
+    hist->bucket[stp_rxlat_bucket(val)]++;
+}
+
+//upper bound of the bucket holding the percentile
+uint32_t stpd_hist_percentile(STPD_HIST *hist, uint32_t percent)
+{
+    uint64_t rank, seen = 0;
+    uint32_t i;
+
+    if (!hist->count)
+        return 0;
+
+    rank = ((hist->count * percent) + 99) / 100;
+    for (i = 0; i < STPD_HIST_BUCKETS; i++)
+    {
+        seen += hist->bucket[i];
+        if (seen >= rank)
+            return (stp_rxlat_bucket_high(i) < hist->max) ? stp_rxlat_bucket_high(i) : hist->max;
+    }
+
+    return hist->max;
+}
+
+void stpd_hist_dump_buckets(STPD_HIST *hist)
+{
+    uint32_t i;
+
+    for (i = 0; i < STPD_HIST_BUCKETS; i++)
+    {
+        if (hist->bucket[i])
+            STP_DUMP("  %10u - %10u : %u\n", stp_rxlat_bucket_low(i), stp_rxlat_bucket_high(i), hist->bucket[i]);
+    }
+}
+
+static void stp_rxlat_add(uint32_t port_id, STPD_LAT_STAGE stage, uint64_t nsec)
+{
+    STPD_LAT_STATS *port_lat = NULL;
+
+    stpd_hist_add(&g_stpd_lat.stage[stage], nsec / 1000);
+
+    if (port_id >= g_max_stp_port)
+        return;
+
+    if (!g_stpd_port_lat)
+        g_stpd_port_lat = calloc(g_max_stp_port, sizeof(STPD_LAT_STATS *));
+
+    if (g_stpd_port_lat)
+    {
+        port_lat = g_stpd_port_lat[port_id];
+        if (!port_lat)
+            port_lat = g_stpd_port_lat[port_id] = calloc(1, sizeof(STPD_LAT_STATS));
+    }
+
+    if (port_lat)
+        stpd_hist_add(&port_lat->stage[stage], nsec / 1000);
+}
+
+/* FUNCTION
+ *		stp_rxlat_queued()
+ *
+ * SYNOPSIS
+ *		records the queue stage of a bpdu taken off the socket. rx_ns is
+ *		the kernel arrival time (CLOCK_REALTIME), 0 if the kernel did not
+ *		supply one. bpdus handed to a sharded worker are only timed this far.
+ */
+void stp_rxlat_queued(uint32_t port_id, uint64_t rx_ns)
+{
+    uint64_t now;
+
+    if (rx_ns)
+    {
+        now = stp_rxlat_clock_ns(CLOCK_REALTIME);
+        stp_rxlat_add(port_id, STPD_LAT_QUEUE, (now > rx_ns) ? (now - rx_ns) : 0);
+    }
+}
+
+/* FUNCTION
+ *		stp_rxlat_begin()
+ *
+ * SYNOPSIS
+ *		called when stpd starts processing a bpdu, see stp_rxlat_queued().
+ */
+void stp_rxlat_begin(uint32_t port_id, uint64_t rx_ns)
+{
+    stp_rxlat_queued(port_id, rx_ns);
+
+    g_stpd_lat_active = true;
+    g_stpd_lat_program_ns = 0;
+    g_stpd_lat_start_ns = stp_rxlat_clock_ns(CLOCK_MONOTONIC);
+}
+
+/* FUNCTION
+ *		stp_rxlat_end()
+ *
+ * SYNOPSIS
+ *		called when the state machines are done with the bpdu.
+ */
+void stp_rxlat_end(uint32_t port_id)
+{
+    uint64_t total;
+
+    if (!g_stpd_lat_active)
+        return;
+
+    total = stp_rxlat_clock_ns(CLOCK_MONOTONIC) - g_stpd_lat_start_ns;
+    if (g_stpd_lat_program_ns > total)
+        g_stpd_lat_program_ns = total;
+
+    stp_rxlat_add(port_id, STPD_LAT_PROCESS, total - g_stpd_lat_program_ns);
+    if (g_stpd_lat_program_ns)
+        stp_rxlat_add(port_id, STPD_LAT_PROGRAM, g_stpd_lat_program_ns);
+
+    g_stpd_lat_active = false;
+}
+
+/* FUNCTION
+ *		stp_rxlat_program_start()
+ *
+ * SYNOPSIS
+ *		returns the start time of port state programming to pass to
+ *		stp_rxlat_program_end(), 0 when no bpdu is being processed.
+ */
+uint64_t stp_rxlat_program_start()
+{
+    return g_stpd_lat_active ? stp_rxlat_clock_ns(CLOCK_MONOTONIC) : 0;
+}
+
+void stp_rxlat_program_end(uint64_t start_ns)
+{
+    if (start_ns && g_stpd_lat_active)
+        g_stpd_lat_program_ns += stp_rxlat_clock_ns(CLOCK_MONOTONIC) - start_ns;
+}
+
+void stp_rxlat_clear()
+{
+    uint32_t i;
+
+    memset(&g_stpd_lat, 0, sizeof(g_stpd_lat));
+    for (i = 0; g_stpd_port_lat && i < g_max_stp_port; i++)
+    {
+        if (g_stpd_port_lat[i])
+            memset(g_stpd_port_lat[i], 0, sizeof(STPD_LAT_STATS));
+    }
+}
+
+static void stp_rxlat_dump_summary(const char *name, STPD_LAT_STATS *lat)
+{
+    STPD_HIST *hist;
+    int i;
+
+    for (i = 0; i < STPD_LAT_STAGES; i++)
+    {
+        hist = &lat->stage[i];
+        if (!hist->count)
+            continue;
+
+        STP_DUMP("%-16s %-8s %10" PRIu64 " %10" PRIu64 " %10u %10u %10u %10u\n",
+                name, g_stpd_lat_stage_name[i], hist->count, hist->sum / hist->count,
+                stpd_hist_percentile(hist, 50), stpd_hist_percentile(hist, 90),
+                stpd_hist_percentile(hist, 99), hist->max);
+    }
+}
+
+/* FUNCTION
+ *		stp_rxlat_dump()
+ *
+ * SYNOPSIS
+ *		dumps the latency percentiles of all ports, or the histograms of
+ *		the named port.
+ */
+void stp_rxlat_dump(char *ifname)
+{
+    STPD_LAT_STATS *lat;
+    STPD_HIST *hist;
+    uint32_t port_id;
+    int stage;
+
+    STP_DUMP("BPDU rx latency (usec)\n");
+    STP_DUMP("%-16s %-8s %10s %10s %10s %10s %10s %10s\n",
+            "Port", "Stage", "Count", "Avg", "P50", "P90", "P99", "Max");
+    STP_DUMP("----------------------------------------------------------------------------------------\n");
+
+    if (!ifname || !ifname[0])
+    {
+        stp_rxlat_dump_summary("all", &g_stpd_lat);
+        for (port_id = 0; g_stpd_port_lat && port_id < g_max_stp_port; port_id++)
+        {
+            if (g_stpd_port_lat[port_id])
+                stp_rxlat_dump_summary(stp_intf_get_port_name(port_id), g_stpd_port_lat[port_id]);
+        }
+        return;
+    }
+
+    port_id = stp_intf_get_port_id_by_name(ifname);
+    lat = (g_stpd_port_lat && port_id < g_max_stp_port) ? g_stpd_port_lat[port_id] : NULL;
+    if (!lat)
+    {
+        STP_DUMP("no samples for %s\n", ifname);
+        return;
+    }
+
+    stp_rxlat_dump_summary(ifname, lat);
+    for (stage = 0; stage < STPD_LAT_STAGES; stage++)
+    {
+        hist = &lat->stage[stage];
+        if (!hist->count)
+            continue;
+
+        STP_DUMP("\n%s histogram\n", g_stpd_lat_stage_name[stage]);
+        stpd_hist_dump_buckets(hist);
+    }
+}
@@ -0,0 +1,497 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "stp_inc.h"
+
+/*
+ * Sharded PVST.
+ *
+ * Optional (see STPD_SHARD_FLAG). The event loop thread remains the only
+ * one reading sockets, handling ipc and netlink and sending frames. It
+ * hands the per class work of a timer tick and of received BPDUs to a pool
+ * of workers in fork-join phases (stp_shard_run()) and takes part as
+ * worker 0, so nothing else runs while a phase is in progress.
+ *
+ * Within a phase a class is touched by one worker only: the timer tick
+ * splits the classes of its tick group by STP_INDEX, received BPDUs are
+ * queued to the worker of the vlan of the class processing them. State the
+ * state machines share is handled as follows:
+ *   bpdu encoding : each worker encodes into its own copy of the bpdu
+ *                   templates (g_stp_bpdu_bufs)
+ *   bpdu tx       : stp_shard_tx() batches the frames of each worker, they
+ *                   are sent through stp_pkt_tx_handler() after the join
+ *   db sync       : the modified fields of the classes are synced by the
+ *                   event loop thread after the join. the port state,
+ *                   fast aging and hello slot updates made inline take the
+ *                   sync lock (stp_shard_sync_lock())
+ *   port state    : bpdus that change the state of a port (bpdu guard,
+ *                   protect, port fast) are processed by the event loop
+ *                   thread, not queued
+ *   drop counters : atomic (STP_DROP_COUNT_INC())
+ *
+ * Workers sleep on a futex between phases, a phase costs a wakeup per
+ * worker and one for the join.
+ */
+
+#define STPD_SHARD_PKT_LEN      128     //pvst and 802.1d bpdus, longer frames are processed inline
+
+typedef struct
+{
+    uint32_t port_id;
+    VLAN_ID  vlan_id;
+    uint16_t len;
+    char     bytes[STPD_SHARD_PKT_LEN];
+}STPD_SHARD_RX_DESC;
+
+typedef struct
+{
+    uint32_t port_id;
+    VLAN_ID  vlan_id;
+    uint16_t size;
+    bool     tagged;
+    char     buf[STPD_TX_FRAME_LEN];
+}STPD_SHARD_TX_FRAME;
+
+typedef struct
+{
+    pthread_t           thread;
+    STP_BPDU_BUFS       bpdu_bufs;
+    STPD_SHARD_RX_DESC  *rx;            //filled by the event loop thread between phases
+    uint32_t            rx_count;
+    STPD_SHARD_TX_FRAME *tx;            //filled by the worker during a phase
+    uint32_t            tx_count;
+    uint32_t            tx_size;
+    uint64_t            phase_busy_usec;
+    uint64_t            busy_usec;
+    uint64_t            rx_frames;
+    uint64_t            tx_frames;
+}__attribute__((aligned(64))) STPD_SHARD_WORKER;
+
+typedef struct
+{
+    bool                active;
+    uint32_t            workers;
+    uint32_t            gen __attribute__((aligned(64)));      //futex, advanced to start a phase
+    uint32_t            pending __attribute__((aligned(64)));  //futex, workers still in the phase
+    STPD_SHARD_FN       *fn;
+    void                *arg;
+    pthread_mutex_t     sync_lock;
+    struct event        *rx_ev;         //processes the queued bpdus
+    uint32_t            rx_queued;
+    uint64_t            phases;
+    uint64_t            phase_usec;
+    uint64_t            crit_usec;
+    uint64_t            rx_inline;
+    uint64_t            rx_full;
+    STPD_SHARD_WORKER   worker[STPD_SHARD_MAX];
+}STPD_SHARD;
+
+static STPD_SHARD g_stpd_shard;
+//worker of the calling thread while it runs a phase, NULL otherwise
+static __thread STPD_SHARD_WORKER *g_stpd_shard_self;
+
+static uint64_t stp_shard_usec(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static void stp_shard_futex_wait(uint32_t *addr, uint32_t val)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void stp_shard_futex_wake(uint32_t *addr, int count)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+static void stp_shard_work(uint32_t shard)
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+    STPD_SHARD_WORKER *w = &sh->worker[shard];
+    uint64_t start = stp_shard_usec(CLOCK_THREAD_CPUTIME_ID);
+
+    g_stpd_shard_self = w;
+    g_stp_bpdu_bufs = &w->bpdu_bufs;
+    sh->fn(shard, sh->workers, sh->arg);
+    g_stp_bpdu_bufs = &stp_global.bpdu_bufs;
+    g_stpd_shard_self = NULL;
+
+    w->phase_busy_usec = stp_shard_usec(CLOCK_THREAD_CPUTIME_ID) - start;
+}
+
+static void *stp_shard_main(void *arg)
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+    uint32_t shard = (uint32_t)(uintptr_t)arg;
+    uint32_t gen = 0;
+
+    for (;;)
+    {
+        while (__atomic_load_n(&sh->gen, __ATOMIC_ACQUIRE) == gen)
+            stp_shard_futex_wait(&sh->gen, gen);
+        gen = __atomic_load_n(&sh->gen, __ATOMIC_ACQUIRE);
+
+        stp_shard_work(shard);
+
+        if (0 == __atomic_sub_fetch(&sh->pending, 1, __ATOMIC_ACQ_REL))
+            stp_shard_futex_wake(&sh->pending, 1);
+    }
+
+    return NULL;
+}
+
+/* sends the frames batched by the workers, in worker order */
+static void stp_shard_tx_flush()
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+    STPD_SHARD_WORKER *w;
+    STPD_SHARD_TX_FRAME *frame;
+    uint32_t i, j;
+
+    for (i = 0; i < sh->workers; i++)
+    {
+        w = &sh->worker[i];
+        for (j = 0; j < w->tx_count; j++)
+        {
+            frame = &w->tx[j];
+            if (-1 == stp_pkt_tx_handler(frame->port_id, frame->vlan_id, frame->buf, frame->size, frame->tagged))
+                STP_LOG_ERR("Send BPDU Failed Vlan %u Port %u", frame->vlan_id, frame->port_id);
+        }
+        w->tx_frames += w->tx_count;
+        w->tx_count = 0;
+    }
+}
+
+/* FUNCTION
+ *		stp_shard_run()
+ *
+ * SYNOPSIS
+ *		runs fn once for every worker, on all workers at once, and returns
+ *		when they are all done. fn runs directly when sharding is off.
+ */
+void stp_shard_run(STPD_SHARD_FN *fn, void *arg)
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+    uint64_t start, crit = 0;
+    uint32_t i, pending;
+
+    if (!sh->active)
+    {
+        fn(0, 1, arg);
+        return;
+    }
+
+    start = stp_shard_usec(CLOCK_MONOTONIC);
+    for (i = 0; i < sh->workers; i++)
+        memcpy(&sh->worker[i].bpdu_bufs, &stp_global.bpdu_bufs, sizeof(STP_BPDU_BUFS));
+
+    sh->fn = fn;
+    sh->arg = arg;
+    __atomic_store_n(&sh->pending, sh->workers - 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&sh->gen, 1, __ATOMIC_RELEASE);
+    stp_shard_futex_wake(&sh->gen, INT_MAX);
+
+    stp_shard_work(0);
+
+    while ((pending = __atomic_load_n(&sh->pending, __ATOMIC_ACQUIRE)) != 0)
+        stp_shard_futex_wait(&sh->pending, pending);
+
+    sh->phases++;
+    sh->phase_usec += stp_shard_usec(CLOCK_MONOTONIC) - start;
+    for (i = 0; i < sh->workers; i++)
+    {
+        sh->worker[i].busy_usec += sh->worker[i].phase_busy_usec;
+        if (sh->worker[i].phase_busy_usec > crit)
+            crit = sh->worker[i].phase_busy_usec;
+    }
+    sh->crit_usec += crit;
+
+    stp_shard_tx_flush();
+}
+
+bool stp_shard_enabled()
+{
+    return g_stpd_shard.active;
+}
+
+/* FUNCTION
+ *		stp_shard_sync_lock()
+ *
+ * SYNOPSIS
+ *		serializes the updates of shared state (stpsync, kernel bridge,
+ *		hello slots) made by the state machines while a phase runs. no-op
+ *		outside of a phase.
+ */
+void stp_shard_sync_lock()
+{
+    if (g_stpd_shard_self)
+        pthread_mutex_lock(&g_stpd_shard.sync_lock);
+}
+
+void stp_shard_sync_unlock()
+{
+    if (g_stpd_shard_self)
+        pthread_mutex_unlock(&g_stpd_shard.sync_lock);
+}
+
+static bool stp_shard_tx_grow(STPD_SHARD_WORKER *w)
+{
+    STPD_SHARD_TX_FRAME *tx;
+    uint32_t size = w->tx_size ? (w->tx_size * 2) : STPD_SHARD_TX_BATCH;
+
+    tx = (STPD_SHARD_TX_FRAME *)realloc(w->tx, size * sizeof(STPD_SHARD_TX_FRAME));
+    if (!tx)
+        return false;
+
+    w->tx = tx;
+    w->tx_size = size;
+    return true;
+}
+
+/* FUNCTION
+ *		stp_shard_tx()
+ *
+ * SYNOPSIS
+ *		transmits a bpdu, same arguments and return as stp_pkt_tx_handler().
+ *		during a phase the frame is copied to the batch of the worker.
+ */
+int stp_shard_tx(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
+{
+    STPD_SHARD_WORKER *w = g_stpd_shard_self;
+    STPD_SHARD_TX_FRAME *frame;
+    int ret;
+
+    if (!w)
+        return stp_pkt_tx_handler(port_id, vlan_id, buffer, size, tagged);
+
+    if (size > STPD_TX_FRAME_LEN || (w->tx_count == w->tx_size && !stp_shard_tx_grow(w)))
+    {
+        //the pacer is only entered under the lock while a phase runs
+        pthread_mutex_lock(&g_stpd_shard.sync_lock);
+        ret = stp_pkt_tx_handler(port_id, vlan_id, buffer, size, tagged);
+        pthread_mutex_unlock(&g_stpd_shard.sync_lock);
+        return ret;
+    }
+
+    frame = &w->tx[w->tx_count++];
+    frame->port_id = port_id;
+    frame->vlan_id = vlan_id;
+    frame->size = size;
+    frame->tagged = tagged;
+    memcpy(frame->buf, buffer, size);
+    return size;
+}
+
+static void stp_shard_rx_fn(uint32_t shard, uint32_t shards, void *arg)
+{
+    STPD_SHARD_WORKER *w = &g_stpd_shard.worker[shard];
+    STPD_SHARD_RX_DESC *desc;
+    uint32_t i;
+
+    for (i = 0; i < w->rx_count; i++)
+    {
+        desc = &w->rx[i];
+        stpmgr_process_rx_bpdu(desc->vlan_id, desc->port_id, (unsigned char *)desc->bytes);
+    }
+
+    w->rx_frames += w->rx_count;
+    w->rx_count = 0;
+}
+
+/* FUNCTION
+ *		stp_shard_rx_flush()
+ *
+ * SYNOPSIS
+ *		processes the queued bpdus. called before anything else may look
+ *		at the classes: the timer tick and ipc messages.
+ */
+void stp_shard_rx_flush()
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+
+    if (!sh->rx_queued)
+        return;
+
+    sh->rx_queued = 0;
+    stp_shard_run(stp_shard_rx_fn, NULL);
+}
+
+static void stp_shard_rx_handler(evutil_socket_t fd, short what, void *arg)
+{
+    stp_shard_rx_flush();
+}
+
+/* FUNCTION
+ *		stp_shard_rx()
+ *
+ * SYNOPSIS
+ *		queues a received pvst mode bpdu (the frame as passed to
+ *		stpmgr_process_rx_bpdu()) to the worker of its vlan. returns false
+ *		if the caller is to process it inline.
+ */
+bool stp_shard_rx(uint32_t port_id, VLAN_ID vlan_id, char *pkt, ssize_t packet_len)
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+    STPD_SHARD_WORKER *w;
+    STPD_SHARD_RX_DESC *desc;
+    VLAN_ID class_vlan = vlan_id;
+
+    if (!sh->active)
+        return false;
+
+    //bpdu guard, protect and the first bpdu on a port fast port change port state, not class state
+    if (packet_len < 2 || packet_len > STPD_SHARD_PKT_LEN || !IS_VALID_VLAN(vlan_id) ||
+            STP_IS_PROTECT_CONFIGURED(port_id) || STP_IS_PROTECT_DO_DISABLE_CONFIGURED(port_id) ||
+            STP_IS_FASTSPAN_ENABLED(port_id))
+    {
+        sh->rx_inline++;
+        return false;
+    }
+
+    //untagged 802.1d bpdus are processed by the class of vlan 1, see stpmgr_rx_stp_bpdu()
+    if ((unsigned char)pkt[1] == 0x80 && stputil_is_port_untag(vlan_id, port_id))
+        class_vlan = 1;
+
+    //hashed, the vlans of the hellos of a tick tend to be evenly spaced
+    w = &sh->worker[((class_vlan * 0x9e3779b1u) >> 16) % sh->workers];
+    if (w->rx_count == STPD_SHARD_RX_BATCH)
+    {
+        sh->rx_full++;
+        stp_shard_rx_flush();
+    }
+
+    desc = &w->rx[w->rx_count++];
+    desc->port_id = port_id;
+    desc->vlan_id = vlan_id;
+    desc->len = (uint16_t)packet_len;
+    memcpy(desc->bytes, pkt, packet_len);
+    //the protocol code expects a zero filled frame buffer, as on the direct path
+    memset(desc->bytes + packet_len, 0, STPD_SHARD_PKT_LEN - packet_len);
+
+    if (sh->rx_queued++ == 0 && sh->rx_ev)
+        event_active(sh->rx_ev, EV_TIMEOUT, 0);
+
+    return true;
+}
+
+/* FUNCTION
+ *		stp_shard_init()
+ *
+ * SYNOPSIS
+ *		starts workers - 1 worker threads, the calling (event loop) thread
+ *		is worker 0. the bpdus queued by stp_shard_rx() are processed from
+ *		the event loop when there is one (g_stpd_evbase).
+ */
+int stp_shard_init(uint32_t workers)
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+    uint32_t i;
+
+    if (sh->active || workers < 2 || workers > STPD_SHARD_MAX)
+    {
+        STP_LOG_ERR("shard init : invalid worker count %u, 2 to %u", workers, STPD_SHARD_MAX);
+        return -1;
+    }
+
+    memset(sh, 0, sizeof(STPD_SHARD));
+    pthread_mutex_init(&sh->sync_lock, NULL);
+    sh->workers = workers;
+
+    for (i = 0; i < workers; i++)
+    {
+        sh->worker[i].rx = (STPD_SHARD_RX_DESC *)calloc(STPD_SHARD_RX_BATCH, sizeof(STPD_SHARD_RX_DESC));
+        if (!sh->worker[i].rx || !stp_shard_tx_grow(&sh->worker[i]))
+        {
+            STP_LOG_ERR("shard init : batch alloc failed");
+            goto fail;
+        }
+    }
+
+    if (g_stpd_evbase)
+    {
+        sh->rx_ev = stpmgr_libevent_create(g_stpd_evbase, -1, 0, stp_shard_rx_handler, NULL, NULL, "SHARD_RX");
+        if (!sh->rx_ev)
+        {
+            STP_LOG_ERR("shard init : rx event create failed");
+            goto fail;
+        }
+    }
+
+    //worker threads are never stopped, the pool lives as long as stpd
+    for (i = 1; i < workers; i++)
+    {
+        if (0 != pthread_create(&sh->worker[i].thread, NULL, stp_shard_main, (void *)(uintptr_t)i))
+        {
+            STP_LOG_ERR("shard init : thread create failed");
+            sh->workers = i;
+            break;
+        }
+    }
+
+    sh->active = (sh->workers > 1);
+    STP_LOG_INFO("sharded pvst running, %u workers", sh->workers);
+    return sh->active ? 0 : -1;
+
+fail:
+    if (sh->rx_ev)
+        stpmgr_libevent_destroy(sh->rx_ev);
+    for (i = 0; i < workers; i++)
+    {
+        free(sh->worker[i].rx);
+        free(sh->worker[i].tx);
+    }
+    memset(sh, 0, sizeof(STPD_SHARD));
+    return -1;
+}
+
+void stp_shard_get_stats(STPD_SHARD_STATS *stats)
+{
+    STPD_SHARD *sh = &g_stpd_shard;
+    uint32_t i;
+
+    memset(stats, 0, sizeof(STPD_SHARD_STATS));
+    if (!sh->active)
+        return;
+
+    stats->workers = sh->workers;
+    stats->phases = sh->phases;
+    stats->phase_usec = sh->phase_usec;
+    stats->crit_usec = sh->crit_usec;
+    stats->rx_inline = sh->rx_inline;
+    stats->rx_full = sh->rx_full;
+    for (i = 0; i < sh->workers; i++)
+    {
+        stats->busy_usec[i] = sh->worker[i].busy_usec;
+        stats->rx_frames[i] = sh->worker[i].rx_frames;
+        stats->tx_frames[i] = sh->worker[i].tx_frames;
+    }
+}
+
+void stp_shard_dump_stats()
+{
+    STPD_SHARD_STATS stats;
+    uint32_t i;
+
+    stp_shard_get_stats(&stats);
+    if (!stats.workers)
+        return;
+
+    STP_DUMP("Shard   : workers %u phases %" PRIu64 " phase-usec %" PRIu64 " crit-usec %" PRIu64
+            " rx-inline %" PRIu64 " rx-full %" PRIu64 "\n",
+            stats.workers, stats.phases, stats.phase_usec, stats.crit_usec,
+            stats.rx_inline, stats.rx_full);
+    for (i = 0; i < stats.workers; i++)
+    {
+        STP_DUMP("  %u     : busy-usec %" PRIu64 " rx %" PRIu64 " tx %" PRIu64 "\n",
+                i, stats.busy_usec[i], stats.rx_frames[i], stats.tx_frames[i]);
+    }
+}
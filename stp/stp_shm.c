@@ -0,0 +1,245 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include "stp_inc.h"
+#include "stp_shm.h"
+
+/*
+ * Publisher of the live counter segment (include/stp_shm.h). The segment is
+ * created once the ports are known and rewritten from the 100ms tick every
+ * STP_SHM_PUBLISH_TICKS, readers never interact with the event loop.
+ */
+
+static STP_SHM_HDR *g_stp_shm;
+static uint32_t g_stp_shm_ticks;
+static bool g_stp_shm_failed;
+
+static uint32_t stp_shm_max_instances()
+{
+    uint32_t count = MSTP_MAX_INSTANCES_PER_REGION + 1;
+
+    return (stp_global.max_instances > count) ? stp_global.max_instances : count;
+}
+
+static int stp_shm_create()
+{
+    uint32_t port_offset, inst_offset, size;
+    int fd;
+
+    port_offset = (sizeof(STP_SHM_HDR) + 63) & ~63;
+    inst_offset = port_offset + (g_max_stp_port * sizeof(STP_SHM_PORT));
+    size = inst_offset + (stp_shm_max_instances() * sizeof(STP_SHM_INSTANCE));
+
+    //a segment left by a previous stpd may have another layout
+    shm_unlink(STP_SHM_NAME);
+    fd = shm_open(STP_SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        STP_LOG_ERR("shm_open %s failed, errno %d", STP_SHM_NAME, errno);
+        return -1;
+    }
+
+    if (ftruncate(fd, size) < 0)
+    {
+        STP_LOG_ERR("ftruncate %s failed, errno %d", STP_SHM_NAME, errno);
+        close(fd);
+        shm_unlink(STP_SHM_NAME);
+        return -1;
+    }
+
+    g_stp_shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (g_stp_shm == MAP_FAILED)
+    {
+        STP_LOG_ERR("mmap %s failed, errno %d", STP_SHM_NAME, errno);
+        g_stp_shm = NULL;
+        shm_unlink(STP_SHM_NAME);
+        return -1;
+    }
+
+    g_stp_shm->hdr_size = sizeof(STP_SHM_HDR);
+    g_stp_shm->pid = getpid();
+    g_stp_shm->size = size;
+    g_stp_shm->port_offset = port_offset;
+    g_stp_shm->port_size = sizeof(STP_SHM_PORT);
+    g_stp_shm->port_count = g_max_stp_port;
+    g_stp_shm->inst_offset = inst_offset;
+    g_stp_shm->inst_size = sizeof(STP_SHM_INSTANCE);
+    g_stp_shm->version = STP_SHM_VERSION;
+    //readers check the magic first
+    __atomic_store_n(&g_stp_shm->magic, STP_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    STP_LOG_INFO("live counters published in /dev/shm%s, %u bytes", STP_SHM_NAME, size);
+    return 0;
+}
+
+static void stp_shm_fill_ports()
+{
+    struct avl_traverser trav;
+    INTERFACE_NODE *node;
+    STPD_INTF_STATS *stats;
+    STP_SHM_PORT *rec;
+    MSTP_PORT *mstp_port;
+    uint32_t port_id;
+
+    for (port_id = 0; port_id < g_max_stp_port; port_id++)
+    {
+        rec = STP_SHM_PORT_REC(g_stp_shm, port_id);
+        stats = g_stpd_intf_stats[port_id];
+
+        rec->ifname[0] = '\0';
+        rec->pkt_rx = stats->pkt_rx;
+        rec->pkt_tx = stats->pkt_tx;
+        rec->pkt_rx_err = stats->pkt_rx_err;
+        rec->pkt_rx_err_trunc = stats->pkt_rx_err_trunc;
+        rec->pkt_tx_err = stats->pkt_tx_err;
+        rec->pkt_tx_queued = stats->pkt_tx_queued;
+        rec->pkt_tx_drop = stats->pkt_tx_drop;
+
+        mstp_port = STP_IS_PROTOCOL_ENABLED(L2_MSTP) ? mstpdata_get_port(port_id) : NULL;
+        if (mstp_port)
+        {
+            rec->mstp_rx[0] = mstp_port->stats.rx.mstp_bpdu;
+            rec->mstp_rx[1] = mstp_port->stats.rx.rstp_bpdu;
+            rec->mstp_rx[2] = mstp_port->stats.rx.config_bpdu;
+            rec->mstp_rx[3] = mstp_port->stats.rx.tcn_bpdu;
+            rec->mstp_tx[0] = mstp_port->stats.tx.mstp_bpdu;
+            rec->mstp_tx[1] = mstp_port->stats.tx.rstp_bpdu;
+            rec->mstp_tx[2] = mstp_port->stats.tx.config_bpdu;
+            rec->mstp_tx[3] = mstp_port->stats.tx.tcn_bpdu;
+        }
+        else
+        {
+            memset(rec->mstp_rx, 0, sizeof(rec->mstp_rx));
+            memset(rec->mstp_tx, 0, sizeof(rec->mstp_tx));
+        }
+    }
+
+    //one pass over the interface db rather than a lookup per port
+    avl_t_init(&trav, g_stpd_intf_db);
+    while (NULL != (node = avl_t_next(&trav)))
+    {
+        if (node->port_id < g_max_stp_port)
+        {
+            rec = STP_SHM_PORT_REC(g_stp_shm, node->port_id);
+            strncpy(rec->ifname, node->ifname, STP_SHM_IFNAME_LEN - 1);
+            rec->ifname[STP_SHM_IFNAME_LEN - 1] = '\0';
+        }
+    }
+}
+
+static uint16_t stp_shm_fill_pvst()
+{
+    STP_CLASS *stp_class;
+    STP_SHM_INSTANCE *rec;
+    uint16_t count = 0;
+    uint32_t i;
+
+    for (i = 0; i < stp_global.max_instances && count < stp_shm_max_instances(); i++)
+    {
+        stp_class = GET_STP_CLASS(i);
+        if (stp_class->state == STP_CLASS_FREE)
+            continue;
+
+        rec = STP_SHM_INST_REC(g_stp_shm, count++);
+        rec->id = stp_class->vlan_id;
+        rec->active = (stp_class->state == STP_CLASS_ACTIVE);
+        rec->topology_change = stp_class->bridge_info.topology_change;
+        rec->root_port = stp_class->bridge_info.root_port;
+        rec->spare = 0;
+        rec->root_path_cost = stp_class->bridge_info.root_path_cost;
+        rec->topology_change_count = stp_class->bridge_info.topology_change_count;
+        rec->rx_drop_bpdu = stp_class->rx_drop_bpdu;
+    }
+
+    return count;
+}
+
+static void stp_shm_fill_mstp_rec(STP_SHM_INSTANCE *rec, MSTP_COMMON_BRIDGE *co, uint32_t root_path_cost)
+{
+    memset(rec, 0, sizeof(STP_SHM_INSTANCE));
+    rec->id = co->mstid;
+    rec->active = co->active;
+    rec->root_port = co->rootPortId;
+    rec->root_path_cost = root_path_cost;
+}
+
+static uint16_t stp_shm_fill_mstp()
+{
+    MSTP_BRIDGE *mstp_bridge = mstpdata_get_bridge();
+    MSTP_MSTI_BRIDGE *msti_bridge;
+    uint16_t count = 0;
+    MSTP_INDEX index;
+
+    if (!mstp_bridge)
+        return 0;
+
+    stp_shm_fill_mstp_rec(STP_SHM_INST_REC(g_stp_shm, count++), &mstp_bridge->cist.co,
+            mstp_bridge->cist.rootPriority.extPathCost);
+
+    for (index = 0; index < MSTP_MAX_INSTANCES_PER_REGION; index++)
+    {
+        msti_bridge = mstp_bridge->msti[index];
+        if (msti_bridge)
+            stp_shm_fill_mstp_rec(STP_SHM_INST_REC(g_stp_shm, count++), &msti_bridge->co,
+                    msti_bridge->rootPriority.intPathCost);
+    }
+
+    return count;
+}
+
+/* FUNCTION
+ *		stp_shm_publish()
+ *
+ * SYNOPSIS
+ *		called from the 100ms tick, rewrites the live counter segment every
+ *		STP_SHM_PUBLISH_TICKS under its seqlock.
+ */
+void stp_shm_publish()
+{
+    struct timespec ts;
+    uint32_t seq;
+    uint16_t inst_count = 0;
+
+    if (++g_stp_shm_ticks < STP_SHM_PUBLISH_TICKS)
+        return;
+    g_stp_shm_ticks = 0;
+
+    //ports not yet known
+    if (!g_stpd_intf_stats || g_stp_shm_failed)
+        return;
+
+    if (!g_stp_shm && stp_shm_create() < 0)
+    {
+        g_stp_shm_failed = true;
+        return;
+    }
+
+    seq = g_stp_shm->seq;
+    __atomic_store_n(&g_stp_shm->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    g_stp_shm->update_usec = ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+    g_stp_shm->publish_count++;
+    g_stp_shm->proto_mode = stp_global.proto_mode;
+    g_stp_shm->enable = stp_global.enable;
+    g_stp_shm->active_instances = stp_global.active_instances;
+    g_stp_shm->stp_drop_count = stp_global.stp_drop_count;
+    g_stp_shm->tcn_drop_count = stp_global.tcn_drop_count;
+    g_stp_shm->pvst_drop_count = stp_global.pvst_drop_count;
+
+    stp_shm_fill_ports();
+
+    if (STP_IS_PROTOCOL_ENABLED(L2_PVSTP))
+        inst_count = stp_shm_fill_pvst();
+    else if (STP_IS_PROTOCOL_ENABLED(L2_MSTP))
+        inst_count = stp_shm_fill_mstp();
+    g_stp_shm->inst_count = inst_count;
+
+    __atomic_store_n(&g_stp_shm->seq, seq + 2, __ATOMIC_RELEASE);
+}
@@ -70,12 +70,204 @@ bool get_timer_value(TIMER *timer, UINT32 *value_in_ticks)
 	return true;
 }
 
+static const char *g_stpd_tick_phase_name[STPD_TICK_PHASES] = { "timers", "tx", "sync-db", "bpdu-sync", "total" };
+
+uint64_t stptimer_prof_usec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/*
+ * clock of the tick phases: bpdu transmission is timed as a phase of its
+ * own wherever the tick sends, it does not count in the phase it runs from.
+ */
+uint64_t stptimer_prof_self_usec()
+{
+    return stptimer_prof_usec() - g_stpd_tick_stats.usec[STPD_TICK_TX];
+}
+
+/* FUNCTION
+ *		stptimer_prof_begin()
+ *
+ * SYNOPSIS
+ *		starts the accounting of a 100ms tick. the protocol tick routines
+ *		add the time of their phases and of the instances / ports that
+ *		used the most of it, stptimer_prof_end() checks the total against
+ *		the overrun threshold.
+ */
+void stptimer_prof_begin()
+{
+    STPD_TICK_STATS *tick = &g_stpd_tick_stats;
+
+    memset(tick->usec, 0, sizeof(tick->usec));
+    tick->top_count = 0;
+    tick->active = true;
+    tick->start_usec = stptimer_prof_usec();
+}
+
+void stptimer_prof_add(STPD_TICK_PHASE phase, uint64_t usec)
+{
+    if (g_stpd_tick_stats.active)
+        g_stpd_tick_stats.usec[phase] += usec;
+}
+
+//returns the start time to pass to stptimer_prof_stop(), 0 outside of a tick
+uint64_t stptimer_prof_start()
+{
+    return g_stpd_tick_stats.active ? stptimer_prof_usec() : 0;
+}
+
+void stptimer_prof_stop(STPD_TICK_PHASE phase, uint64_t start_usec)
+{
+    if (start_usec)
+        stptimer_prof_add(phase, stptimer_prof_usec() - start_usec);
+}
+
+//keeps the STPD_TICK_TOP_MAX most expensive instances / ports of the tick
+void stptimer_prof_top(bool is_port, uint16_t id, uint64_t usec)
+{
+    STPD_TICK_STATS *tick = &g_stpd_tick_stats;
+    int i;
+
+    if (!usec)
+        return;
+
+    if (tick->top_count == STPD_TICK_TOP_MAX)
+    {
+        if (usec <= tick->top[STPD_TICK_TOP_MAX - 1].usec)
+            return;
+        tick->top_count--;
+    }
+
+    for (i = tick->top_count; i > 0 && tick->top[i - 1].usec < usec; i--)
+        tick->top[i] = tick->top[i - 1];
+
+    tick->top[i].is_port = is_port;
+    tick->top[i].id = id;
+    tick->top[i].usec = (usec > UINT32_MAX) ? UINT32_MAX : usec;
+    tick->top_count++;
+}
+
+static int stptimer_prof_top_str(char *buf, int len, STPD_TICK_TOP *top, uint8_t count)
+{
+    int i, n = 0;
+
+    for (i = 0; i < count && n < len; i++)
+    {
+        if (top[i].is_port)
+            n += snprintf(buf + n, len - n, " %s:%u", stp_intf_get_port_name(top[i].id), top[i].usec);
+        else
+            n += snprintf(buf + n, len - n, " %s%u:%u", STP_IS_PROTOCOL_ENABLED(L2_MSTP) ? "MST" : "Vlan",
+                    top[i].id, top[i].usec);
+    }
+
+    return n;
+}
+
+void stptimer_prof_end()
+{
+    STPD_TICK_STATS *tick = &g_stpd_tick_stats;
+    char top_str[256] = "";
+    uint32_t now_sec;
+    int i;
+
+    if (!tick->active)
+        return;
+
+    tick->active = false;
+    tick->usec[STPD_TICK_TOTAL] = stptimer_prof_usec() - tick->start_usec;
+
+    for (i = 0; i < STPD_TICK_PHASES; i++)
+        stpd_hist_add(&tick->phase[i], tick->usec[i]);
+
+    if (!tick->overrun_msec || tick->usec[STPD_TICK_TOTAL] < (uint64_t)tick->overrun_msec * 1000)
+        return;
+
+    tick->overruns++;
+    memcpy(tick->last_overrun_usec, tick->usec, sizeof(tick->usec));
+    memcpy(tick->last_overrun_top, tick->top, sizeof(tick->top));
+    tick->last_overrun_top_count = tick->top_count;
+
+    now_sec = sys_get_seconds();
+    if (tick->last_log_sec && (now_sec - tick->last_log_sec) < STPD_TICK_OVERRUN_LOG_SEC)
+    {
+        tick->overruns_unlogged++;
+        return;
+    }
+
+    stptimer_prof_top_str(top_str, sizeof(top_str), tick->top, tick->top_count);
+    STP_LOG_WARNING("tick overrun %" PRIu64 " us (timers %" PRIu64 " tx %" PRIu64 " sync-db %" PRIu64
+            " bpdu-sync %" PRIu64 ") top usec:%s, %u more overruns since last report",
+            tick->usec[STPD_TICK_TOTAL], tick->usec[STPD_TICK_TIMERS], tick->usec[STPD_TICK_TX],
+            tick->usec[STPD_TICK_SYNC_DB], tick->usec[STPD_TICK_BPDU_SYNC], top_str,
+            tick->overruns_unlogged);
+    tick->overruns_unlogged = 0;
+    tick->last_log_sec = now_sec;
+}
+
+void stptimer_prof_set_overrun(uint32_t msec)
+{
+    g_stpd_tick_stats.overrun_msec = msec;
+}
+
+void stptimer_prof_clear()
+{
+    STPD_TICK_STATS *tick = &g_stpd_tick_stats;
+
+    memset(tick->phase, 0, sizeof(tick->phase));
+    tick->overruns = 0;
+    tick->overruns_unlogged = 0;
+    tick->last_overrun_top_count = 0;
+    memset(tick->last_overrun_usec, 0, sizeof(tick->last_overrun_usec));
+}
+
+void stptimer_prof_dump()
+{
+    STPD_TICK_STATS *tick = &g_stpd_tick_stats;
+    char top_str[256] = "";
+    int i;
+
+    STP_DUMP("\n100ms tick (usec), overrun threshold %u ms, overruns %" PRIu64 "\n",
+            tick->overrun_msec, tick->overruns);
+    STP_DUMP("%-10s %10s %8s %8s %8s %8s\n", "Phase", "Ticks", "Avg", "P50", "P99", "Max");
+    for (i = 0; i < STPD_TICK_PHASES; i++)
+    {
+        if (!tick->phase[i].count)
+            continue;
+
+        STP_DUMP("%-10s %10" PRIu64 " %8" PRIu64 " %8u %8u %8u\n", g_stpd_tick_phase_name[i],
+                tick->phase[i].count, tick->phase[i].sum / tick->phase[i].count,
+                stpd_hist_percentile(&tick->phase[i], 50), stpd_hist_percentile(&tick->phase[i], 99),
+                tick->phase[i].max);
+    }
+
+    if (tick->overruns)
+    {
+        stptimer_prof_top_str(top_str, sizeof(top_str), tick->last_overrun_top, tick->last_overrun_top_count);
+        STP_DUMP("Last overrun : total %" PRIu64 " timers %" PRIu64 " tx %" PRIu64 " sync-db %" PRIu64
+                " bpdu-sync %" PRIu64 "\n", tick->last_overrun_usec[STPD_TICK_TOTAL],
+                tick->last_overrun_usec[STPD_TICK_TIMERS], tick->last_overrun_usec[STPD_TICK_TX],
+                tick->last_overrun_usec[STPD_TICK_SYNC_DB], tick->last_overrun_usec[STPD_TICK_BPDU_SYNC]);
+        STP_DUMP("  top usec :%s\n", top_str);
+    }
+}
+
 void stptimer_100ms_tick(evutil_socket_t fd, short what, void *arg)
 {
     int ret;
 
     g_stpd_stats_libev_timer++;
 
+    //bpdus queued to sharded workers were received before this tick
+    stp_shard_rx_flush();
+
+    stptimer_prof_begin();
+
+    stpmgr_config_txn_tick();
+
     if (STP_IS_PROTOCOL_ENABLED(L2_PVSTP))
     {
         stptimer_tick();
@@ -84,4 +276,8 @@ void stptimer_100ms_tick(evutil_socket_t fd, short what, void *arg)
     {
         mstputil_timer_tick();
     }
+
+    stp_shm_publish();
+
+    stptimer_prof_end();
 }
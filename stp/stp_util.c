@@ -124,7 +124,9 @@ void stputil_set_vlan_topo_change(STP_CLASS *stp_class)
 	if (stp_class->bridge_info.topology_change == stp_class->fast_aging)
 		return;
 
+    stp_shard_sync_lock();
     stpsync_update_fastage_state(stp_class->vlan_id, stp_class->bridge_info.topology_change);
+    stp_shard_sync_unlock();
 	stp_class->fast_aging = stp_class->bridge_info.topology_change;
 }
 
@@ -185,8 +187,15 @@ bool stputil_set_kernel_bridge_port_state(STP_CLASS * stp_class, STP_PORT_CLASS
  */
 bool stputil_set_port_state(STP_CLASS * stp_class, STP_PORT_CLASS * stp_port_class)
 {
+    uint64_t start_ns;
+
+    stp_shard_sync_lock();
+    start_ns = stp_rxlat_program_start();
+    STP_TRACE_PORT_STATE(GET_STP_INDEX(stp_class), stp_class->vlan_id, stp_port_class->port_id.number, stp_port_class->state);
     stputil_set_kernel_bridge_port_state(stp_class, stp_port_class);
     stpsync_update_port_state(GET_STP_PORT_IFNAME(stp_port_class), GET_STP_INDEX(stp_class), stp_port_class->state);
+    stp_rxlat_program_end(start_ns);
+    stp_shard_sync_unlock();
     return true;
 }
 
@@ -273,19 +282,7 @@ bool stputil_get_index_from_vlan(VLAN_ID vlan_id, STP_INDEX *stp_index)
  */
 enum SORT_RETURN stputil_compare_mac(MAC_ADDRESS *mac1, MAC_ADDRESS *mac2)
 {
-
-    if (mac1->_ulong > mac2->_ulong)
-        return (GREATER_THAN);
-
-    if(mac1->_ulong == mac2->_ulong)
-    {
-        if(mac1->_ushort > mac2->_ushort)
-            return (GREATER_THAN);
-        if(mac1->_ushort == mac2->_ushort)
-            return (EQUAL_TO);
-    }
-
-    return (LESS_THAN);
+	return STP_SORT(STP_MAC_KEY(mac1), STP_MAC_KEY(mac2));
 }
 
 /* FUNCTION
@@ -297,18 +294,12 @@ enum SORT_RETURN stputil_compare_mac(MAC_ADDRESS *mac1, MAC_ADDRESS *mac2)
  */
 enum SORT_RETURN stputil_compare_bridge_id(BRIDGE_IDENTIFIER *id1, BRIDGE_IDENTIFIER *id2)
 {
-	UINT16 priority1, priority2;
-
-	priority1 = stputil_get_bridge_priority(id1);
-	priority2 = stputil_get_bridge_priority(id2);
-
-	if (priority1 > priority2)
-		return (GREATER_THAN);
+	uint64_t key1, key2;
 
-	if (priority1 < priority2)
-		return (LESS_THAN);
+	key1 = STP_BRIDGE_KEY(stputil_get_bridge_priority(id1), &id1->address);
+	key2 = STP_BRIDGE_KEY(stputil_get_bridge_priority(id2), &id2->address);
 
-	return stputil_compare_mac(&id1->address, &id2->address);
+	return STP_SORT(key1, key2);
 }
 
 /* FUNCTION
@@ -322,13 +313,272 @@ enum SORT_RETURN stputil_compare_port_id(PORT_IDENTIFIER *port_id1, PORT_IDENTIF
 	UINT16 port1 = *((UINT16 *) port_id1);
 	UINT16 port2 = *((UINT16 *) port_id2);
 
-	if (port1 > port2)
-		return (GREATER_THAN);
+	return STP_SORT(port1, port2);
+}
 
-	if (port1 < port2)
+/* root port selection ------------------------------------------------------ */
+
+/* FUNCTION
+ *		stputil_compare_root_candidate()
+ *
+ * SYNOPSIS
+ *		compares two root port candidates on designated root, root path cost,
+ *		designated bridge, designated port and port id (8.6.8.3). returns
+ *		LESS_THAN if port1 is the better candidate.
+ */
+enum SORT_RETURN stputil_compare_root_candidate(STP_CLASS *stp_class, PORT_ID port1, PORT_ID port2)
+{
+	enum SORT_RETURN result;
+	STP_PORT_CLASS *p1, *p2;
+	UINT32 cost1, cost2;
+
+	p1 = GET_STP_PORT_CLASS(stp_class, port1);
+	p2 = GET_STP_PORT_CLASS(stp_class, port2);
+
+	result = stputil_compare_bridge_id(&p1->designated_root, &p2->designated_root);
+	if (result != EQUAL_TO)
+		return result;
+
+	cost1 = p1->path_cost + p1->designated_cost;
+	cost2 = p2->path_cost + p2->designated_cost;
+	if (cost1 < cost2)
 		return (LESS_THAN);
+	if (cost1 > cost2)
+		return (GREATER_THAN);
+
+	result = stputil_compare_bridge_id(&p1->designated_bridge, &p2->designated_bridge);
+	if (result != EQUAL_TO)
+		return result;
+
+	result = stputil_compare_port_id(&p1->designated_port, &p2->designated_port);
+	if (result != EQUAL_TO)
+		return result;
+
+	return stputil_compare_port_id(&p1->port_id, &p2->port_id);
+}
+
+/* FUNCTION
+ *		stputil_is_root_candidate()
+ *
+ * SYNOPSIS
+ *		returns true if the port can be selected as the root port, i.e. it
+ *		is enabled, not looped back, not designated and has received a root
+ *		better than this bridge.
+ */
+static bool stputil_is_root_candidate(STP_CLASS *stp_class, PORT_ID port_number)
+{
+	STP_PORT_CLASS *stp_port_class;
+
+	if (!is_member(stp_class->enable_mask, port_number))
+		return false;
+
+	stp_port_class = GET_STP_PORT_CLASS(stp_class, port_number);
+
+	// do not service ports that are on token-ring cabling or backup ports
+	if (stp_port_class->self_loop)
+		return false;
+
+	return (!designated_port(stp_class, port_number) &&
+		stputil_compare_bridge_id(&stp_port_class->designated_root,
+			&stp_class->bridge_info.bridge_id) == LESS_THAN);
+}
+
+static UINT16 stputil_root_tree_winner(STP_CLASS *stp_class, UINT16 port1, UINT16 port2)
+{
+	if (port2 == STP_INVALID_PORT)
+		return port1;
+	if (port1 == STP_INVALID_PORT)
+		return port2;
+
+	// ties go to the left (lower numbered) port, as in a linear scan
+	if (stputil_compare_root_candidate(stp_class, port2, port1) == LESS_THAN)
+		return port2;
+	return port1;
+}
+
+/* FUNCTION
+ *		stputil_root_tree_build()
+ *
+ * SYNOPSIS
+ *		builds the root selection tree of the stp class from scratch.
+ *		returns false if the tree could not be allocated.
+ */
+static bool stputil_root_tree_build(STP_CLASS *stp_class)
+{
+	STP_ROOT_TREE *tree = stp_class->root_tree;
+	UINT32 size, i;
+
+	if (tree == NULL)
+	{
+		tree = (STP_ROOT_TREE *) calloc(1, sizeof(STP_ROOT_TREE));
+		if (tree == NULL)
+			return false;
+		stp_class->root_tree = tree;
+	}
+
+	for (size = 1; size < g_max_stp_port; size <<= 1);
+
+	if (tree->node == NULL || tree->size != size)
+	{
+		free(tree->node);
+		tree->size = 0;
+		tree->node = (UINT16 *) malloc(2 * size * sizeof(UINT16));
+		if (tree->node == NULL)
+		{
+			STP_LOG_ERR("root tree alloc failed vlan %u size %u", stp_class->vlan_id, size);
+			return false;
+		}
+		tree->size = size;
+	}
+
+	for (i = 0; i < size; i++)
+	{
+		tree->node[size + i] = (i < g_max_stp_port && stputil_is_root_candidate(stp_class, i)) ?
+			i : STP_INVALID_PORT;
+	}
+
+	for (i = size - 1; i > 0; i--)
+		tree->node[i] = stputil_root_tree_winner(stp_class, tree->node[2 * i], tree->node[2 * i + 1]);
+
+	tree->valid = true;
+	tree->changed_count = 0;
+	return true;
+}
+
+/* FUNCTION
+ *		stputil_root_tree_update()
+ *
+ * SYNOPSIS
+ *		called whenever an input of root selection changes for a single port
+ *		(designated information, self loop, path cost, port id, enable mask).
+ *		replays the matches on the path from the port's leaf to the top.
+ */
+void stputil_root_tree_update(STP_CLASS *stp_class, PORT_ID port_number)
+{
+	STP_ROOT_TREE *tree = stp_class->root_tree;
+	UINT32 i;
+
+	if (tree == NULL)
+		return;
+
+	if (tree->changed_count == 0)
+	{
+		tree->changed_port = port_number;
+		tree->changed_count = 1;
+	}
+	else if (tree->changed_port != port_number)
+	{
+		tree->changed_count = 2;
+	}
+
+	if (!tree->valid)
+		return;
+
+	if (port_number >= tree->size)
+	{
+		tree->valid = false;
+		return;
+	}
+
+	i = tree->size + port_number;
+	tree->node[i] = stputil_is_root_candidate(stp_class, port_number) ?
+		port_number : STP_INVALID_PORT;
+
+	for (i >>= 1; i > 0; i >>= 1)
+		tree->node[i] = stputil_root_tree_winner(stp_class, tree->node[2 * i], tree->node[2 * i + 1]);
+}
+
+/* FUNCTION
+ *		stputil_root_tree_invalidate()
+ *
+ * SYNOPSIS
+ *		forces a rebuild of the root selection tree on the next root
+ *		selection. used when an input common to all ports (bridge id)
+ *		changes.
+ */
+void stputil_root_tree_invalidate(STP_CLASS *stp_class)
+{
+	if (stp_class->root_tree)
+		stp_class->root_tree->valid = false;
+}
+
+/* FUNCTION
+ *		stputil_root_tree_free()
+ *
+ * SYNOPSIS
+ *		releases the root selection tree of the stp class.
+ */
+void stputil_root_tree_free(STP_CLASS *stp_class)
+{
+	if (stp_class->root_tree == NULL)
+		return;
 
-	return (EQUAL_TO);
+	free(stp_class->root_tree->node);
+	free(stp_class->root_tree);
+	stp_class->root_tree = NULL;
+}
+
+/* FUNCTION
+ *		stputil_get_root_port()
+ *
+ * SYNOPSIS
+ *		returns the best root port candidate of the stp class or
+ *		STP_INVALID_PORT. rebuilds the root selection tree if needed and
+ *		falls back to a linear scan if it cannot be allocated.
+ */
+PORT_ID stputil_get_root_port(STP_CLASS *stp_class)
+{
+	PORT_ID port_number, root_port;
+
+	if ((stp_class->root_tree && stp_class->root_tree->valid) ||
+		stputil_root_tree_build(stp_class))
+	{
+		return stp_class->root_tree->node[1];
+	}
+
+	root_port = STP_INVALID_PORT;
+	for (
+		port_number = port_mask_get_first_port(stp_class->enable_mask);
+		port_number != BAD_PORT_ID;
+		port_number = port_mask_get_next_port(stp_class->enable_mask, port_number)
+		)
+	{
+		if (stputil_is_root_candidate(stp_class, port_number))
+			root_port = stputil_root_tree_winner(stp_class, root_port, port_number);
+	}
+
+	return root_port;
+}
+
+/* FUNCTION
+ *		stputil_root_tree_incremental()
+ *
+ * SYNOPSIS
+ *		returns true if the tree is valid and at most one port has changed
+ *		since the last configuration update. *port_number is set to the
+ *		changed port or STP_INVALID_PORT.
+ */
+bool stputil_root_tree_incremental(STP_CLASS *stp_class, PORT_ID *port_number)
+{
+	STP_ROOT_TREE *tree = stp_class->root_tree;
+
+	if (tree == NULL || !tree->valid || tree->changed_count > 1)
+		return false;
+
+	*port_number = (tree->changed_count == 1) ? tree->changed_port : STP_INVALID_PORT;
+	return true;
+}
+
+/* FUNCTION
+ *		stputil_root_tree_clear_changes()
+ *
+ * SYNOPSIS
+ *		called at the end of a configuration update.
+ */
+void stputil_root_tree_clear_changes(STP_CLASS *stp_class)
+{
+	if (stp_class->root_tree)
+		stp_class->root_tree->changed_count = 0;
 }
 
 /* extended and legacy mode functions --------------------------------------- */
@@ -672,7 +922,7 @@ void stputil_send_bpdu(STP_CLASS* stp_class, PORT_ID port_number, enum STP_BPDU_
         return;
     }
 
-	if (-1 == stp_pkt_tx_handler(port_number, vlan_id, (void*) bpdu, bpdu_size, false))
+	if (-1 == stp_shard_tx(port_number, vlan_id, (void*) bpdu, bpdu_size, false))
     {
         //Handle send err
         STP_LOG_ERR("Send STP-BPDU Failed");
@@ -734,7 +984,7 @@ void stputil_send_pvst_bpdu(STP_CLASS* stp_class, PORT_ID port_number, enum STP_
 
     untagged = stputil_is_port_untag(vlan_id, port_number);
 
-	if (-1 == stp_pkt_tx_handler(port_number, vlan_id, (void*) bpdu, bpdu_size, !untagged))
+	if (-1 == stp_shard_tx(port_number, vlan_id, (void*) bpdu, bpdu_size, !untagged))
     {
         //Handle send err
         STP_LOG_ERR("Send PVST-BPDU Failed Vlan %u Port %u", vlan_id, port_number);
@@ -971,6 +1221,7 @@ void stptimer_sync_port_class(STP_CLASS *stp_class, STP_PORT_CLASS * stp_port)
     }
 
     stp_port->modified_fields = 0;
+    STP_TRACE_DB_SYNC(GET_STP_INDEX(stp_class), stp_class->vlan_id, stp_port->port_id.number);
     stpsync_update_port_class(&stp_vlan_intf);
 }
 
@@ -1088,6 +1339,7 @@ void stptimer_sync_stp_class(STP_CLASS *stp_class)
     stp_class->modified_fields = 0;
     stp_class->bridge_info.modified_fields = 0;
 
+    STP_TRACE_DB_SYNC(GET_STP_INDEX(stp_class), stp_class->vlan_id, STP_TRACE_NO_PORT);
     stpsync_update_stp_class(&stp_vlan_table);
 }
 
@@ -1147,6 +1399,36 @@ void stptimer_sync_bpdu_counters(STP_CLASS * stp_class)
 
 /* STP TIMER ROUTINES ------------------------------------------------------- */
 
+/* set while stptimer_tick() services the classes of group g_stp_tick_id */
+static bool stptimer_ticking = false;
+
+/* FUNCTION
+ *		stptimer_shard_update()
+ *
+ * SYNOPSIS
+ *		the part of worker shard of the timer updates of stptimer_tick():
+ *		the shard-th of shards consecutive runs of the classes of group
+ *		g_stp_tick_id. not interleaved, consecutive classes of a group
+ *		take turns in the hello slots.
+ */
+static void stptimer_shard_update(uint32_t shard, uint32_t shards, void *arg)
+{
+	STP_CLASS *stp_class;
+	UINT32 i, count, first, last;
+
+	count = (g_stp_instances > g_stp_tick_id) ?
+		((g_stp_instances - g_stp_tick_id + STP_TICK_GROUPS - 1) / STP_TICK_GROUPS) : 0;
+	first = (count * shard) / shards;
+	last = (count * (shard + 1)) / shards;
+
+	for (i = g_stp_tick_id + (first * STP_TICK_GROUPS); i < g_stp_tick_id + (last * STP_TICK_GROUPS); i += STP_TICK_GROUPS)
+	{
+		stp_class = GET_STP_CLASS(i);
+		if (stp_class->state == STP_CLASS_ACTIVE)
+			stptimer_update(stp_class);
+	}
+}
+
 /* FUNCTION
  *		stptimer_tick()
  *
@@ -1166,28 +1448,56 @@ void stptimer_sync_bpdu_counters(STP_CLASS * stp_class)
  *		      3                3,8,13 ...
  *		      4                4,9,14 ...
  *
+ *		Within a group, root bridge classes are spread over the hello slots
+ *		of the hello interval (see stptimer_start_hello()) so that their
+ *		hellos are not all generated in the same tick.
+ *
+ *		In sharded mode (stp_shard.c) the timers of the group are updated by
+ *		the workers first, the APP DB is then synced here.
  */
 void stptimer_tick()
 {
 	STP_CLASS *stp_class;
 	UINT16 i, start_instance;
+	uint64_t start, updated, done;
+	bool sharded = stp_shard_enabled();
 
 	// handle stp timer
 	if (g_stp_active_instances)
 	{
-		for (i = g_stp_tick_id; i < g_stp_instances; i+=5)
+		stptimer_ticking = true;
+		if (sharded)
+		{
+			start = stptimer_prof_self_usec();
+			stp_shard_run(stptimer_shard_update, NULL);
+			stptimer_prof_add(STPD_TICK_TIMERS, stptimer_prof_self_usec() - start);
+		}
+
+		for (i = g_stp_tick_id; i < g_stp_instances; i+=STP_TICK_GROUPS)
 		{
 			stp_class = GET_STP_CLASS(i);
 
-			if (stp_class->state == STP_CLASS_ACTIVE)
+			if (stp_class->state != STP_CLASS_ACTIVE && stp_class->state != STP_CLASS_CONFIG)
+				continue;
+
+			start = stptimer_prof_self_usec();
+			if (stp_class->state == STP_CLASS_ACTIVE && !sharded)
 				stptimer_update(stp_class);
+			updated = stptimer_prof_self_usec();
 
 			if (stp_class->state == STP_CLASS_ACTIVE || stp_class->state == STP_CLASS_CONFIG)
 				stptimer_sync_db(stp_class);
+			done = stptimer_prof_self_usec();
+
+			stptimer_prof_add(STPD_TICK_TIMERS, updated - start);
+			stptimer_prof_add(STPD_TICK_SYNC_DB, done - updated);
+			stptimer_prof_top(false, stp_class->vlan_id, done - start);
         }
+		stptimer_ticking = false;
 
         if(g_stp_bpdu_sync_tick_id % 10 == 0)
         {
+            start = stptimer_prof_self_usec();
             start_instance = g_stp_bpdu_sync_tick_id/10;
             for(i = start_instance; i < g_stp_instances; i+=10)
             {
@@ -1196,6 +1506,7 @@ void stptimer_tick()
                 if (stp_class->state == STP_CLASS_ACTIVE)
                     stptimer_sync_bpdu_counters(stp_class);
             }
+            stptimer_prof_add(STPD_TICK_BPDU_SYNC, stptimer_prof_self_usec() - start);
         }
 	}
 
@@ -1206,9 +1517,10 @@ void stptimer_tick()
     }
 
 	g_stp_tick_id++;
-	if (g_stp_tick_id >= 5)
+	if (g_stp_tick_id >= STP_TICK_GROUPS)
 	{
 		g_stp_tick_id = 0;
+		stp_global.hello_round++;
 	}
 }
 
@@ -1302,6 +1614,7 @@ void stptimer_update(STP_CLASS *stp_class)
 			(stp_port_class->root_protect_timer.active && !STP_IS_ROOT_PROTECT_CONFIGURED(port_number)))
 		{
 			stp_port_class->root_protect_timer.active = false;
+			STP_TRACE_TIMER_EXPIRY(GET_STP_INDEX(stp_class), stp_class->vlan_id, port_number, STP_TRACE_TIMER_ROOT_PROTECT);
 			stputil_root_protect_timer_expired(stp_class, port_number);	
 
             if (debugGlobal.stp.enabled)
@@ -1373,6 +1686,251 @@ bool stptimer_is_active(TIMER *timer)
     return (is_timer_active(timer));
 }
 
+/* FUNCTION
+ *		stptimer_hello_slots()
+ *
+ * SYNOPSIS
+ *		returns the number of hello slots for a hello interval of the input
+ *		class ticks. this is the largest divisor of the interval that does
+ *		not exceed the configured slot count, so a hello timer restarted
+ *		on expiry stays in its slot.
+ */
+static UINT8 stptimer_hello_slots(UINT32 interval)
+{
+	UINT32 slots;
+
+	slots = stp_global.hello_slots;
+	if (slots > interval)
+		slots = interval;
+	if (slots > STP_HELLO_MAX_SLOTS)
+		slots = STP_HELLO_MAX_SLOTS;
+
+	while (slots > 1 && (interval % slots) != 0)
+		slots--;
+
+	return slots;
+}
+
+/* FUNCTION
+ *		stptimer_hello_release()
+ *
+ * SYNOPSIS
+ *		removes the ports of the stp class from the load of its hello slot.
+ */
+static void stptimer_hello_release(STP_CLASS *stp_class)
+{
+	UINT32 *load;
+
+	if (!stp_class->hello_scheduled)
+		return;
+
+	load = &stp_global.hello_load[GET_STP_INDEX(stp_class) % STP_TICK_GROUPS][stp_class->hello_slot];
+	*load -= (*load < stp_class->hello_load) ? *load : stp_class->hello_load;
+
+	stp_class->hello_scheduled = false;
+	stp_class->hello_load = 0;
+}
+
+/* FUNCTION
+ *		stptimer_start_hello()
+ *
+ * SYNOPSIS
+ *		starts the hello timer of a class that has just become (or is
+ *		re-established as) the root bridge. the timer is started part way
+ *		into its interval so that it expires in the hello slot of the tick
+ *		group with the fewest transmitting ports. hello_timer_expiry()
+ *		restarts the timer from 0, which keeps the class in its slot.
+ *
+ *		the caller has already generated the first hello, so the offset
+ *		only brings the second hello forward, by less than the interval.
+ *		the hold timer still limits the rate per port. among equally
+ *		loaded slots, the one closest to a full interval is used.
+ */
+void stptimer_start_hello(STP_CLASS *stp_class)
+{
+	UINT32 interval, group, next_round, natural, count, best;
+	UINT32 *load;
+	UINT8 slots, slot, offset;
+	PORT_ID port_number;
+
+	// the slot loads are shared by the classes of all sharded workers
+	stp_shard_sync_lock();
+	stptimer_hello_release(stp_class);
+
+	interval = STP_SECONDS_TO_TICKS(stp_class->bridge_info.hello_time);
+	slots = stptimer_hello_slots(interval);
+	if (slots <= 1)
+	{
+		stp_shard_sync_unlock();
+		stptimer_start(&stp_class->hello_timer, 0);
+		return;
+	}
+
+	group = GET_STP_INDEX(stp_class) % STP_TICK_GROUPS;
+	load = stp_global.hello_load[group];
+
+	/*
+	 * the group is serviced next in the current round if stptimer_tick()
+	 * has not reached it yet. a timer started with value v expires on the
+	 * (interval - v)th service from then. a class started by its own
+	 * timer expiry is next serviced in the following round.
+	 */
+	next_round = stp_global.hello_round +
+		((group < g_stp_tick_id || (stptimer_ticking && group == g_stp_tick_id)) ? 1 : 0);
+	natural = (next_round + interval - 1) % slots;
+
+	offset = 0;
+	best = load[natural];
+	for (count = 1; count < slots && best; count++)
+	{
+		slot = (natural + slots - count) % slots;
+		if (load[slot] < best)
+		{
+			best = load[slot];
+			offset = count;
+		}
+	}
+	slot = (natural + slots - offset) % slots;
+
+	count = 0;
+	port_number = port_mask_get_first_port(stp_class->enable_mask);
+	while (port_number != BAD_PORT_ID)
+	{
+		count++;
+		port_number = port_mask_get_next_port(stp_class->enable_mask, port_number);
+	}
+
+	stp_class->hello_slot = slot;
+	stp_class->hello_load = (count > 1) ? count : 1;
+	stp_class->hello_scheduled = true;
+	load[slot] += stp_class->hello_load;
+	stp_shard_sync_unlock();
+
+	start_timer(&stp_class->hello_timer, offset);
+}
+
+/* FUNCTION
+ *		stptimer_stop_hello()
+ *
+ * SYNOPSIS
+ *		stops the hello timer of the stp class and releases its hello slot.
+ */
+void stptimer_stop_hello(STP_CLASS *stp_class)
+{
+	stp_shard_sync_lock();
+	stptimer_hello_release(stp_class);
+	stp_shard_sync_unlock();
+	stptimer_stop(&stp_class->hello_timer);
+}
+
+/* FUNCTION
+ *		stptimer_hello_port_update()
+ *
+ * SYNOPSIS
+ *		accounts a port enabled (add) or disabled in the stp class to the
+ *		load of the class's hello slot.
+ */
+void stptimer_hello_port_update(STP_CLASS *stp_class, bool add)
+{
+	UINT32 *load;
+
+	if (!stp_class->hello_scheduled)
+		return;
+
+	load = &stp_global.hello_load[GET_STP_INDEX(stp_class) % STP_TICK_GROUPS][stp_class->hello_slot];
+	if (add)
+	{
+		stp_class->hello_load++;
+		(*load)++;
+	}
+	else if (stp_class->hello_load > 1)
+	{
+		stp_class->hello_load--;
+		if (*load)
+			(*load)--;
+	}
+}
+
+/* FUNCTION
+ *		stptimer_set_hello_slots()
+ *
+ * SYNOPSIS
+ *		sets the number of hello slots per hello interval (0 or 1 sends
+ *		all hellos of a tick group together) and moves the running hello
+ *		timers to the slots of the new count.
+ */
+void stptimer_set_hello_slots(UINT8 slots)
+{
+	STP_CLASS *stp_class;
+	UINT16 i;
+
+	if (slots > STP_HELLO_MAX_SLOTS)
+		slots = STP_HELLO_MAX_SLOTS;
+
+	if (slots == stp_global.hello_slots)
+		return;
+
+	stp_global.hello_slots = slots;
+	STP_LOG_INFO("hello slots set to %u", slots);
+
+	if (!stp_global.class_array)
+		return;
+
+	for (i = 0; i < stp_global.max_instances; i++)
+	{
+		stp_class = GET_STP_CLASS(i);
+		if (stp_class->state == STP_CLASS_FREE || !is_timer_active(&stp_class->hello_timer))
+			continue;
+
+		stptimer_start_hello(stp_class);
+	}
+}
+
+/* FUNCTION
+ *		stputil_mask_to_list()
+ *
+ * SYNOPSIS
+ *		writes every set bit of the mask as a decimal number followed by
+ *		the separator. runs of set bits are located a word at a time and
+ *		digits are emitted directly, as this serializes full 4K vlan
+ *		masks on every MSTI sync.
+ */
+static int stputil_mask_to_list(BITMAP_T *bmp, uint8_t *str, uint32_t maxlen, char sep)
+{
+    BMP_ID bmp_id, run_end;
+    uint32_t len = 0;
+    char digits[12];
+    int n, val;
+
+    bmp_id = bmp_get_next_set_run(bmp, 0, &run_end);
+    while (bmp_id != BMP_INVALID_ID)
+    {
+        for (; bmp_id <= run_end; bmp_id++)
+        {
+            val = bmp_id;
+            n = 0;
+            do {
+                digits[n++] = '0' + (val % 10);
+                val /= 10;
+            } while (val);
+
+            if (len + n + 1 >= maxlen)
+            {
+                str[len] = '\0';
+                return -1;
+            }
+
+            while (n)
+                str[len++] = digits[--n];
+            str[len++] = sep;
+        }
+        bmp_id = bmp_get_next_set_run(bmp, run_end + 1, &run_end);
+    }
+    str[len] = '\0';
+
+    return len;
+}
+
 int mask_to_string(BITMAP_T *bmp, uint8_t *str, uint32_t maxlen)
 {
     if (!bmp || !bmp->arr || (maxlen < 5) || !str)
@@ -1389,20 +1947,7 @@ int mask_to_string(BITMAP_T *bmp, uint8_t *str, uint32_t maxlen)
         return -1;
     }
 
-    int32_t bmp_id = BMP_INVALID_ID;
-    uint32_t len = 0;
-    do {
-        if (len >= maxlen)
-        {
-            return -1;
-        }
-
-        bmp_id = bmp_get_next_set_bit(bmp, bmp_id);
-        if (bmp_id != -1)
-            len += snprintf((char *)str+len, maxlen-len, "%d ", bmp_id);
-    }while(bmp_id != -1);
-
-    return len;
+    return stputil_mask_to_list(bmp, str, maxlen, ' ');
 }
 
 int mask_to_string2(BITMAP_T *bmp, uint8_t *str, uint32_t maxlen)
@@ -1421,20 +1966,7 @@ int mask_to_string2(BITMAP_T *bmp, uint8_t *str, uint32_t maxlen)
         return -1;
     }
 
-    int32_t bmp_id = BMP_INVALID_ID;
-    uint32_t len = 0;
-    do {
-        if (len >= maxlen)
-        {
-            return -1;
-        }
-
-        bmp_id = bmp_get_next_set_bit(bmp, bmp_id);
-        if (bmp_id != -1)
-            len += snprintf((char *)str+len, maxlen-len, "%d,", bmp_id);
-    }while(bmp_id != -1);
-
-    return len;
+    return stputil_mask_to_list(bmp, str, maxlen, ',');
 }
 
 void sys_assert(int status)
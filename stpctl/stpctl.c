@@ -34,6 +34,12 @@ CMD_LIST g_cmd_list[] = {
     "clrstsvlanintf", STP_CTL_CLEAR_VLAN_INTF,
     "mst",      STP_CTL_DUMP_MST,
     "mstport",  STP_CTL_DUMP_MST_PORT,
+    "mempool",  STP_CTL_DUMP_MEMPOOL_STATS,
+    "txrate",   STP_CTL_SET_TX_RATE,
+    "rxlat",    STP_CTL_DUMP_RX_LATENCY,
+    "tickovr",  STP_CTL_SET_TICK_OVERRUN,
+    "logmod",   STP_CTL_SET_LOG_MODULE,
+    "hellosl",  STP_CTL_SET_HELLO_SLOTS,
 };
 
 void print_cmds()
@@ -42,6 +48,7 @@ void print_cmds()
 
     for (i=0; i<cmd_max; i++)
         stpout("stpctl %s\n",g_cmd_list[i].cmd_name);
+    stpout("stpctl shm [ifname]\n");
 }
 
 
@@ -180,6 +187,119 @@ int send_command(int argc, char **argv)
             break;
         }
 
+        case STP_CTL_SET_TX_RATE:
+        {
+            /*
+             * stpctl txrate <frames per sec per port> [burst]
+             * rate 0 disables bpdu tx pacing
+             */
+            if ((argc < 3) || (argc > 4))
+            {
+                stpout("invalid number of args\n");
+                return -1;
+            }
+
+            msg.level = atoi(argv[2]);
+            msg.vlan_id = (argc == 4) ? atoi(argv[3]) : 0;
+            if ((msg.level < 0) || (msg.vlan_id < 0))
+            {
+                stpout("invalid rate or burst\n");
+                return -1;
+            }
+            break;
+        }
+
+        case STP_CTL_SET_TICK_OVERRUN:
+        {
+            /*
+             * stpctl tickovr <msec>
+             * 100ms ticks longer than msec are reported, 0 disables it
+             */
+            if (!(argc == 3))
+            {
+                stpout("invalid number of args\n");
+                return -1;
+            }
+
+            msg.level = atoi(argv[2]);
+            if (msg.level < 0)
+            {
+                stpout("invalid threshold\n");
+                return -1;
+            }
+            break;
+        }
+
+        case STP_CTL_SET_HELLO_SLOTS:
+        {
+            /*
+             * stpctl hellosl <slots>
+             * pvst hellos of a tick group are spread over this many class
+             * ticks of the hello interval, 0 or 1 sends them together
+             */
+            if (!(argc == 3))
+            {
+                stpout("invalid number of args\n");
+                return -1;
+            }
+
+            msg.level = atoi(argv[2]);
+            if ((msg.level < 0) || (msg.level > 255))
+            {
+                stpout("invalid slot count\n");
+                return -1;
+            }
+            break;
+        }
+
+        case STP_CTL_SET_LOG_MODULE:
+        {
+            /*
+             * stpctl logmod [<module|all> <on|off>]
+             * turns the info and debug logs of a module on or off
+             */
+            msg.intf_name[0] = '\0';
+            msg.level = -1;
+            if (argc == 4)
+            {
+                if (0 == strcmp(argv[3], "on"))
+                    msg.level = 1;
+                else if (0 == strcmp(argv[3], "off"))
+                    msg.level = 0;
+                else
+                {
+                    stpout("invalid state %s\n", argv[3]);
+                    return -1;
+                }
+                strncpy(msg.intf_name, argv[2], IFNAMSIZ - 1);
+                msg.intf_name[IFNAMSIZ - 1] = '\0';
+            }
+            else if (argc != 2)
+            {
+                stpout("invalid number of args\n");
+                return -1;
+            }
+            break;
+        }
+
+        case STP_CTL_DUMP_RX_LATENCY:
+        {
+            /* stpctl rxlat [ifname] */
+            if ((argc < 2) || (argc > 3))
+            {
+                stpout("invalid number of args\n");
+                return -1;
+            }
+
+            msg.intf_name[0] = '\0';
+            if (argc == 3)
+            {
+                strncpy(msg.intf_name, argv[2], IFNAMSIZ - 1);
+                msg.intf_name[IFNAMSIZ - 1] = '\0';
+            }
+            break;
+        }
+
         case STP_CTL_DUMP_NL_DB:
         {
             /* No arg */
@@ -333,6 +453,7 @@ int send_command(int argc, char **argv)
         }
 
         case STP_CTL_DUMP_LIBEV_STATS:
+        case STP_CTL_DUMP_MEMPOOL_STATS:
         {
             /* No arg */
             if (!(argc == 2))
@@ -463,6 +584,85 @@ void display_resp()
         free(line);
 }
 
+static void display_shm_port(STP_SHM_PORT *port)
+{
+    stpout("%-16s %12lu %12lu %8lu %8lu %8lu %10lu %8lu\n", port->ifname,
+            (unsigned long)port->pkt_rx, (unsigned long)port->pkt_tx,
+            (unsigned long)port->pkt_rx_err, (unsigned long)port->pkt_rx_err_trunc,
+            (unsigned long)port->pkt_tx_err, (unsigned long)port->pkt_tx_queued,
+            (unsigned long)port->pkt_tx_drop);
+}
+
+/*
+ * reads the live counters stpd publishes in shared memory, works without
+ * the ipc socket and does not wake up stpd.
+ */
+int display_shm(int argc, char **argv)
+{
+    STP_SHM_READER reader;
+    STP_SHM_HDR *hdr;
+    STP_SHM_PORT *port;
+    STP_SHM_INSTANCE *inst;
+    char *ifname = (argc > 2) ? argv[2] : NULL;
+    int i;
+
+    if (stp_shm_open(&reader) < 0)
+    {
+        stpout("cannot open %s: %s\n", STP_SHM_NAME, strerror(errno));
+        return -1;
+    }
+
+    hdr = stp_shm_snapshot(&reader);
+    if (!hdr)
+    {
+        stpout("cannot read %s: %s\n", STP_SHM_NAME, strerror(errno));
+        stp_shm_close(&reader);
+        return -1;
+    }
+
+    stpout("stpd pid %u, update %lu.%06lu, count %u\n", hdr->pid,
+            (unsigned long)(hdr->update_usec / 1000000), (unsigned long)(hdr->update_usec % 1000000),
+            hdr->publish_count);
+    stpout("mode %s%s, active instances %u, drops stp %u tcn %u pvst %u\n\n",
+            (hdr->proto_mode == L2_PVSTP) ? "pvst" : (hdr->proto_mode == L2_MSTP) ? "mstp" : "none",
+            hdr->enable ? "" : " (disabled)", hdr->active_instances,
+            hdr->stp_drop_count, hdr->tcn_drop_count, hdr->pvst_drop_count);
+
+    stpout("%-16s %12s %12s %8s %8s %8s %10s %8s\n",
+            "Port", "Rx", "Tx", "RxErr", "RxTrunc", "TxErr", "TxQueued", "TxDrop");
+    for (i = 0; i < hdr->port_count; i++)
+    {
+        port = STP_SHM_PORT_REC(hdr, i);
+        if (!port->ifname[0] || (ifname && strcmp(ifname, port->ifname)))
+            continue;
+
+        if (!ifname && !port->pkt_rx && !port->pkt_tx)
+            continue;
+
+        display_shm_port(port);
+        if (hdr->proto_mode == L2_MSTP)
+            stpout("  mstp/rstp/config/tcn rx %u/%u/%u/%u tx %u/%u/%u/%u\n",
+                    port->mstp_rx[0], port->mstp_rx[1], port->mstp_rx[2], port->mstp_rx[3],
+                    port->mstp_tx[0], port->mstp_tx[1], port->mstp_tx[2], port->mstp_tx[3]);
+    }
+
+    if (!ifname)
+    {
+        stpout("\n%-8s %-8s %10s %12s %12s %10s\n",
+                (hdr->proto_mode == L2_MSTP) ? "Mst" : "Vlan", "State", "RootPort", "RootCost", "TcCount", "RxDrop");
+        for (i = 0; i < hdr->inst_count; i++)
+        {
+            inst = STP_SHM_INST_REC(hdr, i);
+            stpout("%-8u %-8s %10u %12u %12u %10u\n", inst->id,
+                    inst->active ? (inst->topology_change ? "tc" : "active") : "inactive",
+                    inst->root_port, inst->root_path_cost, inst->topology_change_count, inst->rx_drop_bpdu);
+        }
+    }
+
+    stp_shm_close(&reader);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     int ch;
@@ -479,6 +679,9 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    if (0 == strcmp("shm", argv[1]))
+        return display_shm(argc, argv);
+
     if (connect_server() != -1) 
     {
         if (send_command(argc, argv) != -1)
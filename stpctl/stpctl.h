@@ -22,6 +22,7 @@
 #include <sys/socket.h>
 #include <linux/if.h>
 #include "stp_ipc.h"
+#include "stp_shm.h"
 #include <stdint.h>
 #include <sys/un.h>
 #include <stddef.h>
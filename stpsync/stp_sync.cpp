@@ -157,6 +157,44 @@ extern "C" {
     {
         stpsync.updateBoundaryPort(ifName, enabled, proto);
     }
+
+    void stpsync_set_buffered(bool buffered)
+    {
+        stpsync.setBuffered(buffered);
+    }
+
+    void stpsync_flush(void)
+    {
+        stpsync.flush();
+    }
+}
+
+/* While a config transaction is open APP DB writes are queued in the
+ * producer pipelines and sent in one go on commit. */
+void StpSync::setBuffered(bool buffered)
+{
+    m_stpVlanTable.setBuffered(buffered);
+    m_stpVlanPortTable.setBuffered(buffered);
+    m_stpVlanInstanceTable.setBuffered(buffered);
+    m_stpPortTable.setBuffered(buffered);
+    m_stpPortStateTable.setBuffered(buffered);
+    m_stpMstTable.setBuffered(buffered);
+    m_stpMstPortTable.setBuffered(buffered);
+    m_stpFastAgeFlushTable.setBuffered(buffered);
+    m_stpInstancePortFlushTable.setBuffered(buffered);
+}
+
+void StpSync::flush()
+{
+    m_stpVlanTable.flush();
+    m_stpVlanPortTable.flush();
+    m_stpVlanInstanceTable.flush();
+    m_stpPortTable.flush();
+    m_stpPortStateTable.flush();
+    m_stpMstTable.flush();
+    m_stpMstPortTable.flush();
+    m_stpFastAgeFlushTable.flush();
+    m_stpInstancePortFlushTable.flush();
 }
 
 
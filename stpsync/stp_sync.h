@@ -51,6 +51,8 @@ namespace swss {
             void updateStpMstInterfaceInfo(STP_MST_PORT_TABLE * stp_mst_intf);
             void delStpMstInterfaceInfo(char * if_name, uint16_t mst_id);
             void updateBoundaryPort(char *if_name, bool enabled, char *proto);
+            void setBuffered(bool buffered);
+            void flush();
 
         protected:
         private:
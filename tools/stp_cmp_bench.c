@@ -0,0 +1,422 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <getopt.h>
+#include "stp_inc.h"
+
+/*
+ * Bridge id / priority vector comparator check and micro-benchmark.
+ *
+ * The field by field comparators that were replaced by the STP_SORT /
+ * STP_BRIDGE_KEY integer keys are kept below as the reference. The program
+ * first checks that the libstp.a comparators agree with them on random
+ * inputs, then times both over the same inputs.
+ *
+ * stp_cmp_bench [-n pairs] [-i passes] [-s seed]
+ */
+
+#define CMP_BENCH_DFLT_PAIRS    4096
+#define CMP_BENCH_DFLT_PASSES   2000
+#define CMP_BENCH_CHECK_PAIRS   1000000
+
+typedef struct
+{
+    MAC_ADDRESS mac[2];
+    BRIDGE_IDENTIFIER bridge[2];
+    PORT_IDENTIFIER port[2];
+    MSTP_BRIDGE_IDENTIFIER mstp_bridge[2];
+    MSTP_CIST_VECTOR cist[2];
+    MSTP_MSTI_VECTOR msti[2];
+} CMP_BENCH_PAIR;
+
+typedef struct
+{
+    const char *name;
+    SORT_RETURN (*old_fn)(CMP_BENCH_PAIR *pair);
+    SORT_RETURN (*new_fn)(CMP_BENCH_PAIR *pair);
+} CMP_BENCH_FN;
+
+/* reference comparators ---------------------------------------------------- */
+
+static __attribute__((noinline)) SORT_RETURN old_compare_mac(MAC_ADDRESS *mac1, MAC_ADDRESS *mac2)
+{
+    if (mac1->_ulong > mac2->_ulong)
+        return (GREATER_THAN);
+
+    if (mac1->_ulong == mac2->_ulong)
+    {
+        if (mac1->_ushort > mac2->_ushort)
+            return (GREATER_THAN);
+        if (mac1->_ushort == mac2->_ushort)
+            return (EQUAL_TO);
+    }
+
+    return (LESS_THAN);
+}
+
+static __attribute__((noinline)) SORT_RETURN old_compare_bridge_id(BRIDGE_IDENTIFIER *id1, BRIDGE_IDENTIFIER *id2)
+{
+    UINT16 priority1, priority2;
+
+    priority1 = stputil_get_bridge_priority(id1);
+    priority2 = stputil_get_bridge_priority(id2);
+
+    if (priority1 > priority2)
+        return (GREATER_THAN);
+
+    if (priority1 < priority2)
+        return (LESS_THAN);
+
+    return old_compare_mac(&id1->address, &id2->address);
+}
+
+static __attribute__((noinline)) SORT_RETURN old_compare_port_id(PORT_IDENTIFIER *port_id1, PORT_IDENTIFIER *port_id2)
+{
+    UINT16 port1 = *((UINT16 *) port_id1);
+    UINT16 port2 = *((UINT16 *) port_id2);
+
+    if (port1 > port2)
+        return (GREATER_THAN);
+
+    if (port1 < port2)
+        return (LESS_THAN);
+
+    return (EQUAL_TO);
+}
+
+static __attribute__((noinline)) SORT_RETURN old_mstp_compare_bridge_id(MSTP_BRIDGE_IDENTIFIER *id1, MSTP_BRIDGE_IDENTIFIER *id2)
+{
+    if (id1->priority > id2->priority)
+        return GREATER_THAN;
+
+    if (id1->priority < id2->priority)
+        return LESS_THAN;
+
+    return old_compare_mac(&id1->address, &id2->address);
+}
+
+static __attribute__((noinline)) SORT_RETURN old_mstp_compare_cist_bridge_id(MSTP_BRIDGE_IDENTIFIER *id1, MSTP_BRIDGE_IDENTIFIER *id2)
+{
+    if (id1->priority > id2->priority)
+        return GREATER_THAN;
+
+    if (id1->priority < id2->priority)
+        return LESS_THAN;
+
+    if (id1->system_id > id2->system_id)
+        return GREATER_THAN;
+
+    if (id1->system_id < id2->system_id)
+        return LESS_THAN;
+
+    return old_compare_mac(&id1->address, &id2->address);
+}
+
+static __attribute__((noinline)) SORT_RETURN old_mstp_compare_port_id(MSTP_PORT_IDENTIFIER *p1, MSTP_PORT_IDENTIFIER *p2)
+{
+    if (p1->priority > p2->priority)
+        return GREATER_THAN;
+    else
+    if (p1->priority < p2->priority)
+        return LESS_THAN;
+
+    if (p1->number > p2->number)
+        return GREATER_THAN;
+    else
+    if (p1->number < p2->number)
+        return LESS_THAN;
+
+    return EQUAL_TO;
+}
+
+static __attribute__((noinline)) SORT_RETURN old_mstp_compare_cist_vectors(MSTP_CIST_VECTOR *vec1, MSTP_CIST_VECTOR *vec2)
+{
+    SORT_RETURN val;
+
+    val = old_mstp_compare_cist_bridge_id(&(vec1->root), &(vec2->root));
+    if (val != EQUAL_TO)
+        return val;
+
+    if (vec1->extPathCost > vec2->extPathCost)
+        return GREATER_THAN;
+    else
+    if (vec1->extPathCost < vec2->extPathCost)
+        return LESS_THAN;
+
+    val = old_mstp_compare_cist_bridge_id(&(vec1->regionalRoot), &(vec2->regionalRoot));
+    if (val != EQUAL_TO)
+        return val;
+
+    if (vec1->intPathCost > vec2->intPathCost)
+        return GREATER_THAN;
+    else
+    if (vec1->intPathCost < vec2->intPathCost)
+        return LESS_THAN;
+
+    val = old_mstp_compare_cist_bridge_id(&(vec1->designatedId), &(vec2->designatedId));
+    if (val != EQUAL_TO)
+        return val;
+
+    return old_mstp_compare_port_id(&(vec1->designatedPort), &(vec2->designatedPort));
+}
+
+static __attribute__((noinline)) SORT_RETURN old_mstp_compare_msti_vectors(MSTP_MSTI_VECTOR *vec1, MSTP_MSTI_VECTOR *vec2)
+{
+    SORT_RETURN val;
+
+    val = old_mstp_compare_bridge_id(&(vec1->regionalRoot), &(vec2->regionalRoot));
+    if (val != EQUAL_TO)
+        return val;
+
+    if (vec1->intPathCost > vec2->intPathCost)
+        return GREATER_THAN;
+    else
+    if (vec1->intPathCost < vec2->intPathCost)
+        return LESS_THAN;
+
+    val = old_mstp_compare_bridge_id(&(vec1->designatedId), &(vec2->designatedId));
+    if (val != EQUAL_TO)
+        return val;
+
+    return old_mstp_compare_port_id(&(vec1->designatedPort), &(vec2->designatedPort));
+}
+
+/* pair adapters ------------------------------------------------------------ */
+
+#define CMP_BENCH_ADAPTER(_name_, _old_, _new_, _field_) \
+    static SORT_RETURN old_##_name_(CMP_BENCH_PAIR *p) { return _old_(&p->_field_[0], &p->_field_[1]); } \
+    static SORT_RETURN new_##_name_(CMP_BENCH_PAIR *p) { return _new_(&p->_field_[0], &p->_field_[1]); }
+
+CMP_BENCH_ADAPTER(mac, old_compare_mac, stputil_compare_mac, mac)
+CMP_BENCH_ADAPTER(bridge, old_compare_bridge_id, stputil_compare_bridge_id, bridge)
+CMP_BENCH_ADAPTER(port, old_compare_port_id, stputil_compare_port_id, port)
+CMP_BENCH_ADAPTER(mstp_bridge, old_mstp_compare_bridge_id, mstputil_compare_bridge_id, mstp_bridge)
+CMP_BENCH_ADAPTER(mstp_cist_bridge, old_mstp_compare_cist_bridge_id, mstputil_compare_cist_bridge_id, mstp_bridge)
+CMP_BENCH_ADAPTER(mstp_port, old_mstp_compare_port_id, mstputil_compare_port_id, port)
+CMP_BENCH_ADAPTER(cist, old_mstp_compare_cist_vectors, mstputil_compare_cist_vectors, cist)
+CMP_BENCH_ADAPTER(msti, old_mstp_compare_msti_vectors, mstputil_compare_msti_vectors, msti)
+
+#define CMP_BENCH_FN_ENTRY(_label_, _name_) { _label_, old_##_name_, new_##_name_ }
+
+static const CMP_BENCH_FN g_cmp_bench_fns[] = {
+    CMP_BENCH_FN_ENTRY("stputil_compare_mac", mac),
+    CMP_BENCH_FN_ENTRY("stputil_compare_bridge_id", bridge),
+    CMP_BENCH_FN_ENTRY("stputil_compare_port_id", port),
+    CMP_BENCH_FN_ENTRY("mstputil_compare_bridge_id", mstp_bridge),
+    CMP_BENCH_FN_ENTRY("mstputil_compare_cist_bridge_id", mstp_cist_bridge),
+    CMP_BENCH_FN_ENTRY("mstputil_compare_port_id", mstp_port),
+    CMP_BENCH_FN_ENTRY("mstputil_compare_cist_vectors", cist),
+    CMP_BENCH_FN_ENTRY("mstputil_compare_msti_vectors", msti),
+};
+
+#define CMP_BENCH_FN_COUNT (sizeof(g_cmp_bench_fns) / sizeof(g_cmp_bench_fns[0]))
+
+/* inputs ------------------------------------------------------------------- */
+
+/*
+ * Values are drawn from small pools so that a good share of the pairs tie on
+ * the leading fields and the later fields decide, as they do in a converged
+ * network where most vectors carry the same root.
+ */
+static uint32_t cmp_bench_pick(uint32_t pool_size)
+{
+    return random() % pool_size;
+}
+
+static void cmp_bench_fill_mac(MAC_ADDRESS *mac)
+{
+    static const uint32_t ulong_pool[] = { 0x00000000, 0x00e0ec00, 0x00e0ec01, 0xffffffff };
+    static const uint16_t ushort_pool[] = { 0x0000, 0x1234, 0x1235, 0xffff };
+
+    mac->_ulong = ulong_pool[cmp_bench_pick(4)];
+    mac->_ushort = ushort_pool[cmp_bench_pick(4)];
+}
+
+static void cmp_bench_fill_mstp_bridge(MSTP_BRIDGE_IDENTIFIER *id)
+{
+    id->priority = cmp_bench_pick(3) * 7;
+    id->system_id = cmp_bench_pick(3) * 0x7ff;
+    cmp_bench_fill_mac(&id->address);
+}
+
+static void cmp_bench_fill_port(PORT_IDENTIFIER *port)
+{
+    port->priority = cmp_bench_pick(3) * 7;
+    port->number = cmp_bench_pick(3) * 0x7ff;
+}
+
+static uint32_t cmp_bench_cost()
+{
+    static const uint32_t cost_pool[] = { 0, 2000, 20000, 0xffffffff };
+
+    return cost_pool[cmp_bench_pick(4)];
+}
+
+static void cmp_bench_fill_pair(CMP_BENCH_PAIR *pair)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        cmp_bench_fill_mac(&pair->mac[i]);
+
+        pair->bridge[i].priority = cmp_bench_pick(3) * 7;
+        pair->bridge[i].system_id = cmp_bench_pick(3) * 0x7ff;
+        cmp_bench_fill_mac(&pair->bridge[i].address);
+
+        cmp_bench_fill_port(&pair->port[i]);
+        cmp_bench_fill_mstp_bridge(&pair->mstp_bridge[i]);
+
+        cmp_bench_fill_mstp_bridge(&pair->cist[i].root);
+        pair->cist[i].extPathCost = cmp_bench_cost();
+        cmp_bench_fill_mstp_bridge(&pair->cist[i].regionalRoot);
+        pair->cist[i].intPathCost = cmp_bench_cost();
+        cmp_bench_fill_mstp_bridge(&pair->cist[i].designatedId);
+        cmp_bench_fill_port(&pair->cist[i].designatedPort);
+
+        cmp_bench_fill_mstp_bridge(&pair->msti[i].regionalRoot);
+        pair->msti[i].intPathCost = cmp_bench_cost();
+        cmp_bench_fill_mstp_bridge(&pair->msti[i].designatedId);
+        cmp_bench_fill_port(&pair->msti[i].designatedPort);
+    }
+
+    //the second half of every pair starts as a copy, so that ties happen on
+    //every field and not only on the leading ones
+    if (cmp_bench_pick(2))
+    {
+        pair->cist[1] = pair->cist[0];
+        pair->msti[1] = pair->msti[0];
+        pair->cist[1].designatedPort.number ^= cmp_bench_pick(2);
+        pair->msti[1].designatedPort.number ^= cmp_bench_pick(2);
+    }
+}
+
+/* check and benchmark ------------------------------------------------------ */
+
+static int cmp_bench_check(uint32_t count)
+{
+    CMP_BENCH_PAIR pair;
+    SORT_RETURN old_ret, new_ret;
+    uint32_t mismatches = 0;
+    uint32_t i, f;
+
+    for (i = 0; i < count; i++)
+    {
+        cmp_bench_fill_pair(&pair);
+        //bridge priority depends on the mode
+        g_stpd_extend_mode = (i & 1);
+
+        for (f = 0; f < CMP_BENCH_FN_COUNT; f++)
+        {
+            old_ret = g_cmp_bench_fns[f].old_fn(&pair);
+            new_ret = g_cmp_bench_fns[f].new_fn(&pair);
+            if (old_ret != new_ret)
+            {
+                if (mismatches++ < 10)
+                    printf("MISMATCH %s: old %d new %d (pair %u)\n", g_cmp_bench_fns[f].name,
+                            old_ret, new_ret, i);
+            }
+        }
+    }
+
+    printf("check: %u pairs x %zu comparators, %u mismatches\n", count, CMP_BENCH_FN_COUNT, mismatches);
+    return mismatches ? -1 : 0;
+}
+
+static uint64_t cmp_bench_nsec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static double cmp_bench_run(SORT_RETURN (*fn)(CMP_BENCH_PAIR *), CMP_BENCH_PAIR *pairs,
+        uint32_t count, uint32_t passes)
+{
+    volatile int sink = 0;
+    uint64_t start;
+    uint32_t i, p;
+    int sum = 0;
+
+    start = cmp_bench_nsec();
+    for (p = 0; p < passes; p++)
+    {
+        for (i = 0; i < count; i++)
+            sum += fn(&pairs[i]);
+    }
+    sink = sum;
+    (void)sink;
+
+    return (double)(cmp_bench_nsec() - start) / ((double)count * passes);
+}
+
+static void cmp_bench_usage(const char *prog)
+{
+    printf("usage: %s [-n pairs] [-i passes] [-s seed]\n", prog);
+    printf("  -n  random input pairs per pass (default %u)\n", CMP_BENCH_DFLT_PAIRS);
+    printf("  -i  passes over the pairs per comparator (default %u)\n", CMP_BENCH_DFLT_PASSES);
+    printf("  -s  random seed (default 1)\n");
+}
+
+int main(int argc, char **argv)
+{
+    CMP_BENCH_PAIR *pairs;
+    uint32_t count = CMP_BENCH_DFLT_PAIRS;
+    uint32_t passes = CMP_BENCH_DFLT_PASSES;
+    unsigned int seed = 1;
+    double old_ns, new_ns;
+    uint32_t i, f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:i:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'i': passes = strtoul(optarg, NULL, 0); break;
+            case 's': seed = strtoul(optarg, NULL, 0); break;
+            default:
+                cmp_bench_usage(argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if (!count || !passes)
+    {
+        cmp_bench_usage(argv[0]);
+        return 1;
+    }
+
+    STP_LOG_SET_LEVEL(APP_LOG_LEVEL_ERR);
+    srandom(seed);
+
+    if (cmp_bench_check(CMP_BENCH_CHECK_PAIRS) < 0)
+        return 1;
+
+    pairs = calloc(count, sizeof(CMP_BENCH_PAIR));
+    if (!pairs)
+    {
+        printf("calloc of %u pairs failed\n", count);
+        return 1;
+    }
+
+    for (i = 0; i < count; i++)
+        cmp_bench_fill_pair(&pairs[i]);
+    g_stpd_extend_mode = true;
+
+    printf("\n%u pairs x %u passes, ns per compare\n", count, passes);
+    printf("%-34s %8s %8s %8s\n", "Comparator", "Old", "New", "Speedup");
+    for (f = 0; f < CMP_BENCH_FN_COUNT; f++)
+    {
+        old_ns = cmp_bench_run(g_cmp_bench_fns[f].old_fn, pairs, count, passes);
+        new_ns = cmp_bench_run(g_cmp_bench_fns[f].new_fn, pairs, count, passes);
+        printf("%-34s %8.2f %8.2f %7.2fx\n", g_cmp_bench_fns[f].name, old_ns, new_ns,
+                new_ns > 0 ? old_ns / new_ns : 0);
+    }
+
+    free(pairs);
+    return 0;
+}
@@ -0,0 +1,523 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include "stp_tool.h"
+
+/*
+ * BPDU rx path benchmark.
+ *
+ * Replays the BPDUs of a pcap capture (tcpdump -w, or stp_sim -w) into one
+ * bridge (see stp_tool.h), through stp_pkt_rx_process() as the packet socket
+ * does, into stpmgr_process_rx_bpdu() or mstpmgr_rx_bpdu(). Every source mac
+ * of the capture is given its own port, the 802.1q tag is removed and its
+ * vlan configured, untagged frames are received on the -u vlan.
+ *
+ * Frames are replayed flat out, at a fixed rate or with the capture timing.
+ * The virtual clock follows the capture timestamps. Each frame is timed on
+ * its own, the report gives the rate and latency percentiles of the rx path
+ * and, per BPDU, the allocations from stpd code (-Wl,--wrap=malloc) and,
+ * with -c, the cache misses and instructions counted by perf_event_open().
+ */
+
+#define BENCH_NSEC_PER_SEC      1000000000ULL
+#define BENCH_TICK_NSEC         (BENCH_NSEC_PER_SEC / 10)
+#define BENCH_DFLT_PORTS_MAX    64
+#define BENCH_ETH_HDR_LEN       (2 * L2_ETH_ADD_LEN)
+#define BENCH_VLAN_TAG_LEN      4
+#define BENCH_ETHERTYPE_VLAN    0x8100
+#define BENCH_BPDU_VERSION_OFF  19      //DA SA length llc(3) protocol id(2)
+#define BENCH_BPDU_VERSION_MSTP 3
+#define BENCH_RATE_CAPTURE      (-1)
+
+typedef struct
+{
+    uint64_t ts_nsec;                   //from the start of the capture
+    uint16_t port;
+    VLAN_ID vlan;
+    uint16_t len;
+    char *data;
+} BENCH_FRAME;
+
+typedef struct
+{
+    uint64_t frames;
+    uint64_t skipped;
+    uint16_t ports;
+    uint16_t vlans;
+    bool mstp;
+} BENCH_CAPTURE;
+
+static BENCH_FRAME *g_bench_frames;
+static uint32_t g_bench_frame_count;
+static uint8_t g_bench_macs[STP_TOOL_MAX_PORTS][L2_ETH_ADD_LEN];
+static VLAN_ID g_bench_vlans[MAX_VLAN_ID];
+
+/* allocation count (-Wl,--wrap) -------------------------------------------- */
+
+static bool g_bench_alloc_active;
+static uint64_t g_bench_allocs;
+static uint64_t g_bench_alloc_bytes;
+
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t nmemb, size_t size);
+extern void *__real_realloc(void *ptr, size_t size);
+
+//only the calls made from the objects of libstp.a and libcommonstp.a
+void *__wrap_malloc(size_t size)
+{
+    if (g_bench_alloc_active)
+    {
+        g_bench_allocs++;
+        g_bench_alloc_bytes += size;
+    }
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    if (g_bench_alloc_active)
+    {
+        g_bench_allocs++;
+        g_bench_alloc_bytes += nmemb * size;
+    }
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (g_bench_alloc_active)
+    {
+        g_bench_allocs++;
+        g_bench_alloc_bytes += size;
+    }
+    return __real_realloc(ptr, size);
+}
+
+/* perf counters ------------------------------------------------------------ */
+
+enum
+{
+    BENCH_PERF_CACHE_MISSES,
+    BENCH_PERF_INSTRUCTIONS,
+    BENCH_PERF_MAX
+};
+
+static int g_bench_perf_fd[BENCH_PERF_MAX] = { -1, -1 };
+
+static int bench_perf_open(uint64_t config, int group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = (group_fd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static bool bench_perf_init()
+{
+    g_bench_perf_fd[BENCH_PERF_CACHE_MISSES] = bench_perf_open(PERF_COUNT_HW_CACHE_MISSES, -1);
+    if (g_bench_perf_fd[BENCH_PERF_CACHE_MISSES] < 0)
+    {
+        printf("perf counters unavailable: %s\n", strerror(errno));
+        return false;
+    }
+
+    g_bench_perf_fd[BENCH_PERF_INSTRUCTIONS] = bench_perf_open(PERF_COUNT_HW_INSTRUCTIONS,
+            g_bench_perf_fd[BENCH_PERF_CACHE_MISSES]);
+    if (g_bench_perf_fd[BENCH_PERF_INSTRUCTIONS] < 0)
+    {
+        printf("perf counters unavailable: %s\n", strerror(errno));
+        close(g_bench_perf_fd[BENCH_PERF_CACHE_MISSES]);
+        g_bench_perf_fd[BENCH_PERF_CACHE_MISSES] = -1;
+        return false;
+    }
+
+    ioctl(g_bench_perf_fd[BENCH_PERF_CACHE_MISSES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+static inline void bench_perf_enable(bool enable)
+{
+    if (g_bench_perf_fd[BENCH_PERF_CACHE_MISSES] >= 0)
+        ioctl(g_bench_perf_fd[BENCH_PERF_CACHE_MISSES],
+                enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static bool bench_perf_read(uint64_t *values)
+{
+    uint64_t buf[1 + BENCH_PERF_MAX];
+
+    if (g_bench_perf_fd[BENCH_PERF_CACHE_MISSES] < 0 ||
+            read(g_bench_perf_fd[BENCH_PERF_CACHE_MISSES], buf, sizeof(buf)) != sizeof(buf))
+        return false;
+
+    memcpy(values, &buf[1], BENCH_PERF_MAX * sizeof(uint64_t));
+    return true;
+}
+
+/* capture ------------------------------------------------------------------ */
+
+static uint64_t bench_now_nsec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * BENCH_NSEC_PER_SEC) + ts.tv_nsec;
+}
+
+static bool bench_is_bpdu(const uint8_t *pkt)
+{
+    static const uint8_t stp_da[L2_ETH_ADD_LEN] = { 0x01, 0x80, 0xc2, 0x00, 0x00, 0x00 };
+    static const uint8_t pvst_da[L2_ETH_ADD_LEN] = { 0x01, 0x00, 0x0c, 0xcc, 0xcc, 0xcd };
+
+    return (0 == memcmp(pkt, stp_da, L2_ETH_ADD_LEN)) || (0 == memcmp(pkt, pvst_da, L2_ETH_ADD_LEN));
+}
+
+//a port per source mac, shared once all ports are taken
+static uint16_t bench_get_port(BENCH_CAPTURE *capture, const uint8_t *mac, uint16_t max_ports)
+{
+    uint16_t i;
+
+    for (i = 0; i < capture->ports; i++)
+    {
+        if (0 == memcmp(g_bench_macs[i], mac, L2_ETH_ADD_LEN))
+            return i;
+    }
+
+    if (capture->ports == max_ports)
+        return mac[L2_ETH_ADD_LEN - 1] % max_ports;
+
+    memcpy(g_bench_macs[capture->ports], mac, L2_ETH_ADD_LEN);
+    return capture->ports++;
+}
+
+static bool bench_add_frame(BENCH_CAPTURE *capture, uint64_t ts_nsec, uint8_t *pkt, uint32_t len,
+        VLAN_ID untagged_vlan, uint16_t max_ports)
+{
+    BENCH_FRAME *frame;
+    VLAN_ID vlan = untagged_vlan;
+    uint16_t i;
+
+    if (len < BENCH_ETH_HDR_LEN + BENCH_VLAN_TAG_LEN || !bench_is_bpdu(pkt))
+        return false;
+
+    //the packet socket hands the vlan and the frame without its tag
+    if (((pkt[12] << 8) | pkt[13]) == BENCH_ETHERTYPE_VLAN)
+    {
+        vlan = ((pkt[14] << 8) | pkt[15]) & 0x0fff;
+        memmove(pkt + BENCH_ETH_HDR_LEN, pkt + BENCH_ETH_HDR_LEN + BENCH_VLAN_TAG_LEN,
+                len - BENCH_ETH_HDR_LEN - BENCH_VLAN_TAG_LEN);
+        len -= BENCH_VLAN_TAG_LEN;
+    }
+
+    if (len > STP_MAX_PKT_LEN || !IS_VALID_VLAN(vlan))
+        return false;
+
+    if (pkt[1] == 0x80 && len > BENCH_BPDU_VERSION_OFF && pkt[BENCH_BPDU_VERSION_OFF] == BENCH_BPDU_VERSION_MSTP)
+        capture->mstp = true;
+
+    for (i = 0; i < capture->vlans && g_bench_vlans[i] != vlan; i++)
+        ;
+    if (i == capture->vlans)
+        g_bench_vlans[capture->vlans++] = vlan;
+
+    frame = &g_bench_frames[g_bench_frame_count++];
+    frame->ts_nsec = ts_nsec;
+    frame->port = bench_get_port(capture, pkt + L2_ETH_ADD_LEN, max_ports);
+    frame->vlan = vlan;
+    frame->len = len;
+    frame->data = malloc(len);
+    if (!frame->data)
+        exit(1);
+    memcpy(frame->data, pkt, len);
+    return true;
+}
+
+static int bench_load(const char *path, BENCH_CAPTURE *capture, VLAN_ID untagged_vlan, uint16_t max_ports)
+{
+    STP_TOOL_PCAP_HDR hdr;
+    STP_TOOL_PCAP_REC rec;
+    uint64_t ts_nsec, first_nsec = 0;
+    uint32_t size = 0, frac_nsec;
+    uint8_t *pkt;
+    bool swap, nsec;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1)
+        goto invalid;
+
+    swap = (hdr.magic == __builtin_bswap32(STP_TOOL_PCAP_MAGIC) ||
+            hdr.magic == __builtin_bswap32(STP_TOOL_PCAP_MAGIC_NSEC));
+    if (swap)
+    {
+        hdr.magic = __builtin_bswap32(hdr.magic);
+        hdr.linktype = __builtin_bswap32(hdr.linktype);
+    }
+
+    if (hdr.magic != STP_TOOL_PCAP_MAGIC && hdr.magic != STP_TOOL_PCAP_MAGIC_NSEC)
+        goto invalid;
+    nsec = (hdr.magic == STP_TOOL_PCAP_MAGIC_NSEC);
+
+    if (hdr.linktype != STP_TOOL_PCAP_ETHERNET)
+    {
+        fprintf(stderr, "%s: link type %u, only ethernet captures are supported\n", path, hdr.linktype);
+        fclose(fp);
+        return -1;
+    }
+
+    pkt = malloc(STP_TOOL_PCAP_SNAPLEN);
+    if (!pkt)
+        exit(1);
+
+    while (fread(&rec, sizeof(rec), 1, fp) == 1)
+    {
+        if (swap)
+        {
+            rec.ts_sec = __builtin_bswap32(rec.ts_sec);
+            rec.ts_frac = __builtin_bswap32(rec.ts_frac);
+            rec.incl_len = __builtin_bswap32(rec.incl_len);
+        }
+
+        if (rec.incl_len > STP_TOOL_PCAP_SNAPLEN || fread(pkt, rec.incl_len, 1, fp) != 1)
+        {
+            free(pkt);
+            goto invalid;
+        }
+
+        if (g_bench_frame_count == size)
+        {
+            size = size ? size * 2 : 1024;
+            g_bench_frames = realloc(g_bench_frames, size * sizeof(BENCH_FRAME));
+            if (!g_bench_frames)
+                exit(1);
+        }
+
+        frac_nsec = nsec ? rec.ts_frac : rec.ts_frac * 1000;
+        ts_nsec = ((uint64_t)rec.ts_sec * BENCH_NSEC_PER_SEC) + frac_nsec;
+        if (!capture->frames)
+            first_nsec = ts_nsec;
+
+        capture->frames++;
+        if (!bench_add_frame(capture, (ts_nsec > first_nsec) ? ts_nsec - first_nsec : 0, pkt, rec.incl_len,
+                    untagged_vlan, max_ports))
+            capture->skipped++;
+    }
+
+    free(pkt);
+    fclose(fp);
+    return 0;
+
+invalid:
+    fprintf(stderr, "%s: not a valid pcap file\n", path);
+    fclose(fp);
+    return -1;
+}
+
+/* replay ------------------------------------------------------------------- */
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint32_t bench_percentile(uint32_t *sorted, uint64_t count, double pct)
+{
+    uint64_t index = (uint64_t)((pct / 100.0) * count);
+
+    return sorted[(index < count) ? index : count - 1];
+}
+
+static void bench_usage(const char *prog)
+{
+    printf("usage: %s [-m pvst|mstp] [-p ports] [-u vlan] [-r rate|cap] [-l loops] [-c] <file.pcap>\n", prog);
+    printf("  -m  protocol, by default mstp if the capture has mstp bpdus\n");
+    printf("  -p  max ports, one per source mac (default %u)\n", BENCH_DFLT_PORTS_MAX);
+    printf("  -u  vlan of the untagged frames (default 1)\n");
+    printf("  -r  bpdus per second, cap for the capture timing (default 0, flat out)\n");
+    printf("  -l  times to replay the capture (default 1)\n");
+    printf("  -c  count cache misses and instructions (perf_event_open)\n");
+}
+
+int main(int argc, char **argv)
+{
+    BENCH_CAPTURE capture;
+    STP_TOOL_BRIDGE bridge;
+    BENCH_FRAME *frame;
+    char pkt[STP_MAX_PKT_LEN];
+    uint64_t perf[BENCH_PERF_MAX], rx_nsec = 0, count = 0, loop_nsec;
+    uint64_t start_nsec, now_nsec, next_tick_nsec, frame_nsec, t0, t1;
+    uint32_t *latency, i, loop, loops = 1;
+    uint16_t max_ports = BENCH_DFLT_PORTS_MAX;
+    VLAN_ID untagged_vlan = 1;
+    struct timespec ts;
+    int mode = -1, rate = 0, opt;
+    bool perf_on = false;
+    double wall_sec;
+
+    while ((opt = getopt(argc, argv, "m:p:u:r:l:ch")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                if (0 == strcmp(optarg, "mstp"))
+                    mode = L2_MSTP;
+                else if (0 == strcmp(optarg, "pvst"))
+                    mode = L2_PVSTP;
+                else
+                {
+                    bench_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'p': max_ports = strtoul(optarg, NULL, 0); break;
+            case 'u': untagged_vlan = strtoul(optarg, NULL, 0); break;
+            case 'r':
+                rate = (0 == strcmp(optarg, "cap")) ? BENCH_RATE_CAPTURE : (int)strtoul(optarg, NULL, 0);
+                break;
+            case 'l': loops = strtoul(optarg, NULL, 0); break;
+            case 'c': perf_on = true; break;
+            default:
+                bench_usage(argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if (optind != argc - 1 || !loops || !max_ports || max_ports > STP_TOOL_MAX_PORTS ||
+            !IS_VALID_VLAN(untagged_vlan))
+    {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    STP_LOG_SET_LEVEL(APP_LOG_LEVEL_ERR);
+
+    memset(&capture, 0, sizeof(capture));
+    if (bench_load(argv[optind], &capture, untagged_vlan, max_ports) < 0)
+        return 1;
+
+    if (!g_bench_frame_count)
+    {
+        fprintf(stderr, "%s: no bpdu in %" PRIu64 " frames\n", argv[optind], capture.frames);
+        return 1;
+    }
+
+    stp_tool_bridge_init(&bridge);
+    bridge.mode = (mode >= 0) ? mode : (capture.mstp ? L2_MSTP : L2_PVSTP);
+    bridge.ports = capture.ports;
+    bridge.vlan = g_bench_vlans[0];
+    bridge.max_instances = capture.vlans;
+    //highest priority, the bridge does not take the root role from the capture
+    bridge.priority = STP_MAX_PRIORITY;
+    bridge.mac[0] = 0x02;
+    bridge.mac[5] = 0xfe;
+    if (stp_tool_init(&bridge) < 0)
+    {
+        fprintf(stderr, "bridge init failed\n");
+        return 1;
+    }
+
+    for (i = 1; i < capture.vlans; i++)
+    {
+        if (stp_tool_add_vlan(g_bench_vlans[i]) < 0)
+        {
+            fprintf(stderr, "vlan %u config failed\n", g_bench_vlans[i]);
+            return 1;
+        }
+    }
+
+    printf("%s: %" PRIu64 " frames, %u bpdus (%" PRIu64 " skipped), %u ports, %u vlans, %s\n",
+            argv[optind], capture.frames, g_bench_frame_count, capture.skipped, capture.ports,
+            capture.vlans, (bridge.mode == L2_MSTP) ? "mstp" : "pvst");
+
+    latency = malloc((uint64_t)g_bench_frame_count * loops * sizeof(uint32_t));
+    if (!latency)
+    {
+        fprintf(stderr, "latency buffer alloc failed\n");
+        return 1;
+    }
+
+    if (perf_on)
+        perf_on = bench_perf_init();
+
+    //each loop goes on from the end of the previous one
+    loop_nsec = g_bench_frames[g_bench_frame_count - 1].ts_nsec + BENCH_TICK_NSEC;
+    next_tick_nsec = BENCH_TICK_NSEC;
+    start_nsec = bench_now_nsec();
+
+    for (loop = 0; loop < loops; loop++)
+    {
+        for (i = 0; i < g_bench_frame_count; i++)
+        {
+            frame = &g_bench_frames[i];
+            frame_nsec = (loop * loop_nsec) + frame->ts_nsec;
+
+            if (rate)
+            {
+                now_nsec = start_nsec + ((rate == BENCH_RATE_CAPTURE) ? frame_nsec :
+                        (count * BENCH_NSEC_PER_SEC / rate));
+                ts.tv_sec = now_nsec / BENCH_NSEC_PER_SEC;
+                ts.tv_nsec = now_nsec % BENCH_NSEC_PER_SEC;
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            }
+
+            //virtual clock on the capture time
+            for (; next_tick_nsec <= frame_nsec; next_tick_nsec += BENCH_TICK_NSEC)
+                stp_tool_tick();
+
+            //bpdus are converted in place
+            memcpy(pkt, frame->data, frame->len);
+
+            if (perf_on)
+                bench_perf_enable(true);
+            g_bench_alloc_active = true;
+            t0 = bench_now_nsec();
+            stp_tool_rx(frame->port, frame->vlan, pkt, frame->len);
+            t1 = bench_now_nsec();
+            g_bench_alloc_active = false;
+            if (perf_on)
+                bench_perf_enable(false);
+
+            latency[count++] = t1 - t0;
+            rx_nsec += t1 - t0;
+        }
+    }
+
+    wall_sec = (double)(bench_now_nsec() - start_nsec) / BENCH_NSEC_PER_SEC;
+
+    qsort(latency, count, sizeof(uint32_t), bench_cmp_u32);
+    printf("replayed %" PRIu64 " bpdus in %.3fs: %.0f bpdus/s, rx path alone %.0f bpdus/s\n",
+            count, wall_sec, count / wall_sec, count / ((double)rx_nsec / BENCH_NSEC_PER_SEC));
+    printf("latency ns: min %u, p50 %u, p90 %u, p99 %u, p99.9 %u, max %u\n", latency[0],
+            bench_percentile(latency, count, 50), bench_percentile(latency, count, 90),
+            bench_percentile(latency, count, 99), bench_percentile(latency, count, 99.9),
+            latency[count - 1]);
+    printf("allocations: %.3f per bpdu, %.1f bytes per bpdu\n", (double)g_bench_allocs / count,
+            (double)g_bench_alloc_bytes / count);
+    if (perf_on && bench_perf_read(perf))
+        printf("cache misses: %.2f per bpdu, instructions: %.0f per bpdu\n",
+                (double)perf[BENCH_PERF_CACHE_MISSES] / count, (double)perf[BENCH_PERF_INSTRUCTIONS] / count);
+
+    free(latency);
+    return 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "stp_tool.h"
+
+/*
+ * Sharded PVST scaling benchmark.
+ *
+ * One PVST bridge (see stp_tool.h) with many vlans, run once per worker
+ * count from 1 (sharding off) to -j, each run in its own child process as
+ * libstp keeps its state in globals. The bridge learns a superior root on
+ * port 0 for every vlan: the hello it sends on port 0 at the start is
+ * captured and rewritten into the BPDU of a better bridge, which is received
+ * every hello time on port 0 through stp_pkt_rx_process() as the packet
+ * socket does. The other ports are designated and send their own hellos.
+ *
+ * Every run replays the same virtual time. The report gives, per worker
+ * count, the wall time, the time spent in the fork-join phases of the
+ * timer tick and of the received BPDUs and the critical path of those
+ * phases, i.e. the sum of the busiest worker of each phase (thread cpu
+ * time). The projected time, wall - phase + critical path, is the run time
+ * with a core per worker. The frames sent and the port state changes are
+ * counted to check the runs against each other.
+ */
+
+#define BENCH_TICKS_PER_SEC     10
+#define BENCH_DFLT_PORTS        16
+#define BENCH_DFLT_VLANS        1000
+#define BENCH_DFLT_SEC          60
+#define BENCH_FIRST_VLAN        2
+#define BENCH_ROOT_PRIORITY     0x1000
+#define BENCH_PVST_DA           { 0x01, 0x00, 0x0c, 0xcc, 0xcc, 0xcd }
+
+typedef struct
+{
+    uint16_t len;
+    char data[STP_MAX_PKT_LEN];
+} BENCH_BPDU;
+
+typedef struct
+{
+    double wall_sec;
+    double phase_sec;
+    double crit_sec;
+    uint64_t phases;
+    uint64_t rx;
+    uint64_t tx;
+    uint64_t changes;
+    uint32_t forwarding;
+} BENCH_RESULT;
+
+static BENCH_BPDU g_bench_bpdus[MAX_VLAN_ID];
+static uint16_t g_bench_vlans;
+static bool g_bench_capture;
+static uint64_t g_bench_tx;
+static uint64_t g_bench_changes;
+static uint8_t g_bench_state[STP_TOOL_MAX_PORTS][MAX_VLAN_ID];
+
+static double bench_now_sec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+//the port 0 hello of each vlan, while every vlan still thinks it is root
+static void bench_tx(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
+{
+    static const uint8_t pvst_da[L2_ETH_ADD_LEN] = BENCH_PVST_DA;
+
+    g_bench_tx++;
+
+    if (!g_bench_capture || port_id != 0 || size > STP_MAX_PKT_LEN ||
+            memcmp(buffer, pvst_da, L2_ETH_ADD_LEN))
+        return;
+
+    memcpy(g_bench_bpdus[vlan_id].data, buffer, size);
+    g_bench_bpdus[vlan_id].len = size;
+}
+
+static void bench_state(char *ifname, uint16_t instance, uint8_t state)
+{
+    uint32_t port_id;
+
+    if (strncmp(ifname, "Ethernet", STP_ETH_NAME_PREFIX_LEN))
+        return;
+
+    port_id = strtoul(ifname + STP_ETH_NAME_PREFIX_LEN, NULL, 10);
+    if (port_id >= STP_TOOL_MAX_PORTS || instance >= MAX_VLAN_ID)
+        return;
+
+    g_bench_changes++;
+    g_bench_state[port_id][instance] = state;
+}
+
+//bridge id of the root: priority 4096, mac 02:00:00:00:00:01
+static void bench_set_root_id(BRIDGE_IDENTIFIER *id)
+{
+    uint8_t *bytes = (uint8_t *)id;
+    uint16_t system_id = ((bytes[0] << 8) | bytes[1]) & 0x0fff;
+
+    bytes[0] = (BENCH_ROOT_PRIORITY | system_id) >> 8;
+    bytes[1] = system_id & 0xff;
+    memset(&bytes[2], 0, L2_ETH_ADD_LEN);
+    bytes[2] = 0x02;
+    bytes[2 + L2_ETH_ADD_LEN - 1] = 0x01;
+}
+
+static int bench_make_bpdus()
+{
+    PVST_CONFIG_BPDU *bpdu;
+    VLAN_ID vlan_id;
+
+    for (vlan_id = BENCH_FIRST_VLAN; vlan_id < BENCH_FIRST_VLAN + g_bench_vlans; vlan_id++)
+    {
+        if (g_bench_bpdus[vlan_id].len < sizeof(PVST_CONFIG_BPDU))
+        {
+            fprintf(stderr, "no hello captured on vlan %u\n", vlan_id);
+            return -1;
+        }
+
+        bpdu = (PVST_CONFIG_BPDU *)g_bench_bpdus[vlan_id].data;
+        bench_set_root_id(&bpdu->root_id);
+        bench_set_root_id(&bpdu->bridge_id);
+        bpdu->root_path_cost = 0;
+    }
+
+    return 0;
+}
+
+static void bench_run(uint16_t ports, uint32_t workers, uint32_t ticks, BENCH_RESULT *result)
+{
+    STP_TOOL_BRIDGE bridge;
+    STPD_SHARD_STATS stats;
+    BENCH_BPDU *bpdu;
+    char pkt[STP_MAX_PKT_LEN];
+    uint32_t tick, hello_ticks, i, j;
+    STP_INDEX stp_index;
+    double start;
+
+    g_stp_tool_tx_fn = bench_tx;
+    g_stp_tool_state_fn = bench_state;
+
+    stp_tool_bridge_init(&bridge);
+    bridge.ports = ports;
+    bridge.vlan = BENCH_FIRST_VLAN;
+    bridge.max_instances = g_bench_vlans;
+    bridge.mac[0] = 0x02;
+    bridge.mac[5] = 0xfe;
+    if (stp_tool_init(&bridge) < 0)
+    {
+        fprintf(stderr, "bridge init failed\n");
+        exit(1);
+    }
+
+    for (i = 1; i < g_bench_vlans; i++)
+    {
+        if (stp_tool_add_vlan(BENCH_FIRST_VLAN + i) < 0)
+        {
+            fprintf(stderr, "vlan %u config failed\n", BENCH_FIRST_VLAN + i);
+            exit(1);
+        }
+    }
+
+    if (workers > 1 && stp_shard_init(workers) < 0)
+    {
+        fprintf(stderr, "shard init failed, %u workers\n", workers);
+        exit(1);
+    }
+
+    //hellos are spread over the hello time
+    hello_ticks = bridge.hello_time * BENCH_TICKS_PER_SEC;
+    g_bench_capture = true;
+    for (tick = 0; tick <= hello_ticks; tick++)
+        stp_tool_tick();
+    g_bench_capture = false;
+
+    if (bench_make_bpdus() < 0)
+        exit(1);
+
+    g_bench_tx = 0;
+    g_bench_changes = 0;
+    start = bench_now_sec();
+
+    for (tick = 0; tick < ticks; tick++)
+    {
+        //a slice of the vlans every tick, each vlan once per hello time
+        for (i = tick % hello_ticks; i < g_bench_vlans; i += hello_ticks)
+        {
+            bpdu = &g_bench_bpdus[BENCH_FIRST_VLAN + i];
+            //bpdus are converted in place
+            memcpy(pkt, bpdu->data, bpdu->len);
+            stp_tool_rx(0, BENCH_FIRST_VLAN + i, pkt, bpdu->len);
+            result->rx++;
+        }
+        stp_tool_tick();
+    }
+    stp_shard_rx_flush();
+
+    result->wall_sec = bench_now_sec() - start;
+    result->tx = g_bench_tx;
+    result->changes = g_bench_changes;
+
+    stp_shard_get_stats(&stats);
+    result->phases = stats.phases;
+    result->phase_sec = stats.phase_usec / 1e6;
+    result->crit_sec = stats.crit_usec / 1e6;
+
+    //instance of the port states is the stp index
+    for (j = 0; j < g_bench_vlans; j++)
+    {
+        if (!stputil_get_index_from_vlan(BENCH_FIRST_VLAN + j, &stp_index))
+            continue;
+
+        for (i = 0; i < ports; i++)
+        {
+            if (g_bench_state[i][stp_index] == FORWARDING)
+                result->forwarding++;
+        }
+    }
+}
+
+static void bench_usage(const char *prog)
+{
+    printf("usage: %s [-j workers] [-p ports] [-v vlans] [-t sec]\n", prog);
+    printf("  -j  runs 1 to workers workers, %u at most (default %u)\n", STPD_SHARD_MAX, STPD_SHARD_MAX);
+    printf("  -p  ports (default %u)\n", BENCH_DFLT_PORTS);
+    printf("  -v  vlans (default %u)\n", BENCH_DFLT_VLANS);
+    printf("  -t  virtual seconds per run (default %u)\n", BENCH_DFLT_SEC);
+}
+
+int main(int argc, char **argv)
+{
+    BENCH_RESULT *result;
+    uint32_t workers, max_workers = STPD_SHARD_MAX, sec = BENCH_DFLT_SEC;
+    uint16_t ports = BENCH_DFLT_PORTS;
+    double base_sec = 0, projected_sec;
+    int opt, status;
+    pid_t pid;
+
+    g_bench_vlans = BENCH_DFLT_VLANS;
+
+    while ((opt = getopt(argc, argv, "j:p:v:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j': max_workers = strtoul(optarg, NULL, 0); break;
+            case 'p': ports = strtoul(optarg, NULL, 0); break;
+            case 'v': g_bench_vlans = strtoul(optarg, NULL, 0); break;
+            case 't': sec = strtoul(optarg, NULL, 0); break;
+            default:
+                bench_usage(argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if (optind != argc || !max_workers || max_workers > STPD_SHARD_MAX || ports < 2 ||
+            ports > STP_TOOL_MAX_PORTS || !g_bench_vlans ||
+            BENCH_FIRST_VLAN + g_bench_vlans > MAX_VLAN_ID || !sec)
+    {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    STP_LOG_SET_LEVEL(APP_LOG_LEVEL_ERR);
+
+    //results of the children
+    result = mmap(NULL, sizeof(BENCH_RESULT), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (result == MAP_FAILED)
+    {
+        fprintf(stderr, "result map failed\n");
+        return 1;
+    }
+
+    printf("pvst, %u ports, %u vlans, %u sec, %ld cpus\n", ports, g_bench_vlans, sec,
+            sysconf(_SC_NPROCESSORS_ONLN));
+    printf("workers  wall-s  phase-s  crit-s  projected-s  speedup  phases      rx       tx  changes  fwd\n");
+    fflush(stdout);
+
+    for (workers = 1; workers <= max_workers; workers++)
+    {
+        memset(result, 0, sizeof(BENCH_RESULT));
+
+        pid = fork();
+        if (pid < 0)
+        {
+            fprintf(stderr, "fork failed\n");
+            return 1;
+        }
+        if (pid == 0)
+        {
+            bench_run(ports, workers, sec * BENCH_TICKS_PER_SEC, result);
+            _exit(0);
+        }
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+        {
+            fprintf(stderr, "run with %u workers failed\n", workers);
+            return 1;
+        }
+
+        projected_sec = result->wall_sec - result->phase_sec + result->crit_sec;
+        if (workers == 1)
+            base_sec = projected_sec;
+
+        printf("%7u  %6.3f  %7.3f  %6.3f  %11.3f  %6.2fx  %6" PRIu64 "  %6" PRIu64 "  %7" PRIu64 "  %7" PRIu64 "  %3u\n",
+                workers, result->wall_sec, result->phase_sec, result->crit_sec, projected_sec,
+                base_sec / projected_sec, result->phases, result->rx, result->tx, result->changes,
+                result->forwarding);
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,1019 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "stp_tool.h"
+
+/*
+ * Multi bridge network simulator.
+ *
+ * Every bridge of the topology is a libstp.a instance (see stp_tool.h). As
+ * libstp keeps its state in globals, each bridge runs in a child process
+ * forked by the simulator, which owns the virtual wires and the virtual
+ * clock and drives the bridges in lock step over socket pairs:
+ *
+ *  - every 100ms tick, each bridge runs its timers
+ *  - the BPDUs sent are carried over the wires and received, in rounds,
+ *    until no bridge sends any more within the tick
+ *
+ * Port state changes (stpsync_update_port_state) are reported back. A phase
+ * (the start, then each link event) has converged once no port state changed
+ * for the settle time, its convergence time is that of its last change. At
+ * the end the forwarding links are checked to form a spanning tree of every
+ * connected part of the network. The BPDUs put on the wires can be written to
+ * a pcap file, which stp_pcap_bench replays.
+ *
+ * Topology file:
+ *     # comment
+ *     bridge <name> [priority]
+ *     link <name> <name> [path cost]
+ *     down <sec> <name> <name>
+ *     up <sec> <name> <name>
+ * or a generated one: ring:<bridges>, leafspine:<leaves>:<spines>,
+ * mesh:<bridges>:<links>[:seed]. The first bridge (the first spine) is given
+ * priority 4096 in generated topologies.
+ */
+
+#define SIM_MAX_BRIDGES         1024
+#define SIM_MAX_LINKS           16384
+#define SIM_MAX_EVENTS          256
+#define SIM_NAME_LEN            32
+#define SIM_TICKS_PER_SEC       10
+#define SIM_MAX_ROUNDS          64      //frame exchanges within a tick
+#define SIM_DFLT_SETTLE_SEC     20
+#define SIM_DFLT_MAX_SEC        600
+#define SIM_ROOT_PRIORITY       4096
+#define SIM_NO_LINK             0xffff
+
+typedef enum
+{
+    //simulator to bridge
+    SIM_MSG_RX,
+    SIM_MSG_TICK,
+    SIM_MSG_LINK,
+    SIM_MSG_SYNC,
+    SIM_MSG_QUIT,
+    //bridge to simulator
+    SIM_MSG_TX,
+    SIM_MSG_STATE,
+    SIM_MSG_DONE,
+    SIM_MSG_STATS,
+} SIM_MSG_TYPE;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t arg;                        //tagged for rx/tx, up for link, state
+    uint16_t port;
+    uint16_t vlan;
+    uint16_t len;
+    union
+    {
+        char frame[STP_MAX_PKT_LEN];
+        struct
+        {
+            uint64_t cpu_usec;
+            uint64_t maxrss_kb;
+        } stats;
+    };
+} SIM_MSG;
+
+#define SIM_MSG_SIZE(_msg_) (offsetof(SIM_MSG, frame) + \
+        ((_msg_)->type == SIM_MSG_STATS ? sizeof((_msg_)->stats) : (_msg_)->len))
+
+typedef struct
+{
+    char name[SIM_NAME_LEN];
+    uint16_t priority;
+    uint16_t ports;
+    uint16_t link[STP_TOOL_MAX_PORTS];
+    uint8_t state[STP_TOOL_MAX_PORTS];
+    pid_t pid;
+    int fd;
+    uint64_t tx;
+    uint64_t cpu_usec;
+    uint64_t maxrss_kb;
+} SIM_BRIDGE;
+
+typedef struct
+{
+    uint16_t bridge[2];
+    uint16_t port[2];
+    uint32_t cost;
+    bool up;
+} SIM_LINK;
+
+typedef struct
+{
+    uint32_t tick;
+    uint16_t link;
+    bool up;
+} SIM_EVENT;
+
+typedef struct
+{
+    uint32_t start_tick;
+    uint32_t last_change_tick;
+    uint32_t changes;
+    uint64_t bpdus;
+    char label[64];
+} SIM_PHASE;
+
+typedef struct
+{
+    uint16_t bridge;
+    SIM_MSG msg;
+} SIM_FRAME;
+
+static SIM_BRIDGE *g_sim_bridges;
+static uint16_t g_sim_bridge_count;
+static SIM_LINK *g_sim_links;
+static uint16_t g_sim_link_count;
+static SIM_EVENT g_sim_events[SIM_MAX_EVENTS];
+static uint16_t g_sim_event_count;
+static SIM_PHASE g_sim_phases[SIM_MAX_EVENTS + 1];
+static uint16_t g_sim_phase_count;
+
+static L2_PROTO_MODE g_sim_mode = L2_PVSTP;
+static uint32_t g_sim_tick;
+static bool g_sim_verbose;
+static FILE *g_sim_pcap;
+
+//frames waiting to be received, filled while the bridges are synced
+static SIM_FRAME *g_sim_frames;
+static uint32_t g_sim_frame_count;
+static uint32_t g_sim_frame_size;
+
+/* topology ----------------------------------------------------------------- */
+
+static int sim_find_bridge(const char *name)
+{
+    int i;
+
+    for (i = 0; i < g_sim_bridge_count; i++)
+    {
+        if (0 == strcmp(g_sim_bridges[i].name, name))
+            return i;
+    }
+    return -1;
+}
+
+static int sim_add_bridge(const char *name, uint16_t priority)
+{
+    SIM_BRIDGE *bridge;
+
+    if (sim_find_bridge(name) >= 0)
+    {
+        fprintf(stderr, "bridge %s defined twice\n", name);
+        return -1;
+    }
+
+    if (g_sim_bridge_count == SIM_MAX_BRIDGES)
+    {
+        fprintf(stderr, "more than %u bridges\n", SIM_MAX_BRIDGES);
+        return -1;
+    }
+
+    bridge = &g_sim_bridges[g_sim_bridge_count];
+    memset(bridge, 0, sizeof(SIM_BRIDGE));
+    strncpy(bridge->name, name, SIM_NAME_LEN - 1);
+    bridge->priority = priority;
+    bridge->fd = -1;
+    return g_sim_bridge_count++;
+}
+
+static int sim_add_link(int b1, int b2, uint32_t cost)
+{
+    SIM_LINK *link;
+    int i, bridge[2] = { b1, b2 };
+
+    if (b1 == b2 || g_sim_link_count == SIM_MAX_LINKS)
+    {
+        fprintf(stderr, "invalid link %d - %d\n", b1, b2);
+        return -1;
+    }
+
+    link = &g_sim_links[g_sim_link_count];
+    for (i = 0; i < 2; i++)
+    {
+        if (g_sim_bridges[bridge[i]].ports == STP_TOOL_MAX_PORTS)
+        {
+            fprintf(stderr, "bridge %s has more than %u links\n", g_sim_bridges[bridge[i]].name,
+                    STP_TOOL_MAX_PORTS);
+            return -1;
+        }
+        link->bridge[i] = bridge[i];
+        link->port[i] = g_sim_bridges[bridge[i]].ports++;
+        g_sim_bridges[bridge[i]].link[link->port[i]] = g_sim_link_count;
+    }
+    link->cost = cost;
+    link->up = true;
+    return g_sim_link_count++;
+}
+
+static int sim_find_link(int b1, int b2)
+{
+    int i;
+
+    for (i = 0; i < g_sim_link_count; i++)
+    {
+        if ((g_sim_links[i].bridge[0] == b1 && g_sim_links[i].bridge[1] == b2) ||
+                (g_sim_links[i].bridge[0] == b2 && g_sim_links[i].bridge[1] == b1))
+            return i;
+    }
+    return -1;
+}
+
+static int sim_add_event(uint32_t sec, int link, bool up)
+{
+    SIM_EVENT *event;
+    int i;
+
+    if (g_sim_event_count == SIM_MAX_EVENTS || link < 0)
+        return -1;
+
+    //kept in time order
+    for (i = g_sim_event_count; i > 0 && g_sim_events[i - 1].tick > sec * SIM_TICKS_PER_SEC; i--)
+        g_sim_events[i] = g_sim_events[i - 1];
+
+    event = &g_sim_events[i];
+    event->tick = sec * SIM_TICKS_PER_SEC;
+    event->link = link;
+    event->up = up;
+    g_sim_event_count++;
+    return 0;
+}
+
+static int sim_get_bridge(const char *name)
+{
+    int index = sim_find_bridge(name);
+
+    //bridges may be declared by their first link
+    return (index >= 0) ? index : sim_add_bridge(name, STP_DFLT_PRIORITY);
+}
+
+static int sim_load_file(const char *path)
+{
+    char line[256], cmd[16], name1[SIM_NAME_LEN], name2[SIM_NAME_LEN];
+    unsigned int value;
+    int line_no = 0, n, b1, b2;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_no++;
+        n = sscanf(line, "%15s", cmd);
+        if (n != 1 || cmd[0] == '#')
+            continue;
+
+        if (0 == strcmp(cmd, "bridge"))
+        {
+            value = STP_DFLT_PRIORITY;
+            n = sscanf(line, "%*s %31s %u", name1, &value);
+            if (n < 1 || sim_add_bridge(name1, value) < 0)
+                goto fail;
+        }
+        else if (0 == strcmp(cmd, "link"))
+        {
+            value = 0;
+            n = sscanf(line, "%*s %31s %31s %u", name1, name2, &value);
+            if (n < 2 || (b1 = sim_get_bridge(name1)) < 0 || (b2 = sim_get_bridge(name2)) < 0 ||
+                    sim_add_link(b1, b2, value) < 0)
+                goto fail;
+        }
+        else if (0 == strcmp(cmd, "down") || 0 == strcmp(cmd, "up"))
+        {
+            n = sscanf(line, "%*s %u %31s %31s", &value, name1, name2);
+            if (n != 3 || (b1 = sim_find_bridge(name1)) < 0 || (b2 = sim_find_bridge(name2)) < 0 ||
+                    sim_add_event(value, sim_find_link(b1, b2), (cmd[0] == 'u')) < 0)
+                goto fail;
+        }
+        else
+            goto fail;
+    }
+
+    fclose(fp);
+    return 0;
+
+fail:
+    fprintf(stderr, "%s:%d: invalid line: %s", path, line_no, line);
+    fclose(fp);
+    return -1;
+}
+
+static int sim_generate(const char *spec)
+{
+    char name[SIM_NAME_LEN];
+    unsigned int a = 0, b = 0, seed = 1;
+    uint32_t i, j, tries;
+
+    if (1 == sscanf(spec, "ring:%u", &a) && a >= 2)
+    {
+        for (i = 0; i < a; i++)
+        {
+            snprintf(name, sizeof(name), "sw%u", i);
+            sim_add_bridge(name, i ? STP_DFLT_PRIORITY : SIM_ROOT_PRIORITY);
+        }
+        for (i = 0; i < a; i++)
+        {
+            if (sim_add_link(i, (i + 1) % a, 0) < 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    if (2 == sscanf(spec, "leafspine:%u:%u", &a, &b) && a && b)
+    {
+        for (i = 0; i < b; i++)
+        {
+            snprintf(name, sizeof(name), "spine%u", i);
+            sim_add_bridge(name, i ? STP_DFLT_PRIORITY : SIM_ROOT_PRIORITY);
+        }
+        for (i = 0; i < a; i++)
+        {
+            snprintf(name, sizeof(name), "leaf%u", i);
+            sim_add_bridge(name, STP_DFLT_PRIORITY);
+        }
+        for (i = 0; i < a; i++)
+        {
+            for (j = 0; j < b; j++)
+            {
+                if (sim_add_link(b + i, j, 0) < 0)
+                    return -1;
+            }
+        }
+        return 0;
+    }
+
+    if (sscanf(spec, "mesh:%u:%u:%u", &a, &b, &seed) >= 2 && a >= 2 && b >= a - 1)
+    {
+        srandom(seed);
+        for (i = 0; i < a; i++)
+        {
+            snprintf(name, sizeof(name), "sw%u", i);
+            sim_add_bridge(name, i ? STP_DFLT_PRIORITY : SIM_ROOT_PRIORITY);
+        }
+        //random tree first so that the mesh is connected
+        for (i = 1; i < a; i++)
+        {
+            if (sim_add_link(i, random() % i, 0) < 0)
+                return -1;
+        }
+        for (tries = 0; g_sim_link_count < b && tries < b * 100; tries++)
+        {
+            i = random() % a;
+            j = random() % a;
+            if (i != j && sim_find_link(i, j) < 0 && sim_add_link(i, j, 0) < 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    fprintf(stderr, "invalid topology %s\n", spec);
+    return -1;
+}
+
+/* bridge process ----------------------------------------------------------- */
+
+static int g_sim_child_fd = -1;
+static SIM_MSG *g_sim_child_out;
+static uint32_t g_sim_child_out_count;
+static uint32_t g_sim_child_out_size;
+
+//replies are held until the sync, the simulator may still be writing to us
+static SIM_MSG *sim_child_out(uint8_t type)
+{
+    SIM_MSG *out;
+
+    if (g_sim_child_out_count == g_sim_child_out_size)
+    {
+        g_sim_child_out_size = g_sim_child_out_size ? g_sim_child_out_size * 2 : 64;
+        g_sim_child_out = realloc(g_sim_child_out, g_sim_child_out_size * sizeof(SIM_MSG));
+        if (!g_sim_child_out)
+            exit(1);
+    }
+
+    out = &g_sim_child_out[g_sim_child_out_count++];
+    out->type = type;
+    out->arg = 0;
+    out->port = 0;
+    out->vlan = 0;
+    out->len = 0;
+    return out;
+}
+
+static void sim_child_tx(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
+{
+    SIM_MSG *out;
+
+    if (size > STP_MAX_PKT_LEN)
+        return;
+
+    out = sim_child_out(SIM_MSG_TX);
+    out->arg = tagged;
+    out->port = port_id;
+    out->vlan = vlan_id;
+    out->len = size;
+    memcpy(out->frame, buffer, size);
+}
+
+static void sim_child_state(char *ifname, uint16_t instance, uint8_t state)
+{
+    SIM_MSG *out;
+
+    if (strncmp(ifname, "Ethernet", STP_ETH_NAME_PREFIX_LEN))
+        return;
+
+    out = sim_child_out(SIM_MSG_STATE);
+    out->port = strtoul(ifname + STP_ETH_NAME_PREFIX_LEN, NULL, 10);
+    out->arg = state;
+}
+
+static void sim_child_send(SIM_MSG *msg)
+{
+    if (send(g_sim_child_fd, msg, SIM_MSG_SIZE(msg), 0) < 0)
+        exit(1);
+}
+
+static void sim_child_flush()
+{
+    uint32_t i;
+
+    for (i = 0; i < g_sim_child_out_count; i++)
+        sim_child_send(&g_sim_child_out[i]);
+    g_sim_child_out_count = 0;
+
+    sim_child_send(sim_child_out(SIM_MSG_DONE));
+    g_sim_child_out_count = 0;
+}
+
+static void sim_child_quit()
+{
+    struct rusage usage;
+    SIM_MSG *out;
+
+    getrusage(RUSAGE_SELF, &usage);
+    out = sim_child_out(SIM_MSG_STATS);
+    out->stats.cpu_usec = ((uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000) +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    out->stats.maxrss_kb = usage.ru_maxrss;
+    sim_child_send(out);
+    exit(0);
+}
+
+static void sim_child_main(int index, int fd)
+{
+    SIM_BRIDGE *bridge = &g_sim_bridges[index];
+    STP_TOOL_BRIDGE config;
+    uint32_t path_cost[STP_TOOL_MAX_PORTS];
+    SIM_MSG msg;
+    ssize_t len;
+    int i;
+
+    g_sim_child_fd = fd;
+    g_stp_tool_tx_fn = sim_child_tx;
+    g_stp_tool_state_fn = sim_child_state;
+
+    stp_tool_bridge_init(&config);
+    config.mode = g_sim_mode;
+    config.ports = bridge->ports;
+    config.priority = bridge->priority;
+    config.mac[0] = 0x02;
+    config.mac[4] = (index + 1) >> 8;
+    config.mac[5] = (index + 1) & 0xff;
+    for (i = 0; i < bridge->ports; i++)
+        path_cost[i] = g_sim_links[bridge->link[i]].cost;
+    config.path_cost = path_cost;
+
+    if (stp_tool_init(&config) < 0)
+    {
+        fprintf(stderr, "%s: init failed\n", bridge->name);
+        exit(1);
+    }
+    sim_child_flush();
+
+    while ((len = recv(fd, &msg, sizeof(msg), 0)) > 0)
+    {
+        switch (msg.type)
+        {
+            case SIM_MSG_RX:
+                stp_tool_rx(msg.port, msg.vlan, msg.frame, msg.len);
+                break;
+            case SIM_MSG_TICK:
+                stp_tool_tick();
+                break;
+            case SIM_MSG_LINK:
+                stp_tool_port_event(msg.port, msg.arg);
+                break;
+            case SIM_MSG_SYNC:
+                sim_child_flush();
+                break;
+            case SIM_MSG_QUIT:
+                sim_child_quit();
+                break;
+        }
+    }
+    exit(0);
+}
+
+/* simulator ---------------------------------------------------------------- */
+
+static void sim_send(int index, SIM_MSG *msg)
+{
+    if (send(g_sim_bridges[index].fd, msg, SIM_MSG_SIZE(msg), 0) < 0)
+    {
+        fprintf(stderr, "%s: send failed: %s\n", g_sim_bridges[index].name, strerror(errno));
+        exit(1);
+    }
+}
+
+static void sim_send_cmd(int index, uint8_t type, uint16_t port, uint8_t arg)
+{
+    SIM_MSG msg;
+
+    msg.type = type;
+    msg.arg = arg;
+    msg.port = port;
+    msg.vlan = 0;
+    msg.len = 0;
+    sim_send(index, &msg);
+}
+
+static const char *sim_state_str(uint8_t state)
+{
+    static const char *names[] = { "disabled", "blocking", "listening", "learning", "forwarding" };
+
+    return (state < L2_MAX_PORT_STATE) ? names[state] : "?";
+}
+
+static int sim_pcap_open(const char *path)
+{
+    STP_TOOL_PCAP_HDR hdr;
+
+    g_sim_pcap = fopen(path, "w");
+    if (!g_sim_pcap)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = STP_TOOL_PCAP_MAGIC;
+    hdr.version_major = 2;
+    hdr.version_minor = 4;
+    hdr.snaplen = STP_TOOL_PCAP_SNAPLEN;
+    hdr.linktype = STP_TOOL_PCAP_ETHERNET;
+    fwrite(&hdr, sizeof(hdr), 1, g_sim_pcap);
+    return 0;
+}
+
+//the frame as seen on the wire, with its 802.1q tag
+static void sim_pcap_write(SIM_MSG *tx)
+{
+    STP_TOOL_PCAP_REC rec;
+    uint8_t tag[4];
+    uint16_t tag_len = tx->arg ? sizeof(tag) : 0;
+
+    if (tx->len < 2 * L2_ETH_ADD_LEN)
+        return;
+
+    rec.ts_sec = g_sim_tick / SIM_TICKS_PER_SEC;
+    rec.ts_frac = (g_sim_tick % SIM_TICKS_PER_SEC) * (1000000 / SIM_TICKS_PER_SEC);
+    rec.incl_len = rec.orig_len = tx->len + tag_len;
+    fwrite(&rec, sizeof(rec), 1, g_sim_pcap);
+
+    fwrite(tx->frame, 2 * L2_ETH_ADD_LEN, 1, g_sim_pcap);
+    if (tag_len)
+    {
+        tag[0] = 0x81;
+        tag[1] = 0x00;
+        tag[2] = (tx->vlan >> 8) & 0x0f;
+        tag[3] = tx->vlan & 0xff;
+        fwrite(tag, sizeof(tag), 1, g_sim_pcap);
+    }
+    fwrite(tx->frame + (2 * L2_ETH_ADD_LEN), tx->len - (2 * L2_ETH_ADD_LEN), 1, g_sim_pcap);
+}
+
+static void sim_queue_frame(int index, SIM_MSG *tx)
+{
+    SIM_BRIDGE *bridge = &g_sim_bridges[index];
+    SIM_LINK *link;
+    SIM_FRAME *frame;
+    int end;
+
+    bridge->tx++;
+    g_sim_phases[g_sim_phase_count - 1].bpdus++;
+
+    if (tx->port >= bridge->ports)
+        return;
+
+    link = &g_sim_links[bridge->link[tx->port]];
+    if (!link->up)
+        return;
+
+    if (g_sim_pcap)
+        sim_pcap_write(tx);
+
+    if (g_sim_frame_count == g_sim_frame_size)
+    {
+        g_sim_frame_size = g_sim_frame_size ? g_sim_frame_size * 2 : 256;
+        g_sim_frames = realloc(g_sim_frames, g_sim_frame_size * sizeof(SIM_FRAME));
+        if (!g_sim_frames)
+        {
+            fprintf(stderr, "frame queue alloc failed\n");
+            exit(1);
+        }
+    }
+
+    end = (link->bridge[0] == index && link->port[0] == tx->port) ? 1 : 0;
+    frame = &g_sim_frames[g_sim_frame_count++];
+    frame->bridge = link->bridge[end];
+    memcpy(&frame->msg, tx, SIM_MSG_SIZE(tx));
+    frame->msg.type = SIM_MSG_RX;
+    frame->msg.port = link->port[end];
+}
+
+static void sim_state_change(int index, SIM_MSG *msg)
+{
+    SIM_BRIDGE *bridge = &g_sim_bridges[index];
+    SIM_PHASE *phase = &g_sim_phases[g_sim_phase_count - 1];
+
+    if (msg->port >= bridge->ports || bridge->state[msg->port] == msg->arg)
+        return;
+
+    if (g_sim_verbose)
+        printf("%7.1fs %s Ethernet%u %s -> %s\n", (double)g_sim_tick / SIM_TICKS_PER_SEC, bridge->name,
+                msg->port, sim_state_str(bridge->state[msg->port]), sim_state_str(msg->arg));
+
+    bridge->state[msg->port] = msg->arg;
+    phase->changes++;
+    phase->last_change_tick = g_sim_tick;
+}
+
+//collects what every bridge sent since the last sync
+static void sim_sync_all()
+{
+    SIM_MSG msg;
+    ssize_t len;
+    int i;
+
+    for (i = 0; i < g_sim_bridge_count; i++)
+        sim_send_cmd(i, SIM_MSG_SYNC, 0, 0);
+
+    for (i = 0; i < g_sim_bridge_count; i++)
+    {
+        while ((len = recv(g_sim_bridges[i].fd, &msg, sizeof(msg), 0)) > 0 && msg.type != SIM_MSG_DONE)
+        {
+            if (msg.type == SIM_MSG_TX)
+                sim_queue_frame(i, &msg);
+            else if (msg.type == SIM_MSG_STATE)
+                sim_state_change(i, &msg);
+        }
+
+        if (len <= 0)
+        {
+            fprintf(stderr, "%s: bridge process exited\n", g_sim_bridges[i].name);
+            exit(1);
+        }
+    }
+}
+
+//carries the queued frames over the wires until no bridge answers any more
+static void sim_exchange()
+{
+    SIM_FRAME *frames = NULL;
+    uint32_t count, size = 0, i;
+    int rounds;
+
+    for (rounds = 0; g_sim_frame_count && rounds < SIM_MAX_ROUNDS; rounds++)
+    {
+        //swap the queue out, the sync below fills it again
+        count = g_sim_frame_count;
+        if (size < count)
+        {
+            size = g_sim_frame_size;
+            frames = realloc(frames, size * sizeof(SIM_FRAME));
+            if (!frames)
+                exit(1);
+        }
+        memcpy(frames, g_sim_frames, count * sizeof(SIM_FRAME));
+        g_sim_frame_count = 0;
+
+        for (i = 0; i < count; i++)
+            sim_send(frames[i].bridge, &frames[i].msg);
+
+        sim_sync_all();
+    }
+    free(frames);
+}
+
+static void sim_start_phase(const char *label)
+{
+    SIM_PHASE *phase = &g_sim_phases[g_sim_phase_count++];
+
+    memset(phase, 0, sizeof(SIM_PHASE));
+    phase->start_tick = g_sim_tick;
+    phase->last_change_tick = g_sim_tick;
+    strncpy(phase->label, label, sizeof(phase->label) - 1);
+}
+
+static void sim_apply_event(SIM_EVENT *event)
+{
+    SIM_LINK *link = &g_sim_links[event->link];
+    char label[64];
+    int i;
+
+    snprintf(label, sizeof(label), "%s-%s %s", g_sim_bridges[link->bridge[0]].name,
+            g_sim_bridges[link->bridge[1]].name, event->up ? "up" : "down");
+    sim_start_phase(label);
+
+    if (g_sim_verbose)
+        printf("%7.1fs link %s\n", (double)g_sim_tick / SIM_TICKS_PER_SEC, label);
+
+    link->up = event->up;
+    for (i = 0; i < 2; i++)
+        sim_send_cmd(link->bridge[i], SIM_MSG_LINK, link->port[i], event->up);
+}
+
+static int sim_spawn()
+{
+    int i, j, fds[2];
+    pid_t pid;
+
+    for (i = 0; i < g_sim_bridge_count; i++)
+    {
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0)
+        {
+            fprintf(stderr, "socketpair: %s\n", strerror(errno));
+            return -1;
+        }
+
+        pid = fork();
+        if (pid < 0)
+        {
+            fprintf(stderr, "fork: %s\n", strerror(errno));
+            return -1;
+        }
+
+        if (pid == 0)
+        {
+            close(fds[0]);
+            for (j = 0; j < i; j++)
+                close(g_sim_bridges[j].fd);
+            sim_child_main(i, fds[1]);
+        }
+
+        close(fds[1]);
+        g_sim_bridges[i].pid = pid;
+        g_sim_bridges[i].fd = fds[0];
+    }
+    return 0;
+}
+
+static void sim_quit_all()
+{
+    SIM_MSG msg;
+    int i;
+
+    for (i = 0; i < g_sim_bridge_count; i++)
+    {
+        sim_send_cmd(i, SIM_MSG_QUIT, 0, 0);
+        while (recv(g_sim_bridges[i].fd, &msg, sizeof(msg), 0) > 0)
+        {
+            if (msg.type == SIM_MSG_STATS)
+            {
+                g_sim_bridges[i].cpu_usec = msg.stats.cpu_usec;
+                g_sim_bridges[i].maxrss_kb = msg.stats.maxrss_kb;
+                break;
+            }
+        }
+        close(g_sim_bridges[i].fd);
+        waitpid(g_sim_bridges[i].pid, NULL, 0);
+    }
+}
+
+/* results ------------------------------------------------------------------ */
+
+static int sim_find_root(int *parent, int i)
+{
+    while (parent[i] != i)
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+//number of connected parts of the network over the given links
+static int sim_count_parts(bool forwarding_only, int *link_count)
+{
+    int *parent, i, a, b, parts;
+    SIM_LINK *link;
+
+    parent = calloc(g_sim_bridge_count, sizeof(int));
+    if (!parent)
+        exit(1);
+    for (i = 0; i < g_sim_bridge_count; i++)
+        parent[i] = i;
+
+    parts = g_sim_bridge_count;
+    *link_count = 0;
+    for (i = 0; i < g_sim_link_count; i++)
+    {
+        link = &g_sim_links[i];
+        if (!link->up)
+            continue;
+        if (forwarding_only && (g_sim_bridges[link->bridge[0]].state[link->port[0]] != FORWARDING ||
+                    g_sim_bridges[link->bridge[1]].state[link->port[1]] != FORWARDING))
+            continue;
+
+        (*link_count)++;
+        a = sim_find_root(parent, link->bridge[0]);
+        b = sim_find_root(parent, link->bridge[1]);
+        if (a != b)
+        {
+            parent[a] = b;
+            parts--;
+        }
+    }
+
+    free(parent);
+    return parts;
+}
+
+static int sim_report(const char *topology, uint64_t wall_usec)
+{
+    SIM_PHASE *phase;
+    uint64_t bpdus = 0, cpu_sum = 0, rss_sum = 0;
+    int up_links, fwd_links, up_parts, fwd_parts, cpu_max = 0, rss_max = 0;
+    bool tree_ok;
+    int i;
+
+    printf("\ntopology %s: %u bridges, %u links, %s\n", topology, g_sim_bridge_count, g_sim_link_count,
+            (g_sim_mode == L2_MSTP) ? "mstp" : "pvst");
+    printf("%-28s %9s %11s %8s %10s\n", "Phase", "Start", "Converged", "Changes", "BPDUs");
+    for (i = 0; i < g_sim_phase_count; i++)
+    {
+        phase = &g_sim_phases[i];
+        printf("%-28s %8.1fs %10.1fs %8u %10" PRIu64 "\n", phase->label,
+                (double)phase->start_tick / SIM_TICKS_PER_SEC,
+                (double)(phase->last_change_tick - phase->start_tick) / SIM_TICKS_PER_SEC,
+                phase->changes, phase->bpdus);
+        bpdus += phase->bpdus;
+    }
+
+    up_parts = sim_count_parts(false, &up_links);
+    fwd_parts = sim_count_parts(true, &fwd_links);
+    //a spanning tree of each part: every bridge reachable, no loop
+    tree_ok = (fwd_parts == up_parts) && (fwd_links == g_sim_bridge_count - fwd_parts);
+    printf("\nspanning tree: %s, %d forwarding links, %d blocked, %d part(s)\n",
+            tree_ok ? "ok" : ((fwd_parts > up_parts) ? "PARTITIONED" : "LOOP"),
+            fwd_links, up_links - fwd_links, up_parts);
+
+    for (i = 0; i < g_sim_bridge_count; i++)
+    {
+        cpu_sum += g_sim_bridges[i].cpu_usec;
+        rss_sum += g_sim_bridges[i].maxrss_kb;
+        if (g_sim_bridges[i].cpu_usec > g_sim_bridges[cpu_max].cpu_usec)
+            cpu_max = i;
+        if (g_sim_bridges[i].maxrss_kb > g_sim_bridges[rss_max].maxrss_kb)
+            rss_max = i;
+    }
+
+    printf("bpdus: %" PRIu64 " sent, %.1f per bridge per second\n", bpdus,
+            (double)bpdus * SIM_TICKS_PER_SEC / ((double)g_sim_bridge_count * (g_sim_tick ? g_sim_tick : 1)));
+    printf("cpu per bridge: avg %.1f ms, max %.1f ms (%s)\n",
+            (double)cpu_sum / g_sim_bridge_count / 1000, (double)g_sim_bridges[cpu_max].cpu_usec / 1000,
+            g_sim_bridges[cpu_max].name);
+    printf("max rss per bridge: avg %" PRIu64 " KB, max %" PRIu64 " KB (%s)\n",
+            rss_sum / g_sim_bridge_count, g_sim_bridges[rss_max].maxrss_kb, g_sim_bridges[rss_max].name);
+    printf("simulated %.1fs in %.2fs\n", (double)g_sim_tick / SIM_TICKS_PER_SEC, (double)wall_usec / 1000000);
+
+    return tree_ok ? 0 : 2;
+}
+
+static void sim_usage(const char *prog)
+{
+    printf("usage: %s -t <topology> [-m pvst|mstp] [-s settle] [-T max] [-k sec] [-w pcap] [-v]\n", prog);
+    printf("  -t  topology file, or ring:<n>, leafspine:<leaves>:<spines>, mesh:<n>:<links>[:seed]\n");
+    printf("  -m  protocol (default pvst)\n");
+    printf("  -s  seconds without port state change to call a phase converged (default %u)\n",
+            SIM_DFLT_SETTLE_SEC);
+    printf("  -T  simulated seconds after which to stop (default %u)\n", SIM_DFLT_MAX_SEC);
+    printf("  -k  take the first link down at this simulated second\n");
+    printf("  -w  write the BPDUs sent over the links to a pcap file\n");
+    printf("  -v  print the port state changes\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *topology = NULL;
+    const char *pcap = NULL;
+    uint32_t settle_ticks = SIM_DFLT_SETTLE_SEC * SIM_TICKS_PER_SEC;
+    uint32_t max_ticks = SIM_DFLT_MAX_SEC * SIM_TICKS_PER_SEC;
+    int kill_sec = -1;
+    uint16_t next_event = 0;
+    uint32_t last_change;
+    uint64_t start_usec;
+    int i, opt;
+
+    while ((opt = getopt(argc, argv, "t:m:s:T:k:w:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': topology = optarg; break;
+            case 'm':
+                if (0 == strcmp(optarg, "mstp"))
+                    g_sim_mode = L2_MSTP;
+                else if (0 == strcmp(optarg, "pvst"))
+                    g_sim_mode = L2_PVSTP;
+                else
+                {
+                    sim_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 's': settle_ticks = strtoul(optarg, NULL, 0) * SIM_TICKS_PER_SEC; break;
+            case 'T': max_ticks = strtoul(optarg, NULL, 0) * SIM_TICKS_PER_SEC; break;
+            case 'k': kill_sec = strtol(optarg, NULL, 0); break;
+            case 'w': pcap = optarg; break;
+            case 'v': g_sim_verbose = true; break;
+            default:
+                sim_usage(argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if (!topology || !settle_ticks)
+    {
+        sim_usage(argv[0]);
+        return 1;
+    }
+
+    STP_LOG_SET_LEVEL(APP_LOG_LEVEL_ERR);
+    signal(SIGPIPE, SIG_IGN);
+
+    g_sim_bridges = calloc(SIM_MAX_BRIDGES, sizeof(SIM_BRIDGE));
+    g_sim_links = calloc(SIM_MAX_LINKS, sizeof(SIM_LINK));
+    if (!g_sim_bridges || !g_sim_links)
+        return 1;
+
+    if (0 == access(topology, R_OK) ? sim_load_file(topology) < 0 : sim_generate(topology) < 0)
+        return 1;
+
+    if (g_sim_bridge_count < 2 || !g_sim_link_count)
+    {
+        fprintf(stderr, "topology needs two bridges and a link\n");
+        return 1;
+    }
+
+    if (kill_sec >= 0 && sim_add_event(kill_sec, 0, false) < 0)
+        return 1;
+
+    start_usec = stptimer_prof_usec();
+    sim_start_phase("start");
+    if (sim_spawn() < 0)
+        return 1;
+
+    //after the fork, the bridge processes must not flush its buffer
+    if (pcap && sim_pcap_open(pcap) < 0)
+        return 1;
+
+    //configuration done, bridges start sending
+    sim_sync_all();
+    sim_exchange();
+
+    for (g_sim_tick = 1; g_sim_tick <= max_ticks; g_sim_tick++)
+    {
+        while (next_event < g_sim_event_count && g_sim_events[next_event].tick <= g_sim_tick)
+            sim_apply_event(&g_sim_events[next_event++]);
+
+        for (i = 0; i < g_sim_bridge_count; i++)
+            sim_send_cmd(i, SIM_MSG_TICK, 0, 0);
+        sim_sync_all();
+        sim_exchange();
+
+        last_change = g_sim_phases[g_sim_phase_count - 1].last_change_tick;
+        if (next_event == g_sim_event_count && g_sim_tick - last_change >= settle_ticks)
+            break;
+    }
+
+    if (g_sim_tick > max_ticks)
+    {
+        g_sim_tick = max_ticks;
+        printf("not converged after %us\n", max_ticks / SIM_TICKS_PER_SEC);
+    }
+
+    sim_quit_all();
+    if (g_sim_pcap)
+        fclose(g_sim_pcap);
+    return sim_report(topology, stptimer_prof_usec() - start_usec);
+}
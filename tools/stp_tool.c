@@ -0,0 +1,365 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include "stp_tool.h"
+
+STP_TOOL_TX_FN *g_stp_tool_tx_fn;
+
+static STP_TOOL_BRIDGE g_stp_tool_bridge;
+static INTERFACE_NODE *g_stp_tool_nodes[STP_TOOL_MAX_PORTS];
+static uint16_t g_stp_tool_pvst_instances;
+static int g_stp_tool_ipc_fd[2] = { -1, -1 };
+
+/* link time replacements (-Wl,--wrap) ------------------------------------- */
+
+int __wrap_stp_pkt_tx_handler(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged)
+{
+    STPD_INCR_PKT_COUNT(port_id, pkt_tx);
+    if (g_stp_tool_tx_fn)
+        g_stp_tool_tx_fn(port_id, vlan_id, buffer, size, tagged);
+    return 0;
+}
+
+//no packet socket, frames are handed to stp_tool_rx()
+int __wrap_stp_pkt_sock_create(INTERFACE_NODE *intf_node)
+{
+    intf_node->sock = 0;
+    intf_node->ev = NULL;
+    return 0;
+}
+
+void __wrap_stp_pkt_sock_close(INTERFACE_NODE *intf_node)
+{
+}
+
+//several tools may run at once, none of them owns /dev/shm/stpd_stats
+void __wrap_stp_shm_publish()
+{
+}
+
+//kernel bridge vlan programming (bridge vlan add/del)
+int __wrap_system(const char *command)
+{
+    return 0;
+}
+
+/* harness ------------------------------------------------------------------ */
+
+void stp_tool_bridge_init(STP_TOOL_BRIDGE *bridge)
+{
+    memset(bridge, 0, sizeof(STP_TOOL_BRIDGE));
+    bridge->mode = L2_PVSTP;
+    bridge->priority = STP_DFLT_PRIORITY;
+    bridge->vlan = 1;
+    bridge->max_instances = STP_TOOL_MAX_INSTANCES;
+    bridge->forward_delay = STP_DFLT_FORWARD_DELAY;
+    bridge->hello_time = STP_DFLT_HELLO_TIME;
+    bridge->max_age = STP_DFLT_MAX_AGE;
+}
+
+/*
+ * hands one message to stpmgr_recv_client_msg() through a datagram socket
+ * pair, so that it takes the same path as a message from stpmgrd.
+ */
+void stp_tool_ipc(STP_MSG_TYPE msg_type, L2_PROTO_MODE mode, void *data, uint32_t len)
+{
+    STP_IPC_MSG *msg;
+
+    msg = calloc(1, sizeof(STP_IPC_MSG) + len);
+    if (!msg)
+    {
+        fprintf(stderr, "ipc msg alloc failed\n");
+        exit(1);
+    }
+
+    msg->msg_type = msg_type;
+    msg->msg_len = len;
+    msg->proto_mode = mode;
+    memcpy(msg->data, data, len);
+
+    if (send(g_stp_tool_ipc_fd[1], msg, sizeof(STP_IPC_MSG) + len, 0) < 0)
+    {
+        fprintf(stderr, "ipc send failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    free(msg);
+
+    stpmgr_recv_client_msg(g_stp_tool_ipc_fd[0], EV_READ, NULL);
+}
+
+static void stp_tool_ifname(uint32_t port_id, char *ifname)
+{
+    snprintf(ifname, IFNAMSIZ, "Ethernet%u", port_id);
+}
+
+//what stp_intf_event_mgr_init() does from the netlink dump
+static int stp_tool_intf_init(uint16_t ports)
+{
+    netlink_db_t if_db;
+    uint32_t port_id;
+
+    g_stpd_intf_db = avl_create(&stp_intf_avl_compare, NULL, &g_stpd_intf_avl_allocator.avl_alloc);
+    g_stpd_mst_info_db = avl_create(&stp_intf_mst_info_avl_compare, NULL, &g_stpd_intf_avl_allocator.avl_alloc);
+    if (!g_stpd_intf_db || !g_stpd_mst_info_db)
+        return -1;
+
+    g_max_stp_port = 0;
+    for (port_id = 0; port_id < ports; port_id++)
+    {
+        memset(&if_db, 0, sizeof(if_db));
+        stp_tool_ifname(port_id, if_db.ifname);
+        if_db.kif_index = STP_TOOL_KIF_BASE + port_id;
+        if_db.oper_state = 1;
+        stp_intf_netlink_cb(&if_db, 1, true);
+    }
+
+    g_max_stp_port = g_max_stp_port * 2;
+    stp_intf_init_port_stats();
+    if (-1 == stp_intf_init_po_id_pool())
+        return -1;
+    g_stpd_port_init_done = 1;
+
+    for (port_id = 0; port_id < ports; port_id++)
+        g_stp_tool_nodes[port_id] = stp_intf_get_node(port_id);
+
+    return 0;
+}
+
+static void stp_tool_pvst_config(STP_TOOL_BRIDGE *bridge)
+{
+    STP_PORT_CONFIG_MSG port_msg;
+    uint16_t i;
+
+    for (i = 0; i < bridge->ports; i++)
+    {
+        memset(&port_msg, 0, sizeof(port_msg));
+        port_msg.opcode = STP_SET_COMMAND;
+        stp_tool_ifname(i, port_msg.intf_name);
+        port_msg.enabled = 1;
+        port_msg.priority = -1;
+        stp_tool_ipc(STP_PORT_CONFIG, L2_PVSTP, &port_msg, sizeof(port_msg));
+    }
+}
+
+//one more pvst instance, all ports untagged members of the vlan
+static int stp_tool_pvst_vlan(STP_TOOL_BRIDGE *bridge, VLAN_ID vlan_id)
+{
+    STP_VLAN_CONFIG_MSG *vlan_msg;
+    STP_VLAN_PORT_CONFIG_MSG vlan_port_msg;
+    uint32_t len;
+    uint16_t i;
+
+    if (g_stp_tool_pvst_instances == bridge->max_instances)
+        return -1;
+
+    len = sizeof(STP_VLAN_CONFIG_MSG) + (bridge->ports * sizeof(PORT_ATTR));
+    vlan_msg = calloc(1, len);
+    if (!vlan_msg)
+    {
+        fprintf(stderr, "vlan msg alloc failed\n");
+        exit(1);
+    }
+
+    vlan_msg->opcode = STP_SET_COMMAND;
+    vlan_msg->newInstance = 1;
+    vlan_msg->vlan_id = vlan_id;
+    vlan_msg->inst_id = g_stp_tool_pvst_instances;
+    vlan_msg->forward_delay = bridge->forward_delay;
+    vlan_msg->hello_time = bridge->hello_time;
+    vlan_msg->max_age = bridge->max_age;
+    vlan_msg->priority = bridge->priority;
+    vlan_msg->count = bridge->ports;
+    for (i = 0; i < bridge->ports; i++)
+    {
+        stp_tool_ifname(i, vlan_msg->port_list[i].intf_name);
+        vlan_msg->port_list[i].mode = 0;
+        vlan_msg->port_list[i].enabled = 1;
+    }
+    stp_tool_ipc(STP_VLAN_CONFIG, L2_PVSTP, vlan_msg, len);
+    free(vlan_msg);
+
+    for (i = 0; bridge->path_cost && i < bridge->ports; i++)
+    {
+        if (!bridge->path_cost[i])
+            continue;
+
+        memset(&vlan_port_msg, 0, sizeof(vlan_port_msg));
+        vlan_port_msg.opcode = STP_SET_COMMAND;
+        vlan_port_msg.vlan_id = vlan_id;
+        stp_tool_ifname(i, vlan_port_msg.intf_name);
+        vlan_port_msg.inst_id = g_stp_tool_pvst_instances;
+        vlan_port_msg.path_cost = bridge->path_cost[i];
+        vlan_port_msg.priority = -1;
+        stp_tool_ipc(STP_VLAN_PORT_CONFIG, L2_PVSTP, &vlan_port_msg, sizeof(vlan_port_msg));
+    }
+
+    g_stp_tool_pvst_instances++;
+    return 0;
+}
+
+//maps the vlan, all ports untagged members, to the cist
+static void stp_tool_mstp_vlan(STP_TOOL_BRIDGE *bridge, VLAN_ID vlan_id)
+{
+    STP_MST_VLAN_PORT_MAP *vlan_msg;
+    uint32_t len;
+    uint16_t i;
+
+    len = sizeof(STP_MST_VLAN_PORT_MAP) + (bridge->ports * sizeof(PORT_LIST));
+    vlan_msg = calloc(1, len);
+    if (!vlan_msg)
+    {
+        fprintf(stderr, "vlan msg alloc failed\n");
+        exit(1);
+    }
+
+    vlan_msg->vlan_id = vlan_id;
+    vlan_msg->port_count = bridge->ports;
+    vlan_msg->stp_mode = L2_MSTP;
+    vlan_msg->add = 1;
+    for (i = 0; i < bridge->ports; i++)
+        stp_tool_ifname(i, vlan_msg->port_list[i].intf_name);
+    stp_tool_ipc(STP_MST_VLAN_PORT_LIST_CONFIG, L2_MSTP, vlan_msg, len);
+    free(vlan_msg);
+}
+
+static void stp_tool_mstp_config(STP_TOOL_BRIDGE *bridge)
+{
+    STP_MST_GLOBAL_CONFIG_MSG global_msg;
+    STP_PORT_CONFIG_MSG port_msg;
+    struct
+    {
+        STP_MST_INSTANCE_CONFIG_MSG hdr;
+        MST_INST_CONFIG_MSG cist;
+    } __attribute__((packed)) inst_msg;
+    uint16_t i;
+
+    memset(&global_msg, 0, sizeof(global_msg));
+    global_msg.opcode = STP_SET_COMMAND;
+    strncpy(global_msg.name, "stp-tool", sizeof(global_msg.name) - 1);
+    global_msg.forward_delay = bridge->forward_delay;
+    global_msg.hello_time = bridge->hello_time;
+    global_msg.max_age = bridge->max_age;
+    stp_tool_ipc(STP_MST_GLOBAL_CONFIG, L2_MSTP, &global_msg, sizeof(global_msg));
+
+    memset(&inst_msg, 0, sizeof(inst_msg));
+    inst_msg.hdr.mst_count = 1;
+    inst_msg.cist.opcode = STP_SET_COMMAND;
+    inst_msg.cist.mst_id = MSTP_MSTID_CIST;
+    inst_msg.cist.priority = bridge->priority;
+    stp_tool_ipc(STP_MST_INST_CONFIG, L2_MSTP, &inst_msg, sizeof(inst_msg));
+
+    stp_tool_mstp_vlan(bridge, bridge->vlan);
+
+    for (i = 0; i < bridge->ports; i++)
+    {
+        memset(&port_msg, 0, sizeof(port_msg));
+        port_msg.opcode = STP_SET_COMMAND;
+        stp_tool_ifname(i, port_msg.intf_name);
+        port_msg.enabled = 1;
+        port_msg.link_type = POINT_TO_POINT;
+        port_msg.priority = -1;
+        port_msg.path_cost = bridge->path_cost ? bridge->path_cost[i] : 0;
+        stp_tool_ipc(STP_PORT_CONFIG, L2_MSTP, &port_msg, sizeof(port_msg));
+    }
+}
+
+/*
+ * sets up the daemon state as stpd_main() and the STP_INIT_READY message do,
+ * then enables the protocol on every port.
+ */
+int stp_tool_init(STP_TOOL_BRIDGE *bridge)
+{
+    STP_BRIDGE_CONFIG_MSG bridge_msg;
+
+    if (!bridge->ports || bridge->ports > STP_TOOL_MAX_PORTS)
+    {
+        fprintf(stderr, "invalid port count %u, 1 to %u\n", bridge->ports, STP_TOOL_MAX_PORTS);
+        return -1;
+    }
+
+    if (!bridge->max_instances)
+    {
+        fprintf(stderr, "invalid instance count 0\n");
+        return -1;
+    }
+
+    memcpy(&g_stp_tool_bridge, bridge, sizeof(STP_TOOL_BRIDGE));
+    memset(&stpd_context, 0, sizeof(STPD_CONTEXT));
+    g_stpd_tick_stats.overrun_msec = STPD_TICK_DFLT_OVERRUN_MSEC;
+    stpmgr_set_extend_mode(true);
+
+    g_stpd_evbase = event_base_new();
+    if (!g_stpd_evbase)
+        return -1;
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, g_stp_tool_ipc_fd) < 0)
+        return -1;
+
+    if (stp_tool_intf_init(bridge->ports) < 0)
+        return -1;
+
+    stpmgr_init(bridge->max_instances);
+    if (!mstpmgr_init())
+        return -1;
+
+    memset(&bridge_msg, 0, sizeof(bridge_msg));
+    bridge_msg.opcode = STP_SET_COMMAND;
+    bridge_msg.stp_mode = bridge->mode;
+    bridge_msg.rootguard_timeout = STP_DFLT_ROOT_PROTECT_TIMEOUT;
+    memcpy(bridge_msg.base_mac_addr, bridge->mac, L2_ETH_ADD_LEN);
+    stp_tool_ipc(STP_BRIDGE_CONFIG, bridge->mode, &bridge_msg, sizeof(bridge_msg));
+
+    if (bridge->mode == L2_MSTP)
+    {
+        stp_tool_mstp_config(bridge);
+        return 0;
+    }
+
+    stp_tool_pvst_config(bridge);
+    return stp_tool_pvst_vlan(bridge, bridge->vlan);
+}
+
+//a vlan not configured yet. pvst: a new instance, mstp: mapped to the cist
+int stp_tool_add_vlan(VLAN_ID vlan_id)
+{
+    if (!IS_VALID_VLAN(vlan_id))
+        return -1;
+
+    if (g_stp_tool_bridge.mode == L2_MSTP)
+    {
+        stp_tool_mstp_vlan(&g_stp_tool_bridge, vlan_id);
+        return 0;
+    }
+
+    return stp_tool_pvst_vlan(&g_stp_tool_bridge, vlan_id);
+}
+
+//one received frame, vlan tag already removed as by the packet socket
+void stp_tool_rx(uint32_t port_id, VLAN_ID vlan_id, char *pkt, uint16_t len)
+{
+    INTERFACE_NODE *node;
+
+    if (port_id >= STP_TOOL_MAX_PORTS || !(node = g_stp_tool_nodes[port_id]))
+        return;
+
+    stp_pkt_rx_process(node, node->kif_index, vlan_id, 0, pkt, len);
+}
+
+void stp_tool_tick()
+{
+    stptimer_100ms_tick(-1, EV_TIMEOUT, NULL);
+}
+
+//link change as netlink reports it
+void stp_tool_port_event(uint32_t port_id, bool up)
+{
+    netlink_db_t if_db;
+
+    memset(&if_db, 0, sizeof(if_db));
+    stp_tool_ifname(port_id, if_db.ifname);
+    if_db.kif_index = STP_TOOL_KIF_BASE + port_id;
+    if_db.oper_state = up;
+    stp_intf_netlink_cb(&if_db, 1, false);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#ifndef __STP_TOOL_H__
+#define __STP_TOOL_H__
+
+#include "stp_inc.h"
+
+/*
+ * Harness for the programs of tools/: runs one stpd bridge in the calling
+ * process without netlink, packet sockets, redis or the kernel bridge.
+ *
+ * The interface db is filled with Ethernet0 .. Ethernet<ports - 1>, all up,
+ * and the bridge is configured with the same ipc messages stpmgrd sends.
+ * Time only moves when stp_tool_tick() is called. The programs are linked
+ * with -Wl,--wrap for stp_pkt_tx_handler, stp_pkt_sock_create,
+ * stp_pkt_sock_close, stp_shm_publish and system (see tools/Makefile.am),
+ * transmitted BPDUs go to g_stp_tool_tx_fn.
+ *
+ * libstp keeps its state in globals, there is one bridge per process.
+ */
+
+#define STP_TOOL_MAX_PORTS          512
+#define STP_TOOL_MAX_INSTANCES      16
+#define STP_TOOL_KIF_BASE           1000    //kernel ifindex of Ethernet0
+
+//classic libpcap file format, as written by tcpdump
+#define STP_TOOL_PCAP_MAGIC         0xa1b2c3d4
+#define STP_TOOL_PCAP_MAGIC_NSEC    0xa1b23c4d
+#define STP_TOOL_PCAP_ETHERNET      1       //link type
+#define STP_TOOL_PCAP_SNAPLEN       65535
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+} STP_TOOL_PCAP_HDR;
+
+typedef struct
+{
+    uint32_t ts_sec;
+    uint32_t ts_frac;                   //usec, nsec for STP_TOOL_PCAP_MAGIC_NSEC
+    uint32_t incl_len;
+    uint32_t orig_len;
+} STP_TOOL_PCAP_REC;
+
+typedef void (STP_TOOL_TX_FN)(uint32_t port_id, VLAN_ID vlan_id, char *buffer, uint16_t size, bool tagged);
+typedef void (STP_TOOL_STATE_FN)(char *ifname, uint16_t instance, uint8_t state);
+
+typedef struct
+{
+    L2_PROTO_MODE mode;
+    uint16_t ports;
+    uint8_t mac[L2_ETH_ADD_LEN];
+    uint16_t priority;
+    VLAN_ID vlan;                       //all ports are untagged members
+    uint16_t max_instances;             //pvst: vlan and those of stp_tool_add_vlan()
+    uint8_t forward_delay;
+    uint8_t hello_time;
+    uint8_t max_age;
+    uint32_t *path_cost;                //per port, 0 for the default, may be NULL
+} STP_TOOL_BRIDGE;
+
+//set by the program, called for every transmitted BPDU
+extern STP_TOOL_TX_FN *g_stp_tool_tx_fn;
+//called from the stpsync_update_port_state() stub
+extern STP_TOOL_STATE_FN *g_stp_tool_state_fn;
+
+extern void stp_tool_bridge_init(STP_TOOL_BRIDGE *bridge);
+extern int stp_tool_init(STP_TOOL_BRIDGE *bridge);
+extern int stp_tool_add_vlan(VLAN_ID vlan_id);
+extern void stp_tool_ipc(STP_MSG_TYPE msg_type, L2_PROTO_MODE mode, void *data, uint32_t len);
+extern void stp_tool_rx(uint32_t port_id, VLAN_ID vlan_id, char *pkt, uint16_t len);
+extern void stp_tool_tick();
+extern void stp_tool_port_event(uint32_t port_id, bool up);
+
+#endif //__STP_TOOL_H__
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2025 Broadcom. All rights reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ */
+
+#include "stp_tool.h"
+
+/*
+ * The stpsync_* C API of stpsync/stp_sync.cpp for the programs of tools/,
+ * which link libstp.a without swss and redis. Nothing is written anywhere,
+ * port state changes are passed to g_stp_tool_state_fn.
+ */
+
+#define STP_TOOL_PORT_SPEED     10000   //Mbps, reported for every port
+
+STP_TOOL_STATE_FN *g_stp_tool_state_fn;
+
+void stpsync_add_vlan_to_instance(uint16_t vlan_id, uint16_t instance)
+{
+}
+
+void stpsync_del_vlan_from_instance(uint16_t vlan_id, uint16_t instance)
+{
+}
+
+void stpsync_update_stp_class(STP_VLAN_TABLE *stp_vlan)
+{
+}
+
+void stpsync_del_stp_class(uint16_t vlan_id)
+{
+}
+
+void stpsync_update_port_class(STP_VLAN_PORT_TABLE *stp_vlan_intf)
+{
+}
+
+void stpsync_del_port_class(char *if_name, uint16_t vlan_id)
+{
+}
+
+void stpsync_update_port_state(char *ifName, uint16_t instance, uint8_t state)
+{
+    if (g_stp_tool_state_fn)
+        g_stp_tool_state_fn(ifName, instance, state);
+}
+
+void stpsync_del_port_state(char *ifName, uint16_t instance)
+{
+}
+
+void stpsync_update_vlan_port_state(char *ifName, uint16_t vlan_id, uint8_t state)
+{
+}
+
+void stpsync_del_vlan_port_state(char *ifName, uint16_t vlan_id)
+{
+}
+
+void stpsync_update_fastage_state(uint16_t vlan_id, bool add)
+{
+}
+
+uint32_t stpsync_get_port_speed(char *ifName)
+{
+    return STP_TOOL_PORT_SPEED;
+}
+
+void stpsync_update_port_admin_state(char *ifName, bool up, bool physical)
+{
+}
+
+void stpsync_update_bpdu_guard_shutdown(char *ifName, bool enabled)
+{
+}
+
+void stpsync_del_stp_port(char *ifName)
+{
+}
+
+void stpsync_update_port_fast(char *ifName, bool enabled)
+{
+}
+
+void stpsync_clear_appdb_stp_tables(void)
+{
+}
+
+void stpsync_update_mst_info(STP_MST_TABLE *stp_mst)
+{
+}
+
+void stpsync_del_mst_info(uint16_t mst_id)
+{
+}
+
+void stpsync_update_mst_port_info(STP_MST_PORT_TABLE *stp_mst_intf)
+{
+}
+
+void stpsync_del_mst_port_info(char *if_name, uint16_t mst_id)
+{
+}
+
+void stpsync_update_boundary_port(char *ifName, bool enabled, char *proto)
+{
+}
+
+void stpsync_flush_instance_port(char *ifName, uint16_t instance)
+{
+}
+
+void stpsync_set_buffered(bool buffered)
+{
+}
+
+void stpsync_flush(void)
+{
+}